@@ -2,6 +2,7 @@
 #include <opencv2/opencv.hpp>
 #include <iostream>
 #include <vector>
+#include "Final Test Codes/Common/DiagnosticLog.h"
 
 int main() {
     // Initialize Kinect Sensor, readers, and coordinate mapper
@@ -78,8 +79,8 @@ int main() {
                                         int x = static_cast<int>(colorPoint.X);
                                         int y = static_cast<int>(colorPoint.Y);
 
-                                        // Debugging output
-                                        std::cout << "Joint " << j << " -> X: " << x << ", Y: " << y << std::endl;
+                                        // Debugging output, build with DIAGNOSTIC_LEVEL=0 to see it
+                                        DIAG_DEBUG("Joint {} -> X: {}, Y: {}", j, x, y);
 
                                         if (x > 0 && x < width && y > 0 && y < height) {
                                             jointPoints.push_back(cv::Point(x, y));
@@ -0,0 +1,143 @@
+//Checks the conversion kernels of Common/ColorConvert.h
+//
+//  ColorConvertCheck.exe
+//
+//the SIMD rows must give the same bytes as the scalar rows, for every alignment of the row tail. With OpenCV the
+//full resolution conversion is compared with cv::cvtColor(COLOR_YUV2BGR_YUY2), the half size image with
+//cvtColor followed by resize(INTER_AREA), and the downscaled BGRA conversion with cvtColor(COLOR_BGRA2BGR) followed
+//by resize(INTER_AREA). Exit code 1 when a check fails.
+#include "../Common/ColorConvert.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool passed, const char* what) {
+    std::cout << (passed ? "ok    " : "FAIL  ") << what << std::endl;
+    if (!passed) ++failures;
+}
+
+static std::vector<uint8_t> randomYuy2(int width, int height, unsigned seed) {
+    std::mt19937 random(seed);
+    std::vector<uint8_t> frame(static_cast<size_t>(width) * height * 2);
+    for (uint8_t& value : frame) value = static_cast<uint8_t>(random() & 0xFF);
+    return frame;
+}
+
+#if __has_include(<opencv2/opencv.hpp>)
+//slowly varying y, u and v, like a camera image
+static std::vector<uint8_t> smoothYuy2(int width, int height) {
+    std::vector<uint8_t> frame(static_cast<size_t>(width) * height * 2);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint8_t* pixel = &frame[(static_cast<size_t>(y) * width + x) * 2];
+            pixel[0] = static_cast<uint8_t>(126 + 100 * std::sin(x * 0.01 + y * 0.02));
+            int pair = x & ~1;
+            pixel[1] = static_cast<uint8_t>((x & 1) ? 128 + 90 * std::cos(pair * 0.007 - y * 0.01) : 128 + 90 * std::sin(pair * 0.005 + y * 0.013));
+        }
+    }
+    return frame;
+}
+#endif
+
+int main() {
+    //every value of y, u and v once
+    bool allValues = true;
+    for (int y = 0; y < 256 && allValues; ++y) {
+        for (int u = 0; u < 256; ++u) {
+            uint8_t row[32], simd[48], scalar[48];
+            for (int v0 = 0; v0 < 256; v0 += 8) {
+                for (int p = 0; p < 8; ++p) {
+                    row[p * 4 + 0] = static_cast<uint8_t>(y);
+                    row[p * 4 + 1] = static_cast<uint8_t>(u);
+                    row[p * 4 + 2] = static_cast<uint8_t>(255 - y);
+                    row[p * 4 + 3] = static_cast<uint8_t>(v0 + p);
+                }
+                yuy2ToBgrRow(row, simd, 16);
+                yuy2ToBgrRowScalar(row, scalar, 16);
+                if (std::memcmp(simd, scalar, sizeof(simd)) != 0) allValues = false;
+            }
+        }
+    }
+    check(allValues, "yuy2ToBgrRow equals the scalar row for all y, u, v");
+
+    bool rows = true, halfRows = true;
+    for (int width = 2; width <= 64; width += 2) {
+        std::vector<uint8_t> frame = randomYuy2(width, 2, width);
+        std::vector<uint8_t> simd(width * 3), scalar(width * 3);
+        yuy2ToBgrRow(frame.data(), simd.data(), width);
+        yuy2ToBgrRowScalar(frame.data(), scalar.data(), width);
+        if (simd != scalar) rows = false;
+        yuy2ToBgrHalfRow(frame.data(), frame.data() + width * 2, simd.data(), width / 2);
+        yuy2ToBgrHalfRowScalar(frame.data(), frame.data() + width * 2, scalar.data(), width / 2);
+        if (!std::equal(simd.begin(), simd.begin() + width / 2 * 3, scalar.begin())) halfRows = false;
+    }
+    check(rows, "yuy2ToBgrRow equals the scalar row for widths 2..64");
+    check(halfRows, "yuy2ToBgrHalfRow equals the scalar row for widths 2..64");
+
+    bool scaledRows = true;
+    for (int divisor = 1; divisor <= 4; ++divisor) {
+        for (int outputWidth = 1; outputWidth <= 40; ++outputWidth) {
+            std::vector<uint8_t> frame = randomYuy2(outputWidth * divisor * 2, divisor, outputWidth + 100 * divisor);
+            const uint8_t* rows[MaxScaleDivisor];
+            for (int r = 0; r < divisor; ++r) rows[r] = &frame[static_cast<size_t>(r) * outputWidth * divisor * 4];
+            std::vector<uint8_t> simd(outputWidth * 3 + 16, 0), scalar(outputWidth * 3 + 16, 0);
+            bgraToBgrScaledRow(rows, divisor, simd.data(), outputWidth);
+            bgraToBgrScaledRowScalar(rows, divisor, scalar.data(), outputWidth);
+            if (simd != scalar) scaledRows = false;
+        }
+    }
+    check(scaledRows, "bgraToBgrScaledRow equals the scalar row for divisors 1..4, nothing written past the row");
+
+#if __has_include(<opencv2/opencv.hpp>)
+    const int width = 1920, height = 1080;
+    std::vector<uint8_t> frame = randomYuy2(width, height, 1);
+    cv::Mat yuy2(height, width, CV_8UC2, frame.data());
+
+    cv::Mat reference, converted;
+    cv::cvtColor(yuy2, reference, cv::COLOR_YUV2BGR_YUY2);
+    convertYuy2ToBgr(yuy2, cv::Rect(0, 0, width, height), converted);
+    double fullDifference = cv::norm(reference, converted, cv::NORM_INF);
+    std::cout << "      full frame, largest difference to cvtColor " << fullDifference << std::endl;
+    check(fullDifference <= 1, "convertYuy2ToBgr within one level of cvtColor");
+
+    cv::Mat region;
+    cv::Rect roi = convertYuy2ToBgr(yuy2, cv::Rect(861, 401, 199, 49), region);
+    check(roi == cv::Rect(860, 401, 200, 49) && cv::norm(reference(roi), region, cv::NORM_INF) <= 1,
+        "convertYuy2ToBgr region widened to pixel pairs and equal to the same part of the frame");
+
+    //a smooth image, on noise the order of averaging and converting decides more than the kernel
+    std::vector<uint8_t> smoothFrame = smoothYuy2(width, height);
+    cv::Mat smooth(height, width, CV_8UC2, smoothFrame.data());
+    cv::Mat smoothReference, areaReference, half;
+    cv::cvtColor(smooth, smoothReference, cv::COLOR_YUV2BGR_YUY2);
+    cv::resize(smoothReference, areaReference, cv::Size(width / 2, height / 2), 0, 0, cv::INTER_AREA);
+    convertYuy2ToBgrHalf(smooth, half);
+    double halfDifference = cv::norm(areaReference, half, cv::NORM_INF);
+    std::cout << "      half frame, largest difference to cvtColor + INTER_AREA " << halfDifference << std::endl;
+    check(half.size() == cv::Size(width / 2, height / 2) && halfDifference <= 4,
+        "convertYuy2ToBgrHalf within four levels of cvtColor + resize(INTER_AREA)");
+
+    //a BGRA frame at 1/2 and 1/3, INTER_AREA at an integer factor is the same box mean
+    std::vector<uint8_t> bgraFrame = randomYuy2(width * 2, height, 2);
+    cv::Mat bgra(height, width, CV_8UC4, bgraFrame.data());
+    cv::Mat bgr;
+    cv::cvtColor(bgra, bgr, cv::COLOR_BGRA2BGR);
+    for (int divisor = 2; divisor <= 3; ++divisor) {
+        cv::Mat areaBgr, scaled;
+        cv::resize(bgr, areaBgr, cv::Size(width / divisor, height / divisor), 0, 0, cv::INTER_AREA);
+        convertBgraToBgrScaled(bgra, divisor, scaled);
+        double scaledDifference = cv::norm(areaBgr, scaled, cv::NORM_INF);
+        std::cout << "      BGRA at 1/" << divisor << ", largest difference to cvtColor + INTER_AREA " << scaledDifference << std::endl;
+        check(scaledDifference <= 1, "convertBgraToBgrScaled within one level of cvtColor + resize(INTER_AREA)");
+    }
+#else
+    std::cout << "      built without OpenCV, the comparison with cvtColor is skipped" << std::endl;
+#endif
+
+    return failures == 0 ? 0 : 1;
+}
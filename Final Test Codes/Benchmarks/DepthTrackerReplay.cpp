@@ -0,0 +1,226 @@
+//Replays synthetic walking speed sessions through DepthPersonTracker and the old center pixel depth
+//reports, per distance band, how often each method sees the walker and its error against the SpineMid depth, and how
+//many frames late (or early) each method passes the WS start (6.5-6.8 m) and stop (1.5-1.6 m) gates, and the walking
+//speed from the gate time against the steady speed of WalkingSpeedEstimator.h, both on the tracker depth
+//every frame is also timed, with frames made to be the worst case (all of the grid foreground in one sheet, in noise
+//that splits it into thousands of blobs); a frame is timed as the fastest of three runs on copies of the tracker, so a
+//preemption of the replay is not counted as tracker work. Exit code 1 when any frame is over the 2 ms WS budget.
+//
+//  DepthTrackerReplay.exe [sessions]
+#include "../Common/SyntheticMotion.h"
+#include "../Common/DepthPersonTracker.h"
+#include "../Common/WalkingSpeedEstimator.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+//the WS frame budget of the tracker, the frames over it are what a station would see as stutter
+static const double budgetMs = 2.0;
+
+//tracker time of one frame (ms), the fastest of three runs on copies; the tracker itself then takes the frame
+static double timedUpdate(DepthPersonTracker& tracker, const UINT16* depth) {
+    double fastest = 1e9;
+    for (int run = 0; run < 3; ++run) {
+        DepthPersonTracker trial = tracker;
+        auto begin = std::chrono::steady_clock::now();
+        trial.update(depth);
+        fastest = std::min(fastest, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+    }
+    tracker.update(depth);
+    return fastest;
+}
+
+//the distance bands of the report (m)
+static const float bandEdges[] = { 0.5f, 2.0f, 4.5f, 6.5f, 8.0f };
+static const int bandCount = 4;
+
+static int band(float z) {
+    for (int b = 0; b < bandCount; ++b) {
+        if (z >= bandEdges[b] && z < bandEdges[b + 1]) return b;
+    }
+    return -1;
+}
+
+struct MethodStats {
+    long seen[bandCount] = { 0 };
+    double absError[bandCount] = { 0 };
+    long gateFrames = 0, gateMisses = 0;
+    int maxGateError = 0;
+
+    void add(float truth, float measured) {
+        int b = band(truth);
+        if (b < 0 || measured <= 0.0f) return;
+        ++seen[b];
+        absError[b] += std::fabs(measured - truth);
+    }
+};
+
+//first frame at which the depth is inside [low, high] after start, -1 if never
+struct GateCrossing {
+    int start = -1, stop = -1;
+
+    void observe(float depth, int frame) {
+        if (start < 0 && depth >= 6.5f && depth <= 6.8f) start = frame;
+        if (start >= 0 && stop < 0 && depth >= 1.5f && depth <= 1.6f) stop = frame;
+    }
+};
+
+static void scoreGates(const GateCrossing& truth, const GateCrossing& measured, MethodStats& stats) {
+    const int truthFrames[] = { truth.start, truth.stop };
+    const int measuredFrames[] = { measured.start, measured.stop };
+    for (int g = 0; g < 2; ++g) {
+        if (truthFrames[g] < 0) continue;
+        if (measuredFrames[g] < 0) {
+            ++stats.gateMisses;
+            continue;
+        }
+        int error = std::abs(measuredFrames[g] - truthFrames[g]);
+        stats.gateFrames += error;
+        stats.maxGateError = std::max(stats.maxGateError, error);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int sessions = argc > 1 ? std::max(1, std::atoi(argv[1])) : 20;
+    const int emptyFrames = 30;         //the corridor is empty when the test is started
+    const float bodyRange = 4.5f;       //skeleton reported only nearer than this
+
+    const SyntheticIntrusion intrusions[] = { Intrusion_None, Intrusion_Bystander };
+    const char* intrusionNames[] = { "walker only", "bystander" };
+
+    std::vector<UINT16> depth(SyntheticMotionGenerator::depthWidth * SyntheticMotionGenerator::depthHeight);
+    std::vector<double> frameMs;
+
+    for (int scene = 0; scene < 2; ++scene) {
+        MethodStats center, tracker;
+        double gateSpeedError = 0.0, estimatorSpeedError = 0.0, maxEstimatorError = 0.0;
+        int gateSpeeds = 0, estimatorSpeeds = 0;
+        long truthFrames[bandCount] = { 0 };
+        for (int s = 0; s < sessions; ++s) {
+            SyntheticParams params;
+            params.scenario = Scenario_WalkingSpeed;
+            params.seed = 1000 + s;
+            params.walkSpeed = 0.6f + 0.05f * (s % 12);
+            params.walkOffset = 0.1f * (s % 5);    //walkers do not keep to the optical axis
+            params.cameraHeight = 1.0f;     //the center pixel on the torso, as on the WS stand
+            params.intrusion = intrusions[scene];
+            params.intrusionStart = 2.0f;
+            params.intrusionDuration = 4.0f;
+            SyntheticMotionGenerator generator(params);
+            DepthPersonTracker depthTracker;
+            GateCrossing truthGates, centerGates, trackerGates;
+            WalkingSpeedEstimator speed;
+
+            SyntheticFrame frame;
+            SyntheticFrame empty;
+            std::memset(&empty, 0, sizeof(empty));
+            for (int f = 0; f < emptyFrames; ++f) {
+                generator.renderDepth(empty, depth.data());
+                depthTracker.update(depth.data());
+            }
+
+            while (generator.next(frame)) {
+                generator.renderDepth(frame, depth.data());
+                const SyntheticBody& walker = frame.bodies[frame.participantIndex];
+                float truth = walker.joints[JointType_SpineMid].Position.Z;
+
+                frameMs.push_back(timedUpdate(depthTracker, depth.data()));
+
+                bool bodyTracked = truth < bodyRange;
+                float fused = depthTracker.handoff(walker.joints[JointType_SpineMid].Position, bodyTracked);
+                float centerDepth = depth[(SyntheticMotionGenerator::depthHeight / 2) * SyntheticMotionGenerator::depthWidth
+                    + SyntheticMotionGenerator::depthWidth / 2] * 0.001f;
+
+                int b = band(truth);
+                if (b >= 0) ++truthFrames[b];
+                //the old loop sees "the walker" whenever the center pixel is nearer than the back wall
+                center.add(truth, centerDepth < 7.9f ? centerDepth : 0.0f);
+                tracker.add(truth, fused);
+                truthGates.observe(truth, frame.frameIndex);
+                centerGates.observe(centerDepth, frame.frameIndex);
+                trackerGates.observe(fused, frame.frameIndex);
+                if (fused > 0.0f) speed.add(frame.relativeTime * 1e-7, fused);
+            }
+            if (trackerGates.start >= 0 && trackerGates.stop >= 0) {
+                //the walker covers about 6.8 - 1.6 m between the first frames inside the two gates
+                float gateSpeed = 5.2f / ((trackerGates.stop - trackerGates.start) / 30.0f);
+                gateSpeedError += std::fabs(gateSpeed - params.walkSpeed);
+                ++gateSpeeds;
+            }
+            if (speed.hasSteadySpeed()) {
+                double error = std::fabs(speed.steadySpeed() - params.walkSpeed);
+                estimatorSpeedError += error;
+                maxEstimatorError = std::max(maxEstimatorError, error);
+                ++estimatorSpeeds;
+            }
+            scoreGates(truthGates, centerGates, center);
+            scoreGates(truthGates, trackerGates, tracker);
+        }
+
+        std::cout << intrusionNames[scene] << ", " << sessions << " sessions" << std::endl;
+        std::cout << std::left << std::setw(18) << "Band (m)" << std::right << std::setw(16) << "Center seen %"
+            << std::setw(16) << "Center err cm" << std::setw(16) << "Tracker seen %" << std::setw(16) << "Tracker err cm" << std::endl;
+        for (int b = 0; b < bandCount; ++b) {
+            std::ostringstream name;
+            name << bandEdges[b] << " - " << bandEdges[b + 1];
+            double n = std::max(1L, truthFrames[b]);
+            std::cout << std::left << std::setw(18) << name.str() << std::right << std::fixed << std::setprecision(1)
+                << std::setw(16) << 100.0 * center.seen[b] / n
+                << std::setw(16) << (center.seen[b] ? 100.0 * center.absError[b] / center.seen[b] : 0.0)
+                << std::setw(16) << 100.0 * tracker.seen[b] / n
+                << std::setw(16) << (tracker.seen[b] ? 100.0 * tracker.absError[b] / tracker.seen[b] : 0.0) << std::endl;
+        }
+        std::cout << "Gate crossings off by (frames): center total " << center.gateFrames << " max " << center.maxGateError
+            << " missed " << center.gateMisses << ", tracker total " << tracker.gateFrames << " max " << tracker.maxGateError
+            << " missed " << tracker.gateMisses << std::endl;
+        std::cout << std::setprecision(3) << "Speed error (m/s): gate time mean " << gateSpeedError / std::max(1, gateSpeeds)
+            << " (" << gateSpeeds << " walks), steady speed mean " << estimatorSpeedError / std::max(1, estimatorSpeeds)
+            << " max " << maxEstimatorError << " (" << estimatorSpeeds << " walks)" << std::endl << std::endl;
+    }
+
+    //worst case: the corridor learned empty, then the whole grid in front of it, as one sheet and as noise
+    std::vector<double> stressMs;
+    {
+        SyntheticParams params;
+        params.scenario = Scenario_WalkingSpeed;
+        SyntheticMotionGenerator generator(params);
+        DepthPersonTracker depthTracker;
+        SyntheticFrame empty;
+        std::memset(&empty, 0, sizeof(empty));
+        for (int f = 0; f < emptyFrames; ++f) {
+            generator.renderDepth(empty, depth.data());
+            depthTracker.update(depth.data());
+        }
+        SyntheticRandom random;
+        random.seed(7);
+        for (int f = 0; f < 60; ++f) {
+            for (UINT16& d : depth) {
+                //even frames a sheet at 1.2 m, odd frames 1-2 m noise with a depth jump between most neighbours
+                d = static_cast<UINT16>(f % 2 ? 1000 + random.next() % 1000 : 1200 + random.next() % 20);
+            }
+            stressMs.push_back(timedUpdate(depthTracker, depth.data()));
+        }
+    }
+    std::sort(stressMs.begin(), stressMs.end());
+
+    std::sort(frameMs.begin(), frameMs.end());
+    double total = 0.0;
+    for (double ms : frameMs) total += ms;
+    size_t overBudget = frameMs.end() - std::upper_bound(frameMs.begin(), frameMs.end(), budgetMs);
+    size_t stressOverBudget = stressMs.end() - std::upper_bound(stressMs.begin(), stressMs.end(), budgetMs);
+    std::cout << std::fixed << std::setprecision(3) << "Tracker per frame: mean " << total / frameMs.size()
+        << " ms, p99 " << frameMs[frameMs.size() * 99 / 100] << " ms, p99.9 " << frameMs[frameMs.size() * 999 / 1000]
+        << " ms, worst " << frameMs.back() << " ms; over the " << budgetMs << " ms budget " << overBudget << " of "
+        << frameMs.size() << " frames" << std::endl;
+    std::cout << "All-foreground frames: median " << stressMs[stressMs.size() / 2] << " ms, worst " << stressMs.back()
+        << " ms; over the budget " << stressOverBudget << " of " << stressMs.size() << " frames" << std::endl;
+    bool passed = overBudget == 0 && stressOverBudget == 0;
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
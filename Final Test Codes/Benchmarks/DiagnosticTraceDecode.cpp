@@ -0,0 +1,103 @@
+//Prints a binary diagnostic trace (DIAGNOSTIC_TRACE, Common/DiagnosticLog.h) as text
+//
+//  DiagnosticTraceDecode.exe diagnostics.trace
+//
+//one line per message: seconds since the first message, thread, severity, source line and the formatted message
+#include "../Common/DiagnosticLog.h"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+
+struct TraceSite {
+    int severity = 0;
+    int line = 0;
+    std::string file;
+    std::string format;
+};
+
+template<class T>
+static bool readValue(std::istream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+static bool readString(std::istream& in, std::string& text) {
+    uint32_t length = 0;
+    if (!readValue(in, length)) return false;
+    text.resize(length);
+    return length == 0 || static_cast<bool>(in.read(&text[0], length));
+}
+
+static std::string fileName(const std::string& path) {
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: DiagnosticTraceDecode <trace file>" << std::endl;
+        return 2;
+    }
+    std::ifstream in(argv[1], std::ios::binary);
+    char magic[4] = { 0 };
+    uint32_t version = 0;
+    if (!in.read(magic, 4) || std::string(magic, 4) != "DIAG" || !readValue(in, version) || version != 1) {
+        std::cerr << "Not a diagnostic trace: " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::map<uint32_t, TraceSite> sites;
+    int64_t firstTime = 0;
+    bool first = true;
+    uint64_t messages = 0;
+    char kind = 0;
+    while (in.get(kind)) {
+        if (kind == 'S') {
+            uint32_t id = 0;
+            int32_t severity = 0, line = 0;
+            TraceSite site;
+            if (!readValue(in, id) || !readValue(in, severity) || !readValue(in, line)
+                || !readString(in, site.file) || !readString(in, site.format)) break;
+            site.severity = severity;
+            site.line = line;
+            sites[id] = site;
+        }
+        else if (kind == 'R') {
+            uint32_t id = 0;
+            DiagnosticRecord record;
+            if (!readValue(in, id) || !readValue(in, record.time) || !readValue(in, record.thread)
+                || !readValue(in, record.suppressed) || !readValue(in, record.argCount) || !readValue(in, record.textLength)) break;
+            if (record.argCount > DiagnosticRecord::maxArgs || record.textLength > DiagnosticRecord::textCapacity) break;
+            in.read(reinterpret_cast<char*>(record.argTypes), record.argCount);
+            in.read(reinterpret_cast<char*>(record.args), record.argCount * sizeof(DiagnosticRecord::Value));
+            in.read(record.text, record.textLength);
+            record.text[record.textLength] = '\0';
+            if (!in) break;
+
+            auto site = sites.find(id);
+            if (site == sites.end()) {
+                std::cerr << "Record of an unknown site " << id << std::endl;
+                return 1;
+            }
+            if (first) {
+                firstTime = record.time;
+                first = false;
+            }
+            std::cout << std::fixed << std::setprecision(6) << std::setw(12) << (record.time - firstTime) / 1e9
+                << "  [" << record.thread << "] " << std::left << std::setw(8) << diagnosticSeverityName(site->second.severity)
+                << std::right << fileName(site->second.file) << ":" << site->second.line << "  ";
+            std::cout.unsetf(std::ios::fixed);
+            std::cout << std::setprecision(6);
+            formatDiagnostic(std::cout, site->second.format.c_str(), record);
+            std::cout << '\n';
+            ++messages;
+        }
+        else {
+            std::cerr << "Corrupt trace at byte " << static_cast<long long>(in.tellg()) - 1 << std::endl;
+            return 1;
+        }
+    }
+    std::cerr << messages << " messages from " << sites.size() << " sites" << std::endl;
+    return 0;
+}
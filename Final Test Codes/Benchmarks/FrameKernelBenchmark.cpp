@@ -0,0 +1,1342 @@
+//Microbenchmarks of the per-frame kernels of the final test codes, on synthetic data (no sensor needed)
+//the kernels are copies of the code in the test loops, keep them in step when the tests change
+//
+//  FrameKernelBenchmark.exe                                      run everything, print a table
+//  FrameKernelBenchmark.exe --benchmark_filter=Stable           run the benchmarks whose name contains "Stable"
+//  FrameKernelBenchmark.exe --benchmark_out=results.json        also write the results (Google Benchmark JSON layout)
+//  FrameKernelBenchmark.exe --baseline=frame_kernels_baseline.json [--tolerance=0.25]
+//                                                                compare against the checked-in baseline, the exit code
+//                                                                is 1 when a benchmark is slower than baseline by more than the tolerance
+//
+//build it as a console project in Release with the same OpenCV as the tests, without OpenCV only the
+//benchmarks that do not need it are compiled
+#if __has_include(<opencv2/opencv.hpp>)
+#include <opencv2/opencv.hpp>
+#include "../Common/OverlayRenderer.h"
+#define BENCHMARK_HAS_OPENCV 1
+#else
+#define BENCHMARK_HAS_OPENCV 0
+#endif
+
+#include "../Common/SyntheticMotion.h"
+#include "../Common/FrameArena.h"
+#include "../Common/DiagnosticLog.h"
+#include "../Common/ColorConvert.h"
+#include "../Common/DepthPersonTracker.h"
+#include "../Common/WalkingSpeedEstimator.h"
+#include "../Common/FloorPlane.h"
+#include "../Common/DepthPointCloud.h"
+#include "../Common/JointKinematics.h"
+#include "../Common/ForwardBend.h"
+#include "../Common/ReachTrajectory.h"
+#include "../Common/ReachCompensation.h"
+#include "../Common/SingleLegStance.h"
+#include "../Common/ParticipantIdentity.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//allocation counting, every operator new of the process goes through here; all the replaced forms allocate with
+//countedAllocate (malloc) and release with countedFree (free), so any new pairs with any delete. countedFree is kept
+//out of line: inlined, gcc sees free() called on the result of operator new and warns -Wmismatched-new-delete
+#if defined(_MSC_VER)
+#define BENCHMARK_NOINLINE __declspec(noinline)
+#else
+#define BENCHMARK_NOINLINE __attribute__((noinline))
+#endif
+static std::atomic<uint64_t> allocationCount{ 0 };
+static std::atomic<uint64_t> allocatedBytes{ 0 };
+
+static void* countedAllocate(size_t size) noexcept {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+static BENCHMARK_NOINLINE void countedFree(void* p) noexcept { std::free(p); }
+
+void* operator new(size_t size) {
+    if (void* p = countedAllocate(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) {
+    if (void* p = countedAllocate(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size); }
+void operator delete(void* p) noexcept { countedFree(p); }
+void operator delete[](void* p) noexcept { countedFree(p); }
+void operator delete(void* p, size_t) noexcept { countedFree(p); }
+void operator delete[](void* p, size_t) noexcept { countedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { countedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { countedFree(p); }
+
+//keeps the optimizer from removing a result
+volatile char benchmarkSink;
+
+template<class T>
+inline void doNotOptimize(const T& value) {
+    benchmarkSink = *reinterpret_cast<const volatile char*>(&value);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+//runner
+
+class BenchmarkState {
+public:
+    explicit BenchmarkState(uint64_t iterations) : remaining(iterations), iterationCount(iterations) {}
+
+    //while (state.keepRunning()) { ...one iteration... }
+    bool keepRunning() {
+        if (remaining == iterationCount) start = std::chrono::steady_clock::now();
+        if (remaining == 0) {
+            stop = std::chrono::steady_clock::now();
+            return false;
+        }
+        --remaining;
+        return true;
+    }
+
+    //items and bytes handled by one iteration, reported as throughput
+    void setItemsPerIteration(uint64_t items) { itemsPerIteration = items; }
+    void setBytesPerIteration(uint64_t bytes) { bytesPerIteration = bytes; }
+
+    uint64_t iterations() const { return iterationCount; }
+    double seconds() const { return std::chrono::duration<double>(stop - start).count(); }
+
+    uint64_t itemsPerIteration = 0;
+    uint64_t bytesPerIteration = 0;
+
+private:
+    uint64_t remaining;
+    uint64_t iterationCount;
+    std::chrono::steady_clock::time_point start, stop;
+};
+
+struct BenchmarkResult {
+    std::string name;
+    uint64_t iterations = 0;
+    double nanosPerIteration = 0.0;
+    double itemsPerSecond = 0.0;
+    double bytesPerSecond = 0.0;
+    double allocationsPerIteration = 0.0;
+    double allocatedBytesPerIteration = 0.0;
+};
+
+struct Benchmark {
+    std::string name;
+    std::function<void(BenchmarkState&)> run;
+};
+
+static std::vector<Benchmark>& benchmarks() {
+    static std::vector<Benchmark> list;
+    return list;
+}
+
+static int registerBenchmark(const char* name, void (*run)(BenchmarkState&)) {
+    benchmarks().push_back({ name, run });
+    return 0;
+}
+
+#define BENCHMARK(function) static int benchmarkRegistration_##function = registerBenchmark(#function, function)
+
+static BenchmarkResult measure(const Benchmark& benchmark, uint64_t iterations) {
+    uint64_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+    uint64_t bytesBefore = allocatedBytes.load(std::memory_order_relaxed);
+
+    BenchmarkState state(iterations);
+    benchmark.run(state);
+
+    BenchmarkResult result;
+    result.name = benchmark.name;
+    result.iterations = iterations;
+    double seconds = std::max(state.seconds(), 1e-9);
+    result.nanosPerIteration = seconds * 1e9 / iterations;
+    result.itemsPerSecond = state.itemsPerIteration * iterations / seconds;
+    result.bytesPerSecond = state.bytesPerIteration * iterations / seconds;
+    //includes the setup of the benchmark function, which is amortized over the iterations
+    result.allocationsPerIteration = static_cast<double>(allocationCount.load(std::memory_order_relaxed) - allocationsBefore) / iterations;
+    result.allocatedBytesPerIteration = static_cast<double>(allocatedBytes.load(std::memory_order_relaxed) - bytesBefore) / iterations;
+    return result;
+}
+
+//grows the iteration count until one run takes minSeconds, then keeps the median of the repetitions
+static BenchmarkResult runBenchmark(const Benchmark& benchmark, double minSeconds, int repetitions) {
+    uint64_t iterations = 1;
+    while (true) {
+        BenchmarkResult trial = measure(benchmark, iterations);
+        double seconds = trial.nanosPerIteration * iterations / 1e9;
+        if (seconds >= minSeconds || iterations >= 1000000000ULL) break;
+        double scale = seconds > 0.0 ? 1.4 * minSeconds / seconds : 10.0;
+        iterations = static_cast<uint64_t>(iterations * std::min(std::max(scale, 2.0), 10.0));
+    }
+
+    std::vector<BenchmarkResult> runs;
+    for (int r = 0; r < repetitions; ++r) runs.push_back(measure(benchmark, iterations));
+    std::sort(runs.begin(), runs.end(), [](const BenchmarkResult& a, const BenchmarkResult& b) {
+        return a.nanosPerIteration < b.nanosPerIteration;
+        });
+    return runs[runs.size() / 2];
+}
+
+static std::string formatTime(double nanos) {
+    std::ostringstream stream;
+    stream << std::fixed << std::setprecision(nanos < 10.0 ? 2 : (nanos < 1000.0 ? 1 : 0));
+    if (nanos < 1000.0) stream << nanos << " ns";
+    else if (nanos < 1e6) stream << nanos / 1e3 << " us";
+    else stream << nanos / 1e6 << " ms";
+    return stream.str();
+}
+
+static std::string formatRate(double perSecond, const char* unit) {
+    if (perSecond <= 0.0) return "";
+    std::ostringstream stream;
+    stream << std::fixed << std::setprecision(1);
+    if (perSecond >= 1e9) stream << perSecond / 1e9 << " G";
+    else if (perSecond >= 1e6) stream << perSecond / 1e6 << " M";
+    else if (perSecond >= 1e3) stream << perSecond / 1e3 << " k";
+    else stream << perSecond << " ";
+    stream << unit << "/s";
+    return stream.str();
+}
+
+static void writeJson(const std::string& filename, const std::vector<BenchmarkResult>& results) {
+    std::ofstream outfile(filename, std::ios::trunc);
+    if (!outfile.is_open()) {
+        std::cerr << "Error: Could not open " << filename << " for writing." << std::endl;
+        return;
+    }
+
+    std::time_t now = std::time(nullptr);
+    char date[32];
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+    outfile << "{\n  \"context\": {\n";
+    outfile << "    \"date\": \"" << date << "\",\n";
+    outfile << "    \"library\": \"FrameKernelBenchmark\",\n";
+    outfile << "    \"opencv\": " << (BENCHMARK_HAS_OPENCV ? "true" : "false") << "\n";
+    outfile << "  },\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& r = results[i];
+        outfile << "    {\n";
+        outfile << "      \"name\": \"" << r.name << "\",\n";
+        outfile << "      \"iterations\": " << r.iterations << ",\n";
+        outfile << "      \"real_time\": " << std::fixed << std::setprecision(2) << r.nanosPerIteration << ",\n";
+        outfile << "      \"time_unit\": \"ns\",\n";
+        outfile << "      \"items_per_second\": " << std::setprecision(0) << r.itemsPerSecond << ",\n";
+        outfile << "      \"bytes_per_second\": " << r.bytesPerSecond << ",\n";
+        outfile << "      \"allocs_per_iter\": " << std::setprecision(2) << r.allocationsPerIteration << ",\n";
+        outfile << "      \"alloc_bytes_per_iter\": " << std::setprecision(0) << r.allocatedBytesPerIteration << "\n";
+        outfile << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+        outfile.unsetf(std::ios::floatfield);
+    }
+    outfile << "  ]\n}\n";
+}
+
+//reads name and real_time of every benchmark in a JSON file written by writeJson
+static std::map<std::string, double> readBaseline(const std::string& filename) {
+    std::map<std::string, double> baseline;
+    std::ifstream infile(filename);
+    if (!infile.is_open()) {
+        std::cerr << "Baseline not found: " << filename << std::endl;
+        return baseline;
+    }
+
+    std::string line, name;
+    while (std::getline(infile, line)) {
+        size_t key = line.find("\"name\": \"");
+        if (key != std::string::npos) {
+            size_t begin = key + 9;
+            name = line.substr(begin, line.find('"', begin) - begin);
+            continue;
+        }
+        key = line.find("\"real_time\": ");
+        if (key != std::string::npos && !name.empty()) {
+            baseline[name] = std::atof(line.c_str() + key + 13);
+            name.clear();
+        }
+    }
+    return baseline;
+}
+
+//---------------------------------------------------------------------------------------------------------------
+//kernels, as they are in the test loops
+
+const int colorWidth = 1920;
+const int colorHeight = 1080;
+const int stabilityFramesThreshold = 20;   //SFB and FRT
+const float stabilityYThreshold = 0.05f;
+
+//SFB, FRT, SOOLWEO and TUG
+bool isStable(const std::deque<float>& history, float threshold) {
+    if (history.size() < stabilityFramesThreshold) return false;
+    float minVal = *std::min_element(history.begin(), history.end());
+    float maxVal = *std::max_element(history.begin(), history.end());
+    return (maxVal - minVal) <= threshold;
+}
+
+//WS
+float getSmoothedDepth(std::deque<float>& depthQueue, float newDepth, size_t windowSize) {
+    depthQueue.push_back(newDepth);
+    if (depthQueue.size() > windowSize) {
+        depthQueue.pop_front();
+    }
+    float sum = std::accumulate(depthQueue.begin(), depthQueue.end(), 0.0f);
+    return sum / depthQueue.size();
+}
+
+//stands in for ICoordinateMapper::MapCameraPointToColorSpace, pinhole model of the Kinect v2 color camera
+inline ColorSpacePoint mapCameraPointToColorSpace(const CameraSpacePoint& p) {
+    ColorSpacePoint c;
+    c.X = 959.5f - 1081.37f * p.X / p.Z;
+    c.Y = 539.5f - 1081.37f * p.Y / p.Z;
+    return c;
+}
+
+//TUG logTUGTestTime, existence check and append of one row
+void logTestRow(const std::string& filename, double value) {
+    std::ifstream infile(filename);
+    std::ofstream outfile;
+
+    bool fileExists = infile.good();
+    infile.close();
+
+    outfile.open(filename, std::ios::app);
+    if (!fileExists) {
+        outfile << "Time Up and Go Test (s),Percentile,Z Score\n";
+    }
+    outfile << value << ",NULL,NULL\n";
+    outfile.close();
+}
+
+//FRT logFunctionalReachTest, rewritten every frame until the test completes
+void logFunctionalReachRow(double reach) {
+    std::string filename = "Functional_Reach_Test_Benchmark.csv";
+
+    std::ofstream outfile(filename, std::ios::trunc);
+    if (!outfile.is_open()) {
+        std::cerr << "Error: Could not open the file for writing.\n";
+        return;
+    }
+    outfile << "Functional Reach Test (cm) 2,Percentile,Z Score,Valid,Compensation\n";
+
+    outfile << reach * 100.0 << ",NULL,NULL," << "Yes," << compensationText(Compensation_None) << "\n";
+    outfile.close();
+}
+
+//one TUG session of synthetic skeletons, shared by the skeleton benchmarks
+static const std::vector<SyntheticFrame>& syntheticSession() {
+    static std::vector<SyntheticFrame> frames;
+    if (frames.empty()) {
+        SyntheticParams params;
+        params.scenario = Scenario_TimedUpGo;
+        params.seed = 29;
+        params.inferredRate = 0.02f;
+        SyntheticMotionGenerator generator(params);
+        SyntheticFrame frame;
+        while (generator.next(frame)) frames.push_back(frame);
+    }
+    return frames;
+}
+
+//---------------------------------------------------------------------------------------------------------------
+//benchmarks
+
+//new BYTE[], CopyConvertedFrameDataToArray and delete[] of every color frame
+static void BM_CopyColorFrame_1080p(BenchmarkState& state) {
+    const UINT bufferSize = colorWidth * colorHeight * 4;
+    std::vector<BYTE> sensorBuffer(bufferSize, 128);
+    while (state.keepRunning()) {
+        BYTE* colorBuffer = new BYTE[bufferSize];
+        std::memcpy(colorBuffer, sensorBuffer.data(), bufferSize);
+        doNotOptimize(colorBuffer[bufferSize / 2]);
+        delete[] colorBuffer;
+    }
+    state.setItemsPerIteration(1);
+    state.setBytesPerIteration(bufferSize);
+}
+BENCHMARK(BM_CopyColorFrame_1080p);
+
+//joint positions of one body mapped to color space, tracked and on-screen joints kept (Stage_Mapping)
+static void BM_JointProjection(BenchmarkState& state) {
+    const std::vector<SyntheticFrame>& frames = syntheticSession();
+    size_t f = 0;
+    while (state.keepRunning()) {
+        const SyntheticBody& body = frames[f].bodies[frames[f].participantIndex];
+        f = (f + 1) % frames.size();
+#if BENCHMARK_HAS_OPENCV
+        std::vector<cv::Point> jointPoints;
+#else
+        std::vector<std::pair<int, int>> jointPoints;
+#endif
+        for (int j = 0; j < JointType_Count; ++j) {
+            if (body.joints[j].TrackingState != TrackingState_Tracked) continue;
+            ColorSpacePoint colorPoint = mapCameraPointToColorSpace(body.joints[j].Position);
+            int x = static_cast<int>(colorPoint.X);
+            int y = static_cast<int>(colorPoint.Y);
+            if (x > 0 && x < colorWidth && y > 0 && y < colorHeight) {
+                jointPoints.push_back({ x, y });
+            }
+        }
+        doNotOptimize(jointPoints.size());
+    }
+    state.setItemsPerIteration(JointType_Count);
+}
+BENCHMARK(BM_JointProjection);
+
+//unit quaternions for every joint of six bodies, the synthetic skeletons have no orientations
+static const std::vector<JointOrientation>& syntheticOrientations() {
+    static std::vector<JointOrientation> orientations;
+    if (orientations.empty()) {
+        orientations.resize(BODY_COUNT * JointType_Count);
+        for (size_t i = 0; i < orientations.size(); ++i) {
+            float angle = 0.37f * i, axis = 0.11f * i;
+            orientations[i].JointType = static_cast<JointType>(i % JointType_Count);
+            orientations[i].Orientation = { std::sin(angle) * std::cos(axis), std::sin(angle) * std::sin(axis), 0.0f, std::cos(angle) };
+        }
+    }
+    return orientations;
+}
+
+//KinematicsFrame of six bodies: gather, pitch/yaw/roll of every joint and the clinical angles in one SSE pass
+static void BM_JointKinematics_SixBodies(BenchmarkState& state) {
+    const std::vector<SyntheticFrame>& frames = syntheticSession();
+    const std::vector<JointOrientation>& orientations = syntheticOrientations();
+    KinematicsFrame kinematics;
+    size_t f = 0;
+    while (state.keepRunning()) {
+        const SyntheticBody& body = frames[f].bodies[frames[f].participantIndex];
+        f = (f + 1) % frames.size();
+        kinematics.clear();
+        for (int b = 0; b < BODY_COUNT; ++b) kinematics.addBody(b, body.joints, &orientations[b * JointType_Count]);
+        kinematics.compute();
+        doNotOptimize(kinematics.body(BODY_COUNT - 1).angle[Angle_HipFlexionLeft]);
+    }
+    state.setItemsPerIteration(BODY_COUNT * JointType_Count);
+}
+BENCHMARK(BM_JointKinematics_SixBodies);
+
+//the same pitch, yaw and roll one joint at a time with double atan2 and asin, as the Pitch, Yaw and Roll prototype
+static void BM_JointEuler_SixBodies_Scalar(BenchmarkState& state) {
+    const std::vector<JointOrientation>& orientations = syntheticOrientations();
+    const double radiansToDegrees = 180.0 / 3.14159265358979;
+    while (state.keepRunning()) {
+        double sum = 0.0;
+        for (const JointOrientation& orientation : orientations) {
+            const Vector4& q = orientation.Orientation;
+            double w = q.w, x = q.x, y = q.y, z = q.z;
+            double pitch = std::atan2(2 * (w * x + y * z), 1 - 2 * (x * x + y * y)) * radiansToDegrees;
+            double yaw = std::asin(std::min(1.0, std::max(-1.0, 2 * (w * y - z * x)))) * radiansToDegrees;
+            double roll = std::atan2(2 * (w * z + x * y), 1 - 2 * (y * y + z * z)) * radiansToDegrees;
+            sum += pitch + yaw + roll;
+        }
+        doNotOptimize(sum);
+    }
+    state.setItemsPerIteration(BODY_COUNT * JointType_Count);
+}
+BENCHMARK(BM_JointEuler_SixBodies_Scalar);
+
+//SFB trunk measurement per frame: kinematics of the participant and the hand/trunk reach fusion
+static void BM_ForwardBend_Update(BenchmarkState& state) {
+    const std::vector<SyntheticFrame>& frames = syntheticSession();
+    KinematicsFrame kinematics;
+    ForwardBendTracker bend;
+    bend.start(frames[0].bodies[frames[0].participantIndex].joints);
+    size_t f = 0;
+    while (state.keepRunning()) {
+        const SyntheticBody& body = frames[f].bodies[frames[f].participantIndex];
+        f = (f + 1) % frames.size();
+        kinematics.clear();
+        kinematics.addBody(0, body.joints);
+        kinematics.compute();
+        bend.update(body.joints, kinematics.body(0), 10.0f);
+        doNotOptimize(bend.fusedReach);
+    }
+    state.setItemsPerIteration(1);
+}
+BENCHMARK(BM_ForwardBend_Update);
+
+//FRT per frame: ReachTrajectory::add on a synthetic reach session, restarted at the end of the session
+static void BM_ReachTrajectory_Add(BenchmarkState& state) {
+    static std::vector<SyntheticFrame> frames;
+    if (frames.empty()) {
+        SyntheticParams params;
+        params.scenario = Scenario_FunctionalReach;
+        params.seed = 31;
+        SyntheticMotionGenerator generator(params);
+        SyntheticFrame frame;
+        while (generator.next(frame)) frames.push_back(frame);
+    }
+    static ReachTrajectory trajectory;
+    trajectory.start(frames[0].bodies[frames[0].participantIndex].joints, 0.0);
+    size_t f = 1;
+    while (state.keepRunning()) {
+        if (f == frames.size()) {
+            trajectory.start(frames[0].bodies[frames[0].participantIndex].joints, 0.0);
+            f = 1;
+        }
+        bool peak = trajectory.add(frames[f].bodies[frames[f].participantIndex].joints, frames[f].relativeTime * 1e-7);
+        ++f;
+        doNotOptimize(peak);
+    }
+    state.setItemsPerIteration(1);
+}
+BENCHMARK(BM_ReachTrajectory_Add);
+
+//FRT per frame: CompensationDetector::update on a synthetic reach session, restarted at the end of the session
+static void BM_ReachCompensation_Update(BenchmarkState& state) {
+    static std::vector<SyntheticFrame> frames;
+    if (frames.empty()) {
+        SyntheticParams params;
+        params.scenario = Scenario_FunctionalReach;
+        params.seed = 31;
+        params.inferredRate = 0.05f;
+        SyntheticMotionGenerator generator(params);
+        SyntheticFrame frame;
+        while (generator.next(frame)) frames.push_back(frame);
+    }
+    CompensationDetector detector;
+    detector.start();
+    size_t f = 0;
+    while (state.keepRunning()) {
+        if (f == frames.size()) {
+            detector.start();
+            f = 0;
+        }
+        int flags = detector.update(frames[f].bodies[frames[f].participantIndex].joints);
+        ++f;
+        doNotOptimize(flags);
+    }
+    state.setItemsPerIteration(1);
+}
+BENCHMARK(BM_ReachCompensation_Update);
+
+//SOOLWEO per frame: SingleLegStanceTimer::update with both foot lifts of a synthetic session, restarted at the end
+static void BM_SingleLegStance_Update(BenchmarkState& state) {
+    static std::vector<float> left, right;
+    static std::vector<double> times;
+    if (times.empty()) {
+        SyntheticParams params;
+        params.scenario = Scenario_SingleLegStance;
+        params.seed = 31;
+        params.stanceDuration = 3.0f;
+        SyntheticMotionGenerator generator(params);
+        SyntheticFrame frame;
+        float baseLeft = 0.0f, baseRight = 0.0f;
+        while (generator.next(frame)) {
+            const Joint* joints = frame.bodies[frame.participantIndex].joints;
+            if (times.empty()) {
+                baseLeft = joints[JointType_FootLeft].Position.Y;
+                baseRight = joints[JointType_FootRight].Position.Y;
+            }
+            left.push_back(std::fabs(joints[JointType_FootLeft].Position.Y - baseLeft));
+            right.push_back(std::fabs(joints[JointType_FootRight].Position.Y - baseRight));
+            times.push_back(frame.relativeTime * 1e-7);
+        }
+    }
+    SingleLegStanceTimer timer;
+    timer.start();
+    size_t f = 0;
+    while (state.keepRunning()) {
+        if (f == times.size()) {
+            timer.start();
+            f = 0;
+        }
+        StanceEvent event = timer.update(left[f], right[f], times[f]);
+        ++f;
+        doNotOptimize(event);
+    }
+    state.setItemsPerIteration(1);
+}
+BENCHMARK(BM_SingleLegStance_Update);
+
+//all tests per frame: ParticipantIdentifier::update with the joints of a synthetic session, a day of 16 participants
+//enrolled beforehand so the update matches and then keeps checking for a swap
+static void BM_ParticipantIdentity_Update(BenchmarkState& state) {
+    static std::vector<SyntheticFrame> frames;
+    if (frames.empty()) {
+        SyntheticParams params;
+        params.scenario = Scenario_SingleLegStance;
+        params.seed = 31;
+        params.inferredRate = 0.05f;
+        SyntheticMotionGenerator generator(params);
+        SyntheticFrame frame;
+        while (generator.next(frame)) frames.push_back(frame);
+    }
+    ParticipantIdentifier identity;
+    identity.registry.load("", "20250101");
+    BoneSignature signature;
+    std::string id;
+    for (int p = 0; p < 16; ++p) {
+        for (int b = 0; b < boneSignatureLength; ++b) {
+            signature.length[b] = 0.25f * (0.8f + 0.025f * p);
+            signature.weight[b] = boneSignatureWeight(b);
+        }
+        identity.registry.enroll(signature, id);
+    }
+    size_t f = 0;
+    while (state.keepRunning()) {
+        if (f == frames.size()) {
+            identity.reset();
+            f = 0;
+        }
+        IdentityEvent event = identity.update(frames[f].bodies[frames[f].participantIndex].joints);
+        ++f;
+        doNotOptimize(event);
+    }
+    state.setItemsPerIteration(1);
+}
+BENCHMARK(BM_ParticipantIdentity_Update);
+
+//one match: ParticipantRegistry::nearest of a bone signature against a full day of enrolled signatures
+static void BM_ParticipantMatch_Day(BenchmarkState& state) {
+    ParticipantRegistry registry;
+    registry.load("", "20250101");
+    BoneSignature query;
+    for (int b = 0; b < boneSignatureLength; ++b) {
+        query.length[b] = 0.2f + 0.01f * b;
+        query.weight[b] = boneSignatureWeight(b);
+    }
+    std::string id;
+    for (int p = 0; p < ParticipantRegistry::capacity; ++p) {
+        BoneSignature enrolled = query;
+        for (int b = 0; b < boneSignatureLength; ++b) enrolled.length[b] *= 0.8f + 0.4f * p / ParticipantRegistry::capacity;
+        registry.enroll(enrolled, id);
+    }
+    int r = 0;
+    while (state.keepRunning()) {
+        query.length[r++ % boneSignatureLength] += 1e-7f;
+        float distance = 0.0f;
+        int nearest = registry.nearest(query, distance);
+        doNotOptimize(nearest);
+        doNotOptimize(distance);
+    }
+    state.setItemsPerIteration(1);
+}
+BENCHMARK(BM_ParticipantMatch_Day);
+
+//SFB per frame: six histories updated and checked for stability
+static void BM_IsStable_SixHistories(BenchmarkState& state) {
+    const std::vector<SyntheticFrame>& frames = syntheticSession();
+    const JointType tracked[6] = { JointType_HandLeft, JointType_HandRight, JointType_ElbowLeft,
+        JointType_ElbowRight, JointType_SpineMid, JointType_SpineShoulder };
+    std::deque<float> histories[6];
+    size_t f = 0;
+    while (state.keepRunning()) {
+        const SyntheticBody& body = frames[f].bodies[frames[f].participantIndex];
+        f = (f + 1) % frames.size();
+        int stableCount = 0;
+        for (int h = 0; h < 6; ++h) {
+            if (histories[h].size() >= stabilityFramesThreshold) histories[h].pop_front();
+            histories[h].push_back(body.joints[tracked[h]].Position.Y);
+            stableCount += isStable(histories[h], stabilityYThreshold);
+        }
+        doNotOptimize(stableCount);
+    }
+    state.setItemsPerIteration(6);
+}
+BENCHMARK(BM_IsStable_SixHistories);
+
+//WS moving average of the center depth pixel
+static void BM_GetSmoothedDepth(BenchmarkState& state) {
+    const std::vector<SyntheticFrame>& frames = syntheticSession();
+    std::deque<float> depthQueue;
+    const size_t smoothingWindowSize = 10;
+    size_t f = 0;
+    while (state.keepRunning()) {
+        float depthInMeters = frames[f].bodies[frames[f].participantIndex].joints[JointType_SpineMid].Position.Z;
+        f = (f + 1) % frames.size();
+        float smoothedDepth = getSmoothedDepth(depthQueue, depthInMeters, smoothingWindowSize);
+        doNotOptimize(smoothedDepth);
+    }
+    state.setItemsPerIteration(1);
+}
+BENCHMARK(BM_GetSmoothedDepth);
+
+//DepthPersonTracker::update on a WS walk off the optical axis, background learned beforehand
+static void BM_DepthPersonTracker_WS(BenchmarkState& state) {
+    const int frameSize = SyntheticMotionGenerator::depthWidth * SyntheticMotionGenerator::depthHeight;
+    static std::vector<UINT16> depthFrames;     //every 4th frame of the walk, 60 frames
+    static const int frameCount = 60;
+    SyntheticParams params;
+    params.scenario = Scenario_WalkingSpeed;
+    params.cameraHeight = 1.0f;
+    params.walkOffset = 0.3f;
+    SyntheticMotionGenerator generator(params);
+    if (depthFrames.empty()) {
+        depthFrames.resize(static_cast<size_t>(frameSize) * frameCount);
+        SyntheticFrame frame;
+        for (int f = 0; f < frameCount * 4 && generator.next(frame); ++f) {
+            if (f % 4 == 0) generator.renderDepth(frame, &depthFrames[static_cast<size_t>(f / 4) * frameSize]);
+        }
+    }
+    DepthPersonTracker tracker;
+    SyntheticFrame empty;
+    std::memset(&empty, 0, sizeof(empty));
+    std::vector<UINT16> emptyDepth(frameSize);
+    generator.renderDepth(empty, emptyDepth.data());
+    for (int f = 0; f < tracker.learningFrames; ++f) tracker.update(emptyDepth.data());
+
+    int f = 0;
+    while (state.keepRunning()) {
+        const DepthTrack& track = tracker.update(&depthFrames[static_cast<size_t>(f) * frameSize]);
+        doNotOptimize(track.z);
+        if (++f == frameCount) f = 0;
+    }
+    state.setItemsPerIteration(1);
+    state.setBytesPerIteration(frameSize * sizeof(UINT16));
+}
+BENCHMARK(BM_DepthPersonTracker_WS);
+
+//one depth sample into the streaming speed regression, a 1 m/s walk with gait sway
+static void BM_WalkingSpeedEstimator_Add(BenchmarkState& state) {
+    WalkingSpeedEstimator speed;
+    double seconds = 0.0;
+    float depth = 8.0f;
+    while (state.keepRunning()) {
+        seconds += 1.0 / 30.0;
+        depth = depth < 1.0f ? 8.0f : depth - 1.0f / 30.0f;
+        speed.add(seconds, depth + 0.01f * std::sin(static_cast<float>(seconds) * 11.0f));
+    }
+    doNotOptimize(speed.steadySamples());
+    state.setItemsPerIteration(1);
+}
+BENCHMARK(BM_WalkingSpeedEstimator_Add);
+
+//depth frame of the SOOLWEO scene, participant standing on one leg in front of the sensor
+static const std::vector<UINT16>& standingDepthFrame() {
+    static std::vector<UINT16> depth;
+    if (depth.empty()) {
+        SyntheticParams params;
+        params.scenario = Scenario_SingleLegStance;
+        SyntheticMotionGenerator generator(params);
+        SyntheticFrame frame;
+        for (int f = 0; f < 120; ++f) generator.next(frame);
+        depth.resize(SyntheticMotionGenerator::depthWidth * SyntheticMotionGenerator::depthHeight);
+        generator.renderDepth(frame, depth.data());
+    }
+    return depth;
+}
+
+//the whole 512x424 depth frame to camera space points through the ray table, AVX2 (SSE2 without -mavx2) and scalar
+static void depthPointCloud(BenchmarkState& state, bool simd) {
+    const std::vector<UINT16>& depth = standingDepthFrame();
+    DepthRayTable rays;
+    DepthPointCloud cloud;
+    depthToPoints(depth.data(), rays, cloud);
+    while (state.keepRunning()) {
+        if (simd) depthToPoints(depth.data(), rays, cloud);
+        else depthToPointsScalar(depth.data(), rays.rayX.data(), rays.rayY.data(), 0, DepthRayTable::pixels, cloud.x.data(), cloud.y.data(), cloud.z.data());
+        doNotOptimize(cloud.z[DepthRayTable::pixels / 2]);
+    }
+    state.setItemsPerIteration(DepthRayTable::pixels);
+    state.setBytesPerIteration(depth.size() * sizeof(UINT16));
+}
+static void BM_DepthToPoints_Full(BenchmarkState& state) { depthPointCloud(state, true); }
+BENCHMARK(BM_DepthToPoints_Full);
+static void BM_DepthToPoints_Full_Scalar(BenchmarkState& state) { depthPointCloud(state, false); }
+BENCHMARK(BM_DepthToPoints_Full_Scalar);
+
+//only the participant's bounding box of the SOOLWEO frame, about a tenth of the pixels
+static void BM_DepthToPoints_Masked(BenchmarkState& state) {
+    const std::vector<UINT16>& depth = standingDepthFrame();
+    DepthRayTable rays;
+    DepthPointCloud cloud;
+    std::vector<uint8_t> mask(DepthRayTable::pixels, 0);
+    for (int v = 100; v < 400; ++v) std::fill(&mask[v * DepthRayTable::width + 216], &mask[v * DepthRayTable::width + 296], 1);
+    int points = 0;
+    while (state.keepRunning()) {
+        points = depthToPointsMasked(depth.data(), rays, mask.data(), cloud);
+        doNotOptimize(points);
+    }
+    state.setItemsPerIteration(points);
+}
+BENCHMARK(BM_DepthToPoints_Masked);
+
+//one floor fit on the SOOLWEO depth frame
+static void BM_FloorPlaneFit_SOOLWEO(BenchmarkState& state) {
+    const std::vector<UINT16>& depth = standingDepthFrame();
+    FloorPlaneFitter fitter;
+    FloorPlane plane;
+    while (state.keepRunning()) {
+        fitter.fit(depth.data(), plane);
+        doNotOptimize(plane.d);
+    }
+    state.setItemsPerIteration(1);
+    state.setBytesPerIteration(depth.size() * sizeof(UINT16));
+}
+BENCHMARK(BM_FloorPlaneFit_SOOLWEO);
+
+//RANSAC inlier count of one candidate plane over the 128x106 point cloud, SSE2 and scalar
+static void floorInlierCount(BenchmarkState& state, bool simd) {
+    const int count = 128 * 106;
+    std::vector<float> xs(count), ys(count), zs(count);
+    for (int i = 0; i < count; ++i) {
+        float z = 0.5f + (i % 97) * 0.04f;
+        xs[i] = ((i % 128) - 64) * z / 91.4f;
+        ys[i] = (i & 1) ? -0.55f : ((i / 128) - 53) * z / 91.4f;
+        zs[i] = z;
+    }
+    int inliers = 0;
+    while (state.keepRunning()) {
+        inliers += simd ? countPlaneInliers(xs.data(), ys.data(), zs.data(), count, 0.01f, 0.999f, 0.02f, 0.55f, 0.03f)
+            : countPlaneInliersScalar(xs.data(), ys.data(), zs.data(), count, 0.01f, 0.999f, 0.02f, 0.55f, 0.03f);
+        doNotOptimize(inliers);
+    }
+    state.setItemsPerIteration(count);
+}
+static void BM_FloorPlaneInliers(BenchmarkState& state) { floorInlierCount(state, true); }
+BENCHMARK(BM_FloorPlaneInliers);
+static void BM_FloorPlaneInliers_Scalar(BenchmarkState& state) { floorInlierCount(state, false); }
+BENCHMARK(BM_FloorPlaneInliers_Scalar);
+
+//CSV logging, one row appended (TUG, WS, SFB, SOOLWEO)
+static void BM_LogAppendRow(BenchmarkState& state) {
+    const std::string filename = "Benchmark_Append_Results.csv";
+    std::remove(filename.c_str());
+    double value = 9.87;
+    while (state.keepRunning()) {
+        logTestRow(filename, value);
+        value += 0.01;
+    }
+    std::remove(filename.c_str());
+    state.setItemsPerIteration(1);
+}
+BENCHMARK(BM_LogAppendRow);
+
+//CSV logging, FRT rewrites its result file on every frame
+static void BM_LogFunctionalReachPerFrame(BenchmarkState& state) {
+    double distance = 0.1;
+    while (state.keepRunning()) {
+        logFunctionalReachRow(distance);
+        distance += 0.0001;
+    }
+    std::remove("Functional_Reach_Test_Benchmark.csv");
+    state.setItemsPerIteration(1);
+}
+BENCHMARK(BM_LogFunctionalReachPerFrame);
+
+//FRT per-frame distance print, std::endl flushes a synchronous write on the frame thread (to a file here, the
+//console is slower still)
+static void BM_DiagnosticEndl_FRT(BenchmarkState& state) {
+    std::ofstream console("Benchmark_Console.txt", std::ios::trunc);
+    float DistanceRightHand = 0.2f;
+    while (state.keepRunning()) {
+        console << "Distance Reached by Right Hand: " << DistanceRightHand * 100.0f << "cm" << std::endl;
+        DistanceRightHand += 0.0001f;
+    }
+    console.close();
+    std::remove("Benchmark_Console.txt");
+    state.setItemsPerIteration(1);
+}
+BENCHMARK(BM_DiagnosticEndl_FRT);
+
+//the same message through DiagnosticLog.h, the frame thread only fills a ring slot (binary trace, no rate limit)
+//messages the writer could not keep up with are dropped and counted, the time is the cost of the call either way
+static void BM_DiagnosticLog_FRT(BenchmarkState& state) {
+    static bool traceOpen = diagnosticLog().setTraceFile("Benchmark_Diagnostics.trace");
+    //destroyed before the log, removes the trace at exit
+    static struct TraceCleanup {
+        ~TraceCleanup() {
+            diagnosticLog().stop();
+            std::remove("Benchmark_Diagnostics.trace");
+        }
+    } traceCleanup;
+    doNotOptimize(traceOpen);
+    float DistanceRightHand = 0.2f;
+    while (state.keepRunning()) {
+        DIAG_INFO("Distance Reached by Right Hand: {}cm", DistanceRightHand * 100.0f);
+        DistanceRightHand += 0.0001f;
+    }
+    state.setItemsPerIteration(1);
+}
+BENCHMARK(BM_DiagnosticLog_FRT);
+
+//rate limited site inside its interval, the common case of a per-frame message
+static void BM_DiagnosticLog_RateLimited(BenchmarkState& state) {
+    float DistanceRightHand = 0.2f;
+    while (state.keepRunning()) {
+        DIAG_INFO_EVERY(60000, "Distance Reached by Right Hand: {}cm", DistanceRightHand * 100.0f);
+        DistanceRightHand += 0.0001f;
+    }
+    state.setItemsPerIteration(1);
+}
+BENCHMARK(BM_DiagnosticLog_RateLimited);
+
+#if BENCHMARK_HAS_OPENCV
+typedef cv::Point FramePoint;
+#else
+typedef std::pair<int, int> FramePoint;
+#endif
+
+//heap temporaries of one FRT frame before FrameArena.h: joint point list, depth text, reach texts
+static void BM_FrameTemporaries_FRT(BenchmarkState& state) {
+    const std::vector<SyntheticFrame>& frames = syntheticSession();
+    size_t f = 0, textBytes = 0;
+    while (state.keepRunning()) {
+        const SyntheticBody& body = frames[f].bodies[frames[f].participantIndex];
+        f = (f + 1) % frames.size();
+        std::vector<FramePoint> jointPoints;
+        for (int j = 0; j < JointType_Count; ++j) {
+            ColorSpacePoint colorPoint = mapCameraPointToColorSpace(body.joints[j].Position);
+            jointPoints.push_back(FramePoint(static_cast<int>(colorPoint.X), static_cast<int>(colorPoint.Y)));
+        }
+        std::ostringstream stream;
+        stream << std::fixed << std::setprecision(2) << body.joints[JointType_SpineMid].Position.Z;
+        std::string depthText = "Depth: " + stream.str() + "m";
+        std::string handText = "Hand Distance: " + std::to_string(body.joints[JointType_HandRight].Position.Z * 100.0f) + " cm";
+        std::string elbowText = "Elbow Distance: " + std::to_string(body.joints[JointType_ElbowRight].Position.Z * 100.0f) + " cm";
+        textBytes += jointPoints.size() + depthText.size() + handText.size() + elbowText.size();
+    }
+    doNotOptimize(textBytes);
+    state.setItemsPerIteration(1);
+}
+BENCHMARK(BM_FrameTemporaries_FRT);
+
+//the same frame with ArenaVector and FrameText, no heap allocation after the first frame
+static void BM_FrameTemporaries_FRT_Arena(BenchmarkState& state) {
+    const std::vector<SyntheticFrame>& frames = syntheticSession();
+    size_t f = 0, textBytes = 0;
+    while (state.keepRunning()) {
+        const SyntheticBody& body = frames[f].bodies[frames[f].participantIndex];
+        f = (f + 1) % frames.size();
+        ArenaVector<FramePoint> jointPoints(frameArena());
+        jointPoints.reserve(JointType_Count);
+        for (int j = 0; j < JointType_Count; ++j) {
+            ColorSpacePoint colorPoint = mapCameraPointToColorSpace(body.joints[j].Position);
+            jointPoints.push_back(FramePoint(static_cast<int>(colorPoint.X), static_cast<int>(colorPoint.Y)));
+        }
+        FrameText depthText, handText, elbowText;
+        depthText << "Depth: " << decimals(body.joints[JointType_SpineMid].Position.Z, 2) << "m";
+        handText << "Hand Distance: " << body.joints[JointType_HandRight].Position.Z * 100.0f << " cm";
+        elbowText << "Elbow Distance: " << body.joints[JointType_ElbowRight].Position.Z * 100.0f << " cm";
+        textBytes += jointPoints.size() + depthText.size() + handText.size() + elbowText.size();
+        frameArena().reset();
+    }
+    doNotOptimize(textBytes);
+    state.setItemsPerIteration(1);
+}
+BENCHMARK(BM_FrameTemporaries_FRT_Arena);
+
+//raw 1080p YUY2 frame, a gradient so the chroma is not constant
+static const std::vector<uint8_t>& syntheticYuy2Frame() {
+    static std::vector<uint8_t> frame;
+    if (frame.empty()) {
+        frame.resize(static_cast<size_t>(colorWidth) * colorHeight * 2);
+        for (int y = 0; y < colorHeight; ++y) {
+            for (int x = 0; x < colorWidth; ++x) {
+                uint8_t* pixel = &frame[(static_cast<size_t>(y) * colorWidth + x) * 2];
+                pixel[0] = static_cast<uint8_t>(16 + (x + y) % 220);
+                pixel[1] = static_cast<uint8_t>((x & 1) ? 128 + (y % 100) : 128 - (x % 100));
+            }
+        }
+    }
+    return frame;
+}
+
+//the display image of ColorIngest_Yuy2: whole frame to 960x540 BGR
+static void BM_Yuy2ToBgrHalf_1080p(BenchmarkState& state) {
+    const std::vector<uint8_t>& frame = syntheticYuy2Frame();
+    std::vector<uint8_t> bgr(static_cast<size_t>(colorWidth / 2) * (colorHeight / 2) * 3);
+    const size_t rowBytes = colorWidth * 2;
+    while (state.keepRunning()) {
+        for (int y = 0; y < colorHeight / 2; ++y) {
+            yuy2ToBgrHalfRow(&frame[2 * y * rowBytes], &frame[(2 * y + 1) * rowBytes], &bgr[y * (colorWidth / 2) * 3], colorWidth / 2);
+        }
+        doNotOptimize(bgr[bgr.size() / 2]);
+    }
+    state.setItemsPerIteration(1);
+    state.setBytesPerIteration(frame.size());
+}
+BENCHMARK(BM_Yuy2ToBgrHalf_1080p);
+
+//the same without SIMD, what a build without SSSE3 gets
+static void BM_Yuy2ToBgrHalf_1080p_Scalar(BenchmarkState& state) {
+    const std::vector<uint8_t>& frame = syntheticYuy2Frame();
+    std::vector<uint8_t> bgr(static_cast<size_t>(colorWidth / 2) * (colorHeight / 2) * 3);
+    const size_t rowBytes = colorWidth * 2;
+    while (state.keepRunning()) {
+        for (int y = 0; y < colorHeight / 2; ++y) {
+            yuy2ToBgrHalfRowScalar(&frame[2 * y * rowBytes], &frame[(2 * y + 1) * rowBytes], &bgr[y * (colorWidth / 2) * 3], colorWidth / 2);
+        }
+        doNotOptimize(bgr[bgr.size() / 2]);
+    }
+    state.setItemsPerIteration(1);
+    state.setBytesPerIteration(frame.size());
+}
+BENCHMARK(BM_Yuy2ToBgrHalf_1080p_Scalar);
+
+//a 200x300 region at full resolution, the size of the FRT hi-vis band around the torso
+static void BM_Yuy2ToBgr_HiVisRoi(BenchmarkState& state) {
+    const std::vector<uint8_t>& frame = syntheticYuy2Frame();
+    const int roiX = 860, roiY = 390, roiWidth = 200, roiHeight = 300;
+    std::vector<uint8_t> bgr(static_cast<size_t>(roiWidth) * roiHeight * 3);
+    const size_t rowBytes = colorWidth * 2;
+    while (state.keepRunning()) {
+        for (int y = 0; y < roiHeight; ++y) {
+            yuy2ToBgrRow(&frame[(roiY + y) * rowBytes + roiX * 2], &bgr[y * roiWidth * 3], roiWidth);
+        }
+        doNotOptimize(bgr[bgr.size() / 2]);
+    }
+    state.setItemsPerIteration(1);
+    state.setBytesPerIteration(static_cast<size_t>(roiWidth) * roiHeight * 2);
+}
+BENCHMARK(BM_Yuy2ToBgr_HiVisRoi);
+
+//the display image of a BGRA frame at 1/divisor of the size, BGRA to BGR and box filter in one pass
+static void runBgraToBgrScaled(BenchmarkState& state, int divisor, bool simd) {
+    std::vector<uint8_t> frame(static_cast<size_t>(colorWidth) * colorHeight * 4);
+    for (size_t i = 0; i < frame.size(); ++i) frame[i] = static_cast<uint8_t>((i * 7) >> 5);
+    const int outputWidth = colorWidth / divisor, outputHeight = colorHeight / divisor;
+    std::vector<uint8_t> bgr(static_cast<size_t>(outputWidth) * outputHeight * 3);
+    const uint8_t* rows[MaxScaleDivisor];
+    while (state.keepRunning()) {
+        for (int y = 0; y < outputHeight; ++y) {
+            for (int r = 0; r < divisor; ++r) rows[r] = &frame[(static_cast<size_t>(y) * divisor + r) * colorWidth * 4];
+            if (simd) bgraToBgrScaledRow(rows, divisor, &bgr[static_cast<size_t>(y) * outputWidth * 3], outputWidth);
+            else bgraToBgrScaledRowScalar(rows, divisor, &bgr[static_cast<size_t>(y) * outputWidth * 3], outputWidth);
+        }
+        doNotOptimize(bgr[bgr.size() / 2]);
+    }
+    state.setItemsPerIteration(1);
+    state.setBytesPerIteration(frame.size() + bgr.size());
+}
+
+static void BM_BgraToBgrScaled_Full(BenchmarkState& state) { runBgraToBgrScaled(state, 1, true); }
+BENCHMARK(BM_BgraToBgrScaled_Full);
+static void BM_BgraToBgrScaled_Half(BenchmarkState& state) { runBgraToBgrScaled(state, 2, true); }
+BENCHMARK(BM_BgraToBgrScaled_Half);
+static void BM_BgraToBgrScaled_Third(BenchmarkState& state) { runBgraToBgrScaled(state, 3, true); }
+BENCHMARK(BM_BgraToBgrScaled_Third);
+static void BM_BgraToBgrScaled_Half_Scalar(BenchmarkState& state) { runBgraToBgrScaled(state, 2, false); }
+BENCHMARK(BM_BgraToBgrScaled_Half_Scalar);
+
+#if BENCHMARK_HAS_OPENCV
+
+static cv::Mat syntheticColorFrame() {
+    cv::Mat bgra(colorHeight, colorWidth, CV_8UC4);
+    cv::randu(bgra, cv::Scalar::all(0), cv::Scalar::all(255));
+    return bgra;
+}
+
+//cvtColor BGRA to BGR of the full color frame (Stage_ConvertColor)
+static void BM_ConvertBGRAtoBGR_1080p(BenchmarkState& state) {
+    cv::Mat bgra = syntheticColorFrame();
+    cv::Mat bgrMat;
+    while (state.keepRunning()) {
+        cv::cvtColor(bgra, bgrMat, cv::COLOR_BGRA2BGR);
+        doNotOptimize(bgrMat.data[0]);
+    }
+    state.setItemsPerIteration(1);
+    state.setBytesPerIteration(static_cast<uint64_t>(colorWidth) * colorHeight * 4);
+}
+BENCHMARK(BM_ConvertBGRAtoBGR_1080p);
+
+//the same with a new bgrMat every frame, as declared inside the test loops
+static void BM_ConvertBGRAtoBGR_1080p_NewMat(BenchmarkState& state) {
+    cv::Mat bgra = syntheticColorFrame();
+    while (state.keepRunning()) {
+        cv::Mat bgrMat;
+        cv::cvtColor(bgra, bgrMat, cv::COLOR_BGRA2BGR);
+        doNotOptimize(bgrMat.data[0]);
+    }
+    state.setItemsPerIteration(1);
+    state.setBytesPerIteration(static_cast<uint64_t>(colorWidth) * colorHeight * 4);
+}
+BENCHMARK(BM_ConvertBGRAtoBGR_1080p_NewMat);
+
+//bounding box of the upper body joints and its rectangle
+static void BM_BoundingRect_UpperBody(BenchmarkState& state) {
+    const std::vector<SyntheticFrame>& frames = syntheticSession();
+    const JointType upperBodyJoints[] = {
+        JointType_Head, JointType_Neck, JointType_SpineShoulder, JointType_SpineMid,
+        JointType_ShoulderLeft, JointType_ShoulderRight
+    };
+    cv::Mat bgrMat(colorHeight, colorWidth, CV_8UC3, cv::Scalar::all(200));
+    size_t f = 0;
+    while (state.keepRunning()) {
+        const SyntheticBody& body = frames[f].bodies[frames[f].participantIndex];
+        f = (f + 1) % frames.size();
+        std::vector<cv::Point> jointPoints;
+        for (JointType jt : upperBodyJoints) {
+            ColorSpacePoint colorPoint = mapCameraPointToColorSpace(body.joints[jt].Position);
+            jointPoints.push_back(cv::Point(static_cast<int>(colorPoint.X), static_cast<int>(colorPoint.Y)));
+        }
+        cv::Rect boundingRect = cv::boundingRect(jointPoints);
+        cv::rectangle(bgrMat, boundingRect, cv::Scalar(0, 255, 0), 2);
+    }
+    state.setItemsPerIteration(1);
+}
+BENCHMARK(BM_BoundingRect_UpperBody);
+
+//hi-vis vest check of the assistant detection: HSV conversion of the chest ROI, three colour masks, ratio
+static void BM_HiVisMask(BenchmarkState& state) {
+    cv::Mat bgrMat(colorHeight, colorWidth, CV_8UC3);
+    cv::randu(bgrMat, cv::Scalar::all(0), cv::Scalar::all(255));
+    cv::Rect hiViROI(860, 400, 200, 50);
+    while (state.keepRunning()) {
+        cv::Mat roi = bgrMat(hiViROI);
+        cv::Mat hsvROI;
+        cv::cvtColor(roi, hsvROI, cv::COLOR_BGR2HSV);
+
+        cv::Scalar lowerYellow(20, 100, 100), upperYellow(40, 255, 255);
+        cv::Scalar lowerGreen(40, 50, 50), upperGreen(80, 255, 255);
+        cv::Scalar lowerOrange(5, 150, 150), upperOrange(20, 255, 255);
+
+        cv::Mat maskYellow, maskGreen, maskOrange;
+        cv::inRange(hsvROI, lowerYellow, upperYellow, maskYellow);
+        cv::inRange(hsvROI, lowerGreen, upperGreen, maskGreen);
+        cv::inRange(hsvROI, lowerOrange, upperOrange, maskOrange);
+
+        cv::Mat combinedMask = maskYellow | maskGreen | maskOrange;
+        double hiViRatio = cv::countNonZero(combinedMask) / static_cast<double>(hiViROI.area());
+        doNotOptimize(hiViRatio);
+    }
+    state.setItemsPerIteration(1);
+    state.setBytesPerIteration(static_cast<uint64_t>(hiViROI.area()) * 3);
+}
+BENCHMARK(BM_HiVisMask);
+
+//the FRT overlay of one frame while the participant bends forward
+static void BM_PutTextOverlay_FRT(BenchmarkState& state) {
+    cv::Mat bgrMat(colorHeight, colorWidth, CV_8UC3, cv::Scalar::all(200));
+    float MaximumRightHandDistance = 0.2f, MaximumRightElbowDistance = 0.15f;
+    while (state.keepRunning()) {
+        cv::putText(bgrMat, "Test Ready", cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+        cv::putText(bgrMat, "Bend Forward", cv::Point(50, 100), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+        for (int copy = 0; copy < 2; ++copy) {
+            cv::putText(bgrMat, "Hand Distance: " + std::to_string(MaximumRightHandDistance * 100.0f) + " cm",
+                cv::Point(50, 500), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+            cv::putText(bgrMat, "Elbow Distance: " + std::to_string(MaximumRightElbowDistance * 100.0f) + " cm",
+                cv::Point(50, 550), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+        }
+        MaximumRightHandDistance += 0.0001f;
+    }
+    state.setItemsPerIteration(6);
+}
+BENCHMARK(BM_PutTextOverlay_FRT);
+
+//the same overlay through the cached glyph atlas layers of OverlayRenderer.h, the distance changes every
+//frame like during the reach so two of the six lines are assembled again each iteration
+static void BM_OverlayRenderer_FRT(BenchmarkState& state) {
+    cv::Mat bgrMat(colorHeight, colorWidth, CV_8UC3, cv::Scalar::all(200));
+    OverlayRenderer overlay;
+    float MaximumRightHandDistance = 0.2f, MaximumRightElbowDistance = 0.15f;
+    while (state.keepRunning()) {
+        overlay.putText(bgrMat, "Test Ready", cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+        overlay.putText(bgrMat, "Bend Forward", cv::Point(50, 100), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+        for (int copy = 0; copy < 2; ++copy) {
+            overlay.putText(bgrMat, "Hand Distance: " + std::to_string(MaximumRightHandDistance * 100.0f) + " cm",
+                cv::Point(50, 500), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+            overlay.putText(bgrMat, "Elbow Distance: " + std::to_string(MaximumRightElbowDistance * 100.0f) + " cm",
+                cv::Point(50, 550), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+        }
+        MaximumRightHandDistance += 0.0001f;
+    }
+    state.setItemsPerIteration(6);
+}
+BENCHMARK(BM_OverlayRenderer_FRT);
+
+//steady state, nothing changes between frames (Test Ready / Test Completed screens)
+static void BM_OverlayRenderer_FRT_Static(BenchmarkState& state) {
+    cv::Mat bgrMat(colorHeight, colorWidth, CV_8UC3, cv::Scalar::all(200));
+    OverlayRenderer overlay;
+    while (state.keepRunning()) {
+        overlay.putText(bgrMat, "Test Ready", cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+        overlay.putText(bgrMat, "Bend Forward", cv::Point(50, 100), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+        overlay.putText(bgrMat, "Hand Distance: 20.000000 cm", cv::Point(50, 500), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+        overlay.putText(bgrMat, "Elbow Distance: 15.000000 cm", cv::Point(50, 550), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+    }
+    state.setItemsPerIteration(4);
+}
+BENCHMARK(BM_OverlayRenderer_FRT_Static);
+
+//overlays of the five tests replayed from synthetic sessions: upper body rectangle, depth and a status line
+//per frame, the way the test logic records them for the display stage of FramePipeline.h
+static const std::vector<OverlayList>& displayReplay() {
+    static std::vector<OverlayList> overlays;
+    if (!overlays.empty()) return overlays;
+    const char* status[Scenario_Count] = { "Test Started", "Test Started!", "Bend Forward", "Test Ready", "Raise Your Foot" };
+    const JointType upperBodyJoints[] = {
+        JointType_Head, JointType_Neck, JointType_SpineShoulder, JointType_SpineMid,
+        JointType_ShoulderLeft, JointType_ShoulderRight
+    };
+    for (int scenario = 0; scenario < Scenario_Count; ++scenario) {
+        SyntheticParams params;
+        params.scenario = static_cast<SyntheticScenario>(scenario);
+        params.seed = 37;
+        SyntheticMotionGenerator generator(params);
+        SyntheticFrame frame;
+        for (int f = 0; f < 300 && generator.next(frame); ++f) {
+            const SyntheticBody& body = frame.bodies[frame.participantIndex];
+            std::vector<cv::Point> jointPoints;
+            for (JointType jt : upperBodyJoints) {
+                ColorSpacePoint colorPoint = mapCameraPointToColorSpace(body.joints[jt].Position);
+                jointPoints.push_back(cv::Point(static_cast<int>(colorPoint.X), static_cast<int>(colorPoint.Y)));
+            }
+            overlays.emplace_back();
+            OverlayList& overlay = overlays.back();
+            overlayRectangle(overlay, cv::boundingRect(jointPoints), cv::Scalar(0, 255, 0), 2);
+            overlayText(overlay, (FrameText() << "Depth: " << decimals(body.joints[JointType_SpineMid].Position.Z, 2) << "m").c_str(),
+                cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+            overlayText(overlay, status[scenario], cv::Point(50, 100), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+            overlayText(overlay, (FrameText() << "Timer: " << leadingDigits(f / 30.0, 4) << "s").c_str(),
+                cv::Point(50, 500), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+        }
+    }
+    return overlays;
+}
+
+//display stage before the direct path: BGRA to BGR, copy for drawing, overlay
+static void BM_DisplayPath_ConvertCopy(BenchmarkState& state) {
+    const std::vector<OverlayList>& overlays = displayReplay();
+    cv::Mat bgra = syntheticColorFrame();
+    cv::Mat bgrMat, displayMat;
+    size_t f = 0;
+    while (state.keepRunning()) {
+        cv::cvtColor(bgra, bgrMat, cv::COLOR_BGRA2BGR);
+        bgrMat.copyTo(displayMat);
+        overlays[f].draw(displayMat);
+        f = (f + 1) % overlays.size();
+        doNotOptimize(displayMat.data[0]);
+    }
+    state.setItemsPerIteration(1);
+}
+BENCHMARK(BM_DisplayPath_ConvertCopy);
+
+//display stage now: the overlay drawn into the BGRA buffer the sensor frame was copied to
+static void BM_DisplayPath_DirectBGRA(BenchmarkState& state) {
+    const std::vector<OverlayList>& overlays = displayReplay();
+    cv::Mat bgra = syntheticColorFrame();
+    size_t f = 0;
+    while (state.keepRunning()) {
+        overlays[f].draw(bgra);
+        f = (f + 1) % overlays.size();
+        doNotOptimize(bgra.data[0]);
+    }
+    state.setItemsPerIteration(1);
+}
+BENCHMARK(BM_DisplayPath_DirectBGRA);
+
+//the same downscaled display image with OpenCV: BGRA to BGR, then resize(INTER_AREA), two passes
+static void BM_DisplayPath_CvtColorResizeHalf(BenchmarkState& state) {
+    const std::vector<OverlayList>& overlays = displayReplay();
+    cv::Mat bgra = syntheticColorFrame();
+    cv::Mat bgrMat, displayMat;
+    size_t f = 0;
+    while (state.keepRunning()) {
+        cv::cvtColor(bgra, bgrMat, cv::COLOR_BGRA2BGR);
+        cv::resize(bgrMat, displayMat, cv::Size(colorWidth / 2, colorHeight / 2), 0, 0, cv::INTER_AREA);
+        overlays[f].draw(displayMat, 0.5);
+        f = (f + 1) % overlays.size();
+        doNotOptimize(displayMat.data[0]);
+    }
+    state.setItemsPerIteration(1);
+}
+BENCHMARK(BM_DisplayPath_CvtColorResizeHalf);
+
+//FramePipeline with DISPLAY_DIVISOR 2: one pass to 960x540 BGR, the overlay drawn scaled
+static void BM_DisplayPath_ScaledHalf(BenchmarkState& state) {
+    const std::vector<OverlayList>& overlays = displayReplay();
+    cv::Mat bgra = syntheticColorFrame();
+    cv::Mat displayMat;
+    size_t f = 0;
+    while (state.keepRunning()) {
+        convertBgraToBgrScaled(bgra, 2, displayMat);
+        overlays[f].draw(displayMat, 0.5);
+        f = (f + 1) % overlays.size();
+        doNotOptimize(displayMat.data[0]);
+    }
+    state.setItemsPerIteration(1);
+}
+BENCHMARK(BM_DisplayPath_ScaledHalf);
+
+#endif
+
+//---------------------------------------------------------------------------------------------------------------
+
+int main(int argc, char* argv[]) {
+    std::string filter, outFile, baselineFile;
+    double tolerance = 0.25;
+    double minSeconds = 0.5;
+    int repetitions = 5;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&arg](const char* option) -> const char* {
+            size_t length = std::strlen(option);
+            return arg.compare(0, length, option) == 0 ? arg.c_str() + length : nullptr;
+        };
+        if (const char* v = value("--benchmark_filter=")) filter = v;
+        else if (const char* v = value("--benchmark_out=")) outFile = v;
+        else if (const char* v = value("--benchmark_min_time=")) minSeconds = std::atof(v);
+        else if (const char* v = value("--benchmark_repetitions=")) repetitions = std::max(1, std::atoi(v));
+        else if (const char* v = value("--baseline=")) baselineFile = v;
+        else if (const char* v = value("--tolerance=")) tolerance = std::atof(v);
+        else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 2;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (!baselineFile.empty()) baseline = readBaseline(baselineFile);
+
+    std::cout << std::left << std::setw(36) << "Benchmark" << std::right << std::setw(12) << "Time"
+        << std::setw(14) << "Iterations" << std::setw(16) << "Throughput" << std::setw(12) << "Allocs/it"
+        << std::setw(14) << "Bytes/it" << (baseline.empty() ? "" : "    vs baseline") << std::endl;
+
+    std::vector<BenchmarkResult> results;
+    int regressions = 0;
+    for (const Benchmark& benchmark : benchmarks()) {
+        if (!filter.empty() && benchmark.name.find(filter) == std::string::npos) continue;
+        BenchmarkResult r = runBenchmark(benchmark, minSeconds, repetitions);
+        results.push_back(r);
+
+        std::string throughput = r.bytesPerSecond > 0.0 ? formatRate(r.bytesPerSecond, "B") : formatRate(r.itemsPerSecond, "items");
+        std::cout << std::left << std::setw(36) << r.name << std::right << std::setw(12) << formatTime(r.nanosPerIteration)
+            << std::setw(14) << r.iterations << std::setw(16) << throughput
+            << std::setw(12) << std::fixed << std::setprecision(2) << r.allocationsPerIteration
+            << std::setw(14) << std::setprecision(0) << r.allocatedBytesPerIteration;
+        std::cout.unsetf(std::ios::floatfield);
+
+        auto it = baseline.find(r.name);
+        if (it != baseline.end() && it->second > 0.0) {
+            double change = r.nanosPerIteration / it->second - 1.0;
+            bool regressed = change > tolerance;
+            regressions += regressed;
+            std::cout << "    " << std::showpos << std::fixed << std::setprecision(1) << change * 100.0 << "%"
+                << std::noshowpos << (regressed ? "  REGRESSION" : "");
+            std::cout.unsetf(std::ios::floatfield);
+        }
+        else if (!baseline.empty()) {
+            std::cout << "    (not in baseline)";
+        }
+        std::cout << std::endl;
+    }
+
+    if (!outFile.empty()) writeJson(outFile, results);
+
+    if (regressions > 0) {
+        std::cerr << regressions << " benchmark(s) slower than the baseline by more than "
+            << tolerance * 100.0 << "%" << std::endl;
+        return 1;
+    }
+    return 0;
+}
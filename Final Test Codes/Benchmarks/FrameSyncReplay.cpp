@@ -0,0 +1,222 @@
+//Replays synthetic TUG sessions through FrameSynchronizer, the acquisition pass of SynchronizedFrameReader, fed by a
+//replay source that drops color and depth frames and delivers color and body frames late, and compares two frame loops:
+//  old - the body frame is read only after a good color frame (the loop before FrameSync.h)
+//  new - FrameSynchronizer, every body frame is handed to the test logic
+//reports the body frames recovered per minute and how much later the old loop sees the TUG transitions. Checks, on
+//every pass, that a body frame the source has is handed over whatever happened to color, that a stream without a new
+//frame keeps its previous time and that the color and depth matches agree with the frames the source delivered.
+//Exit code 1 when a check fails.
+//
+//  FrameSyncReplay.exe [sessions]
+#include "../Common/SyntheticMotion.h"
+#include "../Common/FrameMatcher.h"
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+//frame losses and delays injected on top of the synthetic session
+struct StreamFaults {
+    const char* name;
+    float colorDropRate;    //per frame
+    float burstRate;        //per frame, start of a burst of lost color frames (USB bandwidth, exposure change)
+    int burstLength;
+    float colorLateRate;    //per frame, the color frame arrives one or two sensor ticks late
+    float bodyLateRate;     //per frame, the body frame arrives one sensor tick late
+    float depthDropRate;
+};
+
+//one stream of the replay source: a frame can be acquired from its arrival tick on, acquire returns the newest frame
+//that arrived since the last acquire and skips the older ones, like AcquireLatestFrame
+class ReplayStream {
+public:
+    void push(int arrival, TIMESPAN time) {
+        auto at = pending.end();
+        while (at != pending.begin() && (at - 1)->arrival > arrival) --at;
+        pending.insert(at, PendingFrame{ arrival, time });
+    }
+
+    bool available(int tick) const {
+        for (const PendingFrame& frame : pending) {
+            if (frame.arrival > tick) break;
+            if (!delivered || frame.time > lastTime) return true;
+        }
+        return false;
+    }
+
+    bool acquire(int tick, TIMESPAN& time) {
+        bool found = false;
+        while (!pending.empty() && pending.front().arrival <= tick) {
+            //a late frame older than one already delivered is never handed out
+            if (!delivered || pending.front().time > lastTime) {
+                lastTime = pending.front().time;
+                delivered = found = true;
+            }
+            pending.pop_front();
+        }
+        if (found) time = lastTime;
+        return found;
+    }
+
+    bool delivered = false;
+    TIMESPAN lastTime = 0;
+
+private:
+    struct PendingFrame {
+        int arrival;
+        TIMESPAN time;
+    };
+    std::deque<PendingFrame> pending;
+};
+
+//the three streams of FrameSynchronizer::synchronize, acquired at the current sensor tick
+struct ReplayStreams {
+    ReplayStream color, depth, body;
+    int tick = 0;
+
+    bool hasColor() const { return true; }
+    bool hasDepth() const { return true; }
+    bool hasBody() const { return true; }
+    bool acquireColor(TIMESPAN& time) { return color.acquire(tick, time); }
+    bool acquireDepth(TIMESPAN& time) { return depth.acquire(tick, time); }
+    bool acquireBody(TIMESPAN& time) { return body.acquire(tick, time); }
+};
+
+//first body frame (session frame index) at which each TUG transition is seen, -1 if never
+struct TransitionFrames {
+    int stoodUp = -1;       //SpineMid 5 cm above its seated height
+    int targetDepth = -1;   //SpineMid closer than 1.5 m
+    int satDown = -1;       //back beyond 4.2 m after the target depth
+};
+
+static void observe(const SyntheticBody& body, int frameIndex, float seatedY, TransitionFrames& seen) {
+    const CameraSpacePoint& spineMid = body.joints[JointType_SpineMid].Position;
+    if (seen.stoodUp < 0 && spineMid.Y - seatedY > 0.05f) seen.stoodUp = frameIndex;
+    if (seen.stoodUp >= 0 && seen.targetDepth < 0 && spineMid.Z < 1.5f) seen.targetDepth = frameIndex;
+    if (seen.targetDepth >= 0 && seen.satDown < 0 && spineMid.Z > 4.2f) seen.satDown = frameIndex;
+}
+
+static int delay(int oldFrame, int newFrame) {
+    return (oldFrame >= 0 && newFrame >= 0) ? oldFrame - newFrame : 0;
+}
+
+//the match FrameSynchronizer must report for a body frame, from the newest frame the source delivered
+static bool expectedMatch(const ReplayStream& stream, TIMESPAN bodyTime, TIMESPAN tolerance) {
+    return stream.delivered && std::llabs(bodyTime - stream.lastTime) <= tolerance;
+}
+
+int main(int argc, char* argv[]) {
+    int sessions = argc > 1 ? std::max(1, std::atoi(argv[1])) : 50;
+    uint64_t failedChecks = 0;
+
+    const StreamFaults profiles[] = {
+        { "no faults", 0.00f, 0.000f, 0, 0.00f, 0.00f, 0.00f },
+        { "5% random", 0.05f, 0.000f, 0, 0.00f, 0.00f, 0.00f },
+        { "10% random", 0.10f, 0.000f, 0, 0.00f, 0.00f, 0.00f },
+        { "5% + bursts", 0.05f, 0.010f, 8, 0.00f, 0.00f, 0.00f },
+        { "20% + bursts", 0.20f, 0.020f, 8, 0.00f, 0.00f, 0.00f },
+        { "10% late", 0.00f, 0.000f, 0, 0.10f, 0.00f, 0.02f },
+        { "all faults", 0.10f, 0.010f, 8, 0.10f, 0.05f, 0.05f },
+    };
+
+    std::cout << std::left << std::setw(14) << "Faults" << std::right
+        << std::setw(12) << "Body/min" << std::setw(12) << "Old/min" << std::setw(12) << "New/min"
+        << std::setw(16) << "Recovered/min" << std::setw(16) << "Unmatched/min"
+        << std::setw(14) << "Late (frames)" << std::setw(12) << "Max late" << std::setw(10) << "Failed" << std::endl;
+
+    for (const StreamFaults& profile : profiles) {
+        uint64_t bodyFrames = 0, oldProcessed = 0, newProcessed = 0, unmatched = 0, profileFailed = 0;
+        double minutes = 0.0;
+        long totalLate = 0;
+        int transitions = 0, maxLate = 0;
+
+        for (int s = 0; s < sessions; ++s) {
+            SyntheticParams params;
+            params.scenario = Scenario_TimedUpGo;
+            params.seed = 1000 + s;
+            params.dropoutRate = 0.01f;
+            SyntheticMotionGenerator generator(params);
+            SyntheticRandom random;
+            random.seed(7000 + s);
+
+            FrameSynchronizer sync;
+            ReplayStreams streams;
+            std::vector<SyntheticBody> sessionBodies;
+            TransitionFrames oldSeen, newSeen;
+            SyntheticFrame frame;
+            float seatedY = 0.0f;
+            int burstRemaining = 0;
+
+            while (generator.next(frame)) {
+                if (frame.frameIndex == 0) seatedY = frame.bodies[frame.participantIndex].joints[JointType_SpineMid].Position.Y;
+                sessionBodies.push_back(frame.bodies[frame.participantIndex]);
+                streams.tick = frame.frameIndex;
+
+                if (burstRemaining == 0 && random.uniform() < profile.burstRate) burstRemaining = profile.burstLength;
+                bool colorSent = burstRemaining == 0 && random.uniform() >= profile.colorDropRate;
+                if (burstRemaining > 0) --burstRemaining;
+
+                //the color frame is stamped a few ms before the body frame of the same sensor tick
+                if (colorSent) {
+                    int late = random.uniform() < profile.colorLateRate ? 1 + (random.uniform() < 0.5f ? 1 : 0) : 0;
+                    streams.color.push(frame.frameIndex + late, frame.relativeTime - 20000 - static_cast<INT64>(random.uniform() * 30000));
+                }
+                if (random.uniform() >= profile.depthDropRate) streams.depth.push(frame.frameIndex, frame.relativeTime - 10000);
+                if (frame.bodyFrameAvailable) {
+                    ++bodyFrames;
+                    streams.body.push(frame.frameIndex + (random.uniform() < profile.bodyLateRate ? 1 : 0), frame.relativeTime);
+                }
+
+                bool bodyWaiting = streams.body.available(frame.frameIndex);
+                TIMESPAN colorBefore = sync.colorTime, depthBefore = sync.depthTime;
+                sync.synchronize(streams);
+
+                //checks of the pass against the source
+                bool passed = sync.hasNewBody == bodyWaiting;
+                if (!sync.hasNewColor) passed = passed && sync.colorTime == colorBefore;
+                if (!sync.hasNewDepth) passed = passed && sync.depthTime == depthBefore;
+                if (sync.hasNewBody) {
+                    passed = passed && sync.bodyTime == streams.body.lastTime
+                        && sync.match.colorMatched == expectedMatch(streams.color, sync.bodyTime, sync.matcher.matchTolerance)
+                        && sync.match.depthMatched == expectedMatch(streams.depth, sync.bodyTime, sync.matcher.matchTolerance)
+                        && (!streams.color.delivered || sync.match.colorOffset == sync.bodyTime - streams.color.lastTime);
+                }
+                if (!passed) ++profileFailed;
+
+                if (!sync.hasNewBody) continue;
+                int bodyIndex = static_cast<int>(sync.bodyTime / SyntheticMotionGenerator::frameTicks);
+                bodyIndex = std::min(std::max(bodyIndex, 0), static_cast<int>(sessionBodies.size()) - 1);
+                const SyntheticBody& body = sessionBodies[bodyIndex];
+
+                ++newProcessed;
+                observe(body, frame.frameIndex, seatedY, newSeen);
+                if (sync.hasNewColor) {
+                    ++oldProcessed;
+                    observe(body, frame.frameIndex, seatedY, oldSeen);
+                }
+            }
+
+            minutes += generator.duration() / 60.0;
+            unmatched += sync.matcher.bodyFramesWithoutColor;
+            int late[3] = { delay(oldSeen.stoodUp, newSeen.stoodUp), delay(oldSeen.targetDepth, newSeen.targetDepth),
+                delay(oldSeen.satDown, newSeen.satDown) };
+            for (int l : late) {
+                totalLate += l;
+                maxLate = std::max(maxLate, l);
+                ++transitions;
+            }
+        }
+        failedChecks += profileFailed;
+
+        std::cout << std::left << std::setw(14) << profile.name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(12) << bodyFrames / minutes << std::setw(12) << oldProcessed / minutes
+            << std::setw(12) << newProcessed / minutes << std::setw(16) << (newProcessed - oldProcessed) / minutes
+            << std::setw(16) << unmatched / minutes
+            << std::setw(14) << std::setprecision(2) << static_cast<double>(totalLate) / transitions
+            << std::setw(12) << maxLate << std::setw(10) << profileFailed << std::endl;
+    }
+    std::cout << (failedChecks ? "FAILED" : "passed") << std::endl;
+    return failedChecks ? 1 : 0;
+}
@@ -0,0 +1,147 @@
+//Checks the angle kernels of Common/JointKinematics.h
+//
+//  JointKinematicsCheck.exe
+//
+//atan2Approx and the SSE lanes must stay within 2e-6 rad of std::atan2 around the whole circle, the Euler angles of
+//random joint orientations within 0.001 degrees of the double formulas of the Pitch, Yaw and Roll prototype, and the
+//clinical angles of a seated and a standing skeleton must come out as built. Exit code 1 when a check fails.
+#include "../Common/JointKinematics.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+static int failures = 0;
+
+static void check(bool passed, const char* what, double measured) {
+    std::cout << (passed ? "ok    " : "FAIL  ") << what << " (" << measured << ")" << std::endl;
+    if (!passed) ++failures;
+}
+
+static Joint joint(JointType type, float x, float y, float z) {
+    Joint j;
+    j.JointType = type;
+    j.Position.X = x;
+    j.Position.Y = y;
+    j.Position.Z = z;
+    j.TrackingState = TrackingState_Tracked;
+    return j;
+}
+
+//sideways view in metres: trunk upright above SpineBase, thighs along -Z when seated, arms hanging
+static void skeleton(Joint* joints, bool seated) {
+    for (int j = 0; j < JointType_Count; ++j) joints[j] = joint(static_cast<JointType>(j), 0.0f, 0.0f, 2.0f);
+    joints[JointType_SpineBase] = joint(JointType_SpineBase, 0.0f, 0.5f, 2.0f);
+    joints[JointType_SpineMid] = joint(JointType_SpineMid, 0.0f, 0.8f, 2.0f);
+    joints[JointType_SpineShoulder] = joint(JointType_SpineShoulder, 0.0f, 1.1f, 2.0f);
+    for (int side = 0; side < 2; ++side) {
+        float x = side == 0 ? -0.1f : 0.1f;
+        JointType hip = side == 0 ? JointType_HipLeft : JointType_HipRight;
+        JointType knee = side == 0 ? JointType_KneeLeft : JointType_KneeRight;
+        JointType ankle = side == 0 ? JointType_AnkleLeft : JointType_AnkleRight;
+        JointType shoulder = side == 0 ? JointType_ShoulderLeft : JointType_ShoulderRight;
+        JointType elbow = side == 0 ? JointType_ElbowLeft : JointType_ElbowRight;
+        joints[hip] = joint(hip, x, 0.45f, 2.0f);
+        joints[knee] = seated ? joint(knee, x, 0.45f, 1.6f) : joint(knee, x, 0.05f, 2.0f);
+        joints[ankle] = seated ? joint(ankle, x, 0.05f, 1.6f) : joint(ankle, x, -0.35f, 2.0f);
+        joints[shoulder] = joint(shoulder, x * 2.0f, 1.1f, 2.0f);
+        joints[elbow] = joint(elbow, x * 2.0f, 0.8f, 2.0f);
+    }
+}
+
+int main() {
+    //atan2 around the circle and at the octant boundaries
+    double worstScalar = 0.0, worstSimd = 0.0;
+    for (int k = 0; k <= 720000; ++k) {
+        double theta = -3.14159265358979 + k * (2.0 * 3.14159265358979 / 720000);
+        float y = static_cast<float>(std::sin(theta) * 3.0), x = static_cast<float>(std::cos(theta) * 3.0);
+        double exact = std::atan2(static_cast<double>(y), static_cast<double>(x));
+        double difference = std::fabs(atan2Approx(y, x) - exact);
+        if (difference > 3.14159) difference = std::fabs(difference - 2.0 * 3.14159265358979);
+        worstScalar = std::max(worstScalar, difference);
+#ifdef JOINT_KINEMATICS_SSE2
+        float lanes[4];
+        _mm_storeu_ps(lanes, atan2Approx4(_mm_set1_ps(y), _mm_set1_ps(x)));
+        difference = std::fabs(lanes[0] - exact);
+        if (difference > 3.14159) difference = std::fabs(difference - 2.0 * 3.14159265358979);
+        worstSimd = std::max(worstSimd, difference);
+#endif
+    }
+    check(worstScalar <= 2e-6, "atan2Approx within 2e-6 rad", worstScalar);
+    check(worstSimd <= 2e-6, "atan2Approx4 within 2e-6 rad", worstSimd);
+    check(atan2Approx(0.0f, 0.0f) == 0.0f, "atan2Approx(0, 0) is 0", atan2Approx(0.0f, 0.0f));
+
+    //Euler angles of random orientations, every joint of every body
+    std::mt19937 random(7);
+    std::normal_distribution<float> gaussian(0.0f, 1.0f);
+    Joint joints[JointType_Count];
+    skeleton(joints, true);
+    JointOrientation orientations[BODY_COUNT][JointType_Count];
+    KinematicsFrame frame;
+    for (int b = 0; b < BODY_COUNT; ++b) {
+        for (int j = 0; j < JointType_Count; ++j) {
+            Vector4 q = { gaussian(random), gaussian(random), gaussian(random), gaussian(random) };
+            float norm = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+            q.x /= norm; q.y /= norm; q.z /= norm; q.w /= norm;
+            orientations[b][j].JointType = static_cast<JointType>(j);
+            orientations[b][j].Orientation = q;
+        }
+        frame.addBody(b, joints, orientations[b]);
+    }
+    frame.compute();
+    double worstEuler = 0.0;
+    for (int b = 0; b < BODY_COUNT; ++b) {
+        for (int j = 0; j < JointType_Count; ++j) {
+            const Vector4& q = orientations[b][j].Orientation;
+            double w = q.w, x = q.x, y = q.y, z = q.z;
+            double pitch = std::atan2(2 * (w * x + y * z), 1 - 2 * (x * x + y * y)) * 180.0 / 3.14159265358979;
+            double yaw = std::asin(std::min(1.0, std::max(-1.0, 2 * (w * y - z * x)))) * 180.0 / 3.14159265358979;
+            double roll = std::atan2(2 * (w * z + x * y), 1 - 2 * (y * y + z * z)) * 180.0 / 3.14159265358979;
+            const BodyKinematics& body = frame.body(b);
+            worstEuler = std::max(worstEuler, std::fabs(body.pitch[j] - pitch));
+            //asin loses float precision towards +-90 degrees, like the prototype's own float input did
+            if (std::fabs(yaw) < 85.0) worstEuler = std::max(worstEuler, std::fabs(body.yaw[j] - yaw));
+            worstEuler = std::max(worstEuler, std::fabs(body.roll[j] - roll));
+        }
+    }
+    check(worstEuler <= 1e-3, "pitch, yaw and roll within 0.001 degrees", worstEuler);
+
+    //clinical angles
+    KinematicsFrame postures;
+    Joint seated[JointType_Count], standing[JointType_Count];
+    skeleton(seated, true);
+    skeleton(standing, false);
+    postures.addBody(0, seated);
+    postures.addBody(3, standing);
+    postures.compute();
+    const BodyKinematics& sitting = postures.body(0);
+    const BodyKinematics& upright = postures.body(3);
+    check(std::fabs(sitting.angle[Angle_KneeFlexionLeft] - 90.0f) < 0.01f, "seated knee flexion 90", sitting.angle[Angle_KneeFlexionLeft]);
+    check(std::fabs(sitting.angle[Angle_HipFlexionRight] - 90.0f) < 0.01f, "seated hip flexion 90", sitting.angle[Angle_HipFlexionRight]);
+    check(std::fabs(upright.angle[Angle_KneeFlexionRight]) < 0.01f, "standing knee flexion 0", upright.angle[Angle_KneeFlexionRight]);
+    check(std::fabs(upright.angle[Angle_HipFlexionLeft]) < 0.01f, "standing hip flexion 0", upright.angle[Angle_HipFlexionLeft]);
+    check(std::fabs(upright.angle[Angle_TrunkFlexion]) < 0.01f, "straight trunk flexion 0", upright.angle[Angle_TrunkFlexion]);
+    check(std::fabs(upright.angle[Angle_TrunkInclination]) < 0.01f, "upright trunk inclination 0", upright.angle[Angle_TrunkInclination]);
+    check(std::fabs(upright.angle[Angle_ShoulderElevationLeft]) < 0.01f, "hanging arm elevation 0", upright.angle[Angle_ShoulderElevationLeft]);
+    check(upright.confidence[Angle_HipFlexionLeft] == 1.0f, "tracked joints confidence 1", upright.confidence[Angle_HipFlexionLeft]);
+    check(!postures.body(1).valid && postures.body(3).valid, "only added bodies valid", postures.body(1).valid);
+
+    //leaning forward 30 degrees at the hips
+    Joint leaning[JointType_Count];
+    skeleton(leaning, false);
+    leaning[JointType_SpineMid].Position.Y = 0.5f + 0.3f * 0.8660254f;
+    leaning[JointType_SpineMid].Position.Z = 2.0f - 0.3f * 0.5f;
+    leaning[JointType_SpineShoulder].Position.Y = 0.5f + 0.6f * 0.8660254f;
+    leaning[JointType_SpineShoulder].Position.Z = 2.0f - 0.6f * 0.5f;
+    leaning[JointType_KneeLeft].TrackingState = TrackingState_Inferred;
+    postures.clear();
+    postures.addBody(2, leaning);
+    postures.compute();
+    check(std::fabs(postures.body(2).angle[Angle_TrunkInclination] - 30.0f) < 0.01f, "trunk inclination 30", postures.body(2).angle[Angle_TrunkInclination]);
+    check(std::fabs(postures.body(2).angle[Angle_HipFlexionRight] - 30.0f) < 0.01f, "hip flexion 30", postures.body(2).angle[Angle_HipFlexionRight]);
+    check(postures.body(2).confidence[Angle_HipFlexionLeft] == 0.5f, "inferred knee confidence 0.5", postures.body(2).confidence[Angle_HipFlexionLeft]);
+    check(!postures.body(0).valid, "clear() drops the earlier bodies", postures.body(0).valid);
+
+    std::cout << (failures ? "FAILED" : "passed") << std::endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,502 @@
+//Soak replay of the sensor leases and the frame pipeline stages, at full speed
+//every session opens a replay sensor through ComLease, opens its color, depth and body readers into leases, and runs
+//the stages of FramePipeline.h on the synthetic session of one of the five tests:
+//  acquisition   own thread, FrameSynchronizer over the readers with a lease per acquired frame, the body frames
+//                snapshotted into the SpscQueue with backpressure, the color frames copied into a LatestValue mailbox
+//  test logic    this thread, per-frame FrameArena and FrameText work, the overlay text to the display mailbox
+//  display       own thread, takes the newest color frame and overlay
+//Some color and body frames fail to acquire, some color copies throw (the exception path), and some sessions are
+//stopped early like Enter in the window. The replay interfaces count their references: after every session each one
+//handed out must be back at zero and never below. The process RSS and the frame arena of the test logic thread must
+//stay flat after the first sessions. The color frames are 480x270 BGRA so a leaked frame shows in the RSS at once
+//without the copies of 1080p frames slowing the soak down. Exit code 1 on a leaked or over-released reference, a
+//growing RSS or a growing arena.
+//
+//  LeaseSoakReplay.exe [hours of frames, 1 by default; 12 is a station day]
+#include "../Common/SyntheticMotion.h"
+#include "../Common/KinectLease.h"
+#include "../Common/FrameMatcher.h"
+#include "../Common/FrameQueues.h"
+#include "../Common/FrameArena.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <unistd.h>
+#include <fstream>
+#endif
+
+//resident set size of the process in bytes
+static size_t residentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.WorkingSetSize;
+#else
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    statm >> pages >> resident;
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+static const HRESULT soakOk = S_OK;
+static const HRESULT soakNoFrame = static_cast<HRESULT>(0x8000000AL);     //E_PENDING, no new frame
+
+static const int colorWidth = 480, colorHeight = 270;
+static const size_t colorBytes = static_cast<size_t>(colorWidth) * colorHeight * 4;
+static const int depthPixels = 512 * 424;
+
+//an interface handed out by the replay sensor, with the reference counting of the SDK interfaces. The object stays
+//allocated until the session is checked, so a Release too many is counted instead of freeing it twice
+class SoakInterface {
+public:
+    virtual ~SoakInterface() = default;
+
+    unsigned long AddRef() { return static_cast<unsigned long>(++references); }
+    unsigned long Release() {
+        long left = --references;
+        if (left < 0) overReleases.fetch_add(1, std::memory_order_relaxed);
+        if (left == 0) released();
+        return static_cast<unsigned long>(std::max(left, 0L));
+    }
+    long referenceCount() const { return references.load(std::memory_order_relaxed); }
+
+    static std::atomic<uint64_t> overReleases;
+
+protected:
+    //the last reference is gone, frees the frame buffer like the SDK taking a frame back
+    virtual void released() {}
+
+private:
+    std::atomic<long> references{ 1 };
+};
+std::atomic<uint64_t> SoakInterface::overReleases{ 0 };
+
+//every interface of one session, checked and freed when the session is closed
+class SoakRegistry {
+public:
+    template<class T>
+    T* create() {
+        T* created = new T();
+        std::lock_guard<std::mutex> lock(mutex);
+        objects.emplace_back(created);
+        return created;
+    }
+
+    //interfaces with references still held
+    size_t outstanding() const {
+        size_t count = 0;
+        for (const auto& object : objects) {
+            if (object->referenceCount() > 0) ++count;
+        }
+        return count;
+    }
+
+    size_t size() const { return objects.size(); }
+    void clear() { objects.clear(); }
+
+private:
+    std::mutex mutex;
+    std::vector<std::unique_ptr<SoakInterface>> objects;
+};
+
+class SoakColorFrame : public SoakInterface {
+public:
+    TIMESPAN time = 0;
+    bool throwOnCopy = false;
+    std::vector<uint8_t> pixels;
+
+    HRESULT CopyConvertedFrameDataToArray(UINT capacity, BYTE* out) {
+        if (throwOnCopy) throw std::runtime_error("color copy failed");
+        std::memcpy(out, pixels.data(), std::min<size_t>(capacity, pixels.size()));
+        return soakOk;
+    }
+    HRESULT get_RelativeTime(TIMESPAN* relativeTime) { *relativeTime = time; return soakOk; }
+
+protected:
+    void released() override { std::vector<uint8_t>().swap(pixels); }
+};
+
+class SoakDepthFrame : public SoakInterface {
+public:
+    TIMESPAN time = 0;
+
+    HRESULT CopyFrameDataToArray(UINT capacity, UINT16* out) {
+        std::fill(out, out + std::min<UINT>(capacity, depthPixels), static_cast<UINT16>(2500 + time % 7));
+        return soakOk;
+    }
+    HRESULT get_RelativeTime(TIMESPAN* relativeTime) { *relativeTime = time; return soakOk; }
+};
+
+class SoakBody : public SoakInterface {
+public:
+    SyntheticBody body;
+
+    HRESULT get_IsTracked(BOOLEAN* tracked) { *tracked = body.isTracked; return soakOk; }
+    HRESULT get_TrackingId(UINT64* id) { *id = body.trackingId; return soakOk; }
+    HRESULT GetJoints(UINT capacity, Joint* joints) {
+        std::copy(body.joints, body.joints + std::min<UINT>(capacity, JointType_Count), joints);
+        return soakOk;
+    }
+    HRESULT GetJointOrientations(UINT capacity, JointOrientation* orientations) {
+        std::fill(orientations, orientations + std::min<UINT>(capacity, JointType_Count), JointOrientation());
+        return soakOk;
+    }
+};
+
+class SoakBodyFrame : public SoakInterface {
+public:
+    SyntheticFrame frame;
+    SoakRegistry* registry = nullptr;
+
+    //refreshes the bodies in place, an empty slot gets a new body whose reference the array owns
+    HRESULT GetAndRefreshBodyData(UINT capacity, SoakBody** bodies) {
+        for (UINT i = 0; i < capacity && i < BODY_COUNT; ++i) {
+            if (!bodies[i]) bodies[i] = registry->create<SoakBody>();
+            bodies[i]->body = frame.bodies[i];
+        }
+        return soakOk;
+    }
+    HRESULT get_RelativeTime(TIMESPAN* relativeTime) { *relativeTime = frame.relativeTime; return soakOk; }
+};
+
+//frame losses of the replay sensor
+struct SoakFaults {
+    float colorDropRate = 0.05f;
+    float colorThrowRate = 0.002f;
+    float bodyDropRate = 0.01f;
+};
+
+//the sensor: one synthetic session, a frame of each stream per tick
+class SoakSensor : public SoakInterface {
+public:
+    SoakRegistry* registry = nullptr;
+
+    void start(const SyntheticParams& params, const SoakFaults& sessionFaults, uint64_t seed) {
+        generator.reset(new SyntheticMotionGenerator(params));
+        faults = sessionFaults;
+        random.seed(seed);
+    }
+
+    //the next sensor tick, false at the end of the session
+    bool nextTick() {
+        if (!generator->next(current)) return false;
+        colorPending = random.uniform() >= faults.colorDropRate;
+        colorThrows = random.uniform() < faults.colorThrowRate;
+        bodyPending = current.bodyFrameAvailable && random.uniform() >= faults.bodyDropRate;
+        depthPending = true;
+        return true;
+    }
+
+    HRESULT AcquireColor(SoakColorFrame** frame) {
+        if (!colorPending) return soakNoFrame;
+        colorPending = false;
+        SoakColorFrame* color = registry->create<SoakColorFrame>();
+        color->time = current.relativeTime - 20000;
+        color->throwOnCopy = colorThrows;
+        color->pixels.assign(colorBytes, static_cast<uint8_t>(current.frameIndex));
+        *frame = color;
+        return soakOk;
+    }
+
+    HRESULT AcquireDepth(SoakDepthFrame** frame) {
+        if (!depthPending) return soakNoFrame;
+        depthPending = false;
+        SoakDepthFrame* depth = registry->create<SoakDepthFrame>();
+        depth->time = current.relativeTime - 10000;
+        *frame = depth;
+        return soakOk;
+    }
+
+    HRESULT AcquireBody(SoakBodyFrame** frame) {
+        if (!bodyPending) return soakNoFrame;
+        bodyPending = false;
+        SoakBodyFrame* body = registry->create<SoakBodyFrame>();
+        body->frame = current;
+        body->registry = registry;
+        *frame = body;
+        return soakOk;
+    }
+
+private:
+    std::unique_ptr<SyntheticMotionGenerator> generator;
+    SoakFaults faults;
+    SyntheticRandom random;
+    SyntheticFrame current;
+    bool colorPending = false, colorThrows = false, depthPending = false, bodyPending = false;
+};
+
+//a stream reader of the sensor, opened into a lease
+template<class Frame, HRESULT(SoakSensor::*acquire)(Frame**)>
+class SoakReader : public SoakInterface {
+public:
+    SoakSensor* sensor = nullptr;
+    HRESULT AcquireLatestFrame(Frame** frame) { return (sensor->*acquire)(frame); }
+};
+typedef SoakReader<SoakColorFrame, &SoakSensor::AcquireColor> SoakColorReader;
+typedef SoakReader<SoakDepthFrame, &SoakSensor::AcquireDepth> SoakDepthReader;
+typedef SoakReader<SoakBodyFrame, &SoakSensor::AcquireBody> SoakBodyReader;
+
+template<class Reader>
+static HRESULT openReader(SoakSensor* sensor, SoakRegistry& registry, Reader** reader) {
+    *reader = registry.create<Reader>();
+    (*reader)->sensor = sensor;
+    return soakOk;
+}
+
+//the streams of FrameSynchronizer::synchronize over the readers, as SynchronizedFrameReader acquires them
+struct SoakStreams {
+    ComLease<SoakColorReader> colorReader;
+    ComLease<SoakDepthReader> depthReader;
+    ComLease<SoakBodyReader> bodyReader;
+    SoakBody* bodies[BODY_COUNT] = {};
+    BYTE* colorTarget = nullptr;                //the mailbox slot the color frame is copied into
+    std::vector<UINT16> depthData = std::vector<UINT16>(depthPixels);
+
+    ~SoakStreams() {
+        for (int i = 0; i < BODY_COUNT; ++i) SafeRelease(bodies[i]);
+    }
+
+    bool hasColor() const { return static_cast<bool>(colorReader); }
+    bool hasDepth() const { return static_cast<bool>(depthReader); }
+    bool hasBody() const { return static_cast<bool>(bodyReader); }
+
+    bool acquireColor(TIMESPAN& time) {
+        ComLease<SoakColorFrame> frame;
+        if (colorReader->AcquireLatestFrame(frame.put()) != soakOk) return false;
+        if (frame->CopyConvertedFrameDataToArray(static_cast<UINT>(colorBytes), colorTarget) != soakOk) return false;
+        return frame->get_RelativeTime(&time) == soakOk;
+    }
+
+    bool acquireDepth(TIMESPAN& time) {
+        ComLease<SoakDepthFrame> frame;
+        if (depthReader->AcquireLatestFrame(frame.put()) != soakOk) return false;
+        if (frame->CopyFrameDataToArray(static_cast<UINT>(depthData.size()), depthData.data()) != soakOk) return false;
+        return frame->get_RelativeTime(&time) == soakOk;
+    }
+
+    bool acquireBody(TIMESPAN& time) {
+        ComLease<SoakBodyFrame> frame;
+        if (bodyReader->AcquireLatestFrame(frame.put()) != soakOk) return false;
+        if (frame->GetAndRefreshBodyData(BODY_COUNT, bodies) != soakOk) return false;
+        return frame->get_RelativeTime(&time) == soakOk;
+    }
+};
+
+struct SoakColorImage {
+    std::vector<uint8_t> pixels;
+    TIMESPAN relativeTime = 0;
+};
+
+struct SessionResult {
+    uint64_t frames = 0;            //sensor ticks
+    uint64_t bodyFrames = 0;        //evaluated by the test logic
+    uint64_t colorExceptions = 0;
+    uint64_t displayed = 0;
+    bool stoppedEarly = false;
+};
+
+//one session: sensor and readers opened into leases, the three stages run until the session ends or is stopped
+static SessionResult runSession(SoakRegistry& registry, int session) {
+    SessionResult result;
+    SyntheticParams params;
+    params.scenario = static_cast<SyntheticScenario>(session % Scenario_Count);
+    params.seed = 9000 + session;
+    params.inferredRate = 0.02f;
+    SoakFaults faults;
+
+    ComLease<SoakSensor> sensor(registry.create<SoakSensor>());
+    sensor->registry = &registry;
+    sensor->start(params, faults, 5000 + session);
+
+    SoakStreams streams;
+    {
+        //opened into temporary leases and moved into the streams, as a reader handed on by its opener
+        ComLease<SoakColorReader> color;
+        ComLease<SoakDepthReader> depth;
+        ComLease<SoakBodyReader> body;
+        openReader(sensor.get(), registry, color.put());
+        openReader(sensor.get(), registry, depth.put());
+        openReader(sensor.get(), registry, body.put());
+        streams.colorReader = std::move(color);
+        streams.depthReader = std::move(depth);
+        streams.bodyReader = std::move(body);
+    }
+
+    SpscQueue<BodyFrame> bodyQueue(16);
+    LatestValue<SoakColorImage> colorMailbox;
+    LatestValue<FrameText> overlayMailbox;
+    for (int s = 0; s < 3; ++s) colorMailbox.slot(s).pixels.assign(colorBytes, 0);
+    StageSignal bodySignal, bodyQueueSpace, displaySignal;
+    std::atomic<bool> running{ true }, acquisitionDone{ false };
+    std::atomic<uint64_t> frames{ 0 }, colorExceptions{ 0 }, displayed{ 0 };
+
+    std::thread acquisition([&] {
+        FrameSynchronizer sync;
+        BodyFrame frame;
+        uint64_t spaceSeen = 0;
+        while (running.load(std::memory_order_acquire) && sensor->nextTick()) {
+            frames.fetch_add(1, std::memory_order_relaxed);
+            streams.colorTarget = colorMailbox.writeSlot().pixels.data();
+            try {
+                sync.synchronize(streams);
+            }
+            catch (const std::exception&) {
+                colorExceptions.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (sync.hasNewColor) {
+                colorMailbox.writeSlot().relativeTime = sync.colorTime;
+                colorMailbox.publish();
+                displaySignal.notify();
+            }
+            if (sync.hasNewBody) {
+                frame.relativeTime = sync.bodyTime;
+                frame.match = sync.match;
+                for (int i = 0; i < BODY_COUNT; ++i) snapshotBody(streams.bodies[i], frame.bodies[i]);
+                while (!bodyQueue.tryPush(frame) && running.load(std::memory_order_acquire)) bodyQueueSpace.wait(spaceSeen, 5);
+                bodySignal.notify();
+            }
+        }
+        acquisitionDone.store(true, std::memory_order_release);
+        bodySignal.notify();
+    });
+
+    std::thread display([&] {
+        uint64_t seen = 0;
+        unsigned checksum = 0;
+        while (running.load(std::memory_order_acquire)) {
+            overlayMailbox.take();
+            if (colorMailbox.take()) {
+                const SoakColorImage& image = colorMailbox.readSlot();
+                checksum += image.pixels[image.pixels.size() / 2] + static_cast<unsigned>(overlayMailbox.readSlot().size());
+                displayed.fetch_add(1, std::memory_order_relaxed);
+            }
+            else {
+                displaySignal.wait(seen, 15);
+            }
+        }
+        if (checksum == 1) std::cout << " ";
+    });
+
+    //test logic: every third session is stopped part way, like Enter in the window
+    uint64_t stopAfter = session % 3 == 2 ? 150 + session % 200 : UINT64_MAX;
+    uint64_t bodySeen = 0;
+    BodyFrame frame;
+    for (;;) {
+        if (!bodyQueue.tryPop(frame)) {
+            if (acquisitionDone.load(std::memory_order_acquire) && !bodyQueue.tryPop(frame)) break;
+            bodySignal.wait(bodySeen, 5);
+            continue;
+        }
+        bodyQueueSpace.notify();
+
+        ArenaVector<CameraSpacePoint> points(frameArena());
+        points.reserve(JointType_Count);
+        for (int i = 0; i < BODY_COUNT; ++i) {
+            if (!frame.bodies[i].isTracked) continue;
+            for (int j = 0; j < JointType_Count; ++j) points.push_back(frame.bodies[i].joints[j].Position);
+        }
+        FrameText& text = overlayMailbox.writeSlot();
+        text.clear();
+        text << "Joints: " << static_cast<int>(points.size()) << " SpineMid depth: "
+            << decimals(points.empty() ? 0.0f : points[JointType_SpineMid].Z, 2) << " m";
+        overlayMailbox.publish();
+        displaySignal.notify();
+        frameArena().reset();
+
+        if (++result.bodyFrames >= stopAfter) {
+            result.stoppedEarly = true;
+            break;
+        }
+    }
+
+    running.store(false, std::memory_order_release);
+    bodyQueueSpace.notify();
+    displaySignal.notify();
+    acquisition.join();
+    display.join();
+
+    result.frames = frames.load();
+    result.colorExceptions = colorExceptions.load();
+    result.displayed = displayed.load();
+    return result;
+}
+
+int main(int argc, char** argv) {
+    double hours = argc > 1 ? std::max(0.01, std::atof(argv[1])) : 1.0;
+    const uint64_t targetFrames = static_cast<uint64_t>(hours * 3600.0 * 30.0);
+    const size_t rssTolerance = 4u << 20;       //allocator noise, a leaked color frame is 0.5 MB
+
+    SoakRegistry registry;
+    uint64_t totalFrames = 0, bodyFrames = 0, colorExceptions = 0, displayed = 0, interfaces = 0;
+    uint64_t leakedSessions = 0, leakedInterfaces = 0;
+    int sessions = 0, stoppedEarly = 0;
+    size_t warmRss = 0, maxRss = 0;
+    uint64_t warmArenaAllocations = 0;
+    size_t warmArenaHighWater = 0;
+    const int warmupSessions = 10;
+
+    auto start = std::chrono::steady_clock::now();
+    while (totalFrames < targetFrames) {
+        SessionResult result = runSession(registry, sessions);
+        size_t outstanding = registry.outstanding();
+        interfaces += registry.size();
+        if (outstanding > 0) {
+            ++leakedSessions;
+            leakedInterfaces += outstanding;
+        }
+        registry.clear();
+
+        totalFrames += result.frames;
+        bodyFrames += result.bodyFrames;
+        colorExceptions += result.colorExceptions;
+        displayed += result.displayed;
+        if (result.stoppedEarly) ++stoppedEarly;
+        ++sessions;
+
+        size_t rss = residentBytes();
+        if (sessions == warmupSessions) {
+            warmRss = rss;
+            warmArenaAllocations = frameArena().heapAllocations;
+            warmArenaHighWater = frameArena().highWater;
+        }
+        if (sessions > warmupSessions) maxRss = std::max(maxRss, rss);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    bool rssFlat = sessions <= warmupSessions || maxRss <= warmRss + rssTolerance;
+    bool arenaFlat = sessions <= warmupSessions
+        || (frameArena().heapAllocations == warmArenaAllocations && frameArena().highWater == warmArenaHighWater);
+    uint64_t overReleases = SoakInterface::overReleases.load();
+
+    std::cout << std::fixed << std::setprecision(2)
+        << "sessions " << sessions << " (" << stoppedEarly << " stopped early), " << totalFrames << " sensor frames = "
+        << totalFrames / 30.0 / 3600.0 << " h of frames in " << seconds << " s" << std::endl
+        << "body frames evaluated " << bodyFrames << ", color frames displayed " << displayed
+        << ", color copies that threw " << colorExceptions << std::endl
+        << "interfaces handed out " << interfaces << ", still referenced " << leakedInterfaces << " (in "
+        << leakedSessions << " sessions), released too often " << overReleases << std::endl
+        << "RSS after warm-up " << warmRss / 1048576.0 << " MB, max after " << maxRss / 1048576.0 << " MB"
+        << (rssFlat ? "" : "  GROWING") << std::endl
+        << "arena heap blocks " << frameArena().heapAllocations << " (" << warmArenaAllocations << " after warm-up), high water "
+        << frameArena().highWater << " bytes" << (arenaFlat ? "" : "  GROWING") << std::endl;
+
+    bool passed = leakedInterfaces == 0 && overReleases == 0 && rssFlat && arenaFlat;
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,242 @@
+//Replays synthetic sessions of a day of participants through ParticipantIdentifier
+//every participant (body size and arm length on a lattice, at least 2.7 cm RMS of bone length apart) is enrolled from a
+//TUG session, then does the FRT, SFB and SOOLWEO sessions with other noise. The day is replayed with a per-session joint
+//bias of 0, 1 and 2 cm (3D RMS, a constant offset of every joint for the session, so the bone lengths change with the
+//pose), as the sensor shows from one session to the next. A SOOLWEO session whose second half is another participant
+//under the same tracking ID must be reported as a swap, the same session without the change must not.
+//A session left ambiguous is answered by the operator, who knows the participant: Y when the candidate is them, N for a
+//first session, no answer otherwise (the record stays unlinked); the questions are counted. Without bias every
+//participant must be matched every time without a question. At every bias a session linked to someone else, a
+//participant enrolled twice, a missed swap or a false one is a failure. Two registries on one file, as two tests open
+//side by side, must hand out different IDs and refuse a participant the other enrolled. Also times one match against a
+//full day of signatures. Exit code 1 on a failure.
+//
+//  ParticipantReidReplay.exe [participants, at most 8]
+#include "../Common/SyntheticMotion.h"
+#include "../Common/ParticipantIdentity.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const int latticeSize = 8;
+
+//statures 10% apart from 0.85 to 1.15 of the default, each with short or long arms
+static void participantScale(int participant, SyntheticParams& params) {
+    params.bodyScale = 0.85f + 0.1f * ((participant / 2) % 4);
+    params.armScale = participant % 2 ? 1.13f : 0.87f;
+}
+
+static std::vector<SyntheticFrame> session(SyntheticScenario scenario, uint64_t seed, int participant, float noise, float inferred, float bias) {
+    SyntheticParams params;
+    params.scenario = scenario;
+    params.seed = seed;
+    params.jointNoise = noise;
+    params.inferredRate = inferred;
+    params.stanceDuration = 4.0f;
+    params.jointBias = bias / std::sqrt(3.0f);     //per axis
+    participantScale(participant, params);
+    SyntheticMotionGenerator generator(params);
+    std::vector<SyntheticFrame> frames;
+    SyntheticFrame frame;
+    while (generator.next(frame)) frames.push_back(frame);
+    return frames;
+}
+
+//the first decision of a session, the ID after the operator's answer and the frame of the swap (-1 none)
+struct IdentityResult {
+    IdentityEvent first = Identity_None;    //Matched, Enrolled or Ambiguous, None when never decided
+    std::string id;                         //"" when left unlinked
+    std::string candidate;                  //ambiguousWith() of an ambiguous session
+    float distance = 0.0f;
+    int swapFrame = -1;
+};
+
+//known is the participant's ID for the operator, "" for a first session
+static IdentityResult identify(ParticipantIdentifier& identity, const std::vector<SyntheticFrame>& frames, const std::string& known = "") {
+    IdentityResult result;
+    identity.reset();
+    for (size_t f = 0; f < frames.size(); ++f) {
+        IdentityEvent event = identity.update(frames[f].bodies[frames[f].participantIndex].joints);
+        if (event == Identity_Matched || event == Identity_Enrolled || event == Identity_Ambiguous) {
+            result.first = event;
+            result.distance = identity.matchedDistance();
+            if (event == Identity_Ambiguous) {
+                result.candidate = identity.ambiguousWith();
+                if (known.empty()) identity.confirmNew();
+                else if (result.candidate == known) identity.confirmCandidate();
+            }
+            result.id = identity.participantId();
+        }
+        else if (event == Identity_Swapped && result.swapFrame < 0) {
+            result.swapFrame = static_cast<int>(f);
+        }
+    }
+    return result;
+}
+
+//bone length bias of a session: the signature with bias against the one without, noise free
+static float sessionBias(int participant, uint64_t seed, float bias) {
+    BoneSignatureAccumulator clean, biased;
+    std::vector<SyntheticFrame> cleanFrames = session(Scenario_SingleLegStance, seed, participant, 0.0f, 0.0f, 0.0f);
+    std::vector<SyntheticFrame> biasedFrames = session(Scenario_SingleLegStance, seed, participant, 0.0f, 0.0f, bias);
+    for (const SyntheticFrame& frame : cleanFrames) clean.add(frame.bodies[frame.participantIndex].joints);
+    for (const SyntheticFrame& frame : biasedFrames) biased.add(frame.bodies[frame.participantIndex].joints);
+    return boneSignatureDistance(biased.signature(), clean.signature().length);
+}
+
+//a body of the given scale, every bone measured
+static BoneSignature scaledSignature(float scale) {
+    BoneSignature s;
+    for (int b = 0; b < boneSignatureLength; ++b) {
+        s.length[b] = scale * (0.15f + 0.01f * b);
+        s.weight[b] = boneSignatureWeight(b);
+    }
+    return s;
+}
+
+//two tests open side by side on one participants file, each registry loaded before the other enrolled; true when
+//they hand out different IDs and the second refuses a participant the first enrolled
+static bool sharedFileCheck() {
+    const std::string file = "ParticipantReidReplay_participants.csv";
+    std::remove(file.c_str());
+    ParticipantRegistry first, second;
+    first.load(file, "20250101");
+    second.load(file, "20250101");
+    std::string a, b, c, refused;
+    bool passed = first.enroll(scaledSignature(0.8f), a) && second.enroll(scaledSignature(1.0f), b, 0.04f) && a != b
+        && first.enroll(scaledSignature(1.2f), c) && c != a && c != b
+        && !second.enroll(scaledSignature(1.21f), refused, 0.04f);
+    std::cout << "shared file: " << a << ", " << b << ", " << c << (refused.empty() ? ", near one refused" : ", enrolled twice as " + refused)
+        << (passed ? "" : "  FAILED") << std::endl;
+    std::remove(file.c_str());
+    return passed;
+}
+
+int main(int argc, char** argv) {
+    int participants = argc > 1 ? std::max(2, std::min(latticeSize, std::atoi(argv[1]))) : latticeSize;
+    int failures = 0;
+    const float biases[] = { 0.0f, 0.01f, 0.02f };
+    const SyntheticScenario tests[3] = { Scenario_FunctionalReach, Scenario_SeatedForwardBend, Scenario_SingleLegStance };
+    ParticipantIdentifier identity;
+
+    std::cout << "Bias cm  Bone bias cm  Enrolled  Matched  Asked  Confirmed  Unlinked  Enrolled again  Wrong  Swaps caught  Swap s  False swaps" << std::endl;
+    for (float bias : biases) {
+        identity.registry.load("", "20250101");     //no file, nothing written
+        std::vector<std::string> ids(participants);
+        int enrolled = 0, matched = 0, asked = 0, confirmed = 0, unlinked = 0, enrolledAgain = 0, wrong = 0;
+        float boneBias = 0.0f;
+        std::vector<std::string> problems;
+
+        for (int p = 0; p < participants; ++p) {
+            boneBias += sessionBias(p, 300 + p, bias) / participants;
+            IdentityResult first = identify(identity, session(Scenario_TimedUpGo, 300 + p, p, 0.005f, 0.02f, bias));
+            ids[p] = first.id;
+            if (first.first == Identity_Enrolled) {
+                ++enrolled;
+            }
+            else if (first.first == Identity_Ambiguous && !first.id.empty()) {
+                ++asked;
+                ++confirmed;
+            }
+            else {
+                ++wrong;
+                problems.push_back("participant " + std::to_string(p) + " not enrolled, matched to " + first.id);
+            }
+
+            for (int t = 0; t < 3; ++t) {
+                float noise = 0.005f + 0.0025f * ((p + t) % 3);
+                IdentityResult result = identify(identity, session(tests[t], 400 + p * 3 + t, p, noise, 0.05f, bias), ids[p]);
+                if (result.first == Identity_Matched && result.id == ids[p]) {
+                    ++matched;
+                    continue;
+                }
+                std::ostringstream problem;
+                problem << "participant " << p << " test " << t << ": " << std::fixed << std::setprecision(2);
+                if (result.first == Identity_Ambiguous) {
+                    ++asked;
+                    if (result.id == ids[p]) ++confirmed;
+                    else ++unlinked;
+                    problem << "asked, near " << result.candidate << " at " << result.distance * 100.0f << " cm, "
+                        << (result.id.empty() ? "left unlinked" : "confirmed");
+                }
+                else if (result.first == Identity_Enrolled) {
+                    ++enrolledAgain;
+                    problem << "ENROLLED AGAIN as " << result.id;
+                }
+                else {
+                    ++wrong;
+                    problem << "MATCHED TO " << result.id << " at " << result.distance * 100.0f << " cm";
+                }
+                problems.push_back(problem.str());
+            }
+        }
+        failures += wrong + enrolledAgain;
+        if (bias == 0.0f && matched != 3 * participants) ++failures;
+
+        //swaps: participant p for the first half of a SOOLWEO session, participant p + 1 after it
+        int swapsCaught = 0, falseSwaps = 0;
+        double latency = 0.0;
+        for (int p = 0; p < participants; ++p) {
+            std::vector<SyntheticFrame> frames = session(Scenario_SingleLegStance, 500 + p, p, 0.0075f, 0.05f, bias);
+            std::vector<SyntheticFrame> other = session(Scenario_SingleLegStance, 600 + p, (p + 1) % participants, 0.0075f, 0.05f, bias);
+            IdentityResult plain = identify(identity, frames);
+            if (plain.swapFrame >= 0) {
+                ++falseSwaps;
+                ++failures;
+                problems.push_back("participant " + std::to_string(p) + ": FALSE SWAP without the change");
+            }
+            size_t half = frames.size() / 2;
+            for (size_t f = half; f < frames.size() && f < other.size(); ++f) {
+                frames[f].bodies[frames[f].participantIndex] = other[f].bodies[other[f].participantIndex];
+            }
+            IdentityResult swapped = identify(identity, frames);
+            if (swapped.swapFrame >= 0) {
+                ++swapsCaught;
+                latency += (swapped.swapFrame - static_cast<int>(half)) / 30.0;
+            }
+            else {
+                ++failures;
+                problems.push_back("participant " + std::to_string(p) + ": swap to " + std::to_string((p + 1) % participants) + " MISSED");
+            }
+        }
+
+        std::cout << std::fixed << std::setprecision(1) << std::setw(7) << bias * 100.0f << std::setw(14) << std::setprecision(2)
+            << boneBias * 100.0f << std::setw(10) << enrolled << std::setw(9) << matched << std::setw(7) << asked
+            << std::setw(11) << confirmed << std::setw(10) << unlinked << std::setw(16) << enrolledAgain << std::setw(7) << wrong << std::setw(11) << swapsCaught << "/" << participants
+            << std::setw(8) << (swapsCaught ? latency / swapsCaught : 0.0) << std::setw(13) << falseSwaps << std::endl;
+        for (const std::string& problem : problems) std::cout << "    " << problem << std::endl;
+    }
+
+    if (!sharedFileCheck()) ++failures;
+
+    //one match against a full day of signatures
+    ParticipantRegistry day;
+    day.load("", "20250101");
+    BoneSignature query = identity.accumulator.signature();
+    std::string id;
+    for (int p = 0; p < ParticipantRegistry::capacity; ++p) {
+        BoneSignature s = query;
+        for (int b = 0; b < boneSignatureLength; ++b) s.length[b] *= 0.8f + 0.4f * p / ParticipantRegistry::capacity;
+        day.enroll(s, id);
+    }
+    const int repeats = 200000;
+    float distance = 0.0f, secondDistance = 0.0f, sink = 0.0f;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        query.length[r % boneSignatureLength] += 1e-7f;
+        sink += static_cast<float>(day.nearest(query, distance, secondDistance)) + distance;
+    }
+    double perMatch = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / repeats;
+
+    std::cout << "match against " << day.size() << " signatures: " << std::setprecision(3) << perMatch << " us"
+        << (sink == -1.0f ? " " : "") << std::endl;
+    std::cout << (failures ? "FAILED" : "passed") << std::endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,184 @@
+//Replays synthetic Functional Reach sessions through ReachTrajectory, the old elbow drop check and CompensationDetector
+//reports, per session, the true forward reach of the hand (the same session without noise), the reach and detection
+//frame of the old FRT logic (X travel of the hand and elbow, maximum reached once the elbow is 5 cm short of its
+//maximum) and of ReachTrajectory, and checks that a second replay gives bit for bit the same peak. The compensation
+//detector must stay quiet on the plain sessions and flag the same sessions with a step, a heel rise or a trunk
+//rotation added during the reach.
+//
+//  ReachPeakReplay.exe [sessions]
+#include "../Common/SyntheticMotion.h"
+#include "../Common/ReachTrajectory.h"
+#include "../Common/ReachCompensation.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+struct PeakResult {
+    float reach = 0.0f;                 //m
+    int frame = -1;                     //frame the peak was called, -1 never
+};
+
+static std::vector<SyntheticFrame> session(uint64_t seed, float noise, float inferredRate, float reachDistance) {
+    SyntheticParams params;
+    params.scenario = Scenario_FunctionalReach;
+    params.seed = seed;
+    params.jointNoise = noise;
+    params.inferredRate = inferredRate;
+    params.reachDistance = reachDistance;
+    SyntheticMotionGenerator generator(params);
+    std::vector<SyntheticFrame> frames;
+    SyntheticFrame frame;
+    while (generator.next(frame)) frames.push_back(frame);
+    return frames;
+}
+
+//the arms raised frame, the first with the hand level with the elbow and in front of it (as FRT checks)
+static int armsRaisedFrame(const std::vector<SyntheticFrame>& frames) {
+    for (size_t f = 0; f < frames.size(); ++f) {
+        const Joint* joints = frames[f].bodies[frames[f].participantIndex].joints;
+        if (std::fabs(joints[JointType_ElbowRight].Position.Y - joints[JointType_HandRight].Position.Y) < 0.10f &&
+            joints[JointType_ElbowRight].Position.X > joints[JointType_HandRight].Position.X) return static_cast<int>(f);
+    }
+    return -1;
+}
+
+static PeakResult oldDetector(const std::vector<SyntheticFrame>& frames, int raised) {
+    PeakResult result;
+    const Joint* start = frames[raised].bodies[frames[raised].participantIndex].joints;
+    float maxHand = 0.0f, maxElbow = 0.0f;
+    for (size_t f = raised; f < frames.size(); ++f) {
+        const Joint* joints = frames[f].bodies[frames[f].participantIndex].joints;
+        float hand = std::fabs(start[JointType_HandRight].Position.X - joints[JointType_HandRight].Position.X);
+        float elbow = std::fabs(start[JointType_ElbowRight].Position.X - joints[JointType_ElbowRight].Position.X);
+        maxHand = std::max(maxHand, hand);
+        maxElbow = std::max(maxElbow, elbow);
+        if (maxElbow - elbow > 0.05f) {
+            result.reach = std::max(maxHand, maxElbow);
+            result.frame = static_cast<int>(f);
+            return result;
+        }
+    }
+    return result;
+}
+
+static PeakResult trajectoryDetector(const std::vector<SyntheticFrame>& frames, int raised) {
+    static ReachTrajectory trajectory;  //the ring is 50 KB, like the global in FRT
+    PeakResult result;
+    trajectory.start(frames[raised].bodies[frames[raised].participantIndex].joints, frames[raised].relativeTime * 1e-7);
+    for (size_t f = raised + 1; f < frames.size(); ++f) {
+        if (trajectory.add(frames[f].bodies[frames[f].participantIndex].joints, frames[f].relativeTime * 1e-7)) {
+            result.reach = trajectory.peakReach();
+            result.frame = static_cast<int>(f);
+            return result;
+        }
+    }
+    return result;
+}
+
+//the session with one compensation blended in over half a second, from 1.5 s after the arms are raised
+static std::vector<SyntheticFrame> compensated(std::vector<SyntheticFrame> frames, int raised, CompensationFlag flag) {
+    for (size_t f = raised + 45; f < frames.size(); ++f) {
+        float k = std::min(1.0f, (f - raised - 45) / 15.0f);
+        Joint* joints = frames[f].bodies[frames[f].participantIndex].joints;
+        if (flag == Compensation_Step) {
+            //the right foot steps 15 cm forward (-X)
+            joints[JointType_AnkleRight].Position.X -= 0.15f * k;
+            joints[JointType_FootRight].Position.X -= 0.15f * k;
+        }
+        else if (flag == Compensation_HeelRise) {
+            joints[JointType_AnkleLeft].Position.Y += 0.05f * k;
+            joints[JointType_AnkleRight].Position.Y += 0.05f * k;
+        }
+        else if (flag == Compensation_TrunkRotation) {
+            //the shoulders turn 25 degrees about SpineShoulder
+            float angle = 25.0f * 0.0174533f * k;
+            const CameraSpacePoint center = joints[JointType_SpineShoulder].Position;
+            for (JointType j : { JointType_ShoulderLeft, JointType_ShoulderRight }) {
+                float dx = joints[j].Position.X - center.X, dz = joints[j].Position.Z - center.Z;
+                joints[j].Position.X = center.X + dx * std::cos(angle) - dz * std::sin(angle);
+                joints[j].Position.Z = center.Z + dx * std::sin(angle) + dz * std::cos(angle);
+            }
+        }
+    }
+    return frames;
+}
+
+static int compensationFlags(const std::vector<SyntheticFrame>& frames, int raised) {
+    CompensationDetector detector;
+    detector.start();
+    for (size_t f = raised; f < frames.size(); ++f) detector.update(frames[f].bodies[frames[f].participantIndex].joints);
+    return detector.flags();
+}
+
+int main(int argc, char** argv) {
+    int sessions = argc > 1 ? std::max(1, std::atoi(argv[1])) : 20;
+    int failures = 0;
+    double oldError = 0.0, newError = 0.0;
+    int oldMissed = 0, newMissed = 0;
+    int falseFlags = 0, missedFlags = 0;
+
+    std::cout << "session  reach(cm)  truth  old(cm) frame  new(cm) frame  repeat  compensation (plain / step, heel, rotation)" << std::endl;
+    for (int s = 0; s < sessions; ++s) {
+        float reachDistance = 0.20f + 0.02f * (s % 8);
+        float noise = 0.005f + 0.0025f * (s % 4);
+        float inferred = (s % 3) * 0.05f;
+
+        std::vector<SyntheticFrame> clean = session(100 + s, 0.0f, 0.0f, reachDistance);
+        std::vector<SyntheticFrame> noisy = session(100 + s, noise, inferred, reachDistance);
+        int raised = armsRaisedFrame(clean);
+        if (raised < 0) {
+            std::cout << s << "  no arms raised frame" << std::endl;
+            ++failures;
+            continue;
+        }
+
+        //true reach: the largest forward travel of the noise-free hand, forward as ReachTrajectory takes it
+        ReachTrajectory truthAxis;
+        truthAxis.start(clean[raised].bodies[clean[raised].participantIndex].joints, 0.0);
+        const Joint* origin = clean[raised].bodies[clean[raised].participantIndex].joints;
+        float truth = 0.0f;
+        for (size_t f = raised; f < clean.size(); ++f) {
+            const Joint* joints = clean[f].bodies[clean[f].participantIndex].joints;
+            truth = std::max(truth, truthAxis.forwardDistance(joints[JointType_HandRight].Position.X - origin[JointType_HandRight].Position.X,
+                joints[JointType_HandRight].Position.Z - origin[JointType_HandRight].Position.Z));
+        }
+
+        PeakResult before = oldDetector(noisy, raised);
+        PeakResult after = trajectoryDetector(noisy, raised);
+        PeakResult again = trajectoryDetector(noisy, raised);
+        bool repeatable = after.frame == again.frame && std::memcmp(&after.reach, &again.reach, sizeof(float)) == 0;
+        if (!repeatable) ++failures;
+
+        if (before.frame < 0) ++oldMissed;
+        else oldError += std::fabs(before.reach - truth);
+        if (after.frame < 0) ++newMissed;
+        else newError += std::fabs(after.reach - truth);
+
+        int plain = compensationFlags(noisy, raised);
+        if (plain != Compensation_None) ++falseFlags;
+        int injected[3];
+        const CompensationFlag kinds[3] = { Compensation_Step, Compensation_HeelRise, Compensation_TrunkRotation };
+        for (int c = 0; c < 3; ++c) {
+            injected[c] = compensationFlags(compensated(noisy, raised, kinds[c]), raised);
+            if (!(injected[c] & kinds[c])) ++missedFlags;
+        }
+
+        std::cout << std::setw(7) << s << std::setw(11) << std::fixed << std::setprecision(1) << reachDistance * 100.0f
+            << std::setw(7) << truth * 100.0f
+            << std::setw(9) << before.reach * 100.0f << std::setw(6) << before.frame
+            << std::setw(9) << after.reach * 100.0f << std::setw(6) << after.frame
+            << "  " << (repeatable ? "same" : "DIFFERENT")
+            << "    " << compensationText(plain) << " / " << compensationText(injected[0]) << ", "
+            << compensationText(injected[1]) << ", " << compensationText(injected[2]) << std::endl;
+    }
+
+    int oldFound = sessions - oldMissed, newFound = sessions - newMissed;
+    std::cout << "old: mean error " << (oldFound ? oldError / oldFound * 100.0 : 0.0) << " cm, missed " << oldMissed << std::endl;
+    std::cout << "new: mean error " << (newFound ? newError / newFound * 100.0 : 0.0) << " cm, missed " << newMissed << std::endl;
+    std::cout << "compensation: " << falseFlags << " plain sessions flagged, " << missedFlags << " of " << sessions * 3 << " compensations missed" << std::endl;
+    return failures ? 1 : 0;
+}
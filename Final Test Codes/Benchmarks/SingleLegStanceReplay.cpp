@@ -0,0 +1,152 @@
+//Replays synthetic SOOLWEO sessions through SingleLegStanceTimer and the old right then left logic
+//the sessions lift the right foot and then the left one; every other session is mirrored so the left foot goes first.
+//Reports, per session, the true time of each stance (the crossings of the noise-free foot lift), the times the old
+//logic took (whole frames from the first frame over the threshold to the first frame back under it, right foot first
+//only) and the times of SingleLegStanceTimer with the first leg it found. Exit code 1 when the timer misses a stance,
+//gets the first leg wrong or is off by more than a frame.
+//
+//  SingleLegStanceReplay.exe [sessions]
+#include "../Common/SyntheticMotion.h"
+#include "../Common/SingleLegStance.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+static const float liftThreshold = 0.10f;   //SOOLWEO foot raised threshold (m)
+static const double frameTime = 1.0 / 30.0;
+
+//foot lifts (m) of one session, camera Y against the mean of the first frames as SOOLWEO does without a floor
+struct LiftSeries {
+    std::vector<float> left, right;
+    std::vector<double> time;
+};
+
+static LiftSeries lifts(uint64_t seed, float noise, float stanceDuration, bool mirrored) {
+    SyntheticParams params;
+    params.scenario = Scenario_SingleLegStance;
+    params.seed = seed;
+    params.jointNoise = noise;
+    params.stanceDuration = stanceDuration;
+    SyntheticMotionGenerator generator(params);
+    LiftSeries series;
+    SyntheticFrame frame;
+    float baseLeft = 0.0f, baseRight = 0.0f;
+    int baseFrames = 0;
+    while (generator.next(frame)) {
+        const Joint* joints = frame.bodies[frame.participantIndex].joints;
+        float left = joints[JointType_FootLeft].Position.Y, right = joints[JointType_FootRight].Position.Y;
+        if (mirrored) std::swap(left, right);
+        if (baseFrames < 10) {
+            baseLeft += left / 10.0f;
+            baseRight += right / 10.0f;
+            ++baseFrames;
+        }
+        series.left.push_back(left);
+        series.right.push_back(right);
+        series.time.push_back(frame.relativeTime * 1e-7);
+    }
+    for (size_t f = 0; f < series.time.size(); ++f) {
+        series.left[f] = std::fabs(series.left[f] - baseLeft);
+        series.right[f] = std::fabs(series.right[f] - baseRight);
+    }
+    return series;
+}
+
+//old SOOLWEO: right foot timed from the frame it rises over the threshold to the frame it is back, then the left foot
+static void oldTimes(const LiftSeries& series, float& right, float& left) {
+    right = left = -1.0f;
+    bool rightRaised = false, rightInAir = false, leftRaised = false, leftInAir = false;
+    double rightStart = 0.0, leftStart = 0.0;
+    for (size_t f = 10; f < series.time.size(); ++f) {
+        if (series.right[f] > liftThreshold && !rightRaised && !leftRaised) {
+            rightRaised = rightInAir = true;
+            rightStart = series.time[f];
+        }
+        else if (series.right[f] <= liftThreshold && rightRaised && rightInAir) {
+            right = static_cast<float>(series.time[f] - rightStart);
+            rightInAir = false;
+            if (right > 60.0f) return;
+        }
+        if (series.left[f] > liftThreshold && !leftRaised && rightRaised) {
+            leftRaised = leftInAir = true;
+            leftStart = series.time[f];
+        }
+        else if (series.left[f] <= liftThreshold && leftRaised && leftInAir) {
+            left = static_cast<float>(series.time[f] - leftStart);
+            return;
+        }
+    }
+}
+
+static void timerTimes(const LiftSeries& series, float& right, float& left, int& firstLeg) {
+    SingleLegStanceTimer timer;
+    timer.start();
+    for (size_t f = 10; f < series.time.size() && !timer.completed(); ++f) {
+        timer.update(series.left[f], series.right[f], series.time[f]);
+    }
+    right = timer.leg(Leg_Right).phase == Stance_Timed ? timer.leg(Leg_Right).duration : -1.0f;
+    left = timer.leg(Leg_Left).phase == Stance_Timed ? timer.leg(Leg_Left).duration : -1.0f;
+    firstLeg = timer.firstLeg();
+}
+
+int main(int argc, char** argv) {
+    int sessions = argc > 1 ? std::max(1, std::atoi(argv[1])) : 20;
+    int failures = 0;
+    double oldError = 0.0, newError = 0.0;
+    int oldTimed = 0, newTimed = 0, oldMissed = 0, newMissed = 0;
+
+    std::cout << "session  first  truth R/L (s)   old R/L (s)     new R/L (s)     new first" << std::endl;
+    for (int s = 0; s < sessions; ++s) {
+        bool mirrored = s % 2 == 1;
+        float stanceDuration = 4.0f + 1.5f * (s % 7);
+        float noise = 0.005f + 0.0025f * (s % 3);
+
+        //truth: the same timer on the noise-free lifts, both thresholds at the SOOLWEO one
+        LiftSeries clean = lifts(200 + s, 0.0f, stanceDuration, mirrored);
+        SingleLegStanceTimer truthTimer;
+        truthTimer.downThreshold = liftThreshold;
+        truthTimer.start();
+        for (size_t f = 10; f < clean.time.size(); ++f) truthTimer.update(clean.left[f], clean.right[f], clean.time[f]);
+        float truthRight = truthTimer.leg(Leg_Right).duration, truthLeft = truthTimer.leg(Leg_Left).duration;
+
+        LiftSeries noisy = lifts(200 + s, noise, stanceDuration, mirrored);
+        float oldRight, oldLeft, newRight, newLeft;
+        int firstLeg;
+        oldTimes(noisy, oldRight, oldLeft);
+        timerTimes(noisy, newRight, newLeft, firstLeg);
+
+        const float olds[2] = { oldLeft, oldRight }, news[2] = { newLeft, newRight }, truths[2] = { truthLeft, truthRight };
+        for (int l = 0; l < 2; ++l) {
+            if (olds[l] < 0.0f) ++oldMissed;
+            else {
+                oldError += std::fabs(olds[l] - truths[l]);
+                ++oldTimed;
+            }
+            if (news[l] < 0.0f) {
+                ++newMissed;
+                ++failures;
+            }
+            else {
+                newError += std::fabs(news[l] - truths[l]);
+                ++newTimed;
+                if (std::fabs(news[l] - truths[l]) > frameTime) ++failures;
+            }
+        }
+        int expectedFirst = mirrored ? Leg_Left : Leg_Right;
+        if (firstLeg != expectedFirst) ++failures;
+
+        std::cout << std::setw(7) << s << std::setw(7) << stanceLegName(expectedFirst) << std::fixed << std::setprecision(3)
+            << std::setw(8) << truthRight << std::setw(8) << truthLeft
+            << std::setw(8) << oldRight << std::setw(8) << oldLeft
+            << std::setw(8) << newRight << std::setw(8) << newLeft
+            << "  " << (firstLeg < 0 ? "none" : stanceLegName(firstLeg)) << std::endl;
+    }
+
+    std::cout << "old: mean error " << (oldTimed ? oldError / oldTimed * 1000.0 : 0.0) << " ms, stances missed " << oldMissed << std::endl;
+    std::cout << "new: mean error " << (newTimed ? newError / newTimed * 1000.0 : 0.0) << " ms, stances missed " << newMissed << std::endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,287 @@
+//Checks the calibrations of Common/StationProfile.h on synthetic stations
+//  TUG  synthetic sessions with the chair at 3.5 to 5.2 m and joint noise varied, the participant seated for four
+//       seconds; SeatedCalibration is fed the seated frames as in TUG (hip flexion from KinematicsFrame, SpineMid
+//       tracked) and the chair depth it gives must be within chairTolerance of the noise-free seated SpineMid depth.
+//       The gates of setChairDepth must hold that depth and the turn-around 3 m in front of it. Every session must
+//       calibrate while seated, also with 2 and 3 cm of joint noise. A participant who shifts 10 cm on the chair must
+//       not calibrate across the shift, and an attempt that never completes must time out.
+//  WS   depth frames of an empty corridor: the floor seen by a sensor at 0.5 to 1.2 m height, pitched -3 to 6 degrees,
+//       poles on the start and stop lines, a back wall across the corridor and side walls outside it, with depth
+//       noise growing with distance. CorridorMarkerCalibration must find both poles within markerTolerance of the
+//       camera depth of their front face and the WS gates must end there. A corridor without a floor must time out.
+//Also checks that a 4.4 m chair and markers at 1.6 and 6.8 m give the gates the tests used before. Exit code 1 when a
+//check fails.
+//
+//  StationCalibrationCheck.exe
+#include "../Common/SyntheticMotion.h"
+#include "../Common/JointKinematics.h"
+#include "../Common/StationProfile.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+static const float chairTolerance = 0.02f;      //m
+static const float markerTolerance = 0.05f;     //m, one depth bin of the marker calibration
+static int failures = 0;
+
+static void check(bool passed, const char* what) {
+    if (!passed) {
+        std::cout << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+static bool near(float a, float b, float tolerance) { return std::fabs(a - b) <= tolerance; }
+
+//the TUG calibration loop on one synthetic session, false when it never completed while the participant sat
+static bool calibrateChair(const SyntheticParams& params, float& chairDepth) {
+    SyntheticMotionGenerator generator(params);
+    SeatedCalibration calibration;
+    KinematicsFrame kinematics;
+    SyntheticFrame frame;
+    const float seatedHipFlexion = 60.0f, kinematicsConfidence = 0.5f;     //as in TUG
+    while (generator.next(frame)) {
+        if (!frame.bodyFrameAvailable) continue;
+        const SyntheticBody& body = frame.bodies[frame.participantIndex];
+        kinematics.clear();
+        kinematics.addBody(0, body.joints);
+        kinematics.compute();
+        bool seatedPosture = true;
+        for (KinematicAngle hip : { Angle_HipFlexionLeft, Angle_HipFlexionRight }) {
+            const BodyKinematics& angles = kinematics.body(0);
+            if (angles.confidence[hip] >= kinematicsConfidence && angles.angle[hip] < seatedHipFlexion) seatedPosture = false;
+        }
+        if (seatedPosture && body.joints[JointType_SpineMid].TrackingState == TrackingState_Tracked) {
+            if (calibration.add(body.joints[JointType_SpineMid].Position.Z)) {
+                chairDepth = calibration.chairDepth();
+                return frame.relativeTime * 1e-7 < params.seatedDuration;
+            }
+        }
+        else {
+            calibration.reset();
+        }
+    }
+    return false;
+}
+
+static void checkChair() {
+    const float chairs[] = { 3.5f, 4.0f, 4.4f, 4.8f, 5.2f };
+    struct Noise { float joint, inferred, dropout; } noises[] = { { 0.0f, 0.0f, 0.0f }, { 0.005f, 0.0f, 0.02f },
+        { 0.01f, 0.002f, 0.05f }, { 0.02f, 0.0f, 0.0f }, { 0.03f, 0.0f, 0.0f } };
+
+    std::cout << "TUG chair: sessions with the chair at 3.5 to 5.2 m" << std::endl
+        << std::setw(10) << "Noise cm" << std::setw(12) << "Sessions" << std::setw(14) << "Calibrated" << std::setw(16)
+        << "Mean err cm" << std::setw(14) << "Max err cm" << std::endl;
+    for (const Noise& noise : noises) {
+        int sessions = 0, calibrated = 0;
+        float totalError = 0.0f, maxError = 0.0f;
+        for (float chair : chairs) {
+            for (int s = 0; s < 8; ++s) {
+                SyntheticParams params;
+                params.scenario = Scenario_TimedUpGo;
+                params.seed = 300 + s;
+                params.chairDepth = chair;
+                params.turnDepth = chair - 3.0f;
+                params.seatedDuration = 4.0f;
+                params.bodyScale = 0.9f + 0.05f * (s % 5);
+
+                //the noise-free seated SpineMid depth
+                params.jointNoise = 0.0f;
+                SyntheticMotionGenerator clean(params);
+                SyntheticFrame frame;
+                clean.next(frame);
+                float truth = frame.bodies[frame.participantIndex].joints[JointType_SpineMid].Position.Z;
+
+                params.jointNoise = noise.joint;
+                params.inferredRate = noise.inferred;
+                params.dropoutRate = noise.dropout;
+                ++sessions;
+                float chairDepth = 0.0f;
+                if (!calibrateChair(params, chairDepth)) {
+                    check(false, "chair calibration did not complete while seated");
+                    continue;
+                }
+                ++calibrated;
+                float error = std::fabs(chairDepth - truth);
+                totalError += error;
+                maxError = std::max(maxError, error);
+                check(error <= chairTolerance, "chair depth off by more than the tolerance");
+
+                StationProfile station;
+                station.setChairDepth(chairDepth);
+                check(station.tugSeated.contains(truth) && station.tugReturn.contains(truth), "seated gates miss the chair");
+                check(near(0.5f * (station.tugTurn.low + station.tugTurn.high), truth - 3.0f, chairTolerance),
+                    "turn-around gate not 3 m in front of the chair");
+            }
+        }
+        std::cout << std::fixed << std::setprecision(1) << std::setw(10) << noise.joint * 100.0f << std::setw(12) << sessions
+            << std::setw(14) << calibrated << std::setw(16) << std::setprecision(2) << (calibrated ? totalError / calibrated * 100.0f : 0.0f)
+            << std::setw(14) << maxError * 100.0f << std::endl;
+    }
+}
+
+//a shift on the chair and an attempt without a seated participant, on depths fed directly
+static void checkChairFailures() {
+    SeatedCalibration calibration;
+    calibration.begin();
+    calibration.timedOut(0.0);
+    bool calibrated = false;
+    for (int f = 0; f < SeatedCalibration::frames; ++f) {
+        calibrated = calibration.add(f < SeatedCalibration::frames / 2 ? 4.4f : 4.5f) || calibrated;
+    }
+    check(!calibrated, "calibrated across a 10 cm shift on the chair");
+    check(!calibration.timedOut(SeatedCalibration::frames / 30.0), "timed out before the timeout");
+
+    double now = 0.0;
+    for (int f = 0; f < 30 * 30; ++f) {
+        now = f / 30.0;
+        if (f % 20 == 0) calibration.reset();       //never seated for 3 s in a row
+        else calibration.add(4.4f);
+        if (calibration.timedOut(now)) break;
+    }
+    check(calibration.timedOut(now) && now <= calibration.timeout + 0.1, "an attempt that never completes does not time out");
+
+    SyntheticRandom random;
+    random.seed(3);
+    calibration.begin();
+    calibration.timedOut(0.0);
+    for (int f = 0; f < SeatedCalibration::frames; ++f) calibration.add(4.4f + 0.003f * random.normal());
+    check(calibration.done() && !calibration.timedOut(100.0), "a completed calibration reports a timeout");
+}
+
+//an empty WS corridor seen by a sensor at `height` above the floor pitched down by `pitch` degrees
+struct Corridor {
+    float height = 0.8f, pitch = 0.0f;
+    float nearMarker = 1.6f, farMarker = 6.8f;      //distance of the pole axes along the floor (m)
+    float nearX = 0.3f, farX = -0.3f;               //either side of the walking line, so the near pole does not hide the far one
+    float poleRadius = 0.05f, poleHeight = 1.0f;
+    float backWall = 7.8f;                          //across the corridor (m)
+    float sideWall = 1.3f;                          //either side of the walking line (m)
+
+    //camera z of a pole's front face at the middle of the part the calibration counts
+    float expectedDepth(float distance, float minHeight, float maxHeight) const {
+        float t = pitch * 0.01745329f;
+        float middle = 0.5f * (minHeight + std::min(poleHeight, maxHeight));
+        return (distance - poleRadius) * std::cos(t) + (height - middle) * std::sin(t);
+    }
+
+    void render(const DepthRayTable& rays, SyntheticRandom& random, UINT16* depth) const {
+        const float t = pitch * 0.01745329f, c = std::cos(t), s = std::sin(t);
+        for (int i = 0; i < DepthRayTable::pixels; ++i) {
+            const float rx = rays.rayX[i], ry = rays.rayY[i];
+            const float up = ry * c - s;            //world height gained per metre of camera z
+            const float forward = ry * s + c;       //distance along the floor per metre of camera z
+            float z = 0.0f;
+            auto surface = [&](float candidate, float top) {
+                float h = candidate * up + height;
+                if (candidate > 0.0f && h >= -0.01f && h <= top && (z == 0.0f || candidate < z)) z = candidate;
+            };
+            if (up < 0.0f) surface(height / -up, 0.01f);
+            if (forward > 0.0f) {
+                surface(backWall / forward, 2.5f);
+                const float poles[2][2] = { { nearMarker, nearX }, { farMarker, farX } };
+                for (const auto& pole : poles) {
+                    float candidate = (pole[0] - poleRadius) / forward;
+                    if (std::fabs(rx * candidate - pole[1]) <= poleRadius) surface(candidate, poleHeight);
+                }
+            }
+            if (rx != 0.0f) {
+                float candidate = sideWall / std::fabs(rx);
+                surface(candidate, 2.5f);
+            }
+            if (z > 8.0f) z = 0.0f;
+            if (z > 0.0f) z += (0.001f + 0.0004f * z * z) * random.normal();
+            depth[i] = static_cast<UINT16>(std::max(0.0f, z * 1000.0f + 0.5f));
+        }
+    }
+};
+
+static void checkCorridor() {
+    const float heights[] = { 0.5f, 0.8f, 1.2f };
+    const float pitches[] = { -3.0f, 0.0f, 3.0f, 6.0f };
+    const float markerPairs[][2] = { { 1.6f, 6.8f }, { 1.4f, 6.0f }, { 2.0f, 7.4f } };
+    DepthRayTable rays;
+    std::vector<UINT16> depth(DepthRayTable::pixels);
+    SyntheticRandom random;
+    random.seed(44);
+
+    std::cout << std::endl << "WS corridor: sensor height 0.5 to 1.2 m, pitch -3 to 6 degrees" << std::endl
+        << std::setw(10) << "Height" << std::setw(10) << "Pitch" << std::setw(14) << "Found" << std::setw(16)
+        << "Max near cm" << std::setw(14) << "Max far cm" << std::endl;
+    for (float height : heights) {
+        for (float pitch : pitches) {
+            int found = 0, stations = 0;
+            float maxNear = 0.0f, maxFar = 0.0f;
+            for (const auto& pair : markerPairs) {
+                Corridor corridor;
+                corridor.height = height;
+                corridor.pitch = pitch;
+                corridor.nearMarker = pair[0];
+                corridor.farMarker = pair[1];
+                corridor.nearX = 0.2f + 0.1f * stations;
+                corridor.farX = -0.1f - 0.2f * stations;
+
+                CorridorMarkerCalibration calibration;
+                calibration.begin();
+                calibration.timedOut(0.0);
+                int frames = 0;
+                do {
+                    corridor.render(rays, random, depth.data());
+                } while (!calibration.add(depth.data()) && ++frames < 120);
+                ++stations;
+
+                float nearMarker = 0.0f, farMarker = 0.0f;
+                if (!calibration.floorFound() || !calibration.markers(nearMarker, farMarker)) {
+                    check(false, "corridor markers not found");
+                    continue;
+                }
+                ++found;
+                check(!calibration.timedOut(1000.0), "a completed corridor calibration reports a timeout");
+                float nearError = std::fabs(nearMarker - corridor.expectedDepth(pair[0], calibration.minHeight, calibration.maxHeight));
+                float farError = std::fabs(farMarker - corridor.expectedDepth(pair[1], calibration.minHeight, calibration.maxHeight));
+                maxNear = std::max(maxNear, nearError);
+                maxFar = std::max(maxFar, farError);
+                check(nearError <= markerTolerance, "stop marker off by more than the tolerance");
+                check(farError <= markerTolerance, "start marker off by more than the tolerance");
+
+                StationProfile station;
+                station.setCorridorMarkers(nearMarker, farMarker);
+                check(station.wsStop.high == nearMarker && station.wsStart.high == farMarker, "WS gates do not end at the markers");
+            }
+            std::cout << std::fixed << std::setprecision(1) << std::setw(10) << height << std::setw(10) << pitch
+                << std::setw(10) << found << "/" << stations << std::setw(16) << std::setprecision(2) << maxNear * 100.0f
+                << std::setw(14) << maxFar * 100.0f << std::endl;
+        }
+    }
+}
+
+int main() {
+    //the calibrated gates of the old station layout are the old fixed gates
+    StationProfile defaults, calibrated;
+    calibrated.setChairDepth(4.4f);
+    calibrated.setCorridorMarkers(1.6f, 6.8f);
+    const float rounding = 1e-5f;
+    check(near(calibrated.tugSeated.low, defaults.tugSeated.low, rounding) && near(calibrated.tugSeated.high, defaults.tugSeated.high, rounding)
+        && near(calibrated.tugTurn.low, defaults.tugTurn.low, rounding) && near(calibrated.tugTurn.high, defaults.tugTurn.high, rounding)
+        && near(calibrated.tugReturn.low, defaults.tugReturn.low, rounding) && near(calibrated.tugReturn.high, defaults.tugReturn.high, rounding)
+        && near(calibrated.wsStart.low, defaults.wsStart.low, rounding) && near(calibrated.wsStart.high, defaults.wsStart.high, rounding)
+        && near(calibrated.wsStop.low, defaults.wsStop.low, rounding) && near(calibrated.wsStop.high, defaults.wsStop.high, rounding),
+        "the old station layout does not give the old gates");
+
+    checkChair();
+    checkChairFailures();
+    checkCorridor();
+
+    //no floor in view (the sensor covered): the corridor calibration never completes and times out
+    CorridorMarkerCalibration blind;
+    blind.begin();
+    blind.timedOut(0.0);
+    std::vector<UINT16> nothing(DepthRayTable::pixels, 0);
+    bool completed = false;
+    for (int f = 0; f < 30; ++f) completed = blind.add(nothing.data()) || completed;
+    check(!completed && !blind.timedOut(blind.timeout - 1.0) && blind.timedOut(blind.timeout + 1.0), "a corridor without a floor does not time out");
+    std::cout << (failures ? "FAILED" : "passed") << std::endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,59 @@
+//Checks the tracking lock of Common/TrackingLock.h
+//
+//  TrackingLockCheck.exe
+//
+//a participant locked at body 3 must stay locked when a bystander enters at body 0, the bystander must be reported as a
+//newcomer once and not again while they stay, the participant leaving must not move the lock to the bystander, and
+//release must lock the next tracked body. Exit code 1 when a check fails.
+#include "../Common/FrameQueues.h"
+#include "../Common/TrackingLock.h"
+#include <iostream>
+
+static int failures = 0;
+
+static void check(bool passed, const char* what) {
+    std::cout << (passed ? "ok    " : "FAIL  ") << what << std::endl;
+    if (!passed) ++failures;
+}
+
+static void place(BodySnapshot* bodies, int index, UINT64 id) {
+    bodies[index].isTracked = id != 0;
+    bodies[index].trackingId = id;
+}
+
+int main() {
+    BodySnapshot bodies[BODY_COUNT];
+    TrackingLock lock;
+
+    check(lock.update(bodies) == -1 && !lock.locked(), "nobody in view, nothing locked");
+
+    place(bodies, 3, 101);
+    int found = lock.update(bodies);
+    check(found == 3 && lock.locked() && lock.id() == 101 && lock.newlyLocked(), "participant locked at body 3");
+
+    place(bodies, 0, 202);
+    found = lock.update(bodies);
+    check(found == 3 && lock.id() == 101 && lock.newcomer() && !lock.newlyLocked(), "bystander at body 0: newcomer, lock stays on body 3");
+    found = lock.update(bodies);
+    check(found == 3 && !lock.newcomer() && lock.bystanders() == 1, "bystander stays: no second newcomer");
+
+    place(bodies, 3, 0);
+    place(bodies, 5, 101);
+    found = lock.update(bodies);
+    check(found == 5 && !lock.newcomer(), "participant moves to body 5, found by ID");
+
+    place(bodies, 5, 0);
+    found = lock.update(bodies);
+    check(found == -1 && lock.locked() && lock.id() == 101, "participant gone: the bystander does not take the lock");
+
+    place(bodies, 2, 303);
+    found = lock.update(bodies);
+    check(found == -1 && lock.newcomer() && lock.id() == 101, "another newcomer while the participant is gone");
+
+    lock.release();
+    found = lock.update(bodies);
+    check(found == 0 && lock.id() == 202 && lock.newlyLocked(), "release: the next tracked body is locked");
+
+    std::cout << (failures ? "FAILED" : "passed") << std::endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,311 @@
+//Color conversion of regions and of downscaled display images
+//the sensor delivers 1080p color as YUY2 (2 bytes per pixel). Asking the runtime for BGRA converts and writes the
+//whole 8 MB frame every frame; copying the raw frame moves half the bytes, and then only the pixels somebody looks
+//at are converted: a downscaled image for the window and small regions for the detectors.
+//Nothing on screen needs 1920x1080 either, so a BGRA frame is shown through one pass that converts to BGR and box
+//filters to 1/2 or 1/3 of the size, reading the frame once and writing a quarter (or a ninth) of it.
+//
+//  convertYuy2ToBgr(yuy2, cv::Rect(860, 400, 200, 50), roiBgr);     //full resolution region, x and width rounded to even
+//  convertYuy2ToBgrHalf(yuy2, displayBgr);                          //960x540 display image, 2x2 box filtered
+//  convertBgraToBgrScaled(bgra, 3, displayBgr);                     //640x360 display image, 3x3 box filtered
+//
+//BT.601 video range like cv::COLOR_YUV2BGR_YUY2, in 16-bit fixed point; results are within one level of OpenCV
+//(Benchmarks/ColorConvertCheck.cpp). The SSSE3 kernels give exactly the same bytes as the scalar ones.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSSE3__) || (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+#include <tmmintrin.h>
+#define COLOR_CONVERT_SSSE3 1
+#endif
+
+//coefficients of OpenCV's ITUR_BT_601 (2^20 scale) rounded to 2^13
+const int Yuy2CoefficientY = 9535;      //1.164, unsigned
+const int Yuy2CoefficientUB = 16531;    //2.018
+const int Yuy2CoefficientUG = -3203;    //-0.391
+const int Yuy2CoefficientVG = -6660;    //-0.813
+const int Yuy2CoefficientVR = 13074;    //1.596
+
+//one pixel, the same arithmetic as the SIMD lanes (mulhi of values shifted left by 8, sums in 1/32 levels)
+inline void yuvToBgrPixel(int y, int u, int v, uint8_t* bgr) {
+    int luma = static_cast<int>((static_cast<uint32_t>(y > 16 ? y - 16 : 0) << 8) * Yuy2CoefficientY >> 16);
+    int chromaU = (u - 128) * 256;
+    int chromaV = (v - 128) * 256;
+    int b = luma + ((chromaU * Yuy2CoefficientUB) >> 16);
+    int g = luma + ((chromaU * Yuy2CoefficientUG) >> 16) + ((chromaV * Yuy2CoefficientVG) >> 16);
+    int r = luma + ((chromaV * Yuy2CoefficientVR) >> 16);
+    b = (b + 16) >> 5;
+    g = (g + 16) >> 5;
+    r = (r + 16) >> 5;
+    bgr[0] = static_cast<uint8_t>(b < 0 ? 0 : (b > 255 ? 255 : b));
+    bgr[1] = static_cast<uint8_t>(g < 0 ? 0 : (g > 255 ? 255 : g));
+    bgr[2] = static_cast<uint8_t>(r < 0 ? 0 : (r > 255 ? 255 : r));
+}
+
+//count pixels of a YUY2 row starting at a pixel pair, count even
+inline void yuy2ToBgrRowScalar(const uint8_t* yuy2, uint8_t* bgr, int count) {
+    for (int x = 0; x < count; x += 2, yuy2 += 4, bgr += 6) {
+        yuvToBgrPixel(yuy2[0], yuy2[1], yuy2[3], bgr);
+        yuvToBgrPixel(yuy2[2], yuy2[1], yuy2[3], bgr + 3);
+    }
+}
+
+//one output pixel per 2x2 block of two YUY2 rows, averaged with rounding up like _mm_avg_epu8
+inline void yuy2ToBgrHalfRowScalar(const uint8_t* row0, const uint8_t* row1, uint8_t* bgr, int outputCount) {
+    for (int x = 0; x < outputCount; ++x, row0 += 4, row1 += 4, bgr += 3) {
+        int y0 = (row0[0] + row1[0] + 1) >> 1;
+        int y1 = (row0[2] + row1[2] + 1) >> 1;
+        int u = (row0[1] + row1[1] + 1) >> 1;
+        int v = (row0[3] + row1[3] + 1) >> 1;
+        yuvToBgrPixel((y0 + y1 + 1) >> 1, u, v, bgr);
+    }
+}
+
+//largest divisor of the scaled conversions
+const int MaxScaleDivisor = 8;
+
+//the test windows show the color frame at 1/DISPLAY_DIVISOR of its size, 2 (960x540) unless defined otherwise
+#ifndef DISPLAY_DIVISOR
+#define DISPLAY_DIVISOR 2
+#endif
+
+//one output pixel per divisor x divisor block of BGRA rows (rows[0..divisor-1]), the rounded mean of each channel
+inline void bgraToBgrScaledRowScalar(const uint8_t* const* rows, int divisor, uint8_t* bgr, int outputCount) {
+    const int blockPixels = divisor * divisor;
+    for (int x = 0; x < outputCount; ++x, bgr += 3) {
+        for (int c = 0; c < 3; ++c) {
+            int sum = 0;
+            for (int r = 0; r < divisor; ++r) {
+                const uint8_t* pixel = rows[r] + x * divisor * 4 + c;
+                for (int i = 0; i < divisor; ++i) sum += pixel[i * 4];
+            }
+            bgr[c] = static_cast<uint8_t>((sum + blockPixels / 2) / blockPixels);
+        }
+    }
+}
+
+//the same for YUY2 rows, y averaged over the block and u, v over the pixel pairs the block covers
+inline void yuy2ToBgrScaledRowScalar(const uint8_t* const* rows, int divisor, uint8_t* bgr, int outputCount) {
+    const int blockPixels = divisor * divisor;
+    for (int x = 0; x < outputCount; ++x, bgr += 3) {
+        int ySum = 0, uSum = 0, vSum = 0;
+        for (int r = 0; r < divisor; ++r) {
+            for (int i = 0; i < divisor; ++i) {
+                int pixel = x * divisor + i;
+                const uint8_t* pair = rows[r] + (pixel & ~1) * 2;
+                ySum += pair[(pixel & 1) * 2];
+                uSum += pair[1];
+                vSum += pair[3];
+            }
+        }
+        yuvToBgrPixel((ySum + blockPixels / 2) / blockPixels, (uSum + blockPixels / 2) / blockPixels,
+            (vSum + blockPixels / 2) / blockPixels, bgr);
+    }
+}
+
+#ifdef COLOR_CONVERT_SSSE3
+
+//8 pixels, y/u/v as 16-bit lanes 0..255, 24 bytes of BGR stored
+inline void yuvToBgr8(__m128i y, __m128i u, __m128i v, uint8_t* bgr) {
+    const __m128i sign = _mm_set1_epi16(static_cast<short>(0x8000));
+    __m128i luma = _mm_mulhi_epu16(_mm_slli_epi16(_mm_subs_epu16(y, _mm_set1_epi16(16)), 8), _mm_set1_epi16(Yuy2CoefficientY));
+    __m128i chromaU = _mm_xor_si128(_mm_slli_epi16(u, 8), sign);      //(u - 128) * 256
+    __m128i chromaV = _mm_xor_si128(_mm_slli_epi16(v, 8), sign);
+    __m128i b = _mm_add_epi16(luma, _mm_mulhi_epi16(chromaU, _mm_set1_epi16(Yuy2CoefficientUB)));
+    __m128i g = _mm_add_epi16(luma, _mm_add_epi16(_mm_mulhi_epi16(chromaU, _mm_set1_epi16(Yuy2CoefficientUG)),
+        _mm_mulhi_epi16(chromaV, _mm_set1_epi16(Yuy2CoefficientVG))));
+    __m128i r = _mm_add_epi16(luma, _mm_mulhi_epi16(chromaV, _mm_set1_epi16(Yuy2CoefficientVR)));
+    const __m128i half = _mm_set1_epi16(16);
+    b = _mm_srai_epi16(_mm_add_epi16(b, half), 5);
+    g = _mm_srai_epi16(_mm_add_epi16(g, half), 5);
+    r = _mm_srai_epi16(_mm_add_epi16(r, half), 5);
+
+    //B0 G0 B1 G1 .. B7 G7 and R0 .. R7, shuffled into B G R triples
+    __m128i bg = _mm_unpacklo_epi8(_mm_packus_epi16(b, b), _mm_packus_epi16(g, g));
+    __m128i rr = _mm_packus_epi16(r, r);
+    const char z = static_cast<char>(0x80);
+    __m128i first = _mm_or_si128(
+        _mm_shuffle_epi8(bg, _mm_setr_epi8(0, 1, z, 2, 3, z, 4, 5, z, 6, 7, z, 8, 9, z, 10)),
+        _mm_shuffle_epi8(rr, _mm_setr_epi8(z, z, 0, z, z, 1, z, z, 2, z, z, 3, z, z, 4, z)));
+    __m128i second = _mm_or_si128(
+        _mm_shuffle_epi8(bg, _mm_setr_epi8(11, z, 12, 13, z, 14, 15, z, z, z, z, z, z, z, z, z)),
+        _mm_shuffle_epi8(rr, _mm_setr_epi8(z, 5, z, z, 6, z, z, 7, z, z, z, z, z, z, z, z)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(bgr), first);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(bgr + 16), second);
+}
+
+inline void yuy2ToBgrRow(const uint8_t* yuy2, uint8_t* bgr, int count) {
+    const __m128i lowByte = _mm_set1_epi16(0x00FF);
+    int x = 0;
+    for (; x + 8 <= count; x += 8, yuy2 += 16, bgr += 24) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(yuy2));
+        __m128i y = _mm_and_si128(pixels, lowByte);
+        __m128i uv = _mm_srli_epi16(pixels, 8);                      //U0 V0 U1 V1 ..
+        __m128i u = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+        __m128i v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+        yuvToBgr8(y, u, v, bgr);
+    }
+    yuy2ToBgrRowScalar(yuy2, bgr, count - x);
+}
+
+inline void yuy2ToBgrHalfRow(const uint8_t* row0, const uint8_t* row1, uint8_t* bgr, int outputCount) {
+    const __m128i lowWord = _mm_set1_epi32(0x0000FFFF);
+    const __m128i lowByte = _mm_set1_epi16(0x00FF);
+    int x = 0;
+    for (; x + 8 <= outputCount; x += 8, row0 += 32, row1 += 32, bgr += 24) {
+        //Y0 U Y1 V of 8 blocks, the two rows averaged
+        __m128i a = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1)));
+        __m128i b = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 16)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 16)));
+        __m128i ya = _mm_and_si128(a, lowByte), yb = _mm_and_si128(b, lowByte);
+        __m128i uva = _mm_srli_epi16(a, 8), uvb = _mm_srli_epi16(b, 8);
+        __m128i y0 = _mm_packs_epi32(_mm_and_si128(ya, lowWord), _mm_and_si128(yb, lowWord));
+        __m128i y1 = _mm_packs_epi32(_mm_srli_epi32(ya, 16), _mm_srli_epi32(yb, 16));
+        __m128i u = _mm_packs_epi32(_mm_and_si128(uva, lowWord), _mm_and_si128(uvb, lowWord));
+        __m128i v = _mm_packs_epi32(_mm_srli_epi32(uva, 16), _mm_srli_epi32(uvb, 16));
+        yuvToBgr8(_mm_avg_epu16(y0, y1), u, v, bgr);
+    }
+    yuy2ToBgrHalfRowScalar(row0, row1, bgr, outputCount - x);
+}
+
+//4 BGRA pixels in 16-bit lanes (two registers of two) to 12 bytes of BGR, 16 bytes are written
+inline void storeBgr4(__m128i pixels01, __m128i pixels23, uint8_t* bgr) {
+    const char z = static_cast<char>(0x80);
+    __m128i bgra = _mm_packus_epi16(pixels01, pixels23);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(bgr), _mm_shuffle_epi8(bgra, _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, z, z, z, z)));
+}
+
+//sums of the pixels 0+1+2 and 3+4+5 of three registers of two pixels each
+inline __m128i sumPixelTriples(__m128i a, __m128i b, __m128i c) {
+    __m128d da = _mm_castsi128_pd(a), db = _mm_castsi128_pd(b), dc = _mm_castsi128_pd(c);
+    return _mm_add_epi16(_mm_add_epi16(_mm_castpd_si128(_mm_shuffle_pd(da, db, 2)), _mm_castpd_si128(_mm_shuffle_pd(da, dc, 1))),
+        _mm_castpd_si128(_mm_shuffle_pd(db, dc, 2)));
+}
+
+//returns how many output pixels were written; 4 per step, the 16-byte store needs two more pixels of the row after them
+inline int bgraToBgrScaledRowSimd(const uint8_t* const* rows, int divisor, uint8_t* bgr, int outputCount) {
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+    if (divisor == 1) {
+        const char z = static_cast<char>(0x80);
+        const __m128i toBgr = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, z, z, z, z);
+        for (; x + 6 <= outputCount; x += 4, bgr += 12) {
+            __m128i bgra = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[0] + x * 4));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(bgr), _mm_shuffle_epi8(bgra, toBgr));
+        }
+    }
+    else if (divisor == 2) {
+        const __m128i rounding = _mm_set1_epi16(2);
+        for (; x + 6 <= outputCount; x += 4, bgr += 12) {
+            //8 source pixels of each row, column sums in 16 bits
+            __m128i sum[4] = { zero, zero, zero, zero };
+            for (int r = 0; r < 2; ++r) {
+                const uint8_t* source = rows[r] + x * 2 * 4;
+                for (int h = 0; h < 2; ++h) {
+                    __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + h * 16));
+                    sum[h * 2] = _mm_add_epi16(sum[h * 2], _mm_unpacklo_epi8(pixels, zero));
+                    sum[h * 2 + 1] = _mm_add_epi16(sum[h * 2 + 1], _mm_unpackhi_epi8(pixels, zero));
+                }
+            }
+            __m128i out01 = _mm_add_epi16(_mm_unpacklo_epi64(sum[0], sum[1]), _mm_unpackhi_epi64(sum[0], sum[1]));
+            __m128i out23 = _mm_add_epi16(_mm_unpacklo_epi64(sum[2], sum[3]), _mm_unpackhi_epi64(sum[2], sum[3]));
+            storeBgr4(_mm_srli_epi16(_mm_add_epi16(out01, rounding), 2), _mm_srli_epi16(_mm_add_epi16(out23, rounding), 2), bgr);
+        }
+    }
+    else if (divisor == 3) {
+        //(sum + 4) * 7282 >> 16 is (sum + 4) / 9 for every sum of nine bytes
+        const __m128i rounding = _mm_set1_epi16(4);
+        const __m128i ninth = _mm_set1_epi16(7282);
+        for (; x + 6 <= outputCount; x += 4, bgr += 12) {
+            //12 source pixels of each row
+            __m128i sum[6] = { zero, zero, zero, zero, zero, zero };
+            for (int r = 0; r < 3; ++r) {
+                const uint8_t* source = rows[r] + x * 3 * 4;
+                for (int h = 0; h < 3; ++h) {
+                    __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + h * 16));
+                    sum[h * 2] = _mm_add_epi16(sum[h * 2], _mm_unpacklo_epi8(pixels, zero));
+                    sum[h * 2 + 1] = _mm_add_epi16(sum[h * 2 + 1], _mm_unpackhi_epi8(pixels, zero));
+                }
+            }
+            __m128i out01 = sumPixelTriples(sum[0], sum[1], sum[2]);
+            __m128i out23 = sumPixelTriples(sum[3], sum[4], sum[5]);
+            storeBgr4(_mm_mulhi_epu16(_mm_add_epi16(out01, rounding), ninth), _mm_mulhi_epu16(_mm_add_epi16(out23, rounding), ninth), bgr);
+        }
+    }
+    return x;
+}
+
+#else
+
+inline int bgraToBgrScaledRowSimd(const uint8_t* const*, int, uint8_t*, int) { return 0; }
+
+inline void yuy2ToBgrRow(const uint8_t* yuy2, uint8_t* bgr, int count) { yuy2ToBgrRowScalar(yuy2, bgr, count); }
+inline void yuy2ToBgrHalfRow(const uint8_t* row0, const uint8_t* row1, uint8_t* bgr, int outputCount) {
+    yuy2ToBgrHalfRowScalar(row0, row1, bgr, outputCount);
+}
+
+#endif
+
+//BGRA rows to BGR at 1/divisor of the width, SSSE3 for divisors 1 to 3, rows holds divisor row pointers
+inline void bgraToBgrScaledRow(const uint8_t* const* rows, int divisor, uint8_t* bgr, int outputCount) {
+    int x = bgraToBgrScaledRowSimd(rows, divisor, bgr, outputCount);
+    if (x == outputCount) return;
+    const uint8_t* tail[MaxScaleDivisor];
+    for (int r = 0; r < divisor; ++r) tail[r] = rows[r] + x * divisor * 4;
+    bgraToBgrScaledRowScalar(tail, divisor, bgr + x * 3, outputCount - x);
+}
+
+#if __has_include(<opencv2/opencv.hpp>)
+#include <opencv2/opencv.hpp>
+
+//region of a CV_8UC2 YUY2 frame to BGR, the region is clipped to the frame and widened to whole pixel pairs
+inline cv::Rect convertYuy2ToBgr(const cv::Mat& yuy2, cv::Rect roi, cv::Mat& bgr) {
+    roi &= cv::Rect(0, 0, yuy2.cols & ~1, yuy2.rows);
+    int right = (roi.x + roi.width + 1) & ~1;
+    roi.x &= ~1;
+    roi.width = right - roi.x;
+    bgr.create(roi.height, roi.width, CV_8UC3);
+    for (int y = 0; y < roi.height; ++y) {
+        yuy2ToBgrRow(yuy2.ptr<uint8_t>(roi.y + y) + roi.x * 2, bgr.ptr<uint8_t>(y), roi.width);
+    }
+    return roi;
+}
+
+//whole frame at half width and height, for the window
+inline void convertYuy2ToBgrHalf(const cv::Mat& yuy2, cv::Mat& bgr) {
+    bgr.create(yuy2.rows / 2, yuy2.cols / 2, CV_8UC3);
+    for (int y = 0; y < bgr.rows; ++y) {
+        yuy2ToBgrHalfRow(yuy2.ptr<uint8_t>(2 * y), yuy2.ptr<uint8_t>(2 * y + 1), bgr.ptr<uint8_t>(y), bgr.cols);
+    }
+}
+
+//whole YUY2 frame at 1/divisor of the width and height (1 to MaxScaleDivisor), SSSE3 for 1 and 2
+inline void convertYuy2ToBgrScaled(const cv::Mat& yuy2, int divisor, cv::Mat& bgr) {
+    if (divisor <= 1) {
+        convertYuy2ToBgr(yuy2, cv::Rect(0, 0, yuy2.cols, yuy2.rows), bgr);
+        return;
+    }
+    if (divisor == 2) {
+        convertYuy2ToBgrHalf(yuy2, bgr);
+        return;
+    }
+    divisor = divisor > MaxScaleDivisor ? MaxScaleDivisor : divisor;
+    bgr.create(yuy2.rows / divisor, yuy2.cols / divisor, CV_8UC3);
+    const uint8_t* rows[MaxScaleDivisor];
+    for (int y = 0; y < bgr.rows; ++y) {
+        for (int r = 0; r < divisor; ++r) rows[r] = yuy2.ptr<uint8_t>(y * divisor + r);
+        yuy2ToBgrScaledRowScalar(rows, divisor, bgr.ptr<uint8_t>(y), bgr.cols);
+    }
+}
+
+//whole BGRA frame to BGR at 1/divisor of the width and height (1 to MaxScaleDivisor), in one pass over the frame
+inline void convertBgraToBgrScaled(const cv::Mat& bgra, int divisor, cv::Mat& bgr) {
+    divisor = divisor < 1 ? 1 : (divisor > MaxScaleDivisor ? MaxScaleDivisor : divisor);
+    bgr.create(bgra.rows / divisor, bgra.cols / divisor, CV_8UC3);
+    const uint8_t* rows[MaxScaleDivisor];
+    for (int y = 0; y < bgr.rows; ++y) {
+        for (int r = 0; r < divisor; ++r) rows[r] = bgra.ptr<uint8_t>(y * divisor + r);
+        bgraToBgrScaledRow(rows, divisor, bgr.ptr<uint8_t>(y), bgr.cols);
+    }
+}
+#endif
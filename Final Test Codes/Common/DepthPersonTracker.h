@@ -0,0 +1,357 @@
+//Depth-only person tracker for the walking speed corridor
+//body tracking gives up past ~4.5 m, but the WS start gate is at 6.5-6.8 m. This follows the walker in the depth
+//frame alone: a learned static background is subtracted, the foreground is split into connected blobs (4-connected,
+//no depth jump between neighbours) and the walker's blob is followed by its centroid and nearest surface from 8 m
+//down to 0.5 m. It works on a 2x2 reduced grid (256x212 nearest surfaces); camera space comes from the depth pixel
+//rays of DepthRayTable, the sensor's calibration once setRays() is given one and the nominal pinhole until then.
+//The work of a frame is bounded: when more than a quarter of the grid is foreground (somebody close to the sensor, a
+//changed scene) only every other cell of every other row is labelled, so union-find never sees more than a quarter of
+//the grid, and the nearest surface is read from the blob index of each cell without another find. DepthTrackerReplay
+//measures about 0.5 ms per frame on one thread and at most about 1 ms, also on an all-foreground frame, inside the 2 ms
+//WS budget.
+//Inside body tracking range the skeleton takes over, blended from handoffFar to handoffNear so the depth has no step.
+//
+//  DepthPersonTracker tracker;
+//  tracker.setRays(rays);                                            //DepthRayTable from the coordinate mapper
+//  const DepthTrack& track = tracker.update(depthBuffer.data());     //every 512x424 depth frame (mm)
+//  float depth = tracker.handoff(spineMid, spineMidTracked);         //tracker far away, skeleton close, 0 if nobody
+//
+//the background is the farthest surface seen in each cell, learned over the first learningFrames and kept up to
+//date afterwards; something that stays in front of it for absorbFrames (a moved chair) becomes background.
+#pragma once
+#include "SkeletonTypes.h"
+#include "DepthPointCloud.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+struct DepthTrack {
+    bool valid = false;             //a walker is being followed
+    float x = 0.0f, y = 0.0f;       //blob centroid, camera space (m)
+    float z = 0.0f;                 //centroid depth, filtered (m)
+    float nearestDepth = 0.0f;      //nearest surface of the blob, 5th percentile of its cells (m)
+    float velocity = 0.0f;          //along z (m/s), negative while approaching the sensor
+    int cells = 0;                  //size of the blob on the reduced grid
+    int left = 0, top = 0, right = 0, bottom = 0;   //bounding box in depth frame pixels
+    int missedFrames = 0;           //frames since the blob was last seen, the track coasts meanwhile
+};
+
+class DepthPersonTracker {
+public:
+    static const int depthWidth = 512;
+    static const int depthHeight = 424;
+    static const int gridWidth = depthWidth / 2;
+    static const int gridHeight = depthHeight / 2;
+
+    float minDepth = 0.5f;              //m, nearer readings are ignored
+    float maxDepth = 8.0f;              //m, farther readings only feed the background
+    float corridorHalfWidth = 1.0f;     //m either side of the optical axis where a new walker is looked for
+    float minBlobArea = 0.10f;          //m2 of surface facing the sensor, a person shows about 0.5
+    float depthJump = 0.20f;            //m, neighbouring cells further apart in depth are not connected
+    float gateDistance = 0.6f;          //m from the predicted position a blob may be to continue the track
+    int lostFrames = 15;                //frames a track coasts without its blob before it is dropped
+    int learningFrames = 30;
+    int absorbFrames = 300;
+    float handoffFar = 4.5f;            //m, the skeleton starts to take over
+    float handoffNear = 3.5f;           //m, only the skeleton is used
+    float associationDistance = 0.5f;   //m, a skeleton further than this from the track is somebody else
+    static const int denseForeground = gridWidth * gridHeight / 4;     //foreground cells above which the grid is subsampled
+
+    DepthPersonTracker() {
+        setRays(DepthRayTable());
+        reset();
+    }
+
+    //camera space rays of the depth pixels, reduced to the grid: the ray through the middle of each 2x2 block and the
+    //area the block covers at 1 m depth. The background and the track are kept, they do not depend on the rays
+    void setRays(const DepthRayTable& rays) {
+        const size_t cells = static_cast<size_t>(gridWidth) * gridHeight;
+        gridRayX.resize(cells);
+        gridRayY.resize(cells);
+        gridArea.resize(cells);
+        for (int v = 0; v < gridHeight; ++v) {
+            for (int u = 0; u < gridWidth; ++u) {
+                const int p00 = (2 * v) * depthWidth + 2 * u, p01 = p00 + 1;
+                const int p10 = p00 + depthWidth, p11 = p10 + 1;
+                const size_t i = static_cast<size_t>(v) * gridWidth + u;
+                gridRayX[i] = 0.25f * (rays.rayX[p00] + rays.rayX[p01] + rays.rayX[p10] + rays.rayX[p11]);
+                gridRayY[i] = 0.25f * (rays.rayY[p00] + rays.rayY[p01] + rays.rayY[p10] + rays.rayY[p11]);
+                float width = std::fabs(rays.rayX[p01] + rays.rayX[p11] - rays.rayX[p00] - rays.rayX[p10]);
+                float height = std::fabs(rays.rayY[p00] + rays.rayY[p01] - rays.rayY[p10] - rays.rayY[p11]);
+                gridArea[i] = width * height;
+            }
+        }
+    }
+
+    //forgets the background and the track, the next frames are learned again
+    void reset() {
+        const size_t cells = static_cast<size_t>(gridWidth) * gridHeight;
+        grid.assign(cells, 0);
+        background.assign(cells, 0);
+        absorbCount.assign(cells, 0);
+        parent.assign(cells, -1);
+        blobOf.assign(cells, -1);
+        //at most one blob per labelled cell, and never more than denseForeground cells are labelled
+        blobs.clear();
+        blobs.reserve(denseForeground + 1);
+        framesSeen = 0;
+        rearm();
+    }
+
+    //forgets the track only, for the next trial
+    void rearm() { state = DepthTrack(); }
+
+    const DepthTrack& track() const { return state; }
+
+    //relativeTime of the depth frame (100 ns ticks) for the velocity, 0 assumes 30 fps
+    const DepthTrack& update(const UINT16* depth, TIMESPAN relativeTime = 0) {
+        float dt = 1.0f / 30.0f;
+        if (relativeTime > 0 && lastTime > 0 && relativeTime > lastTime) dt = (relativeTime - lastTime) * 1e-7f;
+        lastTime = relativeTime;
+
+        reduce(depth);
+        subtractBackground();
+        label();
+        follow(dt);
+        ++framesSeen;
+        return state;
+    }
+
+    //depth for the test: the tracker far away, the skeleton point (SpineMid) once it is tracked inside handoffFar,
+    //blended linearly down to handoffNear; 0 when neither sees anybody
+    float handoff(const CameraSpacePoint& bodyPoint, bool bodyTracked) const {
+        bool bodyUsable = bodyTracked && bodyPoint.Z > 0.0f;
+        if (bodyUsable && state.valid) {
+            bodyUsable = std::fabs(bodyPoint.Z - state.z) < associationDistance && std::fabs(bodyPoint.X - state.x) < associationDistance;
+        }
+        if (!state.valid) return bodyUsable ? bodyPoint.Z : 0.0f;
+        if (!bodyUsable) return state.z;
+        float weight = (handoffFar - bodyPoint.Z) / (handoffFar - handoffNear);
+        weight = std::min(1.0f, std::max(0.0f, weight));
+        return state.z + weight * (bodyPoint.Z - state.z);
+    }
+
+private:
+    struct Blob {
+        int cells;
+        int minU, minV, maxU, maxV;
+        int64_t sumDepth;               //mm
+        double sumX, sumY;              //camera space of the cells, mm
+        double area;                    //surface facing the sensor, mm2
+    };
+
+    std::vector<uint16_t> grid;         //nearest valid reading of each 2x2 block (mm), 0 when none
+    std::vector<uint16_t> background;   //farthest surface seen (mm), 0 while unknown
+    std::vector<uint16_t> absorbCount;
+    std::vector<int32_t> parent;        //union-find over the foreground cells, -1 for background
+    std::vector<int32_t> blobOf;        //blob index of every labelled cell
+    std::vector<float> gridRayX, gridRayY, gridArea;    //setRays()
+    std::vector<Blob> blobs;
+    int foregroundCells = 0;            //subtractBackground()
+    int labelStep = 1;                  //1, or 2 when only every other cell of every other row was labelled
+    int framesSeen = 0;
+    TIMESPAN lastTime = 0;
+    DepthTrack state;
+
+    void reduce(const UINT16* depth) {
+        for (int v = 0; v < gridHeight; ++v) {
+            const UINT16* row0 = depth + (2 * v) * depthWidth;
+            const UINT16* row1 = row0 + depthWidth;
+            uint16_t* out = &grid[static_cast<size_t>(v) * gridWidth];
+            for (int u = 0; u < gridWidth; ++u) {
+                //zero is "no reading", subtracting one makes it the largest value so min skips it
+                uint16_t a = static_cast<uint16_t>(row0[2 * u] - 1), b = static_cast<uint16_t>(row0[2 * u + 1] - 1);
+                uint16_t c = static_cast<uint16_t>(row1[2 * u] - 1), d = static_cast<uint16_t>(row1[2 * u + 1] - 1);
+                out[u] = static_cast<uint16_t>(std::min(std::min(a, b), std::min(c, d)) + 1);
+            }
+        }
+    }
+
+    //sensor noise grows with distance, 6 cm plus 1.5 % of the background depth
+    static int foregroundMargin(int backgroundDepth) { return 60 + backgroundDepth * 3 / 200; }
+
+    //marks foreground cells in parent (own index) and background cells (-1), keeps the background up to date
+    void subtractBackground() {
+        const int nearLimit = static_cast<int>(minDepth * 1000.0f);
+        const int farLimit = static_cast<int>(maxDepth * 1000.0f);
+        const bool learning = framesSeen < learningFrames;
+        const int cells = gridWidth * gridHeight;
+        foregroundCells = 0;
+        for (int i = 0; i < cells; ++i) {
+            int d = grid[i];
+            int b = background[i];
+            parent[i] = -1;
+            if (d == 0) continue;
+            if (d > b && (learning || b != 0)) {
+                background[i] = static_cast<uint16_t>(d);
+                absorbCount[i] = 0;
+                continue;
+            }
+            if (d < nearLimit || d > farLimit) continue;
+            if (b == 0 || d + foregroundMargin(b) < b) {
+                if (++absorbCount[i] >= absorbFrames) {
+                    background[i] = static_cast<uint16_t>(d);
+                    absorbCount[i] = 0;
+                    continue;
+                }
+                parent[i] = i;
+                ++foregroundCells;
+            }
+            else {
+                absorbCount[i] = 0;
+            }
+        }
+    }
+
+    int32_t find(int32_t i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    }
+
+    void unite(int32_t a, int32_t b) {
+        a = find(a);
+        b = find(b);
+        if (a != b) parent[std::max(a, b)] = std::min(a, b);
+    }
+
+    //connected blobs of the foreground; a dense foreground is labelled on every other cell of every other row, each
+    //labelled cell then stands for the four of its 2x2 block
+    void label() {
+        const int jump = static_cast<int>(depthJump * 1000.0f);
+        const int step = foregroundCells > denseForeground ? 2 : 1;
+        const int rowStep = step * gridWidth;
+        labelStep = step;
+        if (step > 1) {
+            for (int v = 0; v < gridHeight; ++v) {
+                for (int u = 0; u < gridWidth; ++u) {
+                    if ((u | v) & 1) parent[v * gridWidth + u] = -1;
+                }
+            }
+        }
+        for (int v = 0; v < gridHeight; v += step) {
+            for (int u = 0; u < gridWidth; u += step) {
+                int i = v * gridWidth + u;
+                if (parent[i] < 0) continue;
+                if (u > 0 && parent[i - step] >= 0 && std::abs(grid[i] - grid[i - step]) < jump) unite(i, i - step);
+                if (v > 0 && parent[i - rowStep] >= 0 && std::abs(grid[i] - grid[i - rowStep]) < jump) unite(i, i - rowStep);
+            }
+        }
+
+        blobs.clear();
+        const int weight = step * step;
+        for (int v = 0; v < gridHeight; v += step) {
+            for (int u = 0; u < gridWidth; u += step) {
+                int i = v * gridWidth + u;
+                if (parent[i] < 0) continue;
+                int32_t root = find(i);
+                if (root == i) {
+                    blobOf[i] = static_cast<int32_t>(blobs.size());
+                    blobs.push_back(Blob{ 0, gridWidth, gridHeight, -1, -1, 0, 0.0, 0.0, 0.0 });
+                }
+                else {
+                    blobOf[i] = blobOf[root];
+                }
+                addCell(blobs[blobOf[i]], i, u, v, weight);
+            }
+        }
+    }
+
+    void addCell(Blob& blob, int i, int u, int v, int weight) {
+        const float d = grid[i];
+        blob.cells += weight;
+        blob.sumDepth += static_cast<int64_t>(grid[i]) * weight;
+        blob.sumX += gridRayX[i] * d * weight;
+        blob.sumY += gridRayY[i] * d * weight;
+        blob.area += gridArea[i] * d * d * weight;
+        blob.minU = std::min(blob.minU, u);
+        blob.maxU = std::max(blob.maxU, u);
+        blob.minV = std::min(blob.minV, v);
+        blob.maxV = std::max(blob.maxV, v);
+    }
+
+    //centroid of a blob in camera space and its surface area facing the sensor
+    static void centroid(const Blob& blob, float& x, float& y, float& z, float& area) {
+        z = static_cast<float>(blob.sumDepth) / blob.cells * 0.001f;
+        x = static_cast<float>(blob.sumX / blob.cells * 0.001);
+        y = static_cast<float>(blob.sumY / blob.cells * 0.001);
+        area = static_cast<float>(blob.area * 1e-6);
+    }
+
+    void follow(float dt) {
+        float predictedZ = state.z + state.velocity * dt * (state.missedFrames + 1);
+        int best = -1;
+        float bestScore = 0.0f;
+        for (size_t b = 0; b < blobs.size(); ++b) {
+            float x, y, z, area;
+            centroid(blobs[b], x, y, z, area);
+            if (area < minBlobArea) continue;
+            if (state.valid) {
+                //nearest to the prediction inside the gate
+                float distance = std::sqrt((x - state.x) * (x - state.x) + (z - predictedZ) * (z - predictedZ));
+                float gate = gateDistance + std::fabs(state.velocity) * dt * state.missedFrames;
+                if (distance < gate && (best < 0 || distance < bestScore)) {
+                    best = static_cast<int>(b);
+                    bestScore = distance;
+                }
+            }
+            else if (std::fabs(x) < corridorHalfWidth && (best < 0 || area > bestScore)) {
+                //a new walker: the largest person-sized blob in the corridor
+                best = static_cast<int>(b);
+                bestScore = area;
+            }
+        }
+
+        if (best < 0) {
+            if (state.valid && ++state.missedFrames > lostFrames) state = DepthTrack();
+            return;
+        }
+
+        const Blob& blob = blobs[best];
+        float x, y, z, area;
+        centroid(blob, x, y, z, area);
+        if (!state.valid) {
+            state = DepthTrack();
+            state.valid = true;
+            state.z = z;
+        }
+        else {
+            //alpha-beta filter on the centroid depth
+            float residual = z - predictedZ;
+            state.z = predictedZ + 0.5f * residual;
+            state.velocity += 0.2f * residual / (dt * (state.missedFrames + 1));
+        }
+        state.x = x;
+        state.y = y;
+        state.missedFrames = 0;
+        state.cells = blob.cells;
+        state.left = blob.minU * 2;
+        state.top = blob.minV * 2;
+        state.right = blob.maxU * 2 + 1;
+        state.bottom = blob.maxV * 2 + 1;
+        state.nearestDepth = nearestSurface(best, blob);
+    }
+
+    //5th percentile of the depth of the blob's labelled cells, in 1 cm bins
+    float nearestSurface(int blobIndex, const Blob& blob) {
+        int histogram[801] = { 0 };
+        int labelled = 0;
+        for (int v = blob.minV; v <= blob.maxV; v += labelStep) {
+            for (int u = blob.minU; u <= blob.maxU; u += labelStep) {
+                int i = v * gridWidth + u;
+                if (parent[i] < 0 || blobOf[i] != blobIndex) continue;
+                ++histogram[std::min(800, grid[i] / 10)];
+                ++labelled;
+            }
+        }
+        int wanted = std::max(1, labelled / 20), seen = 0;
+        for (int bin = 0; bin <= 800; ++bin) {
+            seen += histogram[bin];
+            if (seen >= wanted) return bin * 0.01f + 0.005f;
+        }
+        return state.z;
+    }
+};
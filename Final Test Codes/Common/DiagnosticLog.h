@@ -0,0 +1,446 @@
+//Asynchronous diagnostic logging for the frame loop
+//a log call stores its arguments in a lock-free ring and returns, a background thread formats and writes them,
+//so the frame thread never waits on the console. Every call site can be rate limited, repeats inside the interval
+//are counted and reported with the next message of that site.
+//
+//usage:
+//  DIAG_INFO("Participant Locked: {}", trackedID);                                      every call
+//  DIAG_INFO_EVERY(500, "Distance Reached by Right Hand: {}cm", distance * 100.0f);     at most once per 500 ms
+//  DIAG_WARNING_EVERY(1000, "Tracked participant lost. Searching for new participant...");
+//
+//{} is replaced by the next argument (numbers, bool, char, const char*, std::string; texts are cut at 47 bytes in total,
+//the texts past that are empty)
+//define DIAGNOSTIC_LEVEL to 0 (debug), 1 (info, default), 2 (warning) or 3 (error) to filter by severity: the calls below
+//it are compiled out (their arguments are not evaluated), minimumSeverity can raise the level further at runtime,
+//and DIAGNOSTIC_TRACE to write a binary trace (diagnostics.trace) instead of console text, decoded afterwards with
+//Benchmarks/DiagnosticTraceDecode.cpp
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#ifndef DIAGNOSTIC_LEVEL
+#define DIAGNOSTIC_LEVEL 1
+#endif
+
+enum DiagnosticSeverity {
+    Diag_Debug = 0,
+    Diag_Info = 1,
+    Diag_Warning = 2,
+    Diag_Error = 3
+};
+
+inline const char* diagnosticSeverityName(int severity) {
+    static const char* names[4] = { "Debug", "Info", "Warning", "Error" };
+    return names[severity & 3];
+}
+
+inline int64_t diagnosticNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//one static instance per call site, created by the DIAG_ macros
+struct DiagnosticSite {
+    int severity;
+    const char* file;
+    int line;
+    const char* format;
+    int64_t intervalNs;
+    uint32_t id;
+    std::atomic<int64_t> lastTime{ INT64_MIN / 2 };
+    std::atomic<uint32_t> suppressed{ 0 };
+
+    DiagnosticSite(int severity, const char* file, int line, int intervalMs, const char* format)
+        : severity(severity), file(file), line(line), format(format), intervalNs(int64_t(intervalMs) * 1000000), id(nextId()) {}
+
+    //false while the site is inside its rate limit interval, the call is then only counted
+    bool admit(int64_t now) {
+        if (intervalNs <= 0) return true;
+        int64_t last = lastTime.load(std::memory_order_relaxed);
+        if (now - last < intervalNs || !lastTime.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+            suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static uint32_t nextId() {
+        static std::atomic<uint32_t> counter{ 0 };
+        return counter.fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+//arguments of one call, as stored in the ring and in the binary trace
+struct DiagnosticRecord {
+    enum ArgType : uint8_t { Arg_Int, Arg_Unsigned, Arg_Double, Arg_Bool, Arg_Text };
+    static const int maxArgs = 6;
+    static const int textCapacity = 47;
+
+    const DiagnosticSite* site;
+    int64_t time;
+    uint32_t thread;
+    uint32_t suppressed;
+    uint8_t argCount;
+    uint8_t textLength;
+    ArgType argTypes[maxArgs];
+    union Value {
+        int64_t i;
+        uint64_t u;
+        double d;
+    } args[maxArgs];
+    char text[textCapacity + 1];                //text arguments one after another, each ending with '\0', textLength bytes in all
+};
+
+//Vyukov bounded multi-producer queue, the writer thread is the only consumer
+//a full ring drops the message and counts it, the frame thread never waits
+class DiagnosticRing {
+public:
+    explicit DiagnosticRing(size_t capacity) : mask(capacity - 1), cells(new Cell[capacity]) {
+        for (size_t i = 0; i < capacity; ++i) cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    //record to fill in place, nullptr when the ring is full; position is passed on to endPush
+    DiagnosticRecord* beginPush(size_t& position) {
+        position = enqueuePosition.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[position & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0) {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    return &cell.record;
+                }
+            }
+            else if (difference < 0) {
+                return nullptr;
+            }
+            else {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void endPush(size_t position) {
+        cells[position & mask].sequence.store(position + 1, std::memory_order_release);
+    }
+
+    bool pop(DiagnosticRecord& record) {
+        Cell& cell = cells[dequeuePosition & mask];
+        if (cell.sequence.load(std::memory_order_acquire) != dequeuePosition + 1) return false;
+        record = cell.record;
+        cell.sequence.store(dequeuePosition + mask + 1, std::memory_order_release);
+        ++dequeuePosition;
+        return true;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        DiagnosticRecord record;
+    };
+    size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    alignas(64) std::atomic<size_t> enqueuePosition{ 0 };
+    alignas(64) size_t dequeuePosition = 0;        //writer thread only
+};
+
+//writes {} formatted messages, used by the console writer and by the trace decoder
+inline void formatDiagnostic(std::ostream& out, const char* format, const DiagnosticRecord& record) {
+    int arg = 0;
+    const char* text = record.text;
+    const char* textEnd = record.text + record.textLength;     //storeText and the trace decoder keep it within textCapacity
+    for (const char* c = format; *c; ++c) {
+        if (c[0] == '{' && c[1] == '}' && arg < record.argCount) {
+            const DiagnosticRecord::Value& value = record.args[arg];
+            switch (record.argTypes[arg]) {
+            case DiagnosticRecord::Arg_Int: out << value.i; break;
+            case DiagnosticRecord::Arg_Unsigned: out << value.u; break;
+            case DiagnosticRecord::Arg_Double: out << value.d; break;
+            case DiagnosticRecord::Arg_Bool: out << (value.u ? "true" : "false"); break;
+            case DiagnosticRecord::Arg_Text: {
+                //a text that did not fit has no bytes left, it prints empty
+                const char* end = std::find(text, textEnd, '\0');
+                out.write(text, end - text);
+                text = end < textEnd ? end + 1 : textEnd;
+                break;
+            }
+            }
+            ++arg;
+            ++c;
+        }
+        else {
+            out << *c;
+        }
+    }
+    if (record.suppressed > 0) out << "  (+" << record.suppressed << " more)";
+}
+
+class DiagnosticLog {
+public:
+    static const size_t ringCapacity = 4096;
+
+    DiagnosticLog() : ring(ringCapacity) {
+        minimumSeverity.store(DIAGNOSTIC_LEVEL, std::memory_order_relaxed);
+#ifdef DIAGNOSTIC_TRACE
+        setTraceFile("diagnostics.trace");
+#endif
+    }
+
+    ~DiagnosticLog() { stop(); }
+
+    //writes what is queued and ends the writer thread, later messages are dropped
+    void stop() {
+        stopping.store(true, std::memory_order_release);
+        if (writer.joinable()) writer.join();
+        if (trace.is_open()) trace.close();
+    }
+
+    std::atomic<int> minimumSeverity;
+    std::atomic<uint64_t> dropped{ 0 };       //messages lost to a full ring
+
+    bool enabled(int severity) const { return severity >= minimumSeverity.load(std::memory_order_relaxed); }
+
+    //binary trace instead of console text, call before the first message
+    bool setTraceFile(const std::string& path) {
+        trace.open(path, std::ios::binary | std::ios::trunc);
+        if (!trace.is_open()) {
+            std::cerr << "Failed to open diagnostic trace " << path << std::endl;
+            return false;
+        }
+        trace.write("DIAG", 4);
+        uint32_t version = 1;
+        trace.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        return true;
+    }
+
+    template<class... Args>
+    void write(DiagnosticSite& site, const Args&... args) {
+        int64_t now = diagnosticNow();
+        if (!site.admit(now)) return;
+        startWriter();
+
+        size_t position = 0;
+        DiagnosticRecord* record = ring.beginPush(position);
+        if (!record) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        record->site = &site;
+        record->time = now;
+        record->thread = threadNumber();
+        record->suppressed = site.suppressed.exchange(0, std::memory_order_relaxed);
+        record->argCount = 0;
+        record->textLength = 0;
+        storeArgs(*record, args...);
+        ring.endPush(position);
+    }
+
+private:
+    DiagnosticRing ring;
+    std::thread writer;
+    std::atomic<bool> writerStarted{ false };
+    std::atomic<bool> stopping{ false };
+    std::once_flag writerOnce;
+    std::ofstream trace;
+    std::unique_ptr<bool[]> siteWritten;        //trace only, sites already described in the file
+    uint32_t siteWrittenSize = 0;
+
+    void startWriter() {
+        if (writerStarted.load(std::memory_order_acquire)) return;
+        std::call_once(writerOnce, [this] {
+            writer = std::thread(&DiagnosticLog::writerLoop, this);
+            writerStarted.store(true, std::memory_order_release);
+        });
+    }
+
+    static uint32_t threadNumber() {
+        static std::atomic<uint32_t> counter{ 0 };
+        static thread_local uint32_t number = counter.fetch_add(1, std::memory_order_relaxed);
+        return number;
+    }
+
+    static void storeArgs(DiagnosticRecord&) {}
+
+    template<class First, class... Rest>
+    static void storeArgs(DiagnosticRecord& record, const First& first, const Rest&... rest) {
+        if (record.argCount < DiagnosticRecord::maxArgs) {
+            storeArg(record, first);
+            ++record.argCount;
+        }
+        storeArgs(record, rest...);
+    }
+
+    template<class T>
+    static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+        storeArg(DiagnosticRecord& record, const T& value) {
+        DiagnosticRecord::Value& slot = record.args[record.argCount];
+        if (std::is_same<T, bool>::value) {
+            record.argTypes[record.argCount] = DiagnosticRecord::Arg_Bool;
+            slot.u = value ? 1 : 0;
+        }
+        else if (std::is_same<T, char>::value) {
+            char text[2] = { static_cast<char>(value), '\0' };
+            storeText(record, text, 1);
+        }
+        else if (std::is_signed<T>::value || std::is_enum<T>::value) {
+            record.argTypes[record.argCount] = DiagnosticRecord::Arg_Int;
+            slot.i = static_cast<int64_t>(value);
+        }
+        else {
+            record.argTypes[record.argCount] = DiagnosticRecord::Arg_Unsigned;
+            slot.u = static_cast<uint64_t>(value);
+        }
+    }
+
+    template<class T>
+    static typename std::enable_if<std::is_floating_point<T>::value>::type
+        storeArg(DiagnosticRecord& record, const T& value) {
+        record.argTypes[record.argCount] = DiagnosticRecord::Arg_Double;
+        record.args[record.argCount].d = static_cast<double>(value);
+    }
+
+    static void storeArg(DiagnosticRecord& record, const char* text) { storeText(record, text, std::strlen(text)); }
+    static void storeArg(DiagnosticRecord& record, const std::string& text) { storeText(record, text.data(), text.size()); }
+
+    //every text is stored with its '\0', cut to the room left; with no room left it is a zero-length entry
+    static void storeText(DiagnosticRecord& record, const char* text, size_t length) {
+        record.argTypes[record.argCount] = DiagnosticRecord::Arg_Text;
+        size_t room = DiagnosticRecord::textCapacity - record.textLength;
+        if (room == 0) return;
+        if (length + 1 > room) length = room - 1;
+        std::memcpy(record.text + record.textLength, text, length);
+        record.text[record.textLength + length] = '\0';
+        record.textLength = static_cast<uint8_t>(record.textLength + length + 1);
+    }
+
+    void writerLoop() {
+        DiagnosticRecord record;
+        uint64_t droppedReported = 0;
+        int64_t dropReportTime = 0;
+        for (;;) {
+            bool wrote = false;
+            while (ring.pop(record)) {
+                if (trace.is_open()) writeTrace(record);
+                else writeText(record);
+                wrote = true;
+            }
+            bool stop = !wrote && stopping.load(std::memory_order_acquire);
+
+            //lost messages are reported at most once a second
+            uint64_t droppedNow = dropped.load(std::memory_order_relaxed);
+            int64_t now = diagnosticNow();
+            if (droppedNow != droppedReported && (stop || now - dropReportTime >= 1000000000)) {
+                std::cerr << "Diagnostics: " << droppedNow - droppedReported << " messages dropped (log ring full)\n";
+                droppedReported = droppedNow;
+                dropReportTime = now;
+            }
+            if (wrote) {
+                std::cout.flush();
+                if (trace.is_open()) trace.flush();
+                continue;
+            }
+            if (stop) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+
+    void writeText(const DiagnosticRecord& record) {
+        std::ostream& out = record.site->severity >= Diag_Warning ? std::cerr : std::cout;
+        if (record.site->severity != Diag_Info) out << diagnosticSeverityName(record.site->severity) << ": ";
+        formatDiagnostic(out, record.site->format, record);
+        out << '\n';
+    }
+
+    //'S' site description the first time a site appears, then 'R' records that refer to it by id
+    void writeTrace(const DiagnosticRecord& record) {
+        const DiagnosticSite& site = *record.site;
+        if (site.id >= siteWrittenSize) {
+            uint32_t size = std::max<uint32_t>(64, site.id * 2);
+            std::unique_ptr<bool[]> grown(new bool[size]());
+            for (uint32_t i = 0; i < siteWrittenSize; ++i) grown[i] = siteWritten[i];
+            siteWritten.swap(grown);
+            siteWrittenSize = size;
+        }
+        if (!siteWritten[site.id]) {
+            siteWritten[site.id] = true;
+            trace.put('S');
+            writeValue(site.id);
+            writeValue(static_cast<int32_t>(site.severity));
+            writeValue(static_cast<int32_t>(site.line));
+            writeString(site.file);
+            writeString(site.format);
+        }
+        trace.put('R');
+        writeValue(site.id);
+        writeValue(record.time);
+        writeValue(record.thread);
+        writeValue(record.suppressed);
+        writeValue(record.argCount);
+        writeValue(record.textLength);
+        trace.write(reinterpret_cast<const char*>(record.argTypes), record.argCount);
+        trace.write(reinterpret_cast<const char*>(record.args), record.argCount * sizeof(DiagnosticRecord::Value));
+        trace.write(record.text, record.textLength);
+    }
+
+    template<class T>
+    void writeValue(const T& value) { trace.write(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+    void writeString(const char* text) {
+        uint32_t length = static_cast<uint32_t>(std::strlen(text));
+        writeValue(length);
+        trace.write(text, length);
+    }
+};
+
+inline DiagnosticLog& diagnosticLog() {
+    static DiagnosticLog log;
+    return log;
+}
+
+#define DIAG_LOG(severity, intervalMs, format, ...) \
+    do { \
+        if (diagnosticLog().enabled(severity)) { \
+            static DiagnosticSite diagnosticSite_(severity, __FILE__, __LINE__, intervalMs, format); \
+            diagnosticLog().write(diagnosticSite_, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+//calls below DIAGNOSTIC_LEVEL expand to an empty statement
+#define DIAG_COMPILED_OUT(...) do { } while (0)
+
+#if DIAGNOSTIC_LEVEL <= 0
+#define DIAG_DEBUG(format, ...) DIAG_LOG(Diag_Debug, 0, format, ##__VA_ARGS__)
+#define DIAG_DEBUG_EVERY(intervalMs, format, ...) DIAG_LOG(Diag_Debug, intervalMs, format, ##__VA_ARGS__)
+#else
+#define DIAG_DEBUG(...) DIAG_COMPILED_OUT(__VA_ARGS__)
+#define DIAG_DEBUG_EVERY(...) DIAG_COMPILED_OUT(__VA_ARGS__)
+#endif
+
+#if DIAGNOSTIC_LEVEL <= 1
+#define DIAG_INFO(format, ...) DIAG_LOG(Diag_Info, 0, format, ##__VA_ARGS__)
+#define DIAG_INFO_EVERY(intervalMs, format, ...) DIAG_LOG(Diag_Info, intervalMs, format, ##__VA_ARGS__)
+#else
+#define DIAG_INFO(...) DIAG_COMPILED_OUT(__VA_ARGS__)
+#define DIAG_INFO_EVERY(...) DIAG_COMPILED_OUT(__VA_ARGS__)
+#endif
+
+#if DIAGNOSTIC_LEVEL <= 2
+#define DIAG_WARNING(format, ...) DIAG_LOG(Diag_Warning, 0, format, ##__VA_ARGS__)
+#define DIAG_WARNING_EVERY(intervalMs, format, ...) DIAG_LOG(Diag_Warning, intervalMs, format, ##__VA_ARGS__)
+#else
+#define DIAG_WARNING(...) DIAG_COMPILED_OUT(__VA_ARGS__)
+#define DIAG_WARNING_EVERY(...) DIAG_COMPILED_OUT(__VA_ARGS__)
+#endif
+
+#define DIAG_ERROR(format, ...) DIAG_LOG(Diag_Error, 0, format, ##__VA_ARGS__)
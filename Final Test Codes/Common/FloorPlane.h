@@ -0,0 +1,358 @@
+//Floor plane from the depth frame, for heights above the floor
+//a foot is raised when it is higher above the floor, not when its camera Y moved: a participant stepping sideways or
+//a tilted sensor changes camera Y but not the height above the floor. FloorPlaneFitter fits the plane to a subsampled
+//point cloud of one 512x424 depth frame by RANSAC (inliers counted four points at a time with SSE2), refined by least
+//squares on the inliers; about 0.1 ms per fit (BM_FloorPlaneFit_SOOLWEO). FloorPlaneEstimator runs the fit on its
+//own thread every few seconds, the acquisition thread only hands it a copy of a depth frame when a refit is due and
+//the worker is idle, so a fit never delays a frame. A height is one dot product with the plane.
+//
+//  FloorPlaneEstimator floorEstimator;
+//  floorEstimator.start();
+//  floorEstimator.offer(depthBuffer.data(), depthTime);             //every depth frame, returns at once
+//  FloorPlane floor = floorEstimator.plane();                       //the latest fit, valid once a floor was found
+//  if (floor.valid) ...floor.height(joints[JointType_FootLeft].Position)...
+//
+//the floor is the plane with the most points within inlierDistance whose normal is within maxTilt of camera up
+//and that lies between minSensorHeight and maxSensorHeight below the sensor. The depth pixels are turned into camera
+//space points through fitter.rays (DepthPointCloud.h), the sensor's own table when the test sets it.
+#pragma once
+#include "SkeletonTypes.h"
+#include "DepthPointCloud.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || (defined(_MSC_VER) && (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)))
+#include <emmintrin.h>
+#define FLOOR_PLANE_SSE2 1
+#endif
+
+//a*X + b*Y + c*Z + d = 0, (a, b, c) the unit normal pointing up, d the sensor height above the floor
+struct FloorPlane {
+    bool valid = false;
+    float a = 0.0f, b = 1.0f, c = 0.0f, d = 0.0f;
+    int inliers = 0;                //points of the fit within inlierDistance
+    float rmsError = 0.0f;          //of the inliers (m)
+    TIMESPAN relativeTime = 0;      //depth frame the plane was fitted on
+
+    //height of a camera space point above the floor (m)
+    float height(const CameraSpacePoint& p) const { return a * p.X + b * p.Y + c * p.Z + d; }
+
+    //angle between the floor normal and camera up, forward and sideways tilt of the sensor together (degrees)
+    float tiltDegrees() const { return std::acos(std::min(1.0f, std::max(-1.0f, b))) * 57.29578f; }
+};
+
+//number of points with |a*x + b*y + c*z + d| < threshold, count a multiple of 4
+inline int countPlaneInliersScalar(const float* xs, const float* ys, const float* zs, int count,
+    float a, float b, float c, float d, float threshold) {
+    int inliers = 0;
+    for (int i = 0; i < count; ++i) {
+        inliers += std::fabs(a * xs[i] + b * ys[i] + c * zs[i] + d) < threshold;
+    }
+    return inliers;
+}
+
+#ifdef FLOOR_PLANE_SSE2
+
+inline int countPlaneInliers(const float* xs, const float* ys, const float* zs, int count,
+    float a, float b, float c, float d, float threshold) {
+    const __m128 va = _mm_set1_ps(a), vb = _mm_set1_ps(b), vc = _mm_set1_ps(c), vd = _mm_set1_ps(d);
+    const __m128 limit = _mm_set1_ps(threshold);
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128i counts = _mm_setzero_si128();
+    for (int i = 0; i < count; i += 4) {
+        __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(va, _mm_loadu_ps(xs + i)), _mm_mul_ps(vb, _mm_loadu_ps(ys + i))),
+            _mm_add_ps(_mm_mul_ps(vc, _mm_loadu_ps(zs + i)), vd));
+        //an inlier lane is all ones, -1, so subtracting the mask counts it
+        __m128 inside = _mm_cmplt_ps(_mm_and_ps(distance, absMask), limit);
+        counts = _mm_sub_epi32(counts, _mm_castps_si128(inside));
+    }
+    alignas(16) int32_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), counts);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+#else
+
+inline int countPlaneInliers(const float* xs, const float* ys, const float* zs, int count,
+    float a, float b, float c, float d, float threshold) {
+    return countPlaneInliersScalar(xs, ys, zs, count, a, b, c, d, threshold);
+}
+
+#endif
+
+class FloorPlaneFitter {
+public:
+    static const int depthWidth = 512;
+    static const int depthHeight = 424;
+
+    int step = 4;                       //every step-th pixel in both directions, 128x106 points
+    float minDepth = 0.5f;              //m
+    float maxDepth = 4.5f;              //m, the floor farther away is too noisy to help
+    float inlierDistance = 0.03f;       //m
+    float maxTilt = 35.0f;              //degrees between the floor normal and camera up
+    float minSensorHeight = 0.2f;       //m
+    float maxSensorHeight = 2.5f;       //m
+    int minInliers = 400;               //points, about 0.6 m2 of floor at 2 m
+    int maxIterations = 200;
+    uint32_t seed = 0x9E3779B9u;        //the same frame gives the same plane
+    DepthRayTable rays;                 //camera space rays of the depth pixels, the nominal pinhole until set
+
+    //fits the floor to one 512x424 depth frame (mm), false when no plane passes the checks
+    bool fit(const UINT16* depth, FloorPlane& plane) {
+        buildPointCloud(depth);
+        if (pointCount < std::max(minInliers, 3)) return false;
+
+        const float minUp = std::cos(maxTilt * 0.01745329f);
+        uint32_t random = seed;
+        int bestInliers = 0;
+        float best[4] = { 0.0f, 1.0f, 0.0f, 0.0f };
+        int iterations = maxIterations;
+        for (int k = 0; k < iterations; ++k) {
+            int i0 = static_cast<int>(nextRandom(random) % pointCount);
+            int i1 = static_cast<int>(nextRandom(random) % pointCount);
+            int i2 = static_cast<int>(nextRandom(random) % pointCount);
+            float candidate[4];
+            if (!planeThrough(i0, i1, i2, candidate)) continue;
+            if (candidate[1] < minUp || candidate[3] < minSensorHeight || candidate[3] > maxSensorHeight) continue;
+
+            int inliers = countPlaneInliers(xs.data(), ys.data(), zs.data(), paddedCount,
+                candidate[0], candidate[1], candidate[2], candidate[3], inlierDistance);
+            if (inliers > bestInliers) {
+                bestInliers = inliers;
+                std::copy(candidate, candidate + 4, best);
+                //enough iterations to draw three inliers at least once with 99 % probability
+                double fraction = static_cast<double>(inliers) / pointCount;
+                double allInliers = std::min(0.999, fraction * fraction * fraction);
+                int needed = static_cast<int>(std::ceil(std::log(0.01) / std::log(1.0 - allInliers)));
+                iterations = std::min(maxIterations, std::max(k + 1, needed));
+            }
+        }
+        if (bestInliers < minInliers) return false;
+
+        refine(best);
+        if (best[1] < minUp || best[3] < minSensorHeight || best[3] > maxSensorHeight) return false;
+
+        int inliers = 0;
+        double squares = 0.0;
+        for (int i = 0; i < pointCount; ++i) {
+            float distance = best[0] * xs[i] + best[1] * ys[i] + best[2] * zs[i] + best[3];
+            if (std::fabs(distance) < inlierDistance) {
+                ++inliers;
+                squares += distance * distance;
+            }
+        }
+        if (inliers < minInliers) return false;
+
+        plane.valid = true;
+        plane.a = best[0];
+        plane.b = best[1];
+        plane.c = best[2];
+        plane.d = best[3];
+        plane.inliers = inliers;
+        plane.rmsError = static_cast<float>(std::sqrt(squares / inliers));
+        return true;
+    }
+
+    int points() const { return pointCount; }
+
+private:
+    //structure of arrays, padded to a multiple of 4 with points far from any plane
+    std::vector<float> xs, ys, zs;
+    int pointCount = 0, paddedCount = 0;
+
+    void buildPointCloud(const UINT16* depth) {
+        const size_t capacity = static_cast<size_t>((depthWidth + step - 1) / step) * ((depthHeight + step - 1) / step) + 4;
+        xs.resize(capacity);
+        ys.resize(capacity);
+        zs.resize(capacity);
+        const UINT16 nearest = static_cast<UINT16>(minDepth * 1000.0f);
+        const UINT16 farthest = static_cast<UINT16>(maxDepth * 1000.0f);
+        int n = 0;
+        for (int v = step / 2; v < depthHeight; v += step) {
+            for (int u = step / 2; u < depthWidth; u += step) {
+                int pixel = v * depthWidth + u;
+                UINT16 value = depth[pixel];
+                if (value < nearest || value > farthest) continue;
+                float z = value * 0.001f;
+                xs[n] = rays.rayX[pixel] * z;
+                ys[n] = rays.rayY[pixel] * z;
+                zs[n] = z;
+                ++n;
+            }
+        }
+        pointCount = n;
+        paddedCount = (n + 3) & ~3;
+        for (int i = n; i < paddedCount; ++i) {
+            xs[i] = zs[i] = 0.0f;
+            ys[i] = 1e9f;
+        }
+    }
+
+    static uint32_t nextRandom(uint32_t& state) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    //unit normal pointing up (positive b) and d, false for nearly collinear points
+    bool planeThrough(int i0, int i1, int i2, float* plane) const {
+        float ux = xs[i1] - xs[i0], uy = ys[i1] - ys[i0], uz = zs[i1] - zs[i0];
+        float vx = xs[i2] - xs[i0], vy = ys[i2] - ys[i0], vz = zs[i2] - zs[i0];
+        float nx = uy * vz - uz * vy, ny = uz * vx - ux * vz, nz = ux * vy - uy * vx;
+        float length = std::sqrt(nx * nx + ny * ny + nz * nz);
+        if (length < 1e-6f) return false;
+        if (ny < 0.0f) length = -length;
+        plane[0] = nx / length;
+        plane[1] = ny / length;
+        plane[2] = nz / length;
+        plane[3] = -(plane[0] * xs[i0] + plane[1] * ys[i0] + plane[2] * zs[i0]);
+        return true;
+    }
+
+    //least squares plane of the inliers: the normal is the eigenvector of the smallest eigenvalue of their
+    //covariance, found by inverse iteration from the RANSAC normal
+    void refine(float* plane) const {
+        double n = 0.0, mx = 0.0, my = 0.0, mz = 0.0;
+        for (int i = 0; i < pointCount; ++i) {
+            if (std::fabs(plane[0] * xs[i] + plane[1] * ys[i] + plane[2] * zs[i] + plane[3]) >= inlierDistance) continue;
+            n += 1.0;
+            mx += xs[i];
+            my += ys[i];
+            mz += zs[i];
+        }
+        if (n < 3.0) return;
+        mx /= n;
+        my /= n;
+        mz /= n;
+
+        double cxx = 0, cxy = 0, cxz = 0, cyy = 0, cyz = 0, czz = 0;
+        for (int i = 0; i < pointCount; ++i) {
+            if (std::fabs(plane[0] * xs[i] + plane[1] * ys[i] + plane[2] * zs[i] + plane[3]) >= inlierDistance) continue;
+            double dx = xs[i] - mx, dy = ys[i] - my, dz = zs[i] - mz;
+            cxx += dx * dx; cxy += dx * dy; cxz += dx * dz;
+            cyy += dy * dy; cyz += dy * dz; czz += dz * dz;
+        }
+        //a small shift keeps the matrix invertible when the points lie exactly on a plane
+        double shift = 1e-9 * (cxx + cyy + czz) + 1e-12;
+        cxx += shift;
+        cyy += shift;
+        czz += shift;
+        double det = cxx * (cyy * czz - cyz * cyz) - cxy * (cxy * czz - cyz * cxz) + cxz * (cxy * cyz - cyy * cxz);
+        if (std::fabs(det) < 1e-30) return;
+
+        double v[3] = { plane[0], plane[1], plane[2] };
+        for (int k = 0; k < 4; ++k) {
+            //Cramer's rule for C w = v
+            double w0 = (v[0] * (cyy * czz - cyz * cyz) - cxy * (v[1] * czz - cyz * v[2]) + cxz * (v[1] * cyz - cyy * v[2])) / det;
+            double w1 = (cxx * (v[1] * czz - cyz * v[2]) - v[0] * (cxy * czz - cyz * cxz) + cxz * (cxy * v[2] - v[1] * cxz)) / det;
+            double w2 = (cxx * (cyy * v[2] - v[1] * cyz) - cxy * (cxy * v[2] - v[1] * cxz) + v[0] * (cxy * cyz - cyy * cxz)) / det;
+            double length = std::sqrt(w0 * w0 + w1 * w1 + w2 * w2);
+            if (length <= 0.0) return;
+            if (w1 < 0.0) length = -length;
+            v[0] = w0 / length;
+            v[1] = w1 / length;
+            v[2] = w2 / length;
+        }
+        plane[0] = static_cast<float>(v[0]);
+        plane[1] = static_cast<float>(v[1]);
+        plane[2] = static_cast<float>(v[2]);
+        plane[3] = static_cast<float>(-(v[0] * mx + v[1] * my + v[2] * mz));
+    }
+};
+
+class FloorPlaneEstimator {
+public:
+    float refreshSeconds = 3.0f;        //between fits once a floor was found
+    float retrySeconds = 0.5f;          //between fits while none was found
+    FloorPlaneFitter fitter;            //set up before start(), fitter.rays from the coordinate mapper
+
+    ~FloorPlaneEstimator() { stop(); }
+
+    void start() {
+        if (worker.joinable()) return;
+        running = true;
+        worker = std::thread(&FloorPlaneEstimator::fitStage, this);
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            running = false;
+        }
+        pendingReady.notify_one();
+        if (worker.joinable()) worker.join();
+    }
+
+    //every 512x424 depth frame (mm); copies it for the worker only when a refit is due and the worker is idle
+    void offer(const UINT16* depth, TIMESPAN relativeTime) {
+        if (busy.load(std::memory_order_acquire)) return;
+        float interval = hasPlane.load(std::memory_order_relaxed) ? refreshSeconds : retrySeconds;
+        if (offered && relativeTime - lastOffer < static_cast<TIMESPAN>(interval * 1e7f)) return;
+
+        //the worker does not touch pending while busy is false
+        pending.assign(depth, depth + FloorPlaneFitter::depthWidth * FloorPlaneFitter::depthHeight);
+        pendingTime = relativeTime;
+        lastOffer = relativeTime;
+        offered = true;
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            busy.store(true, std::memory_order_release);
+        }
+        pendingReady.notify_one();
+    }
+
+    //the latest floor found, a failed refit (the floor hidden for a moment) keeps the previous one
+    FloorPlane plane() const {
+        std::lock_guard<std::mutex> lock(planeMutex);
+        return latest;
+    }
+
+    //duration of the last fit (ms), worker side, for the profile printout
+    double lastFitMs() const { return fitMs.load(std::memory_order_relaxed); }
+
+private:
+    std::thread worker;
+    bool running = false;                       //under pendingMutex
+    std::mutex pendingMutex;
+    std::condition_variable pendingReady;
+    std::atomic<bool> busy{ false };            //a frame is waiting for or being fitted by the worker
+    std::vector<UINT16> pending;
+    TIMESPAN pendingTime = 0;
+    TIMESPAN lastOffer = 0;                     //offering thread
+    bool offered = false;                       //offering thread
+
+    mutable std::mutex planeMutex;
+    FloorPlane latest;
+    std::atomic<bool> hasPlane{ false };
+    std::atomic<double> fitMs{ 0.0 };
+
+    void fitStage() {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(pendingMutex);
+                pendingReady.wait(lock, [this] { return !running || busy.load(std::memory_order_acquire); });
+                if (!running) return;
+            }
+
+            auto begin = std::chrono::steady_clock::now();
+            FloorPlane fitted;
+            bool found = fitter.fit(pending.data(), fitted);
+            fitMs.store(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count(), std::memory_order_relaxed);
+            if (found) {
+                fitted.relativeTime = pendingTime;
+                std::lock_guard<std::mutex> lock(planeMutex);
+                latest = fitted;
+                hasPlane.store(true, std::memory_order_relaxed);
+            }
+            busy.store(false, std::memory_order_release);
+        }
+    }
+};
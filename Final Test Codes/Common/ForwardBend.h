@@ -0,0 +1,115 @@
+//Seated Forward Bend measured from the trunk as well as from the hands
+//SFB took the reach from the hand X alone, and the hands are the noisiest joints in deep flexion (often inferred, or
+//jumping onto the knees). The trunk joints stay tracked, so the reach is also predicted from the trunk: the hands are
+//held on a two link model fixed at the test ready posture, SpineBase to SpineMid and SpineMid to the hands, and each
+//frame the links take the directions of SpineBase-SpineMid and SpineMid-SpineShoulder in the sagittal plane (the
+//participant sits side on, forward along X). The reach is the weighted mean of the hand reach and the trunk prediction,
+//weighted by the tracking of the hands and of the three spine joints. Trunk flexion and hip flexion (JointKinematics.h)
+//and the fused reach keep their maxima over the trial. A handful of multiplies and two atan2 per frame.
+//
+//  ForwardBendTracker bend;
+//  bend.start(joints);                                       //test ready, the seated posture before the bend
+//  bend.update(joints, kinematics.body(i), handReach);       //every frame until the test completes, handReach in cm
+//  ...bend.fusedReach, bend.maxFusedReach, bend.maxTrunkFlexion, bend.maxHipFlexion...
+#pragma once
+#include "SkeletonTypes.h"
+#include "JointKinematics.h"
+#include <algorithm>
+#include <cmath>
+
+class ForwardBendTracker {
+public:
+    //weight of the trunk prediction with all three spine joints tracked, the hands get 1 tracked and 0.5 inferred. The
+    //trunk does not see the arms reach past the shoulders, so tracked hands count double.
+    float trunkWeight = 0.5f;
+    float minConfidence = 0.5f;         //angles with a lower confidence do not update the maxima
+
+    bool started = false;
+    //this frame
+    float trunkFlexion = 0.0f;          //degrees, spine bend at SpineMid
+    float hipFlexion = 0.0f;            //degrees, mean of both sides
+    float trunkReach = 0.0f;            //cm, predicted from the trunk
+    float fusedReach = 0.0f;            //cm
+    //over the trial
+    float maxTrunkFlexion = 0.0f;
+    float maxHipFlexion = 0.0f;
+    float maxFusedReach = 0.0f;
+
+    //a new trial, the settings are kept
+    void reset() {
+        ForwardBendTracker fresh;
+        fresh.trunkWeight = trunkWeight;
+        fresh.minConfidence = minConfidence;
+        *this = fresh;
+    }
+
+    //the seated posture with the arms forward, before the bend
+    void start(const Joint* joints) {
+        reset();
+        CameraSpacePoint hands = handsMidpoint(joints);
+        forward = hands.X >= joints[JointType_SpineBase].Position.X ? 1.0f : -1.0f;
+        float lowerU, lowerV, handU, handV;
+        sagittal(joints[JointType_SpineBase].Position, joints[JointType_SpineMid].Position, lowerU, lowerV);
+        sagittal(joints[JointType_SpineMid].Position, hands, handU, handV);
+        lowerLength = std::sqrt(lowerU * lowerU + lowerV * lowerV);
+        handLength = std::sqrt(handU * handU + handV * handV);
+        handDirection = atan2Approx(handV, handU);
+        float upperU, upperV;
+        sagittal(joints[JointType_SpineMid].Position, joints[JointType_SpineShoulder].Position, upperU, upperV);
+        upperDirection = atan2Approx(upperV, upperU);
+        startReach = lowerU + handU;
+        started = true;
+    }
+
+    //one frame of the bend, handReach the reach (cm) measured from the hands
+    void update(const Joint* joints, const BodyKinematics& angles, float handReach) {
+        if (!started) return;
+
+        float lowerU, lowerV, upperU, upperV;
+        sagittal(joints[JointType_SpineBase].Position, joints[JointType_SpineMid].Position, lowerU, lowerV);
+        sagittal(joints[JointType_SpineMid].Position, joints[JointType_SpineShoulder].Position, upperU, upperV);
+        //the hands turn with the upper trunk, the links keep their start lengths
+        float lowerDirection = atan2Approx(lowerV, lowerU);
+        float handNow = handDirection + atan2Approx(upperV, upperU) - upperDirection;
+        trunkReach = (lowerLength * std::cos(lowerDirection) + handLength * std::cos(handNow) - startReach) * 100.0f;
+
+        float spineConfidence = std::min(jointTrackingWeight(joints[JointType_SpineBase]),
+            std::min(jointTrackingWeight(joints[JointType_SpineMid]), jointTrackingWeight(joints[JointType_SpineShoulder])));
+        float handConfidence = 0.5f * (jointTrackingWeight(joints[JointType_HandLeft]) + jointTrackingWeight(joints[JointType_HandRight]));
+        float wTrunk = trunkWeight * spineConfidence;
+        if (handConfidence + wTrunk > 0.0f) {
+            fusedReach = (handConfidence * handReach + wTrunk * trunkReach) / (handConfidence + wTrunk);
+            maxFusedReach = std::max(maxFusedReach, fusedReach);
+        }
+
+        trunkFlexion = angles.angle[Angle_TrunkFlexion];
+        if (angles.confidence[Angle_TrunkFlexion] >= minConfidence) maxTrunkFlexion = std::max(maxTrunkFlexion, trunkFlexion);
+        hipFlexion = 0.5f * (angles.angle[Angle_HipFlexionLeft] + angles.angle[Angle_HipFlexionRight]);
+        if (std::min(angles.confidence[Angle_HipFlexionLeft], angles.confidence[Angle_HipFlexionRight]) >= minConfidence) {
+            maxHipFlexion = std::max(maxHipFlexion, hipFlexion);
+        }
+    }
+
+private:
+    float forward = 1.0f;               //sign of X towards the hands
+    float lowerLength = 0.0f, handLength = 0.0f;
+    float handDirection = 0.0f;         //SpineMid to hands at the start, radians from forward
+    float upperDirection = 0.0f;        //SpineMid to SpineShoulder at the start
+    float startReach = 0.0f;            //forward distance of the hands from SpineBase at the start (m)
+
+    static CameraSpacePoint handsMidpoint(const Joint* joints) {
+        const CameraSpacePoint& left = joints[JointType_HandLeft].Position;
+        const CameraSpacePoint& right = joints[JointType_HandRight].Position;
+        CameraSpacePoint mid;
+        mid.X = 0.5f * (left.X + right.X);
+        mid.Y = 0.5f * (left.Y + right.Y);
+        mid.Z = 0.5f * (left.Z + right.Z);
+        return mid;
+    }
+
+    //from a to b in the sagittal plane: u forward, v up
+    void sagittal(const CameraSpacePoint& a, const CameraSpacePoint& b, float& u, float& v) const {
+        u = forward * (b.X - a.X);
+        v = b.Y - a.Y;
+    }
+};
@@ -0,0 +1,231 @@
+//Per-frame scratch memory and heap-free text formatting
+//temporaries of one frame (joint point lists, overlay texts) come from a bump-pointer arena that is reset at the
+//end of the frame, and overlay texts are formatted into a fixed buffer, so after the first frames the frame loop
+//does not touch the heap.
+//
+//  ArenaVector<cv::Point> jointPoints(frameArena());       //released all at once by frameArena().reset()
+//  FrameText text;
+//  text << "Hand Distance: " << MaximumRightHandDistance * 100.0f << " cm";   //same digits as std::to_string
+//  overlayText(overlay, text.c_str(), ...);
+//  ...
+//  frameArena().reset();                                   //last statement of the frame loop
+//  FrameRing<float, 20> handYHistory;                      //the last 20 values, kept across frames without the heap
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)) && __has_include(<charconv>)
+#include <charconv>
+#endif
+//floating point std::to_chars, otherwise snprintf into the same buffer
+#if defined(__cpp_lib_to_chars)
+#define FRAME_TEXT_CHARCONV 1
+#endif
+
+class FrameArena {
+public:
+    //the block grows at reset() when a frame needed more, until one block holds a whole frame
+    explicit FrameArena(size_t initialBytes = 64 * 1024) : blockSize(initialBytes) {}
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    uint64_t heapAllocations = 0;   //blocks taken from the heap, stops growing after warm-up
+    size_t highWater = 0;           //most bytes used by one frame
+
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+        size_t offset = (used + alignment - 1) & ~(alignment - 1);
+        if (!block || offset + bytes > capacity) return allocateOverflow(bytes, alignment);
+        used = offset + bytes;
+        return block.get() + offset;
+    }
+
+    //releases everything allocated since the last reset
+    void reset() {
+        highWater = std::max(highWater, used + overflowBytes);
+        if (overflowBytes > 0) {
+            //the frame did not fit, the next block holds it with room to spare
+            blockSize = std::max(blockSize, (used + overflowBytes) * 2);
+            block.reset();
+            overflow.clear();
+            overflowBytes = 0;
+        }
+        used = 0;
+    }
+
+    size_t bytesUsed() const { return used + overflowBytes; }
+
+private:
+    std::unique_ptr<char[]> block;
+    size_t blockSize;
+    size_t capacity = 0;
+    size_t used = 0;
+    std::vector<std::unique_ptr<char[]>> overflow;   //allocations that did not fit the block, freed at reset
+    size_t overflowBytes = 0;
+
+    void* allocateOverflow(size_t bytes, size_t alignment) {
+        if (!block && bytes + alignment <= blockSize) {
+            block.reset(new char[blockSize]);
+            capacity = blockSize;
+            ++heapAllocations;
+            return allocate(bytes, alignment);
+        }
+        overflow.emplace_back(new char[bytes + alignment]);
+        ++heapAllocations;
+        overflowBytes += bytes + alignment;
+        uintptr_t address = reinterpret_cast<uintptr_t>(overflow.back().get());
+        return reinterpret_cast<void*>((address + alignment - 1) & ~(uintptr_t(alignment) - 1));
+    }
+};
+
+//arena of the calling thread, the test logic resets it once per frame
+inline FrameArena& frameArena() {
+    static thread_local FrameArena arena;
+    return arena;
+}
+
+//standard allocator on a FrameArena, deallocate does nothing, the memory is released by reset()
+template<class T>
+struct ArenaAllocator {
+    typedef T value_type;
+    FrameArena* arena;
+
+    ArenaAllocator(FrameArena& frameArena) noexcept : arena(&frameArena) {}
+    template<class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.arena) {}
+
+    T* allocate(size_t count) { return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) noexcept {}
+};
+
+template<class T, class U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena == b.arena; }
+template<class T, class U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena != b.arena; }
+
+//must not outlive the frame it was created in
+template<class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+//the last N values of a history that lives across frames (stability windows, smoothing), in place of a std::deque
+//that allocates and frees blocks as it slides; push drops the oldest value once N are held, ring[0] is the oldest
+template<class T, size_t N>
+class FrameRing {
+public:
+    void push(const T& value) {
+        values[(first + count) % N] = value;
+        if (count < N) ++count;
+        else first = (first + 1) % N;
+    }
+
+    void clear() { first = count = 0; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool full() const { return count == N; }
+    static constexpr size_t capacity() { return N; }
+
+    const T& operator[](size_t i) const { return values[(first + i) % N]; }
+
+private:
+    T values[N] = {};
+    size_t first = 0;
+    size_t count = 0;
+};
+
+#if __has_include(<opencv2/opencv.hpp>)
+#include <opencv2/opencv.hpp>
+
+//OpenCV only takes std::vector with the default allocator as InputArray, this wraps the points without a copy
+inline cv::Mat pointsView(ArenaVector<cv::Point>& points) {
+    return cv::Mat(static_cast<int>(points.size()), 1, CV_32SC2, points.data());
+}
+#endif
+
+//number with a given count of decimals, text << decimals(depth, 2) prints like std::setprecision(2) with std::fixed
+struct TextDecimals {
+    double value;
+    int precision;
+};
+inline TextDecimals decimals(double value, int precision) { return TextDecimals{ value, precision }; }
+
+//leading characters of std::to_string(value), text << leadingDigits(depth, 4) prints std::to_string(depth).substr(0, 4)
+struct TextLeading {
+    double value;
+    size_t characters;
+};
+inline TextLeading leadingDigits(double value, size_t characters) { return TextLeading{ value, characters }; }
+
+//overlay text in a fixed buffer, numbers are formatted like std::to_string, longer text is cut at capacity
+class FrameText {
+public:
+    static const size_t capacity = 127;
+
+    FrameText() { buffer[0] = '\0'; }
+
+    void clear() {
+        length = 0;
+        buffer[0] = '\0';
+    }
+    const char* c_str() const { return buffer; }
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+
+    FrameText& operator<<(const char* text) { return append(text, std::strlen(text)); }
+    FrameText& operator<<(const std::string& text) { return append(text.data(), text.size()); }
+    FrameText& operator<<(char c) { return append(&c, 1); }
+    FrameText& operator<<(int value) { return appendInteger(value); }
+    FrameText& operator<<(long long value) { return appendInteger(value); }
+    FrameText& operator<<(unsigned long long value) { return appendInteger(value); }
+    FrameText& operator<<(double value) { return appendFixed(value, 6); }
+    FrameText& operator<<(TextDecimals number) { return appendFixed(number.value, number.precision); }
+    FrameText& operator<<(TextLeading number) {
+        size_t start = length;
+        appendFixed(number.value, 6);
+        length = std::min(length, start + number.characters);
+        buffer[length] = '\0';
+        return *this;
+    }
+
+private:
+    char buffer[capacity + 1];
+    size_t length = 0;
+
+    FrameText& append(const char* text, size_t count) {
+        count = std::min(count, size_t(capacity) - length);
+        std::memcpy(buffer + length, text, count);
+        length += count;
+        buffer[length] = '\0';
+        return *this;
+    }
+
+    template<class Integer>
+    FrameText& appendInteger(Integer value) {
+#ifdef FRAME_TEXT_CHARCONV
+        std::to_chars_result result = std::to_chars(buffer + length, buffer + capacity, value);
+        if (result.ec == std::errc()) length = result.ptr - buffer;
+#else
+        int written = value < 0 ? std::snprintf(buffer + length, capacity + 1 - length, "%lld", static_cast<long long>(value))
+            : std::snprintf(buffer + length, capacity + 1 - length, "%llu", static_cast<unsigned long long>(value));
+        if (written > 0) length = std::min(size_t(capacity), length + written);
+#endif
+        buffer[length] = '\0';
+        return *this;
+    }
+
+    FrameText& appendFixed(double value, int precision) {
+#ifdef FRAME_TEXT_CHARCONV
+        std::to_chars_result result = std::to_chars(buffer + length, buffer + capacity, value, std::chars_format::fixed, precision);
+        if (result.ec == std::errc()) length = result.ptr - buffer;
+#else
+        int written = std::snprintf(buffer + length, capacity + 1 - length, "%.*f", precision, value);
+        if (written > 0) length = std::min(size_t(capacity), length + written);
+#endif
+        buffer[length] = '\0';
+        return *this;
+    }
+};
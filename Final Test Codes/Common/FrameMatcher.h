@@ -0,0 +1,99 @@
+//Timestamp matching of the color, depth and body streams, without the sensor and without OpenCV
+//FrameMatcher pairs every body frame with the newest color and depth frames by sensor timestamp. FrameSynchronizer is
+//the acquisition pass of SynchronizedFrameReader (FrameSync.h): each stream is acquired on its own, color and depth
+//before body, so a late or failed color frame never skips the body frame. It runs over any set of streams, the Kinect
+//readers or a replay source:
+//
+//  struct Streams {
+//      bool hasColor() const; bool hasDepth() const; bool hasBody() const;     //the streams that are open
+//      bool acquireColor(TIMESPAN& time);                                      //copies the newest frame of the stream
+//      bool acquireDepth(TIMESPAN& time);                                      //and its time, false without a new one
+//      bool acquireBody(TIMESPAN& time);
+//  };
+//  FrameSynchronizer sync;
+//  sync.synchronize(streams);      //then sync.hasNewBody, sync.bodyTime, sync.match...
+#pragma once
+#include "SkeletonTypes.h"
+#include <cstdint>
+#include <cstdlib>
+
+//how a body frame relates to the newest color and depth frames
+struct FrameMatch {
+    bool colorMatched = false;      //a color frame within matchTolerance of the body frame
+    bool depthMatched = false;
+    TIMESPAN colorOffset = 0;       //body time - color time, 100 ns ticks
+    TIMESPAN depthOffset = 0;
+};
+
+//timestamp bookkeeping of the reader, kept apart from the sensor so sessions can be replayed
+class FrameMatcher {
+public:
+    TIMESPAN matchTolerance = 333333;     //one frame at 30 fps
+
+    uint64_t bodyFrames = 0;
+    uint64_t bodyFramesWithoutColor = 0;  //body frames the old loop (body only after a good color frame) would have lost or paired with an old image
+    uint64_t colorFrames = 0;
+    uint64_t depthFrames = 0;
+
+    void colorArrived(TIMESPAN time) {
+        colorTime = time;
+        hasColor = true;
+        ++colorFrames;
+    }
+
+    void depthArrived(TIMESPAN time) {
+        depthTime = time;
+        hasDepth = true;
+        ++depthFrames;
+    }
+
+    FrameMatch bodyArrived(TIMESPAN time) {
+        FrameMatch match;
+        match.colorOffset = hasColor ? time - colorTime : 0;
+        match.depthOffset = hasDepth ? time - depthTime : 0;
+        match.colorMatched = hasColor && std::llabs(match.colorOffset) <= matchTolerance;
+        match.depthMatched = hasDepth && std::llabs(match.depthOffset) <= matchTolerance;
+        ++bodyFrames;
+        if (!match.colorMatched) ++bodyFramesWithoutColor;
+        return match;
+    }
+
+private:
+    TIMESPAN colorTime = 0, depthTime = 0;
+    bool hasColor = false, hasDepth = false;
+};
+
+//the state of the streams after the latest acquisition pass
+class FrameSynchronizer {
+public:
+    bool hasNewColor = false;               //set by synchronize() for the streams that delivered a frame
+    bool hasNewDepth = false;
+    bool hasNewBody = false;
+    TIMESPAN colorTime = 0, depthTime = 0, bodyTime = 0;   //of the newest frame of each stream, kept without a new one
+    FrameMatch match;                       //of the latest body frame
+    FrameMatcher matcher;
+
+    //acquires the latest frame of every open stream, a stream without a new frame keeps its previous data
+    template<class Streams>
+    void synchronize(Streams& streams) {
+        hasNewColor = hasNewDepth = hasNewBody = false;
+
+        //color and depth first, so the body frame is matched against frames of this pass
+        TIMESPAN time = 0;
+        if (streams.hasColor() && streams.acquireColor(time)) {
+            colorTime = time;
+            matcher.colorArrived(colorTime);
+            hasNewColor = true;
+        }
+        if (streams.hasDepth() && streams.acquireDepth(time)) {
+            depthTime = time;
+            matcher.depthArrived(depthTime);
+            hasNewDepth = true;
+        }
+        if (streams.hasBody() && streams.acquireBody(time)) {
+            bodyTime = time;
+            match = matcher.bodyArrived(bodyTime);
+            hasNewBody = true;
+        }
+    }
+};
@@ -0,0 +1,224 @@
+//Pipeline-parallel frame processing
+//the frame loop of the tests is split into stages on their own threads:
+//  acquisition   SynchronizedFrameReader, waits on the sensor events         (acquisition thread)
+//  test logic    joints, thresholds, timers, logging, records an OverlayList (the thread calling nextBodyFrame, main)
+//  display       newest overlay drawn on the newest color frame, imshow and waitKey (display thread)
+//body frames go to the test logic through a bounded lock-free queue with backpressure, so every body frame is
+//evaluated in sensor order at the full 30 Hz. Color frames and overlays are not critical, they go through
+//latest-value mailboxes that drop the oldest unread frame, and the display runs at whatever rate it sustains.
+//The window shows the frame at 1/displayDivisor of its size (DISPLAY_DIVISOR, 2 by default: 960x540), made in one
+//pass over the BGRA buffer the sensor frame was copied into (ColorConvert.h), and the overlay is drawn on that image
+//with its color frame coordinates scaled to match. With displayDivisor 1 the overlay is drawn straight onto the BGRA
+//buffer and that buffer is shown, there is no BGR copy of the frame.
+//With colorIngest = ColorIngest_Yuy2 (or COLOR_INGEST_YUY2 defined) the raw YUY2 frame is copied instead and the
+//display converts it straight to the downscaled BGR image.
+//With FrameSourceTypes_Depth the depth frames go to depthConsumer on the acquisition thread, it must return quickly
+//(FloorPlane.h only copies a frame now and then for its own thread, WS copies every frame into a DepthFrame queue).
+//
+//  FramePipeline pipeline;
+//  pipeline.start(sensor, FrameSourceTypes_Color | FrameSourceTypes_Body, "Time Up and Go Test");
+//  BodyFrame bodyFrame;
+//  OverlayList overlay;
+//  while (pipeline.isRunning()) {                   //false once Enter is pressed in the window
+//      overlay.clear();
+//      int key = pipeline.takeKey();                 //other keys pressed in the window, -1 when none
+//      if (pipeline.nextBodyFrame(bodyFrame)) { ...bodyFrame.bodies..., overlayText(overlay, ...) }
+//      pipeline.publishOverlay(overlay);
+//  }
+//  pipeline.stop();
+#pragma once
+#include "SkeletonTypes.h"
+#include "FrameProfiler.h"
+#include "FrameSync.h"
+#include "FrameQueues.h"
+#include "OverlayRenderer.h"
+#include "ColorConvert.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+struct ColorFrame {
+    cv::Mat image;
+    TIMESPAN relativeTime = 0;
+};
+
+#ifdef _WIN32
+
+class FramePipeline {
+public:
+    int colorWidth = 1920;
+    int colorHeight = 1080;
+    //set before start()
+#ifdef COLOR_INGEST_YUY2
+    ColorIngest colorIngest = ColorIngest_Yuy2;
+#else
+    ColorIngest colorIngest = ColorIngest_Bgra;
+#endif
+    int displayDivisor = DISPLAY_DIVISOR;    //window size 1/1 (1920x1080), 1/2 (960x540) or 1/3 (640x360) of the frame
+    std::function<void(const UINT16*, TIMESPAN)> depthConsumer;     //every 512x424 depth frame (mm), acquisition thread
+
+    ~FramePipeline() { stop(); }
+
+    bool start(IKinectSensor* sensor, DWORD frameSourceTypes, const std::string& window) {
+        frameReader.colorIngest = colorIngest;
+        if (!frameReader.open(sensor, frameSourceTypes)) return false;
+        windowName = window;
+        if (!frameReader.colorImage.empty()) {
+            colorWidth = frameReader.colorImage.cols;
+            colorHeight = frameReader.colorImage.rows;
+            //the reader copies straight into the mailbox slots, no extra copy of the 8 MB frame
+            for (int s = 0; s < 3; ++s) {
+                colorMailbox.slot(s).image = frameReader.colorImage.clone();
+            }
+        }
+
+        started = true;
+        running = true;
+        acquisitionThread = std::thread(&FramePipeline::acquisitionStage, this);
+        displayThread = std::thread(&FramePipeline::displayStage, this);
+        return true;
+    }
+
+    //false once Enter was pressed in the window or stop() was called
+    bool isRunning() const { return running.load(std::memory_order_acquire); }
+
+    //test logic stage: the next body frame in sensor order, false when none arrived within timeoutMs
+    bool nextBodyFrame(BodyFrame& frame, int timeoutMs = 100) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (!bodyQueue.tryPop(frame)) {
+            if (!isRunning() || std::chrono::steady_clock::now() >= deadline) return false;
+            bodySignal.wait(bodySeen, 5);
+        }
+        bodyQueueSpace.notify();
+        return true;
+    }
+
+    //test logic stage: the last key pressed in the window since the previous call (Enter excepted), -1 when none
+    int takeKey() { return pressedKey.exchange(-1, std::memory_order_acq_rel); }
+
+    //test logic stage: hands the overlay of the evaluated frame to the display, the list is swapped, not copied
+    void publishOverlay(OverlayList& overlay) {
+        std::swap(overlayMailbox.writeSlot(), overlay);
+        overlayMailbox.publish();
+        displaySignal.notify();
+    }
+
+    void stop() {
+        running = false;
+        bodyQueueSpace.notify();
+        displaySignal.notify();
+        if (acquisitionThread.joinable()) acquisitionThread.join();
+        if (displayThread.joinable()) displayThread.join();
+
+        if (!started) return;
+        started = false;
+        frameReader.close();
+        std::cout << "Pipeline: body frames waited on the test logic " << bodyQueueWaits
+            << " times, color frames not displayed " << colorMailbox.dropped
+            << ", overlays not displayed " << overlayMailbox.dropped << std::endl;
+    }
+
+private:
+    SynchronizedFrameReader frameReader;
+    std::string windowName;
+    std::atomic<bool> running{ false };
+    std::atomic<int> pressedKey{ -1 };           //display -> test logic
+    bool started = false;
+
+    SpscQueue<BodyFrame> bodyQueue{ 16 };        //body frames acquisition may run ahead of the test logic
+    LatestValue<ColorFrame> colorMailbox;        //acquisition -> display, BGRA or YUY2 as copied from the sensor
+    LatestValue<OverlayList> overlayMailbox;     //test logic -> display
+
+    StageSignal bodySignal, bodyQueueSpace, displaySignal;
+    uint64_t bodySeen = 0;                       //test logic thread
+    uint64_t bodyQueueWaits = 0;                 //acquisition thread
+
+    std::thread acquisitionThread, displayThread;
+
+    void acquisitionStage() {
+        uint64_t spaceSeen = 0;
+        BodyFrame frame;
+        while (isRunning()) {
+            frameReader.waitForFrames(50);
+            if (!frameReader.colorImage.empty()) frameReader.colorImage = colorMailbox.writeSlot().image;
+            frameReader.update();
+
+            if (frameReader.hasNewColor) {
+                colorMailbox.writeSlot().relativeTime = frameReader.colorTime;
+                colorMailbox.publish();
+                displaySignal.notify();
+            }
+
+            if (frameReader.hasNewDepth && depthConsumer) {
+                depthConsumer(frameReader.depthData.data(), frameReader.depthTime);
+            }
+
+            if (frameReader.hasNewBody) {
+                frame.relativeTime = frameReader.bodyTime;
+                frame.match = frameReader.match;
+                for (int i = 0; i < BODY_COUNT; ++i) snapshotBody(frameReader.bodies[i], frame.bodies[i]);
+
+                //the test logic must see every body frame, so a full queue makes acquisition wait (backpressure)
+                while (!bodyQueue.tryPush(frame) && isRunning()) {
+                    ++bodyQueueWaits;
+                    bodyQueueSpace.wait(spaceSeen, 5);
+                }
+                bodySignal.notify();
+            }
+            PROFILE_FRAME_END();
+        }
+    }
+
+    //HighGUI windows belong to the thread that creates them, so window, imshow and waitKey all live here
+    //the overlay is drawn into the shown image (the downscaled copy, or the BGRA buffer itself), so a frame is shown
+    //once, when it arrives; an overlay published in between appears on the next color frame, at most one frame period later
+    void displayStage() {
+        cv::namedWindow(windowName, cv::WINDOW_AUTOSIZE);
+        cv::Mat displayImage;                       //downscaled BGR, unless displayDivisor is 1 with BGRA
+        uint64_t seen = 0;
+        while (isRunning()) {
+            overlayMailbox.take();                  //the read slot keeps the newest overlay
+            bool newColor = colorMailbox.take();
+
+            if (newColor) {
+                //this slot is the display's until the next take, acquisition fills the other two meanwhile
+                cv::Mat* image = &colorMailbox.readSlot().image;
+                if (image->type() == CV_8UC2 || displayDivisor > 1) {
+                    PROFILE_STAGE_BEGIN(Stage_ConvertColor);
+                    if (image->type() == CV_8UC2) convertYuy2ToBgrScaled(*image, displayDivisor, displayImage);
+                    else convertBgraToBgrScaled(*image, displayDivisor, displayImage);
+                    PROFILE_STAGE_END(Stage_ConvertColor);
+                    image = &displayImage;
+                }
+                overlayMailbox.readSlot().draw(*image, 1.0 / std::max(displayDivisor, 1));
+                PROFILE_STAGE_BEGIN(Stage_Display);
+                cv::imshow(windowName, *image);
+                PROFILE_STAGE_END(Stage_Display);
+            }
+
+            PROFILE_STAGE_BEGIN(Stage_WaitKey);
+            int key = cv::waitKey(1);
+            PROFILE_STAGE_END(Stage_WaitKey);
+            PROFILE_FRAME_END();
+            if (key == 13) {
+                running = false;
+                break;
+            }
+            if (key >= 0) pressedKey.store(key, std::memory_order_release);
+            if (!newColor) displaySignal.wait(seen, 15);
+        }
+        cv::destroyWindow(windowName);
+    }
+};
+
+#endif
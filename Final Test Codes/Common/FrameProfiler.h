@@ -0,0 +1,335 @@
+//Per-stage latency instrumentation for the frame loop
+//define FRAME_PROFILING (Project Properties > C/C++ > Preprocessor) to enable it, otherwise every macro below is empty
+//and profiledPutText is a plain cv::putText call
+//
+//usage:
+//  PROFILE_SESSION("Time_Up_and_Go_Test");        once at startup, the summary is written when the program exits
+//  PROFILE_STAGE_BEGIN(Stage_AcquireColor);
+//  HRESULT hrColor = colorFrameReader->AcquireLatestFrame(&colorFrame);
+//  PROFILE_STAGE_END(Stage_AcquireColor);        optional, the stage also ends when the scope closes
+//  PROFILE_BODY_FRAME(bodyFrame);                 body frame age and dropped frames from the sensor timestamp
+//  PROFILE_FRAME_END();                           once at the end of every loop iteration
+//
+//stages can nest, each stage is reported with the time of its nested stages subtracted
+//
+//define FRAME_PROFILE_ALLOCATIONS as well (in the test's one .cpp, it replaces the global operator new) to count the heap
+//allocations of every frame loop; the summary reports the frames that still allocated after the first profileWarmupFrames
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <string>
+
+#ifdef FRAME_PROFILING
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#endif
+#ifdef FRAME_PROFILE_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+#endif
+
+enum FrameStage {
+    Stage_AcquireColor = 0,     //colorFrameReader->AcquireLatestFrame
+    Stage_CopyColor,            //CopyConvertedFrameDataToArray
+    Stage_ConvertColor,         //cvtColor BGRA to BGR
+    Stage_AcquireDepth,         //depthFrameReader->AcquireLatestFrame and copy
+    Stage_AcquireBody,          //bodyFrameReader->AcquireLatestFrame
+    Stage_BodyData,             //GetAndRefreshBodyData
+    Stage_Mapping,              //joint to color space mapping loops
+    Stage_TestLogic,            //threshold logic of the test
+    Stage_Overlay,              //putText / rectangle overlays
+    Stage_Display,              //imshow
+    Stage_WaitKey,              //waitKey(30)
+    Stage_Frame,                //whole loop iteration
+    Stage_Count
+};
+
+inline const char* frameStageName(FrameStage stage) {
+    static const char* names[Stage_Count] = {
+        "AcquireColor", "CopyColor", "ConvertColor", "AcquireDepth", "AcquireBody", "BodyData",
+        "Mapping", "TestLogic", "Overlay", "Display", "WaitKey", "Frame"
+    };
+    return names[stage];
+}
+
+#ifdef FRAME_PROFILING
+
+//frames of each loop before its buffers, rings and arenas have their final size
+const uint64_t profileWarmupFrames = 90;
+
+//heap allocations made by the calling thread, counted by the operator new of FRAME_PROFILE_ALLOCATIONS
+inline uint64_t& threadHeapAllocations() {
+    static thread_local uint64_t count = 0;
+    return count;
+}
+
+//log-linear histogram of microseconds, 16 sub-buckets per power of two (under 7% error)
+//written only by its owning thread, read by the exporter with relaxed loads
+struct LatencyHistogram {
+    static const int subBuckets = 16;
+    static const int bucketCount = 40 * subBuckets;
+    std::atomic<uint32_t> counts[bucketCount];
+
+    LatencyHistogram() {
+        for (auto& c : counts) c.store(0, std::memory_order_relaxed);
+    }
+
+    static int bucketOf(uint64_t micros) {
+        if (micros < subBuckets) return static_cast<int>(micros);
+        int msb = 63;
+        while (!(micros >> msb)) --msb;
+        int shift = msb - 4;
+        int index = (msb - 3) * subBuckets + static_cast<int>((micros >> shift) & (subBuckets - 1));
+        return index < bucketCount ? index : bucketCount - 1;
+    }
+
+    //midpoint of the bucket in microseconds
+    static double valueOf(int bucket) {
+        if (bucket < subBuckets) return bucket;
+        int msb = bucket / subBuckets + 3;
+        int shift = msb - 4;
+        double low = static_cast<double>((static_cast<uint64_t>(subBuckets + bucket % subBuckets)) << shift);
+        return low + (static_cast<double>(1ULL << shift) / 2.0);
+    }
+
+    //single writer, so a relaxed load and store is enough and avoids a locked increment
+    void record(uint64_t micros) {
+        std::atomic<uint32_t>& c = counts[bucketOf(micros)];
+        c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+};
+
+//everything one thread records, owned by the profiler so it outlives the thread
+struct FrameProfileThreadData {
+    LatencyHistogram stages[Stage_Count];
+    LatencyHistogram bodyFrameAge;
+    uint64_t pendingMicros[Stage_Count] = { 0 };   //exclusive time of each stage in the current frame
+    bool pendingUsed[Stage_Count] = { false };
+    std::atomic<uint64_t> bodyFrames{ 0 };
+    std::atomic<uint64_t> droppedBodyFrames{ 0 };
+    int64_t lastBodyTime = 0;
+    int64_t minClockOffset = INT64_MAX;            //smallest (steady clock - sensor time) seen, in 100 ns ticks
+    uint64_t frames = 0;
+    uint64_t allocationsSeen = 0;                  //threadHeapAllocations() at the end of the previous frame
+    std::atomic<uint64_t> allocatingFrames{ 0 };   //frames after the warm-up that allocated
+    std::atomic<uint64_t> lateAllocations{ 0 };    //their allocations
+    std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+    struct FrameStageTimer* current = nullptr;    //innermost running stage
+};
+
+class FrameProfiler {
+public:
+    ~FrameProfiler() {
+        if (!sessionName.empty()) exportSummary();
+    }
+
+    void setSession(const std::string& name) { sessionName = name; }
+
+    FrameProfileThreadData& threadData() {
+        thread_local FrameProfileThreadData* data = nullptr;
+        if (!data) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            threads.push_back(std::make_unique<FrameProfileThreadData>());
+            data = threads.back().get();
+        }
+        return *data;
+    }
+
+    //commits the stages of the finished frame into the histograms
+    void frameEnd() {
+        FrameProfileThreadData& data = threadData();
+        auto now = std::chrono::steady_clock::now();
+        data.stages[Stage_Frame].record(std::chrono::duration_cast<std::chrono::microseconds>(now - data.frameStart).count());
+        data.frameStart = now;
+        uint64_t allocations = threadHeapAllocations() - data.allocationsSeen;
+        data.allocationsSeen += allocations;
+        if (++data.frames > profileWarmupFrames && allocations > 0) {
+            data.allocatingFrames.store(data.allocatingFrames.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            data.lateAllocations.store(data.lateAllocations.load(std::memory_order_relaxed) + allocations, std::memory_order_relaxed);
+        }
+        for (int s = 0; s < Stage_Count; ++s) {
+            if (!data.pendingUsed[s]) continue;
+            data.stages[s].record(data.pendingMicros[s]);
+            data.pendingMicros[s] = 0;
+            data.pendingUsed[s] = false;
+        }
+    }
+
+    //relativeTime is the sensor timestamp of the body frame in 100 ns ticks (live or replayed)
+    void recordBodyFrame(int64_t relativeTime) {
+        const int64_t frameTicks = 333333;   //30 fps
+        FrameProfileThreadData& data = threadData();
+        int64_t nowTicks = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count() / 100;
+
+        //the sensor clock has no known epoch, the freshest frame seen so far is taken as zero age
+        int64_t offset = nowTicks - relativeTime;
+        if (offset < data.minClockOffset) data.minClockOffset = offset;
+        data.bodyFrameAge.record(static_cast<uint64_t>((offset - data.minClockOffset) / 10));
+
+        if (data.lastBodyTime != 0 && relativeTime > data.lastBodyTime) {
+            int64_t missed = (relativeTime - data.lastBodyTime + frameTicks / 2) / frameTicks - 1;
+            if (missed > 0) data.droppedBodyFrames.fetch_add(missed, std::memory_order_relaxed);
+        }
+        data.lastBodyTime = relativeTime;
+        data.bodyFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //prints p50/p95/p99 per stage and writes <session>_Frame_Profile.csv
+    void exportSummary() {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        std::string filename = sessionName + "_Frame_Profile.csv";
+        std::ofstream outfile(filename, std::ios::trunc);
+        outfile << "Stage,Count,p50 (us),p95 (us),p99 (us)\n";
+        std::cout << "Frame profile (" << sessionName << ")" << std::endl;
+
+        for (int s = 0; s <= Stage_Count; ++s) {
+            uint64_t merged[LatencyHistogram::bucketCount] = { 0 };
+            uint64_t total = 0;
+            for (auto& t : threads) {
+                const LatencyHistogram& h = s < Stage_Count ? t->stages[s] : t->bodyFrameAge;
+                for (int b = 0; b < LatencyHistogram::bucketCount; ++b) {
+                    uint64_t c = h.counts[b].load(std::memory_order_relaxed);
+                    merged[b] += c;
+                    total += c;
+                }
+            }
+            if (total == 0) continue;
+
+            const char* name = s < Stage_Count ? frameStageName(static_cast<FrameStage>(s)) : "BodyFrameAge";
+            double p50 = percentile(merged, total, 0.50);
+            double p95 = percentile(merged, total, 0.95);
+            double p99 = percentile(merged, total, 0.99);
+            outfile << name << "," << total << "," << p50 << "," << p95 << "," << p99 << "\n";
+            std::cout << std::left << std::setw(14) << name << " n=" << std::setw(8) << total
+                << " p50=" << p50 << "us p95=" << p95 << "us p99=" << p99 << "us" << std::endl;
+        }
+
+        uint64_t bodyFrames = 0, dropped = 0;
+        for (auto& t : threads) {
+            bodyFrames += t->bodyFrames.load(std::memory_order_relaxed);
+            dropped += t->droppedBodyFrames.load(std::memory_order_relaxed);
+        }
+        outfile << "BodyFrames," << bodyFrames << ",,,\n";
+        outfile << "DroppedBodyFrames," << dropped << ",,,\n";
+        std::cout << "Body frames: " << bodyFrames << ", dropped: " << dropped << std::endl;
+
+#ifdef FRAME_PROFILE_ALLOCATIONS
+        //one row per frame loop (test logic, acquisition, display), in the order the threads first profiled a stage
+        for (size_t t = 0; t < threads.size(); ++t) {
+            uint64_t frames = threads[t]->frames;
+            uint64_t allocating = threads[t]->allocatingFrames.load(std::memory_order_relaxed);
+            uint64_t allocations = threads[t]->lateAllocations.load(std::memory_order_relaxed);
+            if (frames == 0) continue;
+            outfile << "AllocatingFrames" << t << "," << frames << "," << allocating << "," << allocations << ",\n";
+            std::cout << "Loop " << t << ": " << frames << " frames, " << allocating << " allocated after the first "
+                << profileWarmupFrames << " (" << allocations << " allocations)" << std::endl;
+        }
+#endif
+    }
+
+private:
+    std::string sessionName;
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<FrameProfileThreadData>> threads;
+
+    static double percentile(const uint64_t* counts, uint64_t total, double p) {
+        uint64_t target = static_cast<uint64_t>(p * (total - 1)) + 1;
+        uint64_t seen = 0;
+        for (int b = 0; b < LatencyHistogram::bucketCount; ++b) {
+            seen += counts[b];
+            if (seen >= target) return LatencyHistogram::valueOf(b);
+        }
+        return LatencyHistogram::valueOf(LatencyHistogram::bucketCount - 1);
+    }
+};
+
+inline FrameProfiler& frameProfiler() {
+    static FrameProfiler profiler;
+    return profiler;
+}
+
+//times one stage until stop() or the end of the scope
+struct FrameStageTimer {
+    FrameStage stage;
+    FrameProfileThreadData& data;
+    FrameStageTimer* parent;
+    std::chrono::steady_clock::time_point start;
+    uint64_t childMicros = 0;
+    bool running = true;
+
+    explicit FrameStageTimer(FrameStage s)
+        : stage(s), data(frameProfiler().threadData()), parent(data.current), start(std::chrono::steady_clock::now()) {
+        data.current = this;
+    }
+
+    void stop() {
+        if (!running) return;
+        running = false;
+        uint64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        data.pendingMicros[stage] += elapsed > childMicros ? elapsed - childMicros : 0;
+        data.pendingUsed[stage] = true;
+        if (parent) parent->childMicros += elapsed;
+        data.current = parent;
+    }
+
+    ~FrameStageTimer() { stop(); }
+};
+
+#define PROFILE_SESSION(name) frameProfiler().setSession(name)
+#define PROFILE_STAGE_BEGIN(stage) FrameStageTimer profileTimer_##stage(stage)
+#define PROFILE_STAGE_END(stage) profileTimer_##stage.stop()
+#define PROFILE_FRAME_END() frameProfiler().frameEnd()
+#define PROFILE_BODY_FRAME(frame) \
+    do { TIMESPAN profileBodyTime = 0; (frame)->get_RelativeTime(&profileBodyTime); frameProfiler().recordBodyFrame(profileBodyTime); } while (0)
+
+#else
+
+#define PROFILE_SESSION(name) ((void)0)
+#define PROFILE_STAGE_BEGIN(stage) ((void)0)
+#define PROFILE_STAGE_END(stage) ((void)0)
+#define PROFILE_FRAME_END() ((void)0)
+#define PROFILE_BODY_FRAME(frame) ((void)0)
+
+#endif
+
+#ifdef FRAME_PROFILE_ALLOCATIONS
+//every operator new of the test counts on the allocating thread; all forms allocate with malloc and release with free,
+//so any new pairs with any delete
+inline void* countedHeapAllocate(size_t size) noexcept {
+#ifdef FRAME_PROFILING
+    ++threadHeapAllocations();
+#endif
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new(size_t size) {
+    if (void* p = countedHeapAllocate(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) {
+    if (void* p = countedHeapAllocate(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedHeapAllocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedHeapAllocate(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+#endif
+
+//cv::putText timed as Stage_Overlay when profiling is enabled
+inline void profiledPutText(cv::Mat& image, const std::string& text, cv::Point org, int fontFace, double fontScale,
+    cv::Scalar color, int thickness = 1) {
+    PROFILE_STAGE_BEGIN(Stage_Overlay);
+    cv::putText(image, text, org, fontFace, fontScale, color, thickness);
+}
@@ -0,0 +1,165 @@
+//Queues, mailboxes and body snapshots between the stages of FramePipeline.h, without OpenCV or the sensor
+//SpscQueue carries every body frame from acquisition to the test logic with backpressure, LatestValue hands the newest
+//color frame or overlay to the display and drops older ones, StageSignal wakes a waiting stage. BodyFrame is the copy
+//of one body frame that leaves the acquisition thread, DepthFrame that of a depth frame. Kept apart from the pipeline so replays can run the same stages.
+#pragma once
+#include "SkeletonTypes.h"
+#include "FrameMatcher.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+//bounded single-producer/single-consumer ring, lock-free
+//a full queue is backpressure: tryPush fails and the producer decides whether to wait or drop
+template<class T>
+class SpscQueue {
+public:
+    //capacity is rounded up to a power of two
+    explicit SpscQueue(size_t capacity = 8) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    bool tryPush(const T& value) {
+        size_t tail = tailIndex.load(std::memory_order_relaxed);
+        if (tail - headIndex.load(std::memory_order_acquire) > mask) return false;
+        slots[tail & mask] = value;
+        tailIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == tailIndex.load(std::memory_order_acquire)) return false;
+        value = slots[head & mask];
+        headIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        return tailIndex.load(std::memory_order_acquire) - headIndex.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    std::vector<T> slots;
+    size_t mask = 0;
+    alignas(64) std::atomic<size_t> headIndex{ 0 };   //written by the consumer only
+    alignas(64) std::atomic<size_t> tailIndex{ 0 };   //written by the producer only
+};
+
+//single-producer/single-consumer mailbox that always holds the newest value (a queue of one with drop-oldest)
+//three slots: the producer fills its own slot and swaps it with the shared one, the consumer swaps the shared
+//slot with its own when it is newer, so neither side ever waits and slot buffers (cv::Mat) are reused
+template<class T>
+class LatestValue {
+public:
+    uint64_t published = 0;    //producer side
+    uint64_t dropped = 0;      //producer side, values replaced before the consumer took them
+
+    //slot to fill before publish()
+    T& writeSlot() { return slots[backIndex]; }
+
+    void publish() {
+        uint8_t previous = shared.exchange(static_cast<uint8_t>(backIndex | freshBit), std::memory_order_acq_rel);
+        if (previous & freshBit) ++dropped;
+        backIndex = previous & indexMask;
+        ++published;
+    }
+
+    //moves the newest value to the consumer slot, false when nothing new was published since the last take
+    bool take() {
+        if (!(shared.load(std::memory_order_relaxed) & freshBit)) return false;
+        uint8_t previous = shared.exchange(frontIndex, std::memory_order_acq_rel);
+        frontIndex = previous & indexMask;
+        return true;
+    }
+
+    //slot of the last value taken
+    T& readSlot() { return slots[frontIndex]; }
+
+    //direct access for setting up the buffers before producer and consumer start
+    T& slot(int index) { return slots[index]; }
+
+private:
+    static const uint8_t freshBit = 4;
+    static const uint8_t indexMask = 3;
+    T slots[3];
+    uint8_t backIndex = 0;                   //producer only
+    uint8_t frontIndex = 1;                  //consumer only
+    std::atomic<uint8_t> shared{ 2 };
+};
+
+//wakes a stage thread waiting for input, the data itself never passes through the lock
+class StageSignal {
+public:
+    void notify() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++sequence;
+        }
+        condition.notify_one();
+    }
+
+    //waits until notify() was called after lastSeen or timeoutMs passed
+    void wait(uint64_t& lastSeen, int timeoutMs) {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&] { return sequence != lastSeen; });
+        lastSeen = sequence;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable condition;
+    uint64_t sequence = 0;
+};
+
+//copy of one IBody, with the IBody calls the tests use, so the body data can leave the acquisition thread
+struct BodySnapshot {
+    BOOLEAN isTracked = false;
+    UINT64 trackingId = 0;
+    Joint joints[JointType_Count];
+    JointOrientation orientations[JointType_Count];
+
+    HRESULT get_IsTracked(BOOLEAN* tracked) const { *tracked = isTracked; return S_OK; }
+    HRESULT get_TrackingId(UINT64* id) const { *id = trackingId; return S_OK; }
+    HRESULT GetJoints(UINT capacity, Joint* out) const {
+        for (UINT j = 0; j < capacity && j < JointType_Count; ++j) out[j] = joints[j];
+        return S_OK;
+    }
+    HRESULT GetJointOrientations(UINT capacity, JointOrientation* out) const {
+        for (UINT j = 0; j < capacity && j < JointType_Count; ++j) out[j] = orientations[j];
+        return S_OK;
+    }
+};
+
+//copies one body of the sensor (IBody, or anything with the same calls) into a snapshot, untracked when body is null
+template<class Body>
+inline void snapshotBody(Body* body, BodySnapshot& snapshot) {
+    snapshot.isTracked = false;
+    if (!body) return;
+    body->get_IsTracked(&snapshot.isTracked);
+    if (!snapshot.isTracked) return;
+    body->get_TrackingId(&snapshot.trackingId);
+    body->GetJoints(JointType_Count, snapshot.joints);
+    body->GetJointOrientations(JointType_Count, snapshot.orientations);
+}
+
+struct BodyFrame {
+    TIMESPAN relativeTime = 0;
+    FrameMatch match;
+    BodySnapshot bodies[BODY_COUNT];
+};
+
+//copy of one depth frame (mm) that leaves the acquisition thread, for a test driven by depth frames (WS)
+//the data keeps its size once copied into, so a queue of them allocates only while its slots warm up
+struct DepthFrame {
+    TIMESPAN relativeTime = 0;
+    std::vector<UINT16> data;
+};
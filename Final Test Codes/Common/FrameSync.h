@@ -0,0 +1,210 @@
+//Synchronized reading of the color, depth and body streams
+//each stream is acquired on its own, so a late or failed 1080p color frame no longer skips the body frame of
+//that loop iteration. The body frame is paired with the newest color and depth frames by sensor timestamp. The
+//acquisition pass and the matching are FrameSynchronizer (FrameMatcher.h), replayed without the sensor.
+//
+//  SynchronizedFrameReader frameReader;
+//  frameReader.open(sensor, FrameSourceTypes_Color | FrameSourceTypes_Body);
+//  while (true) {
+//      frameReader.update();
+//      cv::Mat& colorMat = frameReader.colorImage;         //latest color frame (BGRA), black until the first one
+//      if (frameReader.hasNewBody) { ...frameReader.bodies... }
+//  }
+#pragma once
+#include "SkeletonTypes.h"
+#include "FrameMatcher.h"
+#include "FrameProfiler.h"
+#include "KinectLease.h"
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+//what the color stream is copied as: BGRA converted by the sensor runtime, or the raw YUY2 frame (half the bytes)
+//whose regions are converted on demand (ColorConvert.h)
+enum ColorIngest {
+    ColorIngest_Bgra = 0,
+    ColorIngest_Yuy2
+};
+
+#ifdef _WIN32
+
+class SynchronizedFrameReader : public FrameSynchronizer {
+public:
+    ColorIngest colorIngest = ColorIngest_Bgra;  //set before open()
+    cv::Mat colorImage;                     //latest color frame, reused buffer, black until the first frame:
+                                            //CV_8UC4 BGRA, or CV_8UC2 YUY2 with ColorIngest_Yuy2
+    std::vector<UINT16> depthData;          //latest depth frame (mm)
+    int depthWidth = 0, depthHeight = 0;
+    IBody* bodies[BODY_COUNT] = { 0 };      //refreshed in place by every body frame
+
+    ~SynchronizedFrameReader() { close(); }
+
+    //frameSourceTypes is a combination of FrameSourceTypes_Color, FrameSourceTypes_Depth and FrameSourceTypes_Body
+    bool open(IKinectSensor* sensor, DWORD frameSourceTypes) {
+        if (frameSourceTypes & FrameSourceTypes_Color) {
+            ComLease<IColorFrameSource> colorSource;
+            FrameDescriptionLease description;
+            int width = 1920, height = 1080;
+            if (FAILED(sensor->get_ColorFrameSource(colorSource.put())) || !colorSource || FAILED(colorSource->OpenReader(colorReader.put()))) {
+                std::cerr << "Failed to open Color Frame Reader!" << std::endl;
+                return false;
+            }
+            if (SUCCEEDED(colorSource->get_FrameDescription(description.put())) && description) {
+                description->get_Width(&width);
+                description->get_Height(&height);
+            }
+            if (colorIngest == ColorIngest_Yuy2) {
+                //black in YUY2 is Y 16, U and V 128
+                colorImage = cv::Mat(height, width, CV_8UC2, cv::Scalar(16, 128));
+            }
+            else {
+                colorImage = cv::Mat(height, width, CV_8UC4, cv::Scalar(0, 0, 0, 255));
+            }
+        }
+
+        if (frameSourceTypes & FrameSourceTypes_Depth) {
+            ComLease<IDepthFrameSource> depthSource;
+            FrameDescriptionLease description;
+            if (FAILED(sensor->get_DepthFrameSource(depthSource.put())) || !depthSource || FAILED(depthSource->OpenReader(depthReader.put()))) {
+                std::cerr << "Failed to open Depth Frame Reader!" << std::endl;
+                return false;
+            }
+            depthWidth = 512;
+            depthHeight = 424;
+            if (SUCCEEDED(depthSource->get_FrameDescription(description.put())) && description) {
+                description->get_Width(&depthWidth);
+                description->get_Height(&depthHeight);
+            }
+            depthData.assign(static_cast<size_t>(depthWidth) * depthHeight, 0);
+        }
+
+        if (frameSourceTypes & FrameSourceTypes_Body) {
+            ComLease<IBodyFrameSource> bodySource;
+            if (FAILED(sensor->get_BodyFrameSource(bodySource.put())) || !bodySource || FAILED(bodySource->OpenReader(bodyReader.put()))) {
+                std::cerr << "Failed to open Body Frame Reader!" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //acquires the latest frame of every open stream, a stream without a new frame keeps its previous data
+    void update() { synchronize(*this); }
+
+    //blocks until one of the open streams has a new frame or timeoutMs passes, for a reader polled on its own thread
+    bool waitForFrames(DWORD timeoutMs) {
+        if (!subscribed) {
+            if (colorReader) colorReader->SubscribeFrameArrived(&colorEvent);
+            if (depthReader) depthReader->SubscribeFrameArrived(&depthEvent);
+            if (bodyReader) bodyReader->SubscribeFrameArrived(&bodyEvent);
+            subscribed = true;
+        }
+
+        HANDLE handles[3];
+        WAITABLE_HANDLE events[3];
+        DWORD count = 0;
+        if (colorEvent) { events[count] = colorEvent; handles[count++] = reinterpret_cast<HANDLE>(colorEvent); }
+        if (depthEvent) { events[count] = depthEvent; handles[count++] = reinterpret_cast<HANDLE>(depthEvent); }
+        if (bodyEvent) { events[count] = bodyEvent; handles[count++] = reinterpret_cast<HANDLE>(bodyEvent); }
+        if (count == 0) return false;
+
+        DWORD result = WaitForMultipleObjects(count, handles, FALSE, timeoutMs);
+        if (result >= WAIT_OBJECT_0 + count) return false;
+
+        //take the event data so the handle is reset, the frame itself is acquired by update()
+        WAITABLE_HANDLE signaled = events[result - WAIT_OBJECT_0];
+        if (signaled == colorEvent) {
+            ComLease<IColorFrameArrivedEventArgs> eventData;
+            colorReader->GetFrameArrivedEventData(signaled, eventData.put());
+        }
+        else if (signaled == depthEvent) {
+            ComLease<IDepthFrameArrivedEventArgs> eventData;
+            depthReader->GetFrameArrivedEventData(signaled, eventData.put());
+        }
+        else {
+            ComLease<IBodyFrameArrivedEventArgs> eventData;
+            bodyReader->GetFrameArrivedEventData(signaled, eventData.put());
+        }
+        return true;
+    }
+
+    void close() {
+        if (colorReader && colorEvent) colorReader->UnsubscribeFrameArrived(colorEvent);
+        if (depthReader && depthEvent) depthReader->UnsubscribeFrameArrived(depthEvent);
+        if (bodyReader && bodyEvent) bodyReader->UnsubscribeFrameArrived(bodyEvent);
+        colorEvent = depthEvent = bodyEvent = 0;
+        subscribed = false;
+
+        if (colorReader || depthReader || bodyReader) {
+            std::cout << "Body frames: " << matcher.bodyFrames << ", without a matching color frame: "
+                << matcher.bodyFramesWithoutColor << std::endl;
+        }
+        for (int i = 0; i < BODY_COUNT; ++i) SafeRelease(bodies[i]);
+        colorReader.reset();
+        depthReader.reset();
+        bodyReader.reset();
+    }
+
+private:
+    friend class FrameSynchronizer;
+
+    ComLease<IColorFrameReader> colorReader;
+    ComLease<IDepthFrameReader> depthReader;
+    ComLease<IBodyFrameReader> bodyReader;
+    WAITABLE_HANDLE colorEvent = 0, depthEvent = 0, bodyEvent = 0;
+    bool subscribed = false;
+
+    //the streams of FrameSynchronizer::synchronize
+    bool hasColor() const { return colorReader.get() != nullptr; }
+    bool hasDepth() const { return depthReader.get() != nullptr; }
+    bool hasBody() const { return bodyReader.get() != nullptr; }
+
+    bool acquireColor(TIMESPAN& time) {
+        ColorFrameLease colorFrame;
+        PROFILE_STAGE_BEGIN(Stage_AcquireColor);
+        HRESULT hr = colorReader->AcquireLatestFrame(colorFrame.put());
+        PROFILE_STAGE_END(Stage_AcquireColor);
+        if (FAILED(hr)) return false;
+        PROFILE_STAGE_BEGIN(Stage_CopyColor);
+        hr = copyColorFrame(colorFrame.get());
+        PROFILE_STAGE_END(Stage_CopyColor);
+        return SUCCEEDED(hr) && SUCCEEDED(colorFrame->get_RelativeTime(&time));
+    }
+
+    bool acquireDepth(TIMESPAN& time) {
+        DepthFrameLease depthFrame;
+        PROFILE_STAGE_BEGIN(Stage_AcquireDepth);
+        HRESULT hr = depthReader->AcquireLatestFrame(depthFrame.put());
+        if (SUCCEEDED(hr)) hr = depthFrame->CopyFrameDataToArray(static_cast<UINT>(depthData.size()), depthData.data());
+        if (SUCCEEDED(hr)) hr = depthFrame->get_RelativeTime(&time);
+        PROFILE_STAGE_END(Stage_AcquireDepth);
+        return SUCCEEDED(hr);
+    }
+
+    bool acquireBody(TIMESPAN& time) {
+        BodyFrameLease bodyFrame;
+        PROFILE_STAGE_BEGIN(Stage_AcquireBody);
+        HRESULT hr = bodyReader->AcquireLatestFrame(bodyFrame.put());
+        PROFILE_STAGE_END(Stage_AcquireBody);
+        if (FAILED(hr)) return false;
+        PROFILE_BODY_FRAME(bodyFrame.get());
+        PROFILE_STAGE_BEGIN(Stage_BodyData);
+        hr = bodyFrame->GetAndRefreshBodyData(_countof(bodies), bodies);
+        PROFILE_STAGE_END(Stage_BodyData);
+        return SUCCEEDED(hr) && SUCCEEDED(bodyFrame->get_RelativeTime(&time));
+    }
+
+    HRESULT copyColorFrame(IColorFrame* colorFrame) {
+        const UINT bytes = static_cast<UINT>(colorImage.total() * colorImage.elemSize());
+        if (colorImage.type() == CV_8UC2) {
+            ColorImageFormat rawFormat = ColorImageFormat_None;
+            colorFrame->get_RawColorImageFormat(&rawFormat);
+            if (rawFormat == ColorImageFormat_Yuy2) return colorFrame->CopyRawFrameDataToArray(bytes, colorImage.data);
+            return colorFrame->CopyConvertedFrameDataToArray(bytes, colorImage.data, ColorImageFormat_Yuy2);
+        }
+        return colorFrame->CopyConvertedFrameDataToArray(bytes, colorImage.data, ColorImageFormat_Bgra);
+    }
+};
+
+#endif
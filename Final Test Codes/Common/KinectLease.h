@@ -0,0 +1,122 @@
+//Owning handles for Kinect SDK interfaces and frames
+//every interface the SDK hands out (sensor, sources, readers, frames, frame descriptions, event data) must be
+//Released exactly once. A lease holds one reference and releases it when it goes out of scope, on every return
+//and exception path, so a frame loop that runs for hours cannot leak one frame per iteration.
+//
+//  KinectSensorLease sensor;
+//  if (!sensor.open()) return -1;                          //GetDefaultKinectSensor + Open, Close + Release at scope exit
+//  ComLease<ICoordinateMapper> coordinateMapper;
+//  sensor->get_CoordinateMapper(coordinateMapper.put());
+//  ...
+//  ColorFrameLease colorFrame;                             //per frame, released at the end of the iteration
+//  if (SUCCEEDED(colorReader->AcquireLatestFrame(colorFrame.put()))) { ...colorFrame->... }
+//
+//leases are move-only, a copy would release the same reference twice.
+#pragma once
+#include "SkeletonTypes.h"
+#include <utility>
+
+//releases and clears a raw interface pointer, for arrays filled by the SDK (IBody* bodies[BODY_COUNT])
+template<class Interface>
+inline void SafeRelease(Interface*& interfaceToRelease) {
+    if (interfaceToRelease) {
+        interfaceToRelease->Release();
+        interfaceToRelease = nullptr;
+    }
+}
+
+template<class Interface>
+class ComLease {
+public:
+    ComLease() = default;
+    //takes over a reference the caller owns, without AddRef
+    explicit ComLease(Interface* owned) : pointer(owned) {}
+    ~ComLease() { SafeRelease(pointer); }
+
+    ComLease(const ComLease&) = delete;
+    ComLease& operator=(const ComLease&) = delete;
+    ComLease(ComLease&& other) noexcept : pointer(other.pointer) { other.pointer = nullptr; }
+    ComLease& operator=(ComLease&& other) noexcept {
+        if (this != &other) {
+            SafeRelease(pointer);
+            pointer = other.pointer;
+            other.pointer = nullptr;
+        }
+        return *this;
+    }
+
+    //for SDK out parameters (AcquireLatestFrame, get_FrameDescription, OpenReader), releases the previous reference first
+    Interface** put() {
+        SafeRelease(pointer);
+        return &pointer;
+    }
+
+    Interface* get() const { return pointer; }
+    Interface* operator->() const { return pointer; }
+    explicit operator bool() const { return pointer != nullptr; }
+
+    void reset() { SafeRelease(pointer); }
+    //gives the reference back to the caller, who must release it
+    Interface* detach() {
+        Interface* released = pointer;
+        pointer = nullptr;
+        return released;
+    }
+
+private:
+    Interface* pointer = nullptr;
+};
+
+#ifdef _WIN32
+
+typedef ComLease<IColorFrame> ColorFrameLease;
+typedef ComLease<IDepthFrame> DepthFrameLease;
+typedef ComLease<IBodyFrame> BodyFrameLease;
+typedef ComLease<IFrameDescription> FrameDescriptionLease;
+
+//the default sensor, opened by open() and closed before it is released
+class KinectSensorLease {
+public:
+    KinectSensorLease() = default;
+    ~KinectSensorLease() { close(); }
+    KinectSensorLease(const KinectSensorLease&) = delete;
+    KinectSensorLease& operator=(const KinectSensorLease&) = delete;
+    //the open sensor goes with the move, the source is left closed and empty
+    KinectSensorLease(KinectSensorLease&& other) noexcept : sensor(std::move(other.sensor)), opened(other.opened) { other.opened = false; }
+    KinectSensorLease& operator=(KinectSensorLease&& other) noexcept {
+        if (this != &other) {
+            close();
+            sensor = std::move(other.sensor);
+            opened = other.opened;
+            other.opened = false;
+        }
+        return *this;
+    }
+
+    bool open() {
+        close();
+        if (FAILED(GetDefaultKinectSensor(sensor.put())) || !sensor) return false;
+        if (FAILED(sensor->Open())) {
+            sensor.reset();
+            return false;
+        }
+        opened = true;
+        return true;
+    }
+
+    void close() {
+        if (opened) sensor->Close();
+        opened = false;
+        sensor.reset();
+    }
+
+    IKinectSensor* get() const { return sensor.get(); }
+    IKinectSensor* operator->() const { return sensor.get(); }
+    explicit operator bool() const { return static_cast<bool>(sensor); }
+
+private:
+    ComLease<IKinectSensor> sensor;
+    bool opened = false;
+};
+
+#endif
@@ -0,0 +1,224 @@
+//Normative scoring against the reference table in Resources/averaged_data.csv
+//copy averaged_data.csv next to the executable, the table is loaded once at startup
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//columns of averaged_data.csv, in file order
+enum NormativeTest {
+    Norm_SeatedForwardBend = 0,
+    Norm_GripStrength,
+    Norm_FunctionalReach,
+    Norm_StandingOneLeg,
+    Norm_TimedUpGo,
+    Norm_WalkingSpeed,
+    Norm_Count
+};
+
+//TUG and Walking Speed are times, a lower value is the better result
+inline bool isLowerBetter(NormativeTest test) {
+    return test == Norm_TimedUpGo || test == Norm_WalkingSpeed;
+}
+
+struct NormativeScore {
+    bool valid = false;
+    float percentile = 0.0f;   //percentage of the reference group with a worse result (higher is better)
+    float zScore = 0.0f;       //(value - mean) / standard deviation of the reference group
+    size_t sampleCount = 0;    //reference values the score was computed against
+};
+
+//raw reference values of one stratum, one vector per test
+struct NormativeSamples {
+    std::vector<float> columns[Norm_Count];
+};
+
+//one stratum of the reference table, every column is stored sorted and back to back in a single array
+struct NormativeColumns {
+    std::vector<float> values;
+    size_t offsets[Norm_Count + 1] = { 0 };
+    float mean[Norm_Count] = { 0 };
+    float stdDev[Norm_Count] = { 0 };
+
+    void build(NormativeSamples& samples) {
+        values.clear();
+        for (int t = 0; t < Norm_Count; ++t) {
+            std::vector<float>& column = samples.columns[t];
+            std::sort(column.begin(), column.end());
+
+            offsets[t] = values.size();
+            values.insert(values.end(), column.begin(), column.end());
+
+            double sum = 0.0, sumSq = 0.0;
+            for (float v : column) {
+                sum += v;
+                sumSq += static_cast<double>(v) * v;
+            }
+            size_t n = column.size();
+            mean[t] = n ? static_cast<float>(sum / n) : 0.0f;
+            stdDev[t] = n > 1 ? static_cast<float>(std::sqrt(std::max(0.0, (sumSq - sum * sum / n) / (n - 1)))) : 0.0f;
+        }
+        offsets[Norm_Count] = values.size();
+    }
+
+    size_t count(NormativeTest test) const {
+        return offsets[test + 1] - offsets[test];
+    }
+
+    //binary search over the sorted column, O(log n)
+    NormativeScore score(NormativeTest test, float value) const {
+        NormativeScore result;
+        size_t n = count(test);
+        if (n == 0) return result;
+
+        const float* first = values.data() + offsets[test];
+        const float* last = first + n;
+        size_t below = std::lower_bound(first, last, value) - first;
+        size_t atOrBelow = std::upper_bound(first, last, value) - first;
+
+        //mid-rank percentile so ties count half above and half below
+        float rawPercentile = 100.0f * (below + atOrBelow) / (2.0f * n);
+
+        result.valid = true;
+        result.sampleCount = n;
+        result.percentile = isLowerBetter(test) ? 100.0f - rawPercentile : rawPercentile;
+        result.zScore = stdDev[test] > 0.0f ? (value - mean[test]) / stdDev[test] : 0.0f;
+        return result;
+    }
+};
+
+class NormativeTable {
+public:
+    //minimum reference values before a stratum is used instead of the pooled table
+    size_t minimumStratumSize = 20;
+
+    //demographicsFile is optional: a CSV export of the HaaS master data with one row per row of dataFile,
+    //and "Gender" and/or "Age" columns. Age is grouped into the HaaS bands (<65, 65-69, 70-74, 75-79, 80+)
+    bool load(const std::string& dataFile, const std::string& demographicsFile = "") {
+        std::ifstream infile(dataFile);
+        if (!infile.is_open()) {
+            std::cerr << "Normative data not found: " << dataFile << std::endl;
+            return false;
+        }
+
+        std::vector<std::string> strata;
+        if (!demographicsFile.empty()) {
+            strata = loadStrata(demographicsFile);
+        }
+
+        NormativeSamples pooledSamples;
+        std::map<std::string, NormativeSamples> strataSamples;
+
+        std::string line;
+        std::getline(infile, line); //header
+        size_t row = 0;
+        while (std::getline(infile, line)) {
+            std::stringstream ss(line);
+            std::string cell;
+            for (int t = 0; t < Norm_Count && std::getline(ss, cell, ','); ++t) {
+                float value = 0.0f;
+                try {
+                    value = std::stof(cell);
+                }
+                catch (...) {
+                    continue;
+                }
+                //0.0 marks a test the participant did not take
+                if (value <= 0.0f || std::isnan(value)) continue;
+
+                pooledSamples.columns[t].push_back(value);
+                if (row < strata.size() && !strata[row].empty()) {
+                    strataSamples[strata[row]].columns[t].push_back(value);
+                }
+            }
+            ++row;
+        }
+
+        pooled.build(pooledSamples);
+        stratified.clear();
+        for (auto& entry : strataSamples) {
+            stratified[entry.first].build(entry.second);
+        }
+
+        loaded = pooled.offsets[Norm_Count] > 0;
+        return loaded;
+    }
+
+    bool isLoaded() const { return loaded; }
+
+    //score against the participant's stratum when it has enough reference values, otherwise the pooled table
+    NormativeScore score(NormativeTest test, float value, const std::string& stratum = "") const {
+        if (!stratum.empty()) {
+            auto it = stratified.find(stratum);
+            if (it != stratified.end() && it->second.count(test) >= minimumStratumSize) {
+                return it->second.score(test, value);
+            }
+        }
+        return pooled.score(test, value);
+    }
+
+    //stratum key used by the table, e.g. stratumKey("M", 72) == "M70-74"
+    static std::string stratumKey(const std::string& gender, int age) {
+        std::string key = gender.empty() ? "" : gender.substr(0, 1);
+        if (!key.empty()) key[0] = static_cast<char>(toupper(static_cast<unsigned char>(key[0])));
+        if (age <= 0) return key;
+        if (age < 65) return key + "<65";
+        if (age >= 80) return key + "80+";
+        int band = 65 + ((age - 65) / 5) * 5;
+        return key + std::to_string(band) + "-" + std::to_string(band + 4);
+    }
+
+private:
+    NormativeColumns pooled;
+    std::map<std::string, NormativeColumns> stratified;
+    bool loaded = false;
+
+    static std::vector<std::string> loadStrata(const std::string& demographicsFile) {
+        std::vector<std::string> strata;
+        std::ifstream infile(demographicsFile);
+        if (!infile.is_open()) {
+            std::cerr << "Demographic data not found: " << demographicsFile << std::endl;
+            return strata;
+        }
+
+        std::string line, cell;
+        std::getline(infile, line);
+        int genderColumn = -1, ageColumn = -1;
+        std::stringstream header(line);
+        for (int c = 0; std::getline(header, cell, ','); ++c) {
+            if (cell.find("Gender") != std::string::npos || cell.find("Sex") != std::string::npos) genderColumn = c;
+            if (cell.find("Age") != std::string::npos) ageColumn = c;
+        }
+
+        while (std::getline(infile, line)) {
+            std::stringstream ss(line);
+            std::string gender;
+            int age = 0;
+            for (int c = 0; std::getline(ss, cell, ','); ++c) {
+                if (c == genderColumn) gender = cell;
+                if (c == ageColumn) {
+                    try { age = std::stoi(cell); }
+                    catch (...) { age = 0; }
+                }
+            }
+            strata.push_back(stratumKey(gender, age));
+        }
+        return strata;
+    }
+};
+
+//on-screen text for a score, e.g. "Percentile: 62 (z = -0.31)"
+inline std::string formatNormativeScore(const NormativeScore& score) {
+    if (!score.valid) return "Percentile: N/A";
+    std::ostringstream stream;
+    stream << "Percentile: " << static_cast<int>(std::round(score.percentile))
+        << " (z = " << std::fixed << std::setprecision(2) << score.zScore << ")";
+    return stream.str();
+}
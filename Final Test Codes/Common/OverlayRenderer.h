@@ -0,0 +1,367 @@
+//Cached text overlays for the frame loop
+//cv::putText draws the Hershey strokes of every character on every call, while the overlays of the tests only change
+//when the test state or a displayed number changes. Here every character is rasterized once into a glyph atlas,
+//a line of text is assembled from the atlas only when its content changes, and each frame only its small
+//rectangle of the image is blended.
+//
+//  overlayText(bgrMat, "Test Ready", cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+//
+//same arguments and placement as cv::putText (within a pixel), for 8-bit images with 1, 3 or 4 channels
+//define OVERLAY_PUTTEXT to draw with cv::putText instead, e.g. to compare Stage_Overlay of both with FRAME_PROFILING
+#pragma once
+#include "FrameProfiler.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+//every printable ASCII character of one font, size and thickness, rendered once as 8-bit coverage
+struct GlyphAtlas {
+    static const int firstChar = 32;
+    static const int lastChar = 126;
+    static const int glyphCount = lastChar - firstChar + 1;
+
+    int fontFace = 0;
+    double fontScale = 1.0;
+    int thickness = 1;
+    int lineType = cv::LINE_8;
+    int padding = 0;        //free pixels around each glyph, strokes reach past the text box by half the thickness
+    int ascent = 0;         //highest glyph above the baseline
+    int descent = 0;        //lowest glyph below the baseline
+    cv::Mat alpha;          //glyphs side by side in one row
+    int cellX[glyphCount] = { 0 };
+    int cellWidth[glyphCount] = { 0 };
+    int advance[glyphCount] = { 0 };    //pen advance in font units, getTextSize sums these times the scale
+
+    void build(int face, double scale, int thick, int line) {
+        fontFace = face;
+        fontScale = scale;
+        thickness = thick;
+        lineType = line;
+        padding = thickness + 2;
+
+        int totalWidth = 0;
+        ascent = descent = 0;
+        for (int g = 0; g < glyphCount; ++g) {
+            int baseline = 0;
+            cv::Size size = cv::getTextSize(std::string(1, static_cast<char>(firstChar + g)), face, scale, thick, &baseline);
+            ascent = std::max(ascent, size.height);
+            descent = std::max(descent, baseline);
+            cellX[g] = totalWidth;
+            cellWidth[g] = size.width + 2 * padding;
+            totalWidth += cellWidth[g];
+            //at scale 1 and thickness 1 getTextSize reports the advance plus the thickness, without rounding
+            advance[g] = cv::getTextSize(std::string(1, static_cast<char>(firstChar + g)), face, 1.0, 1, &baseline).width - 1;
+        }
+
+        alpha = cv::Mat::zeros(cellHeight(), totalWidth, CV_8UC1);
+        for (int g = 0; g < glyphCount; ++g) {
+            cv::Mat cell = alpha(cv::Rect(cellX[g], 0, cellWidth[g], cellHeight()));
+            cv::putText(cell, std::string(1, static_cast<char>(firstChar + g)), cv::Point(padding, padding + ascent),
+                face, scale, cv::Scalar(255), thick, line);
+        }
+    }
+
+    int cellHeight() const { return ascent + descent + 2 * padding; }
+
+    //width getTextSize reports for text whose advances add up to units
+    int textWidth(int units) const { return cvRound(units * fontScale + thickness); }
+
+    //characters cv::putText cannot draw come out as '?', like in putText
+    static int glyphIndex(char c) {
+        int code = static_cast<unsigned char>(c);
+        return (code >= firstChar && code <= lastChar) ? code - firstChar : '?' - firstChar;
+    }
+};
+
+//one line of text assembled from the atlas
+struct TextLayer {
+    cv::Mat alpha;
+    cv::Point offset;       //top left corner relative to the text origin (bottom left of the text, as in putText)
+};
+
+class OverlayRenderer {
+public:
+    //layers kept for reuse, the least recently drawn one is dropped first (changing numbers create new layers)
+    size_t maximumLayers = 64;
+    //layers assembled so far, a steady frame assembles none
+    uint64_t layerBuilds = 0;
+
+    void putText(cv::Mat& image, const std::string& text, cv::Point org, int fontFace, double fontScale,
+        cv::Scalar color, int thickness = 1, int lineType = cv::LINE_8) {
+        putText(image, text.c_str(), text.size(), org, fontFace, fontScale, color, thickness, lineType);
+    }
+
+    //text of a FrameText (FrameArena.h), a layer that is already cached is found without copying the text
+    void putText(cv::Mat& image, const char* text, cv::Point org, int fontFace, double fontScale,
+        cv::Scalar color, int thickness = 1, int lineType = cv::LINE_8) {
+        putText(image, text, std::strlen(text), org, fontFace, fontScale, color, thickness, lineType);
+    }
+
+    void putText(cv::Mat& image, const char* text, size_t length, cv::Point org, int fontFace, double fontScale,
+        cv::Scalar color, int thickness = 1, int lineType = cv::LINE_8) {
+        if (length == 0 || image.depth() != CV_8U || image.channels() == 2) {
+            cv::putText(image, std::string(text, length), org, fontFace, fontScale, color, thickness, lineType);
+            return;
+        }
+        TextLayer& layer = textLayer(text, length, fontFace, fontScale, thickness, lineType);
+        blend(image, layer, org + layer.offset, color);
+    }
+
+private:
+    typedef std::tuple<int, double, int, int> AtlasKey;                   //font, scale, thickness, line type
+
+    struct LayerKey {
+        AtlasKey atlas;
+        std::string text;
+    };
+    //a LayerKey that points at the text instead of owning it, for the lookup
+    struct LayerLookup {
+        AtlasKey atlas;
+        const char* text;
+        size_t length;
+    };
+    //transparent, so layers.find(LayerLookup) does not build a std::string
+    struct LayerLess {
+        typedef void is_transparent;
+        static bool less(const AtlasKey& atlasA, const char* textA, size_t lengthA,
+            const AtlasKey& atlasB, const char* textB, size_t lengthB) {
+            if (atlasA != atlasB) return atlasA < atlasB;
+            int order = std::memcmp(textA, textB, std::min(lengthA, lengthB));
+            return order != 0 ? order < 0 : lengthA < lengthB;
+        }
+        bool operator()(const LayerKey& a, const LayerKey& b) const {
+            return less(a.atlas, a.text.data(), a.text.size(), b.atlas, b.text.data(), b.text.size());
+        }
+        bool operator()(const LayerKey& a, const LayerLookup& b) const {
+            return less(a.atlas, a.text.data(), a.text.size(), b.atlas, b.text, b.length);
+        }
+        bool operator()(const LayerLookup& a, const LayerKey& b) const {
+            return less(a.atlas, a.text, a.length, b.atlas, b.text.data(), b.text.size());
+        }
+    };
+
+    //a layer and its place in the drawing order, moved to the back of recentLayers without allocating when drawn
+    struct CachedLayer {
+        TextLayer layer;
+        std::list<const LayerKey*>::iterator recent;
+    };
+
+    std::map<AtlasKey, std::unique_ptr<GlyphAtlas>> atlases;
+    std::map<LayerKey, CachedLayer, LayerLess> layers;
+    std::list<const LayerKey*> recentLayers;    //keys of the layers, the least recently drawn first
+
+    GlyphAtlas& glyphAtlas(int fontFace, double fontScale, int thickness, int lineType) {
+        std::unique_ptr<GlyphAtlas>& atlas = atlases[AtlasKey(fontFace, fontScale, thickness, lineType)];
+        if (!atlas) {
+            atlas.reset(new GlyphAtlas());
+            atlas->build(fontFace, fontScale, thickness, lineType);
+        }
+        return *atlas;
+    }
+
+    TextLayer& textLayer(const char* text, size_t length, int fontFace, double fontScale, int thickness, int lineType) {
+        LayerLookup lookup = { AtlasKey(fontFace, fontScale, thickness, lineType), text, length };
+        auto it = layers.find(lookup);
+        if (it != layers.end()) {
+            recentLayers.splice(recentLayers.end(), recentLayers, it->second.recent);
+            return it->second.layer;
+        }
+
+        if (layers.size() >= maximumLayers && !recentLayers.empty()) {
+            layers.erase(*recentLayers.front());
+            recentLayers.pop_front();
+        }
+
+        it = layers.emplace(LayerKey{ lookup.atlas, std::string(text, length) }, CachedLayer()).first;
+        it->second.recent = recentLayers.insert(recentLayers.end(), &it->first);
+        buildLayer(glyphAtlas(fontFace, fontScale, thickness, lineType), it->first.text, it->second.layer);
+        ++layerBuilds;
+        return it->second.layer;
+    }
+
+    //each glyph is placed where putText would draw it, the pen position after a prefix of the text is the
+    //width getTextSize reports for that prefix less the thickness it adds, summed from the advances of the atlas
+    static void buildLayer(const GlyphAtlas& atlas, const std::string& text, TextLayer& layer) {
+        int units = 0;
+        for (char c : text) units += atlas.advance[atlas.glyphIndex(c)];
+        int width = atlas.textWidth(units);
+        layer.alpha = cv::Mat::zeros(atlas.cellHeight(), width + 2 * atlas.padding + atlas.cellWidth[atlas.glyphIndex(text.back())], CV_8UC1);
+        layer.offset = cv::Point(-atlas.padding, -atlas.padding - atlas.ascent);
+
+        units = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            int g = atlas.glyphIndex(text[i]);
+            int pen = i > 0 ? atlas.textWidth(units) - atlas.thickness : 0;
+            units += atlas.advance[g];
+            cv::Rect cell(atlas.cellX[g], 0, atlas.cellWidth[g], atlas.cellHeight());
+            cv::Mat target = layer.alpha(cv::Rect(std::max(pen, 0), 0, atlas.cellWidth[g], atlas.cellHeight()));
+            //neighbouring glyphs overlap in their padding
+            cv::max(target, atlas.alpha(cell), target);
+        }
+    }
+
+    //alpha blends the layer into its rectangle of the image, nothing outside that rectangle is touched
+    static void blend(cv::Mat& image, const TextLayer& layer, cv::Point topLeft, const cv::Scalar& color) {
+        cv::Rect target(topLeft, layer.alpha.size());
+        cv::Rect visible = target & cv::Rect(0, 0, image.cols, image.rows);
+        if (visible.empty()) return;
+
+        const int channels = image.channels();
+        uint8_t ink[4];
+        for (int c = 0; c < 4; ++c) ink[c] = cv::saturate_cast<uint8_t>(color[c]);
+
+        for (int y = 0; y < visible.height; ++y) {
+            const uint8_t* a = layer.alpha.ptr<uint8_t>(visible.y - target.y + y) + (visible.x - target.x);
+            uint8_t* p = image.ptr<uint8_t>(visible.y + y) + visible.x * channels;
+            for (int x = 0; x < visible.width; ++x, p += channels) {
+                const int coverage = a[x];
+                if (coverage == 0) continue;
+                if (coverage == 255) {
+                    for (int c = 0; c < channels; ++c) p[c] = ink[c];
+                }
+                else {
+                    for (int c = 0; c < channels; ++c) p[c] = static_cast<uint8_t>((p[c] * (255 - coverage) + ink[c] * coverage + 127) / 255);
+                }
+            }
+        }
+    }
+};
+
+inline OverlayRenderer& overlayRenderer() {
+    static OverlayRenderer renderer;
+    return renderer;
+}
+
+//drop-in replacement of cv::putText for the overlays of the frame loop, timed as Stage_Overlay when profiling is enabled
+inline void overlayText(cv::Mat& image, const std::string& text, cv::Point org, int fontFace, double fontScale,
+    cv::Scalar color, int thickness = 1) {
+#ifdef OVERLAY_PUTTEXT
+    profiledPutText(image, text, org, fontFace, fontScale, color, thickness);
+#else
+    PROFILE_STAGE_BEGIN(Stage_Overlay);
+    overlayRenderer().putText(image, text, org, fontFace, fontScale, color, thickness);
+#endif
+}
+
+//string literals and FrameText::c_str(), no std::string is built for a cached text
+inline void overlayText(cv::Mat& image, const char* text, cv::Point org, int fontFace, double fontScale,
+    cv::Scalar color, int thickness = 1) {
+#ifdef OVERLAY_PUTTEXT
+    profiledPutText(image, text, org, fontFace, fontScale, color, thickness);
+#else
+    PROFILE_STAGE_BEGIN(Stage_Overlay);
+    overlayRenderer().putText(image, text, org, fontFace, fontScale, color, thickness);
+#endif
+}
+
+//drawing commands of one frame, recorded by the test logic and drawn later by the render stage (FramePipeline.h)
+struct OverlayItem {
+    enum Kind { Text, Rectangle, Circle };
+    Kind kind = Text;
+    std::string text;
+    cv::Point point;            //text origin or circle center
+    cv::Rect rect;
+    int radius = 0;
+    int fontFace = 0;
+    double fontScale = 1.0;
+    cv::Scalar color;
+    int thickness = 1;
+};
+
+class OverlayList {
+public:
+    std::vector<OverlayItem> items;
+
+    //keeps the allocated items, so a steady overlay does not allocate
+    void clear() { count = 0; }
+    bool empty() const { return count == 0; }
+
+    OverlayItem& add(OverlayItem::Kind kind) {
+        if (count == items.size()) items.emplace_back();
+        OverlayItem& item = items[count++];
+        item.kind = kind;
+        return item;
+    }
+
+    //scale maps the color frame coordinates the items were recorded in to a downscaled image
+    void draw(cv::Mat& image, double scale = 1.0) const {
+        PROFILE_STAGE_BEGIN(Stage_Overlay);
+        for (size_t i = 0; i < count; ++i) {
+            const OverlayItem& item = items[i];
+            if (scale != 1.0) {
+                drawScaled(image, item, scale);
+                continue;
+            }
+            switch (item.kind) {
+            case OverlayItem::Text:
+                overlayRenderer().putText(image, item.text, item.point, item.fontFace, item.fontScale, item.color, item.thickness);
+                break;
+            case OverlayItem::Rectangle:
+                cv::rectangle(image, item.rect, item.color, item.thickness);
+                break;
+            case OverlayItem::Circle:
+                cv::circle(image, item.point, item.radius, item.color, item.thickness);
+                break;
+            }
+        }
+    }
+
+private:
+    size_t count = 0;
+
+    static void drawScaled(cv::Mat& image, const OverlayItem& item, double scale) {
+        cv::Point point(cvRound(item.point.x * scale), cvRound(item.point.y * scale));
+        int thickness = std::max(1, cvRound(item.thickness * scale));
+        switch (item.kind) {
+        case OverlayItem::Text:
+            overlayRenderer().putText(image, item.text, point, item.fontFace, item.fontScale * scale, item.color, thickness);
+            break;
+        case OverlayItem::Rectangle:
+            cv::rectangle(image, cv::Rect(cvRound(item.rect.x * scale), cvRound(item.rect.y * scale),
+                cvRound(item.rect.width * scale), cvRound(item.rect.height * scale)), item.color, thickness);
+            break;
+        case OverlayItem::Circle:
+            cv::circle(image, point, std::max(1, cvRound(item.radius * scale)), item.color, thickness);
+            break;
+        }
+    }
+};
+
+//the item keeps its string between frames, assigning a text of the same or shorter length does not allocate
+inline void overlayText(OverlayList& overlay, const char* text, cv::Point org, int fontFace, double fontScale,
+    cv::Scalar color, int thickness = 1) {
+    OverlayItem& item = overlay.add(OverlayItem::Text);
+    item.text.assign(text);
+    item.point = org;
+    item.fontFace = fontFace;
+    item.fontScale = fontScale;
+    item.color = color;
+    item.thickness = thickness;
+}
+
+inline void overlayText(OverlayList& overlay, const std::string& text, cv::Point org, int fontFace, double fontScale,
+    cv::Scalar color, int thickness = 1) {
+    overlayText(overlay, text.c_str(), org, fontFace, fontScale, color, thickness);
+}
+
+inline void overlayRectangle(OverlayList& overlay, cv::Rect rect, cv::Scalar color, int thickness = 1) {
+    OverlayItem& item = overlay.add(OverlayItem::Rectangle);
+    item.rect = rect;
+    item.color = color;
+    item.thickness = thickness;
+}
+
+inline void overlayCircle(OverlayList& overlay, cv::Point center, int radius, cv::Scalar color, int thickness = 1) {
+    OverlayItem& item = overlay.add(OverlayItem::Circle);
+    item.point = center;
+    item.radius = radius;
+    item.color = color;
+    item.thickness = thickness;
+}
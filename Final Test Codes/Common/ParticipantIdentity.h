@@ -0,0 +1,497 @@
+//Participant re-identification from bone lengths
+//the result files of the tests and of trials _1 and _2 were linked to a participant by hand in Patient_Data.csv. The
+//bone lengths of a skeleton barely change with posture, so the 20 bones of the bones table (skeletonBones) averaged
+//over stable frames make a signature of the participant. The signatures of the day are kept in participants.csv next
+//to the executable: the first test a participant does enrols them under a new ID (date and number), every later test
+//matches them to it and writes the ID into its result record.
+//  stable frame   SpineBase moved less than maxFrameMotion since the last frame; a bone counts when both joints are
+//                 tracked and, after a few samples, it is within maxDeviation of its mean
+//  match          weighted RMS difference of the bones (hand and foot bones a quarter, they are the noisiest) against
+//                 every enrolled signature, at most a few hundred floats with SSE, well under a microsecond. The sensor's
+//                 joint positions carry a bias of 1-2 cm that changes with the pose and the session, so the same
+//                 participant comes back up to matchDistance away; the nearest is taken only when the second nearest is
+//                 clearly farther (matchRatio), a new participant is enrolled without asking only beyond
+//                 enrollDistance from everybody. In between the participant is left unidentified rather than guessed
+//                 and the operator confirms them as the nearest or enrols them as new (Y / N in the tests).
+//                 Participants whose signatures are less than about twice the bias apart cannot be told apart by
+//                 their bones (ParticipantReidReplay)
+//  enrolment      under participants.csv.lock the file is read again and the ID follows the highest of the day in it,
+//                 the tests open side by side all day share the file
+//  swap           a short running signature is compared with the signature of this session every frame (the same
+//                 bias); off by more than swapDistance for swapFrames frames in a row means someone else is measured
+//
+//  ParticipantIdentifier identity;
+//  identity.load("participants.csv");
+//  switch (identity.update(joints)) ...                      //every frame of the locked participant
+//  ...identity.participantId(), identity.swapped()...
+//  if (key == 'n') identity.confirmNew();                    //the operator's answer to Identity_Ambiguous
+#pragma once
+#include "SkeletonTypes.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#if defined(__SSE2__) || (defined(_MSC_VER) && (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)))
+#include <emmintrin.h>
+#define PARTICIPANT_IDENTITY_SSE2 1
+#endif
+
+//the bones table of "SKELETON Refined with joints smoothening.cpp", the first 20 of skeletonBones
+const int boneSignatureLength = 20;
+
+//reliability of each bone in the distance: the wrist-hand and ankle-foot bones count a quarter
+inline float boneSignatureWeight(int b) {
+    return b == 10 || b == 13 || b == 16 || b == 19 ? 0.25f : 1.0f;
+}
+
+struct BoneSignature {
+    alignas(16) float length[boneSignatureLength] = {};     //m
+    alignas(16) float weight[boneSignatureLength] = {};     //0 for a bone that was never measured
+};
+
+//mean bone lengths over the stable frames of one participant
+class BoneSignatureAccumulator {
+public:
+    int minSamples = 30;                //per bone, before the signature is ready
+    float maxFrameMotion = 0.05f;       //m of SpineBase between two frames, 1.5 m/s at 30 fps
+    float maxDeviation = 0.2f;          //fraction of the mean a bone sample may be off
+    float recentSmoothing = 0.1f;       //weight of a new sample in the recent signature
+
+    void reset() {
+        for (int b = 0; b < boneSignatureLength; ++b) {
+            sum[b] = 0.0;
+            samples[b] = 0;
+            recentLength[b] = 0.0f;
+            recentSeen[b] = false;
+        }
+        hasPrevious = false;
+        stableFrames = 0;
+    }
+
+    BoneSignatureAccumulator() { reset(); }
+
+    //one frame of the participant, true when it was stable
+    bool add(const Joint* joints) {
+        const Joint& root = joints[JointType_SpineBase];
+        bool stable = false;
+        if (root.TrackingState == TrackingState_Tracked) {
+            if (hasPrevious) {
+                float dx = root.Position.X - previousRoot.X, dy = root.Position.Y - previousRoot.Y, dz = root.Position.Z - previousRoot.Z;
+                stable = dx * dx + dy * dy + dz * dz <= maxFrameMotion * maxFrameMotion;
+            }
+            previousRoot = root.Position;
+            hasPrevious = true;
+        }
+        if (!stable) return false;
+
+        for (int b = 0; b < boneSignatureLength; ++b) {
+            const Joint& a = joints[skeletonBones[b][0]];
+            const Joint& c = joints[skeletonBones[b][1]];
+            if (a.TrackingState != TrackingState_Tracked || c.TrackingState != TrackingState_Tracked) continue;
+            float dx = a.Position.X - c.Position.X, dy = a.Position.Y - c.Position.Y, dz = a.Position.Z - c.Position.Z;
+            float length = std::sqrt(dx * dx + dy * dy + dz * dz);
+            //the recent signature takes every sample, a different person must move it even when their bones are far off
+            //the mean; only the mean rejects outliers
+            recentLength[b] = recentSeen[b] ? recentLength[b] + recentSmoothing * (length - recentLength[b]) : length;
+            recentSeen[b] = true;
+            if (samples[b] >= 5) {
+                float mean = static_cast<float>(sum[b] / samples[b]);
+                if (std::fabs(length - mean) > maxDeviation * mean) continue;
+            }
+            sum[b] += length;
+            ++samples[b];
+        }
+        ++stableFrames;
+        return true;
+    }
+
+    //every bone of full weight has minSamples samples
+    bool ready() const {
+        for (int b = 0; b < boneSignatureLength; ++b) {
+            if (boneSignatureWeight(b) == 1.0f && samples[b] < minSamples) return false;
+        }
+        return true;
+    }
+
+    //the mean over all stable frames
+    BoneSignature signature() const {
+        BoneSignature s;
+        for (int b = 0; b < boneSignatureLength; ++b) {
+            if (samples[b] == 0) continue;
+            s.length[b] = static_cast<float>(sum[b] / samples[b]);
+            s.weight[b] = boneSignatureWeight(b);
+        }
+        return s;
+    }
+
+    //the last second or so, to notice a different person
+    BoneSignature recent() const {
+        BoneSignature s;
+        for (int b = 0; b < boneSignatureLength; ++b) {
+            if (!recentSeen[b]) continue;
+            s.length[b] = recentLength[b];
+            s.weight[b] = boneSignatureWeight(b);
+        }
+        return s;
+    }
+
+    int frames() const { return stableFrames; }
+
+private:
+    double sum[boneSignatureLength];
+    int samples[boneSignatureLength];
+    float recentLength[boneSignatureLength];
+    bool recentSeen[boneSignatureLength];
+    CameraSpacePoint previousRoot = {};
+    bool hasPrevious = false;
+    int stableFrames = 0;
+};
+
+//weighted RMS difference (m) of two signatures over the bones both have
+inline float boneSignatureDistance(const BoneSignature& a, const float* enrolled) {
+#ifdef PARTICIPANT_IDENTITY_SSE2
+    __m128 total = _mm_setzero_ps(), weights = _mm_setzero_ps();
+    for (int b = 0; b < boneSignatureLength; b += 4) {
+        __m128 w = _mm_load_ps(a.weight + b);
+        __m128 d = _mm_sub_ps(_mm_load_ps(a.length + b), _mm_load_ps(enrolled + b));
+        total = _mm_add_ps(total, _mm_mul_ps(w, _mm_mul_ps(d, d)));
+        weights = _mm_add_ps(weights, w);
+    }
+    float t[4], w[4];
+    _mm_storeu_ps(t, total);
+    _mm_storeu_ps(w, weights);
+    float sumSquares = (t[0] + t[1]) + (t[2] + t[3]);
+    float sumWeights = (w[0] + w[1]) + (w[2] + w[3]);
+#else
+    float sumSquares = 0.0f, sumWeights = 0.0f;
+    for (int b = 0; b < boneSignatureLength; ++b) {
+        float d = a.length[b] - enrolled[b];
+        sumSquares += a.weight[b] * d * d;
+        sumWeights += a.weight[b];
+    }
+#endif
+    return sumWeights > 0.0f ? std::sqrt(sumSquares / sumWeights) : 1e9f;
+}
+
+//today's date as YYYYMMDD
+inline std::string participantDate() {
+    std::time_t now = std::time(nullptr);
+    std::tm local = {};
+#ifdef _WIN32
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    std::ostringstream date;
+    date << std::put_time(&local, "%Y%m%d");
+    return date.str();
+}
+
+//participants.csv.lock, held while the file is read again and a participant appended: several tests stay open all
+//day and enrol into the same file. A lock older than the wait is left by a test that crashed and is taken over
+class ParticipantFileLock {
+public:
+    explicit ParticipantFileLock(const std::string& file, int waitMilliseconds = 2000) : path(file + ".lock") {
+        for (int waited = 0; waited < waitMilliseconds && !held; waited += 20) {
+            held = create();
+            if (!held) std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        if (!held) {
+            std::cerr << "Taking over a stale participant lock: " << path << std::endl;
+            std::remove(path.c_str());
+            held = create();
+        }
+    }
+    ~ParticipantFileLock() {
+        if (held) std::remove(path.c_str());
+    }
+    ParticipantFileLock(const ParticipantFileLock&) = delete;
+    ParticipantFileLock& operator=(const ParticipantFileLock&) = delete;
+
+    bool locked() const { return held; }
+
+private:
+    //fails when another test holds the lock
+    bool create() const {
+        FILE* file = nullptr;
+#ifdef _WIN32
+        if (fopen_s(&file, path.c_str(), "wx") != 0) file = nullptr;
+#else
+        file = std::fopen(path.c_str(), "wx");
+#endif
+        if (!file) return false;
+        std::fclose(file);
+        return true;
+    }
+
+    std::string path;
+    bool held = false;
+};
+
+//signatures enrolled today, nearest neighbour by a scan of the packed lengths
+class ParticipantRegistry {
+public:
+    static const int capacity = 64;     //participants in a day
+
+    //today's rows of the file, the others are kept in it but not matched; false when there is no file yet
+    bool load(const std::string& file, const std::string& date = participantDate()) {
+        filename = file;
+        today = date;
+        count = 0;
+        highest = 0;
+        return reload();
+    }
+
+    //today's rows again, with those other tests enrolled since; the rows only grow, so the indices stay valid
+    bool reload() {
+        if (filename.empty()) return false;
+        int rows = 0;
+        std::ifstream infile(filename);
+        if (!infile.is_open()) return false;
+        std::string line;
+        std::getline(infile, line); //header
+        while (std::getline(infile, line) && rows < capacity) {
+            std::stringstream ss(line);
+            std::string rowDate, id, value;
+            if (!std::getline(ss, rowDate, ',') || !std::getline(ss, id, ',') || rowDate != today) continue;
+            bool complete = true;
+            for (int b = 0; b < boneSignatureLength && complete; ++b) {
+                try {
+                    complete = static_cast<bool>(std::getline(ss, value, ','));
+                    if (complete) lengths[rows][b] = std::stof(value);
+                }
+                catch (const std::exception&) {
+                    complete = false;
+                }
+            }
+            if (!complete) {
+                std::cerr << "Unreadable participant signature: " << line << std::endl;
+                continue;
+            }
+            ids[rows] = id;
+            highest = std::max(highest, idNumber(id));
+            ++rows;
+        }
+        count = std::max(count, rows);
+        return true;
+    }
+
+    //a new participant under the next ID of the day, appended to the file. Under the file lock the file is read again
+    //and the number follows the highest ID in it, so tests open side by side never hand out the same ID; false when
+    //the day is full, the file cannot be locked, or someone enrolled meanwhile is within refuseDistance (m RMS)
+    bool enroll(const BoneSignature& signature, std::string& id, float refuseDistance = 0.0f) {
+        if (filename.empty()) return append(signature, id, refuseDistance);
+        ParticipantFileLock lock(filename);
+        if (!lock.locked()) {
+            std::cerr << "Error: Could not lock " << filename << ", participant not enrolled.\n";
+            return false;
+        }
+        reload();
+        if (!append(signature, id, refuseDistance)) return false;
+
+        bool header = !std::ifstream(filename).good();
+        std::ofstream outfile(filename, std::ios::app);
+        if (!outfile) {
+            std::cerr << "Error: Could not open file for writing.\n";
+            return true;
+        }
+        if (header) {
+            outfile << "Date,Participant";
+            for (int b = 0; b < boneSignatureLength; ++b) outfile << ",Bone " << b + 1 << " (m)";
+            outfile << "\n";
+        }
+        outfile << today << "," << id << std::fixed << std::setprecision(4);
+        for (int b = 0; b < boneSignatureLength; ++b) outfile << "," << signature.length[b];
+        outfile << "\n";
+        return true;
+    }
+
+    //the enrolled participant nearest to the signature, -1 when none is enrolled; secondDistance to the next nearest
+    int nearest(const BoneSignature& signature, float& distance, float& secondDistance) const {
+        int best = -1;
+        distance = secondDistance = 1e9f;
+        for (int p = 0; p < count; ++p) {
+            float d = boneSignatureDistance(signature, lengths[p]);
+            if (d < distance) {
+                secondDistance = distance;
+                distance = d;
+                best = p;
+            }
+            else if (d < secondDistance) {
+                secondDistance = d;
+            }
+        }
+        return best;
+    }
+
+    int nearest(const BoneSignature& signature, float& distance) const {
+        float secondDistance;
+        return nearest(signature, distance, secondDistance);
+    }
+
+    float distanceTo(const BoneSignature& signature, int p) const { return boneSignatureDistance(signature, lengths[p]); }
+
+    int size() const { return count; }
+    const std::string& id(int p) const { return ids[p]; }
+
+private:
+    //the number after the date, 0 when there is none
+    static int idNumber(const std::string& id) {
+        size_t dash = id.rfind('-');
+        return dash == std::string::npos ? 0 : std::atoi(id.c_str() + dash + 1);
+    }
+
+    //into memory under the number after the highest of the day
+    bool append(const BoneSignature& signature, std::string& id, float refuseDistance) {
+        if (count >= capacity) return false;
+        float distance;
+        if (refuseDistance > 0.0f && nearest(signature, distance) >= 0 && distance <= refuseDistance) return false;
+        std::ostringstream next;
+        next << today << "-" << std::setw(2) << std::setfill('0') << highest + 1;
+        id = next.str();
+        for (int b = 0; b < boneSignatureLength; ++b) lengths[count][b] = signature.length[b];
+        ids[count] = id;
+        ++count;
+        ++highest;
+        return true;
+    }
+
+    alignas(16) float lengths[capacity][boneSignatureLength];
+    std::string ids[capacity];
+    int count = 0;
+    int highest = 0;                    //number of the highest ID of the day
+    std::string filename;
+    std::string today = participantDate();
+};
+
+enum IdentityEvent {
+    Identity_None = 0,
+    Identity_Matched,                   //participantId() is an enrolled participant
+    Identity_Enrolled,                  //participantId() is new, written to the file
+    Identity_Ambiguous,                 //near ambiguousWith() but not clearly the same participant: unidentified until the
+                                        //operator confirms them (confirmCandidate) or enrols them as new (confirmNew)
+    Identity_Swapped                    //the skeleton stopped matching the one identified (or left unidentified)
+};
+
+//the participant of one test: matched, enrolled or left ambiguous once the signature is ready, then watched for a swap
+class ParticipantIdentifier {
+public:
+    ParticipantRegistry registry;
+    BoneSignatureAccumulator accumulator;
+    float matchDistance = 0.02f;        //m RMS, nearer can be the same participant in another session (joint bias)
+    float matchRatio = 0.6f;            //the nearest at most this fraction of the second nearest, else ambiguous
+    float enrollDistance = 0.04f;       //m RMS, a new participant is enrolled without asking only this far from everybody
+    float swapDistance = 0.025f;        //m RMS, farther from this session's signature is someone else, a swap
+    int swapFrames = 30;
+
+    bool load(const std::string& filename) { return registry.load(filename); }
+
+    //a new trial, the participant is identified again
+    void reset() {
+        accumulator.reset();
+        participant = -1;
+        candidate = -1;
+        decided = false;
+        lastDistance = 0.0f;
+        offFrames = 0;
+        isSwapped = false;
+    }
+
+    IdentityEvent update(const Joint* joints) {
+        if (!accumulator.add(joints)) return Identity_None;
+        if (!decided) {
+            if (!accumulator.ready()) return Identity_None;
+            sessionSignature = accumulator.signature();
+            decided = true;
+            //matched when clearly nearest to one participant, enrolled when far from all of them, the participants
+            //other tests enrolled since included; in between the sensor's bias makes it impossible to tell, the
+            //operator is asked and the result records stay unlinked until they answer
+            registry.reload();
+            float secondDistance;
+            int nearest = registry.nearest(sessionSignature, lastDistance, secondDistance);
+            if (nearest >= 0 && lastDistance <= matchDistance && lastDistance <= matchRatio * secondDistance) {
+                participant = nearest;
+                return Identity_Matched;
+            }
+            std::string id;
+            if ((nearest < 0 || lastDistance > enrollDistance) && registry.enroll(sessionSignature, id, enrollDistance)) {
+                participant = registry.size() - 1;
+                lastDistance = 0.0f;
+                return Identity_Enrolled;
+            }
+            //refused by the registry too when another test enrolled someone near meanwhile
+            candidate = registry.nearest(sessionSignature, lastDistance);
+            return candidate >= 0 ? Identity_Ambiguous : Identity_None;
+        }
+        if (isSwapped) return Identity_None;
+        float distance = boneSignatureDistance(accumulator.recent(), sessionSignature.length);
+        offFrames = distance > swapDistance ? offFrames + 1 : 0;
+        if (offFrames >= swapFrames) {
+            isSwapped = true;
+            return Identity_Swapped;
+        }
+        return Identity_None;
+    }
+
+    //the operator's answer for an ambiguous participant: a new participant, enrolled without the distance check
+    bool confirmNew() {
+        if (!awaitingConfirmation()) return false;
+        std::string id;
+        if (!registry.enroll(sessionSignature, id)) return false;
+        participant = registry.size() - 1;
+        candidate = -1;
+        lastDistance = 0.0f;
+        return true;
+    }
+
+    //the operator's answer for an ambiguous participant: the same as ambiguousWith()
+    bool confirmCandidate() {
+        if (!awaitingConfirmation()) return false;
+        participant = candidate;
+        candidate = -1;
+        return true;
+    }
+
+    //left unidentified near someone, until confirmNew or confirmCandidate
+    bool awaitingConfirmation() const { return decided && participant < 0 && candidate >= 0; }
+
+    bool identified() const { return participant >= 0; }
+    //"" until identified
+    const char* participantId() const { return participant >= 0 ? registry.id(participant).c_str() : ""; }
+    float matchedDistance() const { return lastDistance; }
+    //the nearest participant of an ambiguous signature, "" otherwise
+    const char* ambiguousWith() const { return candidate >= 0 ? registry.id(candidate).c_str() : ""; }
+    bool swapped() const { return isSwapped; }
+
+    //the enrolled participant the recent frames look like, "" when none is clearly nearest
+    const char* recentMatch() const {
+        float distance, secondDistance;
+        int p = registry.nearest(accumulator.recent(), distance, secondDistance);
+        return p >= 0 && distance <= matchDistance && distance <= matchRatio * secondDistance ? registry.id(p).c_str() : "";
+    }
+
+private:
+    int participant = -1;               //registry index, -1 until identified
+    int candidate = -1;                 //registry index of the nearest when ambiguous
+    bool decided = false;               //matched, enrolled or ambiguous
+    BoneSignature sessionSignature;     //the signature the decision was made on, the reference for a swap
+    float lastDistance = 0.0f;
+    int offFrames = 0;
+    bool isSwapped = false;
+};
+
+//the two columns every result record ends with: ",Participant,Swap" and the ID (NULL until identified) and Yes/No
+const char* const participantColumnsHeader = ",Participant,Swap";
+
+inline void writeParticipantColumns(std::ostream& out, const ParticipantIdentifier& identity) {
+    out << "," << (identity.identified() ? identity.participantId() : "NULL") << "," << (identity.swapped() ? "Yes" : "No");
+}
@@ -0,0 +1,180 @@
+//Compensatory movements during a Functional Reach trial
+//a reach does not count when the participant steps, lifts the heels or turns the trunk to get further. FRT only
+//looked at the right hand and elbow, so these trials were scored like any other. From the arms raised posture on,
+//the ankles, feet and shoulders are smoothed (tracked positions only, inferred ones carry three times the noise), their
+//mean over the first baselineFrames frames is the reference, and after that the detector flags
+//  step             an ankle or foot moved more than stepDistance on the floor plane (X, Z)
+//  heel rise        an ankle rose more than heelRise while its foot stayed below stepDistance
+//  trunk rotation   the shoulder line turned more than rotationDegrees about the vertical
+//for confirmFrames frames in a row. The flags stay set for the rest of the trial. Reads the joint array FRT already
+//has, a few dozen operations per frame.
+//
+//  CompensationDetector compensation;
+//  compensation.start();                                    //arms raised
+//  compensation.update(joints);                             //every body frame of the trial
+//  if (compensation.invalid()) ...compensationText(compensation.flags())...
+#pragma once
+#include "SkeletonTypes.h"
+#include "JointKinematics.h"
+#include <algorithm>
+#include <cmath>
+
+enum CompensationFlag {
+    Compensation_None = 0,
+    Compensation_Step = 1,
+    Compensation_HeelRise = 2,
+    Compensation_TrunkRotation = 4
+};
+
+//"Step, Heel Rise" for Compensation_Step | Compensation_HeelRise
+inline const char* compensationText(int flags) {
+    static const char* const texts[8] = { "None", "Step", "Heel Rise", "Step, Heel Rise", "Trunk Rotation",
+        "Step, Trunk Rotation", "Heel Rise, Trunk Rotation", "Step, Heel Rise, Trunk Rotation" };
+    return texts[flags & 7];
+}
+
+class CompensationDetector {
+public:
+    float smoothing = 0.4f;             //weight of a tracked joint's new position
+    float stepDistance = 0.08f;         //m
+    float heelRise = 0.03f;             //m
+    float rotationDegrees = 15.0f;
+    int confirmFrames = 3;
+    int baselineFrames = 10;
+
+    //largest values seen after the baseline, for the log
+    float maxFootShift = 0.0f;          //m
+    float maxHeelRise = 0.0f;           //m
+    float maxRotation = 0.0f;           //degrees
+
+    void reset() {
+        CompensationDetector fresh;
+        fresh.smoothing = smoothing;
+        fresh.stepDistance = stepDistance;
+        fresh.heelRise = heelRise;
+        fresh.rotationDegrees = rotationDegrees;
+        fresh.confirmFrames = confirmFrames;
+        fresh.baselineFrames = baselineFrames;
+        *this = fresh;
+    }
+
+    void start() {
+        reset();
+        isStarted = true;
+    }
+
+    //one body frame, the flags so far
+    int update(const Joint* joints) {
+        if (!isStarted) return flagsSeen;
+        for (int f = 0; f < trackedJointCount; ++f) smooth(f, joints[trackedJoint(f)]);
+        float rotation = 0.0f;
+        bool shouldersTracked = shoulderYaw(rotation);
+
+        if (frames < baselineFrames) {
+            for (int f = 0; f < footJointCount; ++f) {
+                if (!seen[f]) continue;
+                baseX[f] += position[f].X;
+                baseY[f] += position[f].Y;
+                baseZ[f] += position[f].Z;
+                ++baseCount[f];
+            }
+            if (shouldersTracked) {
+                //the yaw is averaged as a unit vector, it may sit near +-180
+                baseYawX += std::cos(rotation);
+                baseYawZ += std::sin(rotation);
+            }
+            if (++frames == baselineFrames) {
+                for (int f = 0; f < footJointCount; ++f) {
+                    if (baseCount[f] == 0) continue;
+                    baseX[f] /= baseCount[f];
+                    baseY[f] /= baseCount[f];
+                    baseZ[f] /= baseCount[f];
+                }
+                baseYaw = atan2Approx(baseYawZ, baseYawX);
+            }
+            return flagsSeen;
+        }
+
+        bool stepped = false, heelUp = false;
+        for (int side = 0; side < 2; ++side) {
+            bool footMoved = false;
+            for (int f = side * 2; f < side * 2 + 2; ++f) {
+                if (baseCount[f] == 0) continue;
+                float dx = position[f].X - baseX[f], dz = position[f].Z - baseZ[f];
+                float shift = std::sqrt(dx * dx + dz * dz);
+                maxFootShift = std::max(maxFootShift, shift);
+                if (shift > stepDistance) footMoved = true;
+            }
+            stepped = stepped || footMoved;
+            int ankle = side * 2;
+            if (baseCount[ankle] > 0) {
+                float rise = position[ankle].Y - baseY[ankle];
+                maxHeelRise = std::max(maxHeelRise, rise);
+                if (rise > heelRise && !footMoved) heelUp = true;
+            }
+        }
+
+        bool turned = false;
+        if (shouldersTracked && (baseYawX != 0.0f || baseYawZ != 0.0f)) {
+            float difference = std::fabs(rotation - baseYaw) * 57.2957795f;
+            if (difference > 180.0f) difference = 360.0f - difference;
+            maxRotation = std::max(maxRotation, difference);
+            turned = difference > rotationDegrees;
+        }
+
+        confirm(stepped, stepFrames, Compensation_Step);
+        confirm(heelUp, heelFrames, Compensation_HeelRise);
+        confirm(turned, rotationFrames, Compensation_TrunkRotation);
+        return flagsSeen;
+    }
+
+    int flags() const { return flagsSeen; }
+    bool invalid() const { return flagsSeen != Compensation_None; }
+
+private:
+    static const int footJointCount = 4;
+    static const int trackedJointCount = 6;
+    static const int shoulderLeft = 4, shoulderRight = 5;
+
+    //left ankle and foot, right ankle and foot, then the shoulders
+    static JointType trackedJoint(int f) {
+        static const JointType joints[trackedJointCount] = { JointType_AnkleLeft, JointType_FootLeft, JointType_AnkleRight,
+            JointType_FootRight, JointType_ShoulderLeft, JointType_ShoulderRight };
+        return joints[f];
+    }
+
+    bool isStarted = false;
+    int frames = 0;
+    float baseX[footJointCount] = {}, baseY[footJointCount] = {}, baseZ[footJointCount] = {};
+    int baseCount[footJointCount] = {};
+    float baseYawX = 0.0f, baseYawZ = 0.0f, baseYaw = 0.0f;
+    CameraSpacePoint position[trackedJointCount] = {};  //smoothed
+    bool seen[trackedJointCount] = {};  //tracked at least once since start()
+    int stepFrames = 0, heelFrames = 0, rotationFrames = 0;
+    int flagsSeen = Compensation_None;
+
+    //the first tracked position as it is, then exponential smoothing; other states keep the last position
+    void smooth(int f, const Joint& joint) {
+        if (joint.TrackingState != TrackingState_Tracked) return;
+        if (!seen[f]) {
+            position[f] = joint.Position;
+            seen[f] = true;
+            return;
+        }
+        position[f].X += smoothing * (joint.Position.X - position[f].X);
+        position[f].Y += smoothing * (joint.Position.Y - position[f].Y);
+        position[f].Z += smoothing * (joint.Position.Z - position[f].Z);
+    }
+
+    //direction of the smoothed shoulder line on the floor plane (radians), false until both shoulders were tracked
+    bool shoulderYaw(float& yaw) const {
+        if (!seen[shoulderLeft] || !seen[shoulderRight]) return false;
+        yaw = atan2Approx(position[shoulderRight].Z - position[shoulderLeft].Z, position[shoulderRight].X - position[shoulderLeft].X);
+        return true;
+    }
+
+    void confirm(bool seen, int& run, CompensationFlag flag) {
+        run = seen ? run + 1 : 0;
+        if (run >= confirmFrames) flagsSeen |= flag;
+    }
+};
@@ -0,0 +1,149 @@
+//Functional Reach trajectory and peak
+//FRT took the reach as the X travel of the right hand and elbow, and called the maximum reached once the elbow was
+//5 cm short of its maximum on a single frame. Here the filtered hand, wrist and elbow of every frame from the arms
+//raised posture on go into a fixed ring, and the reach is their travel along the direction the arms pointed when raised
+//(shoulder to hand, horizontal), so drifting sideways or towards the sensor does not count. The reach is the mean of
+//the three joints weighted by their tracking, its speed the slope over the last few frames. The peak detector has
+//hysteresis: it arms once the reach rises, follows the maximum, and confirms the peak only when the reach is back by
+//dropDistance and still moving back, so a noisy frame or a pause at the far point does not end the reach. No clocks
+//and no randomness, a replayed session gives the same peak every run (Benchmarks/ReachPeakReplay.cpp).
+//
+//  ReachTrajectory reach;
+//  reach.start(joints, bodyFrame.relativeTime * 1e-7);       //arms raised
+//  reach.add(joints, bodyFrame.relativeTime * 1e-7);         //every body frame after that
+//  if (reach.peakFound()) ...reach.peakReach()...            //m
+#pragma once
+#include "SkeletonTypes.h"
+#include "JointKinematics.h"
+#include <algorithm>
+#include <cmath>
+
+struct ReachSample {
+    double time = 0.0;                  //s
+    CameraSpacePoint hand, wrist, elbow;    //filtered
+    float reach = 0.0f;                 //m along the initial forward direction
+    float speed = 0.0f;                 //m/s, positive reaching out
+};
+
+class ReachTrajectory {
+public:
+    static const int capacity = 1024;   //34 s at 30 fps, a trial is about 10 s
+
+    float smoothing = 0.4f;             //weight of a tracked joint's new position, inferred joints get half
+    int slopeFrames = 4;                //speed over this many frames
+    float minReach = 0.05f;             //m, a smaller peak is not a reach
+    float riseSpeed = 0.05f;            //m/s that arms the detector
+    float dropDistance = 0.03f;         //m back from the peak
+    float returnSpeed = 0.05f;          //m/s back towards the body
+
+    void reset() {
+        count = 0;
+        head = 0;
+        isStarted = false;
+        isRising = false;
+        isPeakFound = false;
+        peak = ReachSample();
+    }
+
+    //the arms raised posture, its hand, wrist and elbow are the origin of the reach
+    void start(const Joint* joints, double time) {
+        reset();
+        const JointType side[] = { JointType_HandRight, JointType_WristRight, JointType_ElbowRight };
+        for (int j = 0; j < 3; ++j) origin[j] = joints[side[j]].Position;
+
+        //forward is where the arm points, horizontal; from the elbow if the shoulder is not there
+        const CameraSpacePoint& hand = joints[JointType_HandRight].Position;
+        const CameraSpacePoint& root = jointTrackingWeight(joints[JointType_ShoulderRight]) > 0.0f ?
+            joints[JointType_ShoulderRight].Position : joints[JointType_ElbowRight].Position;
+        float dx = hand.X - root.X, dz = hand.Z - root.Z;
+        float length = std::sqrt(dx * dx + dz * dz);
+        if (length < 0.1f) {
+            dx = hand.X >= joints[JointType_ElbowRight].Position.X ? 1.0f : -1.0f;
+            dz = 0.0f;
+            length = 1.0f;
+        }
+        forwardX = dx / length;
+        forwardZ = dz / length;
+
+        ReachSample first;
+        first.time = time;
+        first.hand = origin[0];
+        first.wrist = origin[1];
+        first.elbow = origin[2];
+        push(first);
+        isStarted = true;
+    }
+
+    //one body frame, true once the peak is found
+    bool add(const Joint* joints, double time) {
+        if (!isStarted) return false;
+        const ReachSample& last = sample(count - 1);
+        ReachSample next;
+        next.time = time;
+        next.hand = filtered(last.hand, joints[JointType_HandRight]);
+        next.wrist = filtered(last.wrist, joints[JointType_WristRight]);
+        next.elbow = filtered(last.elbow, joints[JointType_ElbowRight]);
+
+        const JointType side[] = { JointType_HandRight, JointType_WristRight, JointType_ElbowRight };
+        const CameraSpacePoint* points[] = { &next.hand, &next.wrist, &next.elbow };
+        float sum = 0.0f, weights = 0.0f;
+        for (int j = 0; j < 3; ++j) {
+            float w = jointTrackingWeight(joints[side[j]]);
+            sum += w * forwardDistance(points[j]->X - origin[j].X, points[j]->Z - origin[j].Z);
+            weights += w;
+        }
+        next.reach = weights > 0.0f ? sum / weights : last.reach;
+
+        int back = std::min(slopeFrames, count);
+        const ReachSample& before = sample(count - back);
+        double elapsed = time - before.time;
+        next.speed = elapsed > 0.0 ? static_cast<float>((next.reach - before.reach) / elapsed) : last.speed;
+        push(next);
+
+        if (!isPeakFound) {
+            if (!isRising && next.speed >= riseSpeed) isRising = true;
+            if (isRising && next.reach > peak.reach) peak = next;
+            if (isRising && peak.reach >= minReach && next.reach <= peak.reach - dropDistance && next.speed <= -returnSpeed) {
+                isPeakFound = true;
+            }
+        }
+        return isPeakFound;
+    }
+
+    //travel (m) along the forward direction of a horizontal displacement
+    float forwardDistance(float dx, float dz) const { return dx * forwardX + dz * forwardZ; }
+
+    bool started() const { return isStarted; }
+    bool peakFound() const { return isPeakFound; }
+    float peakReach() const { return peak.reach; }      //the largest reach so far until the peak is found
+    double peakTime() const { return peak.time; }
+    float reach() const { return count ? sample(count - 1).reach : 0.0f; }
+
+    //the ring, 0 the oldest sample kept
+    int size() const { return count; }
+    const ReachSample& sample(int i) const { return ring[(head + capacity - count + i) % capacity]; }
+
+private:
+    ReachSample ring[capacity];
+    int count = 0;                      //samples in the ring
+    int head = 0;                       //slot of the next sample
+    bool isStarted = false, isRising = false, isPeakFound = false;
+    ReachSample peak;
+    CameraSpacePoint origin[3] = {};    //hand, wrist and elbow at start()
+    float forwardX = -1.0f, forwardZ = 0.0f;
+
+    void push(const ReachSample& s) {
+        ring[head] = s;
+        head = (head + 1) % capacity;
+        count = std::min(count + 1, capacity);
+    }
+
+    CameraSpacePoint filtered(const CameraSpacePoint& previous, const Joint& joint) const {
+        float a = smoothing * jointTrackingWeight(joint);
+        CameraSpacePoint p;
+        p.X = previous.X + a * (joint.Position.X - previous.X);
+        p.Y = previous.Y + a * (joint.Position.Y - previous.Y);
+        p.Z = previous.Z + a * (joint.Position.Z - previous.Z);
+        return p;
+    }
+};
@@ -0,0 +1,155 @@
+//Standing on one leg, timed for whichever foot is lifted first and then the other one
+//SOOLWEO asked for the right foot, then the left, and took the times from the steady clock on the frame the lift crossed
+//its threshold, so a participant who lifted the left foot first was never timed and every stance was off by up to a
+//frame at both ends. Here each leg has a small state machine, Down -> Lifted -> Timed, fed the foot lift of every body
+//frame with the frame time. Lift-off is where the lift crosses liftThreshold; the foot is down again once the lift falls
+//under the lower downThreshold (hysteresis, so noise at the threshold does not end the stance) and touch-down is its last
+//crossing of liftThreshold on the way, so both ends are timed at the same height. Crossings are interpolated linearly
+//between the two frames around them. A lift shorter than minStance is a stumble and the leg goes back to Down. Only one
+//leg can be Lifted at a time; once the first stance is timed the other leg is next, unless the first stance was longer
+//than maxStance, which completes the test on its own.
+//
+//  SingleLegStanceTimer stance;
+//  stance.start();                                                     //test ready
+//  switch (stance.update(leftLift, rightLift, bodyFrame.relativeTime * 1e-7)) ...  //every body frame, lifts in m
+//  ...stance.leg(Leg_Right).duration, stance.leg(Leg_Left).duration, stance.longest()...
+#pragma once
+#include <algorithm>
+
+enum StanceLeg {
+    Leg_Left = 0,
+    Leg_Right = 1
+};
+
+enum LegStancePhase {
+    Stance_Down = 0,                //on the floor, waiting for its turn or its lift
+    Stance_Lifted,                  //in the air, timing
+    Stance_Timed                    //back down, duration known
+};
+
+enum StanceEvent {
+    StanceEvent_None = 0,
+    StanceEvent_LiftOff,            //lastLeg() was lifted
+    StanceEvent_TouchDown,          //lastLeg() came back down, its stance is timed and the other leg is next
+    StanceEvent_Completed           //both stances timed, or the first one longer than maxStance
+};
+
+inline const char* stanceLegName(int leg) { return leg == Leg_Left ? "Left" : "Right"; }
+
+struct LegStance {
+    LegStancePhase phase = Stance_Down;
+    double liftOff = 0.0;           //s, interpolated
+    double touchDown = 0.0;         //s, interpolated
+    float duration = 0.0f;          //s, 0 until Timed
+};
+
+class SingleLegStanceTimer {
+public:
+    float liftThreshold = 0.10f;    //m of foot lift that starts a stance
+    float downThreshold = 0.07f;    //m the lift falls back under to end it
+    float minStance = 0.3f;         //s, shorter lifts are not a stance
+    float maxStance = 60.0f;        //s, a first stance longer than this is enough for the test
+
+    //a new trial, the settings are kept
+    void reset() {
+        for (int l = 0; l < 2; ++l) {
+            legs[l] = LegStance();
+            hasPrevious[l] = false;
+            downCrossing[l] = 0.0;
+        }
+        isStarted = false;
+        isCompleted = false;
+        first = -1;
+        last = -1;
+    }
+
+    void start() {
+        reset();
+        isStarted = true;
+    }
+
+    //one body frame, the lift (m) of each foot since the test got ready and the frame time (s)
+    StanceEvent update(float leftLift, float rightLift, double time) {
+        const float lifts[2] = { leftLift, rightLift };
+        StanceEvent event = StanceEvent_None;
+        if (isStarted && !isCompleted) {
+            for (int l = 0; l < 2; ++l) {
+                StanceEvent legEvent = step(l, lifts[l], time);
+                if (legEvent != StanceEvent_None) event = legEvent;
+            }
+        }
+        for (int l = 0; l < 2; ++l) {
+            previousLift[l] = lifts[l];
+            previousTime[l] = time;
+            hasPrevious[l] = true;
+        }
+        return event;
+    }
+
+    const LegStance& leg(int l) const { return legs[l]; }
+    bool started() const { return isStarted; }
+    bool completed() const { return isCompleted; }
+    int firstLeg() const { return first; }          //-1 until a stance is timed
+    int lastLeg() const { return last; }            //leg of the last event
+    int nextLeg() const { return first < 0 ? -1 : 1 - first; }
+    float longest() const { return std::max(legs[Leg_Left].duration, legs[Leg_Right].duration); }
+
+    //s in the air so far of the lifted leg, 0 when none is
+    float liftedTime(double time) const {
+        for (int l = 0; l < 2; ++l) {
+            if (legs[l].phase == Stance_Lifted) return static_cast<float>(time - legs[l].liftOff);
+        }
+        return 0.0f;
+    }
+
+private:
+    LegStance legs[2];
+    float previousLift[2] = {};
+    double previousTime[2] = {};
+    double downCrossing[2] = {};        //last time the lifted foot crossed liftThreshold downwards
+    bool hasPrevious[2] = {};
+    bool isStarted = false, isCompleted = false;
+    int first = -1, last = -1;
+
+    StanceEvent step(int l, float lift, double time) {
+        LegStance& stance = legs[l];
+        if (stance.phase == Stance_Down) {
+            //one leg at a time, and after the first stance only the other leg
+            if (legs[1 - l].phase == Stance_Lifted || (first >= 0 && l == first)) return StanceEvent_None;
+            if (lift <= liftThreshold) return StanceEvent_None;
+            stance.phase = Stance_Lifted;
+            stance.liftOff = crossing(l, lift, time, liftThreshold);
+            downCrossing[l] = time;
+            last = l;
+            return StanceEvent_LiftOff;
+        }
+        if (stance.phase != Stance_Lifted) return StanceEvent_None;
+        if (lift <= liftThreshold && previousLift[l] > liftThreshold) downCrossing[l] = crossing(l, lift, time, liftThreshold);
+        if (lift < downThreshold) {
+            double touchDown = downCrossing[l];
+            if (touchDown - stance.liftOff < minStance) {
+                stance = LegStance();
+                return StanceEvent_None;
+            }
+            stance.phase = Stance_Timed;
+            stance.touchDown = touchDown;
+            stance.duration = static_cast<float>(touchDown - stance.liftOff);
+            last = l;
+            if (first < 0) first = l;
+            if (legs[1 - l].phase == Stance_Timed || (l == first && stance.duration > maxStance)) {
+                isCompleted = true;
+                return StanceEvent_Completed;
+            }
+            return StanceEvent_TouchDown;
+        }
+        return StanceEvent_None;
+    }
+
+    //time the lift crossed the threshold between the previous frame and this one
+    double crossing(int l, float lift, double time, float threshold) const {
+        if (!hasPrevious[l] || lift == previousLift[l]) return time;
+        double k = (threshold - previousLift[l]) / static_cast<double>(lift - previousLift[l]);
+        k = std::min(1.0, std::max(0.0, k));
+        return previousTime[l] + k * (time - previousTime[l]);
+    }
+};
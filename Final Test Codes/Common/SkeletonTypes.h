@@ -0,0 +1,126 @@
+//Skeleton types of the Kinect SDK
+//on Windows this is Kinect.h itself, elsewhere (synthetic data, benchmarks) the same names and layout are declared here
+#pragma once
+
+#ifdef _WIN32
+#include <Kinect.h>
+#else
+#include <cstdint>
+
+typedef unsigned char BYTE;
+typedef unsigned int UINT;
+typedef uint16_t UINT16;
+typedef int64_t INT64;
+typedef uint64_t UINT64;
+typedef INT64 TIMESPAN;
+typedef unsigned char BOOLEAN;
+typedef long HRESULT;
+
+#ifndef S_OK
+#define S_OK ((HRESULT)0L)
+#endif
+
+#ifndef BODY_COUNT
+#define BODY_COUNT 6
+#endif
+
+enum _JointType {
+    JointType_SpineBase = 0,
+    JointType_SpineMid = 1,
+    JointType_Neck = 2,
+    JointType_Head = 3,
+    JointType_ShoulderLeft = 4,
+    JointType_ElbowLeft = 5,
+    JointType_WristLeft = 6,
+    JointType_HandLeft = 7,
+    JointType_ShoulderRight = 8,
+    JointType_ElbowRight = 9,
+    JointType_WristRight = 10,
+    JointType_HandRight = 11,
+    JointType_HipLeft = 12,
+    JointType_KneeLeft = 13,
+    JointType_AnkleLeft = 14,
+    JointType_FootLeft = 15,
+    JointType_HipRight = 16,
+    JointType_KneeRight = 17,
+    JointType_AnkleRight = 18,
+    JointType_FootRight = 19,
+    JointType_SpineShoulder = 20,
+    JointType_HandTipLeft = 21,
+    JointType_ThumbLeft = 22,
+    JointType_HandTipRight = 23,
+    JointType_ThumbRight = 24,
+    JointType_Count = 25
+};
+typedef enum _JointType JointType;
+
+enum _TrackingState {
+    TrackingState_NotTracked = 0,
+    TrackingState_Inferred = 1,
+    TrackingState_Tracked = 2
+};
+typedef enum _TrackingState TrackingState;
+
+typedef struct _CameraSpacePoint {
+    float X;
+    float Y;
+    float Z;
+} CameraSpacePoint;
+
+typedef struct _ColorSpacePoint {
+    float X;
+    float Y;
+} ColorSpacePoint;
+
+typedef struct _DepthSpacePoint {
+    float X;
+    float Y;
+} DepthSpacePoint;
+
+typedef struct _Vector4 {
+    float x;
+    float y;
+    float z;
+    float w;
+} Vector4;
+
+typedef struct _Joint {
+    enum _JointType JointType;
+    CameraSpacePoint Position;
+    enum _TrackingState TrackingState;
+} Joint;
+
+typedef struct _JointOrientation {
+    enum _JointType JointType;
+    Vector4 Orientation;
+} JointOrientation;
+#endif
+
+//pairs of joints drawn as the skeleton, the first 20 are the bones table of "SKELETON Refined with joints smoothening.cpp"
+static const JointType skeletonBones[][2] = {
+    { JointType_Head, JointType_Neck },
+    { JointType_Neck, JointType_SpineShoulder },
+    { JointType_SpineShoulder, JointType_SpineMid },
+    { JointType_SpineMid, JointType_SpineBase },
+    { JointType_SpineShoulder, JointType_ShoulderLeft },
+    { JointType_SpineShoulder, JointType_ShoulderRight },
+    { JointType_SpineBase, JointType_HipLeft },
+    { JointType_SpineBase, JointType_HipRight },
+    { JointType_ShoulderLeft, JointType_ElbowLeft },
+    { JointType_ElbowLeft, JointType_WristLeft },
+    { JointType_WristLeft, JointType_HandLeft },
+    { JointType_ShoulderRight, JointType_ElbowRight },
+    { JointType_ElbowRight, JointType_WristRight },
+    { JointType_WristRight, JointType_HandRight },
+    { JointType_HipLeft, JointType_KneeLeft },
+    { JointType_KneeLeft, JointType_AnkleLeft },
+    { JointType_AnkleLeft, JointType_FootLeft },
+    { JointType_HipRight, JointType_KneeRight },
+    { JointType_KneeRight, JointType_AnkleRight },
+    { JointType_AnkleRight, JointType_FootRight },
+    { JointType_HandLeft, JointType_HandTipLeft },
+    { JointType_WristLeft, JointType_ThumbLeft },
+    { JointType_HandRight, JointType_HandTipRight },
+    { JointType_WristRight, JointType_ThumbRight }
+};
+const int skeletonBoneCount = sizeof(skeletonBones) / sizeof(skeletonBones[0]);
@@ -0,0 +1,291 @@
+//Station profile: the depth gates of TUG and WS for one sensor placement
+//the tests compared SpineMid depth with fixed distances from the sensor, so moving the sensor 20 cm broke every
+//station. The gates are read from station_profile.csv at startup and written by the calibration mode of each test
+//(C in the window):
+//  TUG  the participant sits still on the chair for three seconds, the chair depth is the median SpineMid depth and
+//       every gate follows from it: seated and back at the chair around it, the turn-around 3 m in front of it
+//  WS   with the corridor empty, the cones or poles on the start and stop lines are found in the depth frame as objects
+//       standing on the fitted floor (FloorPlane.h); the start gate ends at the far marker, the stop gate at the near one
+//without a profile the gates are the distances the tests used before. The checks in the frame loop stay comparisons.
+//A calibration that has not completed `timeout` seconds after its first frame has failed, the test tells the operator
+//and keeps the gates it had.
+//
+//  StationProfile station;
+//  station.load("station_profile.csv");
+//  if (station.wsStart.contains(depth)) ...
+#pragma once
+#include "SkeletonTypes.h"
+#include "DepthPointCloud.h"
+#include "FloorPlane.h"
+#include "FrameArena.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//SpineMid depth range (m)
+struct DepthGate {
+    float low = 0.0f, high = 0.0f;
+
+    bool contains(float depth) const { return depth >= low && depth <= high; }
+};
+
+struct StationProfile {
+    DepthGate tugSeated{ 4.3f, 4.5f };     //participant on the chair, test ready
+    DepthGate tugTurn{ 1.3f, 1.5f };       //turn-around target reached
+    DepthGate tugReturn{ 4.2f, 4.5f };     //back at the chair, timer stops
+    DepthGate wsStart{ 6.5f, 6.8f };       //timer starts
+    DepthGate wsStop{ 1.5f, 1.6f };        //timer stops
+
+    //TUG gates around the SpineMid depth of the seated participant, 4.4 m gives the defaults
+    void setChairDepth(float chair) {
+        tugSeated = DepthGate{ chair - 0.1f, chair + 0.1f };
+        tugTurn = DepthGate{ chair - 3.1f, chair - 2.9f };
+        tugReturn = DepthGate{ chair - 0.2f, chair + 0.1f };
+    }
+
+    //WS gates ending at the start (far) and stop (near) markers, 6.8 m and 1.6 m give the defaults
+    void setCorridorMarkers(float nearMarker, float farMarker) {
+        wsStart = DepthGate{ farMarker - 0.3f, farMarker };
+        wsStop = DepthGate{ nearMarker - 0.1f, nearMarker };
+    }
+
+    //keeps the defaults (or the gates read so far) when the file is missing or a line is not understood
+    bool load(const std::string& filename) {
+        std::ifstream infile(filename);
+        if (!infile.is_open()) {
+            std::cerr << "Station profile not found: " << filename << ", using the default gates" << std::endl;
+            return false;
+        }
+        std::string line;
+        std::getline(infile, line); //header
+        while (std::getline(infile, line)) {
+            std::stringstream ss(line);
+            std::string name, low, high;
+            if (!std::getline(ss, name, ',') || !std::getline(ss, low, ',') || !std::getline(ss, high, ',')) continue;
+            DepthGate* gate = gateNamed(name);
+            if (!gate) {
+                std::cerr << "Unknown gate in station profile: " << name << std::endl;
+                continue;
+            }
+            try {
+                DepthGate read{ std::stof(low), std::stof(high) };
+                if (read.low < read.high) *gate = read;
+            }
+            catch (const std::exception&) {
+                std::cerr << "Unreadable gate in station profile: " << line << std::endl;
+            }
+        }
+        return true;
+    }
+
+    bool save(const std::string& filename) const {
+        std::ofstream outfile(filename, std::ios::trunc);
+        if (!outfile) {
+            std::cerr << "Error: Could not open file for writing.\n";
+            return false;
+        }
+        outfile << "Gate,Low (m),High (m)\n";
+        outfile << std::fixed << std::setprecision(3);
+        for (int g = 0; g < gateCount; ++g) {
+            outfile << gateName(g) << "," << gate(g).low << "," << gate(g).high << "\n";
+        }
+        return static_cast<bool>(outfile);
+    }
+
+private:
+    static const int gateCount = 5;
+
+    //the gates in file order
+    static const char* gateName(int g) {
+        static const char* const names[gateCount] = { "TUG Seated", "TUG Turn", "TUG Return", "WS Start", "WS Stop" };
+        return names[g];
+    }
+
+    const DepthGate& gate(int g) const {
+        const DepthGate* gates[gateCount] = { &tugSeated, &tugTurn, &tugReturn, &wsStart, &wsStop };
+        return *gates[g];
+    }
+
+    DepthGate* gateNamed(const std::string& name) {
+        DepthGate* gates[gateCount] = { &tugSeated, &tugTurn, &tugReturn, &wsStart, &wsStop };
+        for (int g = 0; g < gateCount; ++g) {
+            if (name == gateName(g)) return gates[g];
+        }
+        return nullptr;
+    }
+};
+
+//TUG: SpineMid depth of the seated participant, the median of `frames` consecutive seated frames that agree
+//the frames agree when their median absolute deviation from the median is within maxDeviation: a still participant
+//passes with joint noise of 2 cm and more, one who shifts on the chair does not, and a few outlying frames do not
+//decide it as they did with the nearest and farthest frame
+class SeatedCalibration {
+public:
+    static const int frames = 90;       //3 s at 30 fps
+    float maxDeviation = 0.025f;        //m, median absolute deviation of those frames
+    double timeout = 20.0;              //s from the first frame of the attempt
+
+    //C in the window: a new attempt
+    void begin() {
+        reset();
+        startTime = -1.0;
+    }
+
+    //the participant is not seated: the frames start again, the attempt and its timeout go on
+    void reset() { depths.clear(); }
+
+    //SpineMid depth of a frame in which the participant sits, reset() when they do not; true once calibrated
+    bool add(float depth) {
+        depths.push(depth);
+        return done();
+    }
+
+    bool done() const { return depths.full() && deviation() <= maxDeviation; }
+
+    //every frame of the attempt, seated or not, now is the sensor time of the frame (s); true once the attempt ran
+    //`timeout` seconds without completing
+    bool timedOut(double now) {
+        if (startTime < 0.0) startTime = now;
+        return !done() && now - startTime > timeout;
+    }
+
+    //0..1, for the overlay
+    float progress() const { return static_cast<float>(depths.size()) / frames; }
+
+    float chairDepth() const {
+        for (size_t i = 0; i < depths.size(); ++i) scratch[i] = depths[i];
+        return median(depths.size());
+    }
+
+    //median absolute deviation of the frames from their median (m)
+    float deviation() const {
+        float center = chairDepth();
+        for (size_t i = 0; i < depths.size(); ++i) scratch[i] = std::fabs(depths[i] - center);
+        return median(depths.size());
+    }
+
+private:
+    FrameRing<float, frames> depths;
+    mutable float scratch[frames];
+    double startTime = -1.0;
+
+    //median of the first n values of scratch, reordered
+    float median(size_t n) const {
+        if (n == 0) return 0.0f;
+        std::nth_element(scratch, scratch + n / 2, scratch + n);
+        return scratch[n / 2];
+    }
+};
+
+//WS: depths of the start and stop markers in the empty corridor
+//every depth frame becomes camera space points; points between minHeight and maxHeight above the floor and within
+//corridorHalfWidth of the optical axis go into 5 cm depth bins. After `frames` frames the runs of bins with at least
+//minPoints points per frame are the objects in the corridor; one wider than maxMarkerWidth is a wall, not a marker.
+//The nearest and the farthest object are the stop and start markers, their depth the mean of their points.
+class CorridorMarkerCalibration {
+public:
+    int frames = 30;
+    double timeout = 20.0;              //s from the first frame of the attempt, for finding the floor and adding the frames
+    float minDepth = 0.5f, maxDepth = 8.0f;     //m
+    float corridorHalfWidth = 1.0f;     //m
+    float minHeight = 0.08f;            //m above the floor, the floor itself stays below this
+    float maxHeight = 1.5f;             //m
+    float minPoints = 8.0f;             //per bin and frame
+    float maxMarkerWidth = 1.5f;        //m, a pair of cones either side of the walking line fits
+    float minSeparation = 2.0f;         //m between the stop and start markers
+    FloorPlaneFitter floorFitter;       //floorFitter.rays from the coordinate mapper when there is one
+
+    CorridorMarkerCalibration() { reset(); }
+
+    //C in the window: a new attempt
+    void begin() {
+        reset();
+        startTime = -1.0;
+    }
+
+    //every frame of the attempt, now is the sensor time of the frame (s); true once the attempt ran `timeout` seconds
+    //without adding all its frames
+    bool timedOut(double now) {
+        if (startTime < 0.0) startTime = now;
+        return framesAdded < frames && now - startTime > timeout;
+    }
+
+    void reset() {
+        framesAdded = 0;
+        floor = FloorPlane();
+        bins.assign(binCount(), Bin());
+    }
+
+    //one 512x424 depth frame (mm) of the empty corridor, true once `frames` frames were added
+    //frames before the floor was found are not counted
+    bool add(const UINT16* depth) {
+        if (framesAdded >= frames) return true;
+        if (!floor.valid && !floorFitter.fit(depth, floor)) return false;
+
+        depthToPoints(depth, floorFitter.rays, cloud);
+        for (int i = 0; i < cloud.count; ++i) {
+            float z = cloud.z[i];
+            if (z < minDepth || z >= maxDepth || std::fabs(cloud.x[i]) > corridorHalfWidth) continue;
+            CameraSpacePoint p = { cloud.x[i], cloud.y[i], z };
+            float height = floor.height(p);
+            if (height < minHeight || height > maxHeight) continue;
+            Bin& bin = bins[static_cast<int>((z - minDepth) / binSize)];
+            if (bin.points == 0) bin.minX = bin.maxX = p.X;
+            bin.minX = std::min(bin.minX, p.X);
+            bin.maxX = std::max(bin.maxX, p.X);
+            bin.sumZ += z;
+            ++bin.points;
+        }
+        return ++framesAdded >= frames;
+    }
+
+    bool floorFound() const { return floor.valid; }
+    float progress() const { return static_cast<float>(framesAdded) / frames; }
+
+    //depth of the stop (near) and start (far) markers, false when two markers minSeparation apart were not found
+    bool markers(float& nearMarker, float& farMarker) const {
+        if (framesAdded == 0) return false;
+        std::vector<float> found;
+        const double occupied = minPoints * framesAdded;
+        for (int b = 0; b < binCount();) {
+            if (bins[b].points < occupied) {
+                ++b;
+                continue;
+            }
+            Bin object = bins[b];
+            for (++b; b < binCount() && bins[b].points >= occupied; ++b) {
+                object.minX = std::min(object.minX, bins[b].minX);
+                object.maxX = std::max(object.maxX, bins[b].maxX);
+                object.sumZ += bins[b].sumZ;
+                object.points += bins[b].points;
+            }
+            if (object.maxX - object.minX <= maxMarkerWidth) found.push_back(static_cast<float>(object.sumZ / object.points));
+        }
+        if (found.size() < 2 || found.back() - found.front() < minSeparation) return false;
+        nearMarker = found.front();
+        farMarker = found.back();
+        return true;
+    }
+
+private:
+    static constexpr float binSize = 0.05f;
+
+    struct Bin {
+        long points = 0;
+        double sumZ = 0.0;
+        float minX = 0.0f, maxX = 0.0f;
+    };
+
+    int framesAdded = 0;
+    double startTime = -1.0;
+    FloorPlane floor;
+    DepthPointCloud cloud;
+    std::vector<Bin> bins;
+
+    int binCount() const { return static_cast<int>(std::ceil((maxDepth - minDepth) / binSize)); }
+};
@@ -0,0 +1,585 @@
+//Deterministic synthetic skeleton (and optional depth) streams for benchmarking and regression testing
+//without a participant or a sensor. The same parameters and seed always produce the same frames, on any compiler.
+//
+//  SyntheticParams params;
+//  params.scenario = Scenario_TimedUpGo;
+//  params.seed = 42;
+//  SyntheticMotionGenerator generator(params);
+//  SyntheticFrame frame;
+//  while (generator.next(frame)) { ... frame.bodies[i].joints ... }
+#pragma once
+#include "SkeletonTypes.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+enum SyntheticScenario {
+    Scenario_TimedUpGo = 0,        //sit, stand, walk 3 m, turn, walk back, turn, sit
+    Scenario_WalkingSpeed,         //straight walk from 7 m to 1 m
+    Scenario_FunctionalReach,      //side view, arms raised then forward reach and return
+    Scenario_SeatedForwardBend,    //side view, seated on the floor, bend forward and return
+    Scenario_SingleLegStance,      //facing the sensor, right foot then left foot lifted with sway
+    Scenario_Count
+};
+
+enum SyntheticIntrusion {
+    Intrusion_None = 0,
+    Intrusion_Bystander,           //a second person walks across the scene behind the participant
+    Intrusion_Assistant            //a second person stands next to the participant
+};
+
+struct SyntheticParams {
+    SyntheticScenario scenario = Scenario_TimedUpGo;
+    uint64_t seed = 1;
+    UINT64 trackingId = 72057594037927936ULL;
+
+    float cameraHeight = 0.55f;    //sensor height above the floor (m)
+    float jointNoise = 0.005f;     //standard deviation of the joint position noise (m)
+    float inferredRate = 0.0f;     //per joint and frame, joint reported as Inferred with three times the noise
+    float notTrackedRate = 0.0f;   //per joint and frame, joint reported as NotTracked
+    float dropoutRate = 0.0f;      //per frame, the body frame is not available
+
+    float walkSpeed = 1.0f;        //TUG and WS cruise speed (m/s)
+    float walkOffset = 0.0f;       //WS walking line to the side of the optical axis (m)
+    float chairDepth = 4.4f;       //TUG chair distance from the sensor (m)
+    float turnDepth = 1.4f;        //TUG turn-around distance from the sensor (m)
+    float seatedDuration = 2.0f;   //TUG time seated before standing up (s), the chair calibration needs 3
+    float reachDistance = 0.30f;   //FRT and SFB forward reach of the hands (m)
+    float stanceDuration = 10.0f;  //SOOLWEO time each foot is lifted (s)
+    float sway = 0.015f;           //SOOLWEO sway amplitude (m)
+    float bodyScale = 1.0f;        //participant size, the whole skeleton scaled about the floor under SpineBase
+    float armScale = 1.0f;         //upper arm and forearm length on top of bodyScale
+    float jointBias = 0.0f;        //per session constant offset of each joint (m per axis), the pose dependent bias
+                                   //of the sensor's joint positions; it changes the bone lengths differently per pose
+
+    SyntheticIntrusion intrusion = Intrusion_None;
+    float intrusionStart = 3.0f;   //seconds into the session
+    float intrusionDuration = 3.0f;
+};
+
+struct SyntheticBody {
+    UINT64 trackingId;
+    bool isTracked;
+    Joint joints[JointType_Count];
+};
+
+struct SyntheticFrame {
+    int frameIndex;
+    INT64 relativeTime;            //100 ns ticks, like IBodyFrame::get_RelativeTime
+    bool bodyFrameAvailable;       //false when the frame is dropped (AcquireLatestFrame fails)
+    int participantIndex;          //slot of the participant in bodies[]
+    SyntheticBody bodies[BODY_COUNT];
+};
+
+//body pose driving the forward kinematics, angles in radians, index 0 is left and 1 is right
+struct SyntheticPose {
+    float rootX = 0.0f, rootZ = 2.5f;  //SpineBase position on the floor plane, camera space
+    float rootHeight = 0.97f;          //SpineBase height above the floor
+    float heading = 0.0f;              //0 faces the sensor, pi/2 faces camera +X
+    float trunkPitch = 0.0f;           //forward lean
+    float hipFlex[2] = { 0.0f, 0.0f };
+    float kneeFlex[2] = { 0.0f, 0.0f };
+    float shoulderFlex[2] = { 0.0f, 0.0f };    //0 arm hanging down, pi/2 arm forward
+    float elbowFlex[2] = { 0.0f, 0.0f };
+};
+
+//xorshift64*, identical on every platform unlike the std distributions
+struct SyntheticRandom {
+    uint64_t state = 1;
+
+    void seed(uint64_t s) {
+        state = (s + 1) * 0x9E3779B97F4A7C15ULL;
+        if (state == 0) state = 1;
+    }
+
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1DULL;
+    }
+
+    float uniform() {
+        return (next() >> 40) * (1.0f / 16777216.0f);
+    }
+
+    //Irwin-Hall sum of four uniforms scaled to unit variance, cheap and close enough to a normal for noise
+    float normal() {
+        return (uniform() + uniform() + uniform() + uniform() - 2.0f) * 1.7320508f;
+    }
+};
+
+class SyntheticMotionGenerator {
+public:
+    static const INT64 frameTicks = 333333;        //30 fps
+    static const int depthWidth = 512;
+    static const int depthHeight = 424;
+
+    SyntheticMotionGenerator() { reset(SyntheticParams()); }
+    explicit SyntheticMotionGenerator(const SyntheticParams& p) { reset(p); }
+
+    void reset(const SyntheticParams& p) {
+        params = p;
+        random.seed(p.seed);
+        frameIndex = 0;
+        participantSlot = static_cast<int>(random.next() % BODY_COUNT);
+        intruderSlot = (participantSlot + 1 + static_cast<int>(random.next() % (BODY_COUNT - 1))) % BODY_COUNT;
+        intruderId = p.trackingId + 1 + (random.next() & 0xFFFF);
+        sessionSeconds = scenarioDuration();
+
+        //drawn from their own stream, the other frames of a seed stay the same with or without bias
+        SyntheticRandom biasRandom;
+        biasRandom.seed(p.seed ^ 0x5EB1A5ULL);
+        for (int j = 0; j < JointType_Count; ++j) {
+            bias[j].X = p.jointBias * biasRandom.normal();
+            bias[j].Y = p.jointBias * biasRandom.normal();
+            bias[j].Z = p.jointBias * biasRandom.normal();
+        }
+    }
+
+    //length of the session in seconds
+    float duration() const { return sessionSeconds; }
+    int frameCount() const { return static_cast<int>(sessionSeconds * 30.0f) + 1; }
+
+    //fills the next frame, returns false once the scenario has finished
+    bool next(SyntheticFrame& frame) {
+        if (frameIndex >= frameCount()) return false;
+        float t = frameIndex / 30.0f;
+
+        frame.frameIndex = frameIndex;
+        frame.relativeTime = static_cast<INT64>(frameIndex) * frameTicks;
+        frame.participantIndex = participantSlot;
+        frame.bodyFrameAvailable = params.dropoutRate <= 0.0f || random.uniform() >= params.dropoutRate;
+        std::memset(frame.bodies, 0, sizeof(frame.bodies));
+
+        SyntheticPose pose;
+        scenarioPose(t, pose);
+        SyntheticBody& participant = frame.bodies[participantSlot];
+        participant.isTracked = true;
+        participant.trackingId = params.trackingId;
+        solve(pose, participant.joints);
+        if (params.jointBias > 0.0f) {
+            for (int j = 0; j < JointType_Count; ++j) {
+                participant.joints[j].Position.X += bias[j].X;
+                participant.joints[j].Position.Y += bias[j].Y;
+                participant.joints[j].Position.Z += bias[j].Z;
+            }
+        }
+        degrade(participant.joints);
+
+        SyntheticPose intruderPose;
+        if (intrusionPose(t, pose, intruderPose)) {
+            SyntheticBody& intruder = frame.bodies[intruderSlot];
+            intruder.isTracked = true;
+            intruder.trackingId = intruderId;
+            solve(intruderPose, intruder.joints);
+            degrade(intruder.joints);
+        }
+
+        ++frameIndex;
+        return true;
+    }
+
+    //512x424 depth frame in millimetres matching the frame, back wall at 8 m and the floor below the sensor
+    void renderDepth(const SyntheticFrame& frame, UINT16* depth) const {
+        for (int v = 0; v < depthHeight; ++v) {
+            float rayY = (depthCy - v) / depthFy;
+            UINT16 background = 8000;
+            if (rayY < 0.0f) {
+                float floorZ = params.cameraHeight / -rayY;
+                if (floorZ < 8.0f) background = static_cast<UINT16>(floorZ * 1000.0f);
+            }
+            std::fill(depth + v * depthWidth, depth + (v + 1) * depthWidth, background);
+        }
+
+        for (int i = 0; i < BODY_COUNT; ++i) {
+            const SyntheticBody& body = frame.bodies[i];
+            if (!body.isTracked) continue;
+            for (int b = 0; b < skeletonBoneCount; ++b) {
+                const CameraSpacePoint& a = body.joints[skeletonBones[b][0]].Position;
+                const CameraSpacePoint& c = body.joints[skeletonBones[b][1]].Position;
+                float radius = b == 0 ? 0.11f : (b < 4 ? 0.14f : 0.06f);
+                for (int s = 0; s <= 4; ++s) {
+                    float k = s / 4.0f;
+                    splat(depth, a.X + (c.X - a.X) * k, a.Y + (c.Y - a.Y) * k, a.Z + (c.Z - a.Z) * k, radius);
+                }
+            }
+        }
+    }
+
+private:
+    //pinhole approximation of the Kinect v2 depth camera
+    static constexpr float depthFx = 365.46f;
+    static constexpr float depthFy = 365.46f;
+    static constexpr float depthCx = 256.0f;
+    static constexpr float depthCy = 212.0f;
+    static constexpr float pi = 3.14159265f;
+    static constexpr float deg = pi / 180.0f;
+
+    //segment lengths (m)
+    static constexpr float pelvisHalfWidth = 0.10f;
+    static constexpr float shoulderHalfWidth = 0.18f;
+    static constexpr float upperArm = 0.28f, forearm = 0.25f, handLength = 0.08f;
+    static constexpr float thigh = 0.42f, shank = 0.42f, ankleHeight = 0.08f;
+    static constexpr float standingHeight = 0.05f + thigh + shank + ankleHeight;
+    static constexpr float trunkLength = 0.45f;    //SpineBase to SpineShoulder
+
+    SyntheticParams params;
+    SyntheticRandom random;
+    CameraSpacePoint bias[JointType_Count];
+    int frameIndex = 0;
+    int participantSlot = 0;
+    int intruderSlot = 1;
+    UINT64 intruderId = 0;
+    float sessionSeconds = 0.0f;
+
+    static float smoothstep(float x) {
+        x = std::min(1.0f, std::max(0.0f, x));
+        return x * x * (3.0f - 2.0f * x);
+    }
+
+    static float mix(float a, float b, float k) { return a + (b - a) * k; }
+
+    static void mixPose(const SyntheticPose& a, const SyntheticPose& b, float k, SyntheticPose& out) {
+        k = smoothstep(k);
+        out.rootX = mix(a.rootX, b.rootX, k);
+        out.rootZ = mix(a.rootZ, b.rootZ, k);
+        out.rootHeight = mix(a.rootHeight, b.rootHeight, k);
+        out.heading = mix(a.heading, b.heading, k);
+        out.trunkPitch = mix(a.trunkPitch, b.trunkPitch, k);
+        for (int s = 0; s < 2; ++s) {
+            out.hipFlex[s] = mix(a.hipFlex[s], b.hipFlex[s], k);
+            out.kneeFlex[s] = mix(a.kneeFlex[s], b.kneeFlex[s], k);
+            out.shoulderFlex[s] = mix(a.shoulderFlex[s], b.shoulderFlex[s], k);
+            out.elbowFlex[s] = mix(a.elbowFlex[s], b.elbowFlex[s], k);
+        }
+    }
+
+    //forward trunk lean that moves the shoulders forward by the requested reach, arms kept horizontal
+    float reachPitch() const {
+        return std::asin(std::min(0.95f, std::max(0.0f, params.reachDistance / trunkLength)));
+    }
+
+    //constant-speed walk with one second of acceleration and deceleration, returns distance covered after t seconds
+    float walkDistance(float t, float distance) const {
+        float v = std::max(0.1f, params.walkSpeed);
+        float ramp = std::min(1.0f, distance / v);         //seconds of acceleration and of deceleration
+        float cruise = std::max(0.0f, distance / v - ramp);
+        float total = cruise + 2.0f * ramp;
+        if (t <= 0.0f) return 0.0f;
+        if (t >= total) return distance;
+        if (t < ramp) return 0.5f * v * t * t / ramp;
+        if (t < ramp + cruise) return 0.5f * v * ramp + v * (t - ramp);
+        float r = total - t;
+        return distance - 0.5f * v * r * r / ramp;
+    }
+
+    float walkTime(float distance) const {
+        float v = std::max(0.1f, params.walkSpeed);
+        float ramp = std::min(1.0f, distance / v);
+        return std::max(0.0f, distance / v - ramp) + 2.0f * ramp;
+    }
+
+    //leg and arm swing for a walking pose, distance walked drives the gait phase
+    void applyGait(float distance, SyntheticPose& pose) const {
+        float phase = 2.0f * pi * distance / 1.1f;     //1.1 m stride
+        float s = std::sin(phase);
+        pose.hipFlex[0] = 25.0f * deg * s;
+        pose.hipFlex[1] = -25.0f * deg * s;
+        pose.kneeFlex[0] = 35.0f * deg * std::max(0.0f, std::sin(phase + 0.6f));
+        pose.kneeFlex[1] = 35.0f * deg * std::max(0.0f, -std::sin(phase + 0.6f));
+        pose.shoulderFlex[0] = -15.0f * deg * s;
+        pose.shoulderFlex[1] = 15.0f * deg * s;
+        pose.elbowFlex[0] = pose.elbowFlex[1] = 15.0f * deg;
+        pose.rootHeight = standingHeight - 0.02f * (1.0f - std::cos(2.0f * phase)) * 0.5f;
+    }
+
+    float scenarioDuration() const {
+        switch (params.scenario) {
+        case Scenario_TimedUpGo: {
+            float walk = walkTime(std::max(0.5f, params.chairDepth - 0.42f - params.turnDepth));
+            return params.seatedDuration + 1.5f + walk + 1.5f + walk + 1.5f + 1.5f + 2.0f;
+        }
+        case Scenario_WalkingSpeed:
+            return 1.0f + walkTime(6.0f) + 1.0f;
+        case Scenario_FunctionalReach:
+            return 2.0f + 1.0f + 1.5f + 1.5f + 1.0f + 1.5f + 1.0f + 1.0f + 1.0f;
+        case Scenario_SeatedForwardBend:
+            return 2.0f + 2.0f + 1.0f + 2.0f + 1.0f;
+        case Scenario_SingleLegStance:
+            return 2.0f + 0.5f + params.stanceDuration + 0.5f + 1.5f + 0.5f + params.stanceDuration + 0.5f + 1.0f;
+        default:
+            return 0.0f;
+        }
+    }
+
+    void scenarioPose(float t, SyntheticPose& pose) const {
+        switch (params.scenario) {
+        case Scenario_TimedUpGo: timedUpGoPose(t, pose); break;
+        case Scenario_WalkingSpeed: walkingSpeedPose(t, pose); break;
+        case Scenario_FunctionalReach: functionalReachPose(t, pose); break;
+        case Scenario_SeatedForwardBend: seatedForwardBendPose(t, pose); break;
+        case Scenario_SingleLegStance: singleLegStancePose(t, pose); break;
+        default: break;
+        }
+    }
+
+    void timedUpGoPose(float t, SyntheticPose& pose) const {
+        SyntheticPose seated;
+        seated.rootZ = params.chairDepth;
+        seated.rootHeight = 0.55f;
+        seated.hipFlex[0] = seated.hipFlex[1] = 90.0f * deg;
+        seated.kneeFlex[0] = seated.kneeFlex[1] = 90.0f * deg;
+        seated.shoulderFlex[0] = seated.shoulderFlex[1] = 30.0f * deg;
+        seated.elbowFlex[0] = seated.elbowFlex[1] = 60.0f * deg;
+
+        SyntheticPose standing;
+        standing.rootZ = params.chairDepth - 0.42f;
+        SyntheticPose rising = standing;                //halfway up, leaning forward
+        rising.rootZ = params.chairDepth - 0.25f;
+        rising.rootHeight = 0.65f;
+        rising.trunkPitch = 35.0f * deg;
+        rising.hipFlex[0] = rising.hipFlex[1] = 60.0f * deg;
+        rising.kneeFlex[0] = rising.kneeFlex[1] = 60.0f * deg;
+
+        float distance = std::max(0.5f, params.chairDepth - 0.42f - params.turnDepth);
+        float walk = walkTime(distance);
+        float phases[] = { params.seatedDuration, 0.75f, 0.75f, walk, 1.5f, walk, 1.5f, 0.75f, 0.75f };
+
+        float start = 0.0f;
+        int phase = 0;
+        for (; phase < 9 && t >= start + phases[phase]; ++phase) start += phases[phase];
+        float local = t - start;
+        float k = phase < 9 ? local / phases[phase] : 1.0f;
+
+        switch (phase) {
+        case 0: pose = seated; break;
+        case 1: mixPose(seated, rising, k, pose); break;
+        case 2: mixPose(rising, standing, k, pose); break;
+        case 3: {
+            float d = walkDistance(local, distance);
+            pose = standing;
+            pose.rootZ = standing.rootZ - d;
+            applyGait(d, pose);
+            break;
+        }
+        case 4:
+            pose = standing;
+            pose.rootZ = params.turnDepth;
+            pose.heading = pi * smoothstep(k);
+            break;
+        case 5: {
+            float d = walkDistance(local, distance);
+            pose = standing;
+            pose.heading = pi;
+            pose.rootZ = params.turnDepth + d;
+            applyGait(d, pose);
+            break;
+        }
+        case 6:
+            pose = standing;
+            pose.heading = pi + pi * smoothstep(k);
+            break;
+        case 7: mixPose(standing, rising, k, pose); break;
+        case 8: mixPose(rising, seated, k, pose); break;
+        default: pose = seated; break;
+        }
+    }
+
+    void walkingSpeedPose(float t, SyntheticPose& pose) const {
+        pose.rootZ = 7.0f;
+        float d = walkDistance(t - 1.0f, 6.0f);
+        pose.rootZ = 7.0f - d;
+        pose.rootX = params.walkOffset;
+        if (d > 0.0f && d < 6.0f) applyGait(d, pose);
+    }
+
+    void functionalReachPose(float t, SyntheticPose& pose) const {
+        SyntheticPose armsDown;
+        armsDown.heading = -pi / 2.0f;                  //side view, reaching towards camera -X
+        SyntheticPose armsRaised = armsDown;
+        armsRaised.shoulderFlex[0] = armsRaised.shoulderFlex[1] = 90.0f * deg;
+        SyntheticPose reaching = armsRaised;
+        reaching.trunkPitch = reachPitch();
+        reaching.shoulderFlex[0] = reaching.shoulderFlex[1] = 90.0f * deg - reaching.trunkPitch;
+        reaching.rootX = 0.05f;                         //hips move back while leaning
+
+        float phases[] = { 2.0f, 1.0f, 1.5f, 1.5f, 1.0f, 1.5f, 1.0f, 1.0f, 1.0f };
+        const SyntheticPose* from[] = { &armsDown, &armsDown, &armsRaised, &armsRaised, &reaching, &reaching, &armsRaised, &armsRaised, &armsDown };
+        const SyntheticPose* to[] = { &armsDown, &armsRaised, &armsRaised, &reaching, &reaching, &armsRaised, &armsRaised, &armsDown, &armsDown };
+        keyframes(t, phases, from, to, 9, pose);
+    }
+
+    void seatedForwardBendPose(float t, SyntheticPose& pose) const {
+        SyntheticPose upright;
+        upright.heading = -pi / 2.0f;
+        upright.rootHeight = 0.12f;                     //seated on the floor, legs extended forward
+        upright.hipFlex[0] = upright.hipFlex[1] = 90.0f * deg;
+        upright.shoulderFlex[0] = upright.shoulderFlex[1] = 90.0f * deg;
+        SyntheticPose bent = upright;
+        bent.trunkPitch = reachPitch();
+        bent.shoulderFlex[0] = bent.shoulderFlex[1] = 90.0f * deg - bent.trunkPitch;
+
+        float phases[] = { 2.0f, 2.0f, 1.0f, 2.0f, 1.0f };
+        const SyntheticPose* from[] = { &upright, &upright, &bent, &bent, &upright };
+        const SyntheticPose* to[] = { &upright, &bent, &bent, &upright, &upright };
+        keyframes(t, phases, from, to, 5, pose);
+    }
+
+    void singleLegStancePose(float t, SyntheticPose& pose) const {
+        SyntheticPose both;
+        SyntheticPose rightUp = both;
+        rightUp.hipFlex[1] = 20.0f * deg;
+        rightUp.kneeFlex[1] = 80.0f * deg;
+        SyntheticPose leftUp = both;
+        leftUp.hipFlex[0] = 20.0f * deg;
+        leftUp.kneeFlex[0] = 80.0f * deg;
+
+        float d = params.stanceDuration;
+        float phases[] = { 2.0f, 0.5f, d, 0.5f, 1.5f, 0.5f, d, 0.5f, 1.0f };
+        const SyntheticPose* from[] = { &both, &both, &rightUp, &rightUp, &both, &both, &leftUp, &leftUp, &both };
+        const SyntheticPose* to[] = { &both, &rightUp, &rightUp, &both, &both, &leftUp, &leftUp, &both, &both };
+        keyframes(t, phases, from, to, 9, pose);
+
+        //postural sway, two incommensurate frequencies so it never repeats exactly
+        pose.rootX += params.sway * (0.7f * std::sin(2.0f * pi * 0.45f * t) + 0.3f * std::sin(2.0f * pi * 1.3f * t + 1.0f));
+        pose.rootZ += params.sway * 0.5f * std::sin(2.0f * pi * 0.3f * t + 2.0f);
+    }
+
+    static void keyframes(float t, const float* phases, const SyntheticPose* const* from, const SyntheticPose* const* to,
+        int count, SyntheticPose& pose) {
+        float start = 0.0f;
+        for (int p = 0; p < count; ++p) {
+            if (t < start + phases[p]) {
+                mixPose(*from[p], *to[p], (t - start) / phases[p], pose);
+                return;
+            }
+            start += phases[p];
+        }
+        pose = *to[count - 1];
+    }
+
+    bool intrusionPose(float t, const SyntheticPose& participant, SyntheticPose& pose) const {
+        if (params.intrusion == Intrusion_None) return false;
+        float local = t - params.intrusionStart;
+        if (local < 0.0f || local > params.intrusionDuration) return false;
+
+        if (params.intrusion == Intrusion_Bystander) {
+            float k = local / params.intrusionDuration;
+            pose.heading = pi / 2.0f;
+            pose.rootZ = participant.rootZ + 1.0f;
+            pose.rootX = -2.5f + 5.0f * k;
+            applyGait(5.0f * k, pose);
+        }
+        else {
+            pose.rootX = participant.rootX + 0.6f;
+            pose.rootZ = participant.rootZ + 0.1f;
+            pose.shoulderFlex[0] = 45.0f * deg;
+        }
+        return true;
+    }
+
+    //forward kinematics of the pose into camera space joints
+    void solve(const SyntheticPose& pose, Joint* joints) const {
+        //participant frame: right, up and forward directions in camera space
+        float sh = std::sin(pose.heading), ch = std::cos(pose.heading);
+        float fx = sh, fz = -ch;          //forward
+        float rx = ch, rz = sh;           //right
+        float floorY = -params.cameraHeight;
+
+        auto place = [&](JointType type, float x, float y, float z) {
+            Joint& j = joints[type];
+            j.JointType = type;
+            float scale = params.bodyScale;
+            j.Position.X = pose.rootX + (x * rx + z * fx) * scale;
+            j.Position.Y = floorY + (pose.rootHeight + y) * scale;
+            j.Position.Z = pose.rootZ + (x * rz + z * fz) * scale;
+            j.TrackingState = TrackingState_Tracked;
+        };
+
+        //trunk, pitched forward about the participant's right axis
+        float sp = std::sin(pose.trunkPitch), cp = std::cos(pose.trunkPitch);
+        auto trunk = [&](float height, float& y, float& z) { y = height * cp; z = height * sp; };
+        float y, z;
+        place(JointType_SpineBase, 0.0f, 0.0f, 0.0f);
+        trunk(0.25f, y, z); place(JointType_SpineMid, 0.0f, y, z);
+        trunk(trunkLength, y, z); place(JointType_SpineShoulder, 0.0f, y, z);
+        float shoulderY = y, shoulderZ = z;
+        trunk(0.52f, y, z); place(JointType_Neck, 0.0f, y, z);
+        trunk(0.67f, y, z); place(JointType_Head, 0.0f, y, z);
+
+        for (int s = 0; s < 2; ++s) {
+            float side = s == 0 ? -1.0f : 1.0f;
+            bool left = s == 0;
+
+            //arm, angle measured from hanging straight down, trunk pitch included
+            float sx = side * shoulderHalfWidth;
+            float a = pose.shoulderFlex[s] + pose.trunkPitch;
+            float ey = shoulderY - upperArm * params.armScale * std::cos(a), ez = shoulderZ + upperArm * params.armScale * std::sin(a);
+            float b = a + pose.elbowFlex[s];
+            float wy = ey - forearm * params.armScale * std::cos(b), wz = ez + forearm * params.armScale * std::sin(b);
+            float hy = wy - handLength * std::cos(b), hz = wz + handLength * std::sin(b);
+            place(left ? JointType_ShoulderLeft : JointType_ShoulderRight, sx, shoulderY, shoulderZ);
+            place(left ? JointType_ElbowLeft : JointType_ElbowRight, sx, ey, ez);
+            place(left ? JointType_WristLeft : JointType_WristRight, sx, wy, wz);
+            place(left ? JointType_HandLeft : JointType_HandRight, sx, hy, hz);
+            place(left ? JointType_HandTipLeft : JointType_HandTipRight, sx, hy - 0.05f * std::cos(b), hz + 0.05f * std::sin(b));
+            place(left ? JointType_ThumbLeft : JointType_ThumbRight, sx - side * 0.03f, hy, hz);
+
+            //leg, knee flexion bends the shank backwards
+            float hx = side * pelvisHalfWidth;
+            float h = pose.hipFlex[s];
+            float ky = -thigh * std::cos(h), kz = thigh * std::sin(h);
+            float k = h - pose.kneeFlex[s];
+            float ay = ky - shank * std::cos(k), az = kz + shank * std::sin(k);
+            place(left ? JointType_HipLeft : JointType_HipRight, hx, -0.05f, 0.0f);
+            place(left ? JointType_KneeLeft : JointType_KneeRight, hx, ky - 0.05f, kz);
+            place(left ? JointType_AnkleLeft : JointType_AnkleRight, hx, ay - 0.05f, az);
+            place(left ? JointType_FootLeft : JointType_FootRight, hx, ay - 0.11f, az + 0.10f);
+        }
+    }
+
+    //sensor noise and tracking state degradation
+    void degrade(Joint* joints) {
+        bool degraded = params.inferredRate > 0.0f || params.notTrackedRate > 0.0f;
+        if (params.jointNoise <= 0.0f && !degraded) return;
+
+        for (int j = 0; j < JointType_Count; ++j) {
+            float noise = params.jointNoise;
+            if (degraded) {
+                float r = random.uniform();
+                if (r < params.notTrackedRate) {
+                    joints[j].TrackingState = TrackingState_NotTracked;
+                }
+                else if (r < params.notTrackedRate + params.inferredRate) {
+                    joints[j].TrackingState = TrackingState_Inferred;
+                    noise *= 3.0f;
+                }
+            }
+            if (noise > 0.0f) {
+                joints[j].Position.X += noise * random.normal();
+                joints[j].Position.Y += noise * random.normal();
+                joints[j].Position.Z += noise * random.normal();
+            }
+        }
+    }
+
+    void splat(UINT16* depth, float x, float y, float z, float radius) const {
+        if (z <= 0.3f) return;
+        int u = static_cast<int>(depthCx + x * depthFx / z);
+        int v = static_cast<int>(depthCy - y * depthFy / z);
+        int r = std::max(1, static_cast<int>(radius * depthFx / z));
+        UINT16 value = static_cast<UINT16>(z * 1000.0f);
+        for (int dv = -r; dv <= r; ++dv) {
+            int row = v + dv;
+            if (row < 0 || row >= depthHeight) continue;
+            int span = static_cast<int>(std::sqrt(static_cast<float>(r * r - dv * dv)));
+            int first = std::max(0, u - span), last = std::min(depthWidth - 1, u + span);
+            UINT16* line = depth + row * depthWidth;
+            for (int col = first; col <= last; ++col) {
+                if (value < line[col]) line[col] = value;
+            }
+        }
+    }
+};
@@ -0,0 +1,73 @@
+//Tracking lock on the participant of a test
+//TUG, FRT and SOOLWEO follow one participant by the body tracking ID. The first tracked body locks it; from then on the
+//six bodies of every frame are searched for that ID, so a bystander at a lower body index never takes over the test. A
+//tracked body with another ID that was not in the previous frame is a newcomer: the test invalidates the attempt in
+//progress and keeps the lock, the results of a completed trial stay. R in the window releases the lock for the next
+//participant (FRT also releases it when nobody at all is in view, as it did before).
+//
+//  TrackingLock lock;
+//  int i = lock.update(bodies);        //every body frame: the index of the locked participant, -1 when not in the frame
+//  if (lock.newcomer()) ...            //someone else entered, invalidate an attempt in progress
+//  lock.release();                     //R, the next tracked body is locked
+#pragma once
+#include "SkeletonTypes.h"
+
+class TrackingLock {
+public:
+    //any body type with get_IsTracked and get_TrackingId (BodySnapshot, IBody)
+    template<class Body>
+    int update(const Body* bodies, int count = BODY_COUNT) {
+        int found = -1;
+        int others = 0;
+        UINT64 seen[BODY_COUNT] = {};
+        hasNewcomer = false;
+        wasLocked = false;
+        for (int i = 0; i < count && i < BODY_COUNT; ++i) {
+            BOOLEAN tracked = false;
+            bodies[i].get_IsTracked(&tracked);
+            if (!tracked) continue;
+            UINT64 id = 0;
+            bodies[i].get_TrackingId(&id);
+            if (!isLocked) {
+                lockedId = id;
+                isLocked = wasLocked = true;
+            }
+            if (id == lockedId) {
+                found = i;
+                continue;
+            }
+            seen[others++] = id;
+            if (!inPrevious(id)) hasNewcomer = true;
+        }
+        for (int o = 0; o < others; ++o) previous[o] = seen[o];
+        previousCount = others;
+        return found;
+    }
+
+    void release() {
+        isLocked = false;
+        lockedId = 0;
+        previousCount = 0;
+    }
+
+    bool locked() const { return isLocked; }
+    UINT64 id() const { return lockedId; }
+    bool newlyLocked() const { return wasLocked; }      //the lock was taken in the last update
+    bool newcomer() const { return hasNewcomer; }       //another tracked ID entered in the last update
+    int bystanders() const { return previousCount; }    //tracked bodies other than the participant in the last update
+
+private:
+    bool inPrevious(UINT64 id) const {
+        for (int o = 0; o < previousCount; ++o) {
+            if (previous[o] == id) return true;
+        }
+        return false;
+    }
+
+    bool isLocked = false;
+    UINT64 lockedId = 0;
+    bool wasLocked = false;
+    bool hasNewcomer = false;
+    UINT64 previous[BODY_COUNT] = {};   //the other tracked IDs of the previous frame
+    int previousCount = 0;
+};
@@ -0,0 +1,150 @@
+//Streaming walking speed from the walker's depth over the whole walk
+//the WS gates time the walk between two 10 cm bands; this fits the trajectory instead. A ring of the last
+//windowSize (time, depth) samples keeps running regression sums for its older and its newer half. When both halves
+//agree on the speed (no acceleration) the sample between them belongs to the constant velocity segment and is added
+//to that segment's regression, so the start and the stop of the walk drop out by themselves. The steady speed is the
+//pooled slope of all steady segments, a pause in the middle only splits the segment.
+//O(1) memory (the ring) and O(1) work per sample.
+//
+//  WalkingSpeedEstimator speed;
+//  speed.add(depthTime * 1e-7, walkerDepth);          //every depth frame, seconds and metres
+//  if (speed.hasWindowSpeed()) ...speed.windowSpeed()...   //continuous, last ~1 s
+//  if (speed.hasSteadySpeed()) ...speed.steadySpeed()...   //constant velocity part of the walk so far, the result
+#pragma once
+#include <cmath>
+
+//least-squares line through (t, z) samples from running sums, samples can be removed again
+struct LineFitSums {
+    double n = 0.0, t = 0.0, z = 0.0, tt = 0.0, tz = 0.0;
+
+    void add(double time, double depth) {
+        n += 1.0;
+        t += time;
+        z += depth;
+        tt += time * time;
+        tz += time * depth;
+    }
+
+    void remove(double time, double depth) {
+        n -= 1.0;
+        t -= time;
+        z -= depth;
+        tt -= time * time;
+        tz -= time * depth;
+    }
+
+    //centered second moments
+    double sxx() const { return n > 0.0 ? tt - t * t / n : 0.0; }
+    double sxy() const { return n > 0.0 ? tz - t * z / n : 0.0; }
+    double meanTime() const { return n > 0.0 ? t / n : 0.0; }
+
+    //dz/dt, 0 with fewer than two distinct times
+    double slope() const {
+        double d = sxx();
+        return d > 1e-9 ? sxy() / d : 0.0;
+    }
+};
+
+class WalkingSpeedEstimator {
+public:
+    static const int windowSize = 32;       //samples, about 1 s at 30 fps
+    float maxAcceleration = 0.3f;           //m/s2 between the window halves, more is starting or stopping
+    float minSpeed = 0.15f;                 //m/s, slower is standing
+    int minSteadySamples = 15;              //before steadySpeed() is reported
+
+    WalkingSpeedEstimator() { reset(); }
+
+    void reset() {
+        count = 0;
+        newest = -1;
+        timeOrigin = 0.0;
+        older = newer = segment = LineFitSums();
+        pooledSxx = pooledSxy = 0.0;
+        pooledSamples = 0;
+        steady = false;
+    }
+
+    //samples in time order, seconds (any origin) and depth in metres
+    void add(double seconds, float depth) {
+        if (count == 0) timeOrigin = seconds;
+        double time = seconds - timeOrigin;
+        if (count > 0 && time <= samples[newest].time) return;     //repeated frame
+
+        const int half = windowSize / 2;
+        if (count == windowSize) {
+            const Sample& oldest = samples[(newest + 1) % windowSize];
+            older.remove(oldest.time, oldest.depth);
+        }
+        newest = (newest + 1) % windowSize;
+        samples[newest] = Sample{ time, depth };
+        newer.add(time, depth);
+        count = count < windowSize ? count + 1 : count;
+        if (count <= half) return;
+
+        //the sample half a window back moves from the newer to the older half
+        const Sample& middle = samples[(newest - half + windowSize) % windowSize];
+        newer.remove(middle.time, middle.depth);
+        older.add(middle.time, middle.depth);
+        if (count < windowSize) return;
+
+        double speedChange = std::fabs(newer.slope() - older.slope());
+        double halfSpan = newer.meanTime() - older.meanTime();
+        steady = halfSpan > 0.0 && speedChange < maxAcceleration * halfSpan && std::fabs(windowSlope()) > minSpeed;
+        if (steady) {
+            segment.add(middle.time, middle.depth);
+        }
+        else {
+            closeSegment();
+        }
+    }
+
+    bool hasWindowSpeed() const { return count == windowSize; }
+    //speed over the last window (m/s), positive whichever way the walker goes
+    float windowSpeed() const { return static_cast<float>(std::fabs(windowSlope())); }
+    //the middle of the window is on a constant velocity segment
+    bool isSteady() const { return steady; }
+
+    bool hasSteadySpeed() const { return pooledSamples + static_cast<int>(segment.n) >= minSteadySamples; }
+    //pooled regression slope of every steady segment so far (m/s)
+    float steadySpeed() const {
+        double sxx = pooledSxx + segment.sxx();
+        double sxy = pooledSxy + segment.sxy();
+        return sxx > 1e-9 ? static_cast<float>(std::fabs(sxy / sxx)) : 0.0f;
+    }
+    int steadySamples() const { return pooledSamples + static_cast<int>(segment.n); }
+
+private:
+    struct Sample {
+        double time;
+        float depth;
+    };
+
+    Sample samples[windowSize];
+    int count = 0;
+    int newest = -1;
+    double timeOrigin = 0.0;
+    LineFitSums older, newer;       //older and newer half of the ring
+    LineFitSums segment;            //current steady segment
+    double pooledSxx = 0.0, pooledSxy = 0.0;
+    int pooledSamples = 0;
+    bool steady = false;
+
+    double windowSlope() const {
+        LineFitSums window = older;
+        window.n += newer.n;
+        window.t += newer.t;
+        window.z += newer.z;
+        window.tt += newer.tt;
+        window.tz += newer.tz;
+        return window.slope();
+    }
+
+    void closeSegment() {
+        if (segment.n >= 3.0) {
+            pooledSxx += segment.sxx();
+            pooledSxy += segment.sxy();
+            pooledSamples += static_cast<int>(segment.n);
+        }
+        segment = LineFitSums();
+    }
+};
@@ -2,7 +2,6 @@
 #include <opencv2/opencv.hpp>
 #include <iostream>
 #include <vector>
-#include <deque> // For stability history tracking
 #include <fstream>
 #include <vector>
 #include <sstream>
@@ -11,28 +10,56 @@
 #include<sapi.h>
 #include <algorithm>
 #include <iomanip>  // For setprecision
-
-
-void logSeatedForwardBendTest(const std::vector<float>& rightHandDistances, const std::vector<float>& leftHandDistances) {
+#include "../Common/NormativeScoring.h"
+#include "../Common/FrameProfiler.h"
+#include "../Common/OverlayRenderer.h"
+#include "../Common/FramePipeline.h"
+#include "../Common/FrameArena.h"
+#include "../Common/DiagnosticLog.h"
+#include "../Common/KinectLease.h"
+#include "../Common/JointKinematics.h"
+#include "../Common/ForwardBend.h"
+#include "../Common/ParticipantIdentity.h"
+
+
+void logSeatedForwardBendTest(std::initializer_list<float> rightHandDistances, std::initializer_list<float> leftHandDistances, const NormativeScore& score,
+    const ForwardBendTracker& bend, const ParticipantIdentifier& identity) {
     std::string filename = "Seated_Forward_Bend_Test_Results_1.csv";
 
-    std::ofstream outfile(filename, std::ios::trunc);  // Open file in truncate mode (overwrite)
+    // Check if the file exists, the header is written only to a new file
+    std::ifstream infile(filename);
+    bool fileExists = infile.good();
+    infile.close();
+
+    std::ofstream outfile(filename, std::ios::app);  // Open file in append mode, every trial is kept
     if (!outfile.is_open()) {
         std::cerr << "Error: Could not open the file for writing.\n";
         return;
     }
 
-    // Write the header
-    outfile << "Seated Forward Bench Test (cm) 1\n";
+    // Write header only if file is new
+    if (!fileExists) {
+        outfile << "Seated Forward Bench Test (cm) 1,Percentile,Z Score,Trunk Flexion (deg),Hip Flexion (deg),Fused Reach (cm)" << participantColumnsHeader << "\n";
+    }
 
     // Compute the maximum reach distance
-    if (!rightHandDistances.empty() || !leftHandDistances.empty()) {
-        float maxRightHand = rightHandDistances.empty() ? 0.0f : *std::max_element(rightHandDistances.begin(), rightHandDistances.end());
-        float maxLeftHand = leftHandDistances.empty() ? 0.0f : *std::max_element(leftHandDistances.begin(), leftHandDistances.end());
+    if (rightHandDistances.size() > 0 || leftHandDistances.size() > 0) {
+        float maxRightHand = rightHandDistances.size() == 0 ? 0.0f : *std::max_element(rightHandDistances.begin(), rightHandDistances.end());
+        float maxLeftHand = leftHandDistances.size() == 0 ? 0.0f : *std::max_element(leftHandDistances.begin(), leftHandDistances.end());
         float maxOverall = std::max(maxRightHand, maxLeftHand);
 
-        // Write only the max overall distance
-        outfile << std::fixed << std::setprecision(2) << maxOverall << "\n";
+        // Write the max overall distance of this trial in a new row, with its normative score
+        outfile << std::fixed << std::setprecision(2) << maxOverall << ",";
+        if (score.valid) {
+            outfile << score.percentile << "," << score.zScore;
+        }
+        else {
+            outfile << "NULL,NULL";
+        }
+        //the trunk measurement, the reach fused from the hands and the trunk
+        outfile << "," << bend.maxTrunkFlexion << "," << bend.maxHipFlexion << "," << bend.maxFusedReach;
+        writeParticipantColumns(outfile, identity);
+        outfile << "\n";
     }
 
     outfile.close();
@@ -136,8 +163,9 @@ float initialLeftHandZ = -1.0f, initialRightHandZ = -1.0f,
 initialLeftElbowZ = -1.0f, initialRightElbowZ = -1.0f,
 initialMidSpineZ = -1.0f, initialShoulderSpineZ = -1.0f;
 
-// Deques to store Y-coordinate history for stability detection
-std::deque<float> leftHandYHistory, rightHandYHistory,
+// Y-coordinate history for stability detection, the last stabilityFramesThreshold frames in fixed rings
+typedef FrameRing<float, stabilityFramesThreshold> StabilityHistory;
+StabilityHistory leftHandYHistory, rightHandYHistory,
 leftElbowYHistory, rightElbowYHistory,
 midSpineYHistory, shoulderSpineYHistory;
 
@@ -148,363 +176,469 @@ lastMidSpineY = -1.0f, lastShoulderSpineY = -1.0f;
 
 int stabilityFrames = 0; // To track how many frames the joints are stable
 
+//trunk flexion, hip flexion and the reach fused from hands and trunk, alongside the hand distances
+KinematicsFrame kinematics;
+ForwardBendTracker forwardBend;
+
+//bone length signature matched to the day's participants (participants.csv), its ID goes into the result record
+ParticipantIdentifier participantIdentity;
+
+//puts the protocol back to waiting for a straight seated posture, the sensor and body tracking stay open
+void rearmTest() {
+    nonRaisedLeftHandX = nonRaisedLeftHandY = nonRaisedLeftHandZ = 0.0f;
+    nonRaisedRightHandX = nonRaisedRightHandY = nonRaisedRightHandZ = 0.0f;
+    nonRaisedElbowLeftX = nonRaisedElbowLeftY = nonRaisedElbowLeftZ = 0.0f;
+    nonRaisedElbowRightX = nonRaisedElbowRightY = nonRaisedElbowRightZ = 0.0f;
+    nonRaisedMidSpineX = nonRaisedMidSpineY = nonRaisedMidSpineZ = 0.0f;
+    nonRaisedShoulderSpineX = nonRaisedShoulderSpineY = nonRaisedShoulderSpineZ = 0.0f;
+
+    raisedLeftHandX = raisedLeftHandY = raisedLeftHandZ = 0.0f;
+    raisedRightHandX = raisedRightHandY = raisedRightHandZ = 0.0f;
+    raisedElbowLeftX = raisedElbowLeftY = raisedElbowLeftZ = 0.0f;
+    raisedElbowRightX = raisedElbowRightY = raisedElbowRightZ = 0.0f;
+    raisedMidSpineX = raisedMidSpineY = raisedMidSpineZ = 0.0f;
+    raisedShoulderSpineX = raisedShoulderSpineY = raisedShoulderSpineZ = 0.0f;
+
+    testStarted = false;
+    testReady = false;
+    armsRaised = false;
+    messagePrinted = false;
+    isPersonStable = false;
+    isPersonStraight = false;
+    FinalMaximumDistance = false;
+    testComplete = false;
+    onetimereading = false;
+    initialPostureretain = false;
+    initialSpeak = false;
+
+    RightHandDistance = LeftHandDistance = 0.0f;
+    currenRightHandDistance = currentLeftHandDistance = 0.0f;
+    MaximumRightHandDistance = MaximumLeftHandDistance = 0.0f;
+    Distance = 0.0f;
+
+    initialLeftHandZ = initialRightHandZ = -1.0f;
+    initialLeftElbowZ = initialRightElbowZ = -1.0f;
+    initialMidSpineZ = initialShoulderSpineZ = -1.0f;
+
+    leftHandYHistory.clear();
+    rightHandYHistory.clear();
+    leftElbowYHistory.clear();
+    rightElbowYHistory.clear();
+    midSpineYHistory.clear();
+    shoulderSpineYHistory.clear();
+    lastLeftHandY = lastRightHandY = -1.0f;
+    lastLeftElbowY = lastRightElbowY = -1.0f;
+    lastMidSpineY = lastShoulderSpineY = -1.0f;
+
+    stabilityFrames = 0;
+    forwardBend.reset();
+    participantIdentity.reset();
+}
+
 // Function to check stability
-bool isStable(const std::deque<float>& history, float threshold) {
-    if (history.size() < stabilityFramesThreshold) return false;
-    float minVal = *std::min_element(history.begin(), history.end());
-    float maxVal = *std::max_element(history.begin(), history.end());
+bool isStable(const StabilityHistory& history, float threshold) {
+    if (!history.full()) return false;
+    float minVal = history[0], maxVal = history[0];
+    for (size_t i = 1; i < history.size(); ++i) {
+        minVal = std::min(minVal, history[i]);
+        maxVal = std::max(maxVal, history[i]);
+    }
     return (maxVal - minVal) <= threshold;
 }
 
 
 int main() {
     // Initialize Kinect Sensor, readers, and coordinate mapper
-    IKinectSensor* sensor = nullptr;
-    IColorFrameReader* colorFrameReader = nullptr;
-    IBodyFrameReader* bodyFrameReader = nullptr;
-    ICoordinateMapper* coordinateMapper = nullptr;
+    //closed and released when main returns, on every return path
+    KinectSensorLease sensor;
+    ComLease<ICoordinateMapper> coordinateMapper;
 
-    if (FAILED(GetDefaultKinectSensor(&sensor)) || !sensor) {
+    if (!sensor.open()) {
         std::cerr << "Kinect sensor not found!" << std::endl;
         return -1;
     }
-    sensor->Open();
-    sensor->get_CoordinateMapper(&coordinateMapper);
-
-    IColorFrameSource* colorSource = nullptr;
-    sensor->get_ColorFrameSource(&colorSource);
-    colorSource->OpenReader(&colorFrameReader);
+    sensor->get_CoordinateMapper(coordinateMapper.put());
 
-    IBodyFrameSource* bodySource = nullptr;
-    sensor->get_BodyFrameSource(&bodySource);
-    bodySource->OpenReader(&bodyFrameReader);
+    //acquisition, color conversion and display run on their own threads, the test logic below gets every body frame
+    FramePipeline pipeline;
+    if (!pipeline.start(sensor.get(), FrameSourceTypes_Color | FrameSourceTypes_Body, "Seated Forward Bent Test")) {
+        return -1;
+    }
+    BodyFrame bodyFrame;
+    OverlayList overlay;
+    PROFILE_SESSION("Seated_Forward_Bend_Test");
 
-    cv::namedWindow("Seated Forward Bent Test", cv::WINDOW_AUTOSIZE);
+    //reference table for the percentile shown at the end of the test
+    NormativeTable normativeTable;
+    normativeTable.load("averaged_data.csv");
+    participantIdentity.load("participants.csv");
+    NormativeScore normativeScore;
+    std::string normativeText;
 
     // Frame loop
-    while (true) {
-        IColorFrame* colorFrame = nullptr;
-        HRESULT hrColor = colorFrameReader->AcquireLatestFrame(&colorFrame);
-
-        if (SUCCEEDED(hrColor)) {
-            IFrameDescription* frameDescription = nullptr;
-            colorFrame->get_FrameDescription(&frameDescription);
+    while (pipeline.isRunning()) {
+        overlay.clear();
+
+        //R in the window re-arms the test for the next trial, it applies from this frame on
+        int key = pipeline.takeKey();
+        if (key == 'r' || key == 'R') {
+            rearmTest();
+            normativeScore = NormativeScore();
+            normativeText.clear();
+            DIAG_INFO("Test re-armed for the next trial");
+            speak("Ready for the next trial");
+        }
+        //Y and N answer the question of a participant left unidentified (Identity_Ambiguous): the nearest, or someone new
+        if ((key == 'y' || key == 'Y') && participantIdentity.confirmCandidate()) {
+            DIAG_INFO("Participant confirmed by the operator: {}", participantIdentity.participantId());
+        }
+        if ((key == 'n' || key == 'N') && participantIdentity.confirmNew()) {
+            DIAG_INFO("New participant enrolled by the operator: {}", participantIdentity.participantId());
+        }
+        if (participantIdentity.awaitingConfirmation()) {
+            overlayText(overlay, (FrameText() << "Participant " << participantIdentity.ambiguousWith() << "? Y yes, N new participant").c_str(),
+                cv::Point(50, 1000), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 255), 2);
+        }
 
-            int width, height;
-            frameDescription->get_Width(&width);
-            frameDescription->get_Height(&height);
+        int width = pipeline.colorWidth;
+        int height = pipeline.colorHeight;
+
+        if (pipeline.nextBodyFrame(bodyFrame)) {
+            BodySnapshot* bodies = bodyFrame.bodies;
+
+
+            for (int i = 0; i < BODY_COUNT; ++i) {
+                BodySnapshot* body = &bodies[i];
+                if (body) {
+                    BOOLEAN isTracked = false;
+                    body->get_IsTracked(&isTracked);
+
+                    if (isTracked) {
+                        Joint joints[JointType_Count];
+                        body->GetJoints(_countof(joints), joints);
+                        PROFILE_STAGE_BEGIN(Stage_TestLogic);
+
+                        //bone length signature of this participant, matched to the day's participants and watched for a swap
+                        switch (participantIdentity.update(joints)) {
+                        case Identity_Matched:
+                            DIAG_INFO("Participant identified: {} ({} cm)", participantIdentity.participantId(), participantIdentity.matchedDistance() * 100.0f);
+                            break;
+                        case Identity_Enrolled:
+                            DIAG_INFO("New participant enrolled: {}", participantIdentity.participantId());
+                            break;
+                        case Identity_Ambiguous:
+                            DIAG_WARNING("Participant not identified: {} cm from {}, not clearly the same participant, Y or N in the window", participantIdentity.matchedDistance() * 100.0f,
+                                participantIdentity.ambiguousWith());
+                            break;
+                        case Identity_Swapped:
+                            DIAG_WARNING("Participant swap! {} no longer matches the skeleton, now like: {}", participantIdentity.participantId(),
+                                participantIdentity.recentMatch());
+                            break;
+                        default:
+                            break;
+                        }
 
-            UINT bufferSize = width * height * 4;
-            BYTE* colorBuffer = new BYTE[bufferSize];
-            hrColor = colorFrame->CopyConvertedFrameDataToArray(bufferSize, colorBuffer, ColorImageFormat_Bgra);
+                        kinematics.clear();
+                        kinematics.addBody(i, joints);
+                        kinematics.compute();
 
-            if (SUCCEEDED(hrColor)) {
-                cv::Mat colorMat(height, width, CV_8UC4, colorBuffer);
-                cv::Mat bgrMat;
-                cv::cvtColor(colorMat, bgrMat, cv::COLOR_BGRA2BGR);
+                        float leftHandY = 0, rightHandY = 0,
+                            leftElbowY = 0, rightElbowY = 0,
+                            shoulderSpineY = 0, midSpineY = 0;
 
-                IBodyFrame* bodyFrame = nullptr;
-                HRESULT hrBody = bodyFrameReader->AcquireLatestFrame(&bodyFrame);
+                        PROFILE_STAGE_BEGIN(Stage_Mapping);
+                        ArenaVector<cv::Point> jointPoints(frameArena());  // Store valid joint positions
+                        jointPoints.reserve(JointType_Count);
 
-                if (SUCCEEDED(hrBody)) {
-                    IBody* bodies[BODY_COUNT] = { 0 };
-                    hrBody = bodyFrame->GetAndRefreshBodyData(_countof(bodies), bodies);
+                        for (int j = 0; j < JointType_Count; ++j) {
+                            if (joints[j].TrackingState == TrackingState_Tracked) {
+                                ColorSpacePoint colorPoint;
+                                coordinateMapper->MapCameraPointToColorSpace(joints[j].Position, &colorPoint);
 
+                                int x = static_cast<int>(colorPoint.X);
+                                int y = static_cast<int>(colorPoint.Y);
 
-                    for (int i = 0; i < BODY_COUNT; ++i) {
-                        IBody* body = bodies[i];
-                        if (body) {
-                            BOOLEAN isTracked = false;
-                            body->get_IsTracked(&isTracked);
+                                // Debugging output
+                                //std::cout << "Joint " << j << " -> X: " << x << ", Y: " << y << std::endl;
 
-                            if (isTracked) {
-                                Joint joints[JointType_Count];
-                                body->GetJoints(_countof(joints), joints);
+                                if (x > 0 && x < width && y > 0 && y < height) {
+                                    jointPoints.push_back(cv::Point(x, y));
+                                }
+                            }
+                        }
 
+                        PROFILE_STAGE_END(Stage_Mapping);
 
-                                float leftHandY = 0, rightHandY = 0,
-                                    leftElbowY = 0, rightElbowY = 0,
-                                    shoulderSpineY = 0, midSpineY = 0;
+                        // If we have valid joint points, draw bounding box
+                        if (!jointPoints.empty()) {
+                            PROFILE_STAGE_BEGIN(Stage_Overlay);
+                            cv::Rect boundingRect = cv::boundingRect(pointsView(jointPoints));
+                            overlayRectangle(overlay, boundingRect, cv::Scalar(0, 255, 0), 2);
 
-                                std::vector<cv::Point> jointPoints;  // Store valid joint positions
+                        }
 
-                                for (int j = 0; j < JointType_Count; ++j) {
-                                    if (joints[j].TrackingState == TrackingState_Tracked) {
-                                        ColorSpacePoint colorPoint;
-                                        coordinateMapper->MapCameraPointToColorSpace(joints[j].Position, &colorPoint);
 
-                                        int x = static_cast<int>(colorPoint.X);
-                                        int y = static_cast<int>(colorPoint.Y);
+                        // Only draw circles for selected joints
+                        for (int j = 0; j < JointType_Count; j++) {
+                            if (joints[j].TrackingState == TrackingState_Tracked &&
+                                (j == JointType_HandLeft || j == JointType_HandRight ||
+                                    j == JointType_ElbowLeft || j == JointType_ElbowRight ||
+                                    j == JointType_SpineMid || j == JointType_SpineShoulder)) {
 
-                                        // Debugging output
-                                        //std::cout << "Joint " << j << " -> X: " << x << ", Y: " << y << std::endl;
+                                // Use the raw camera space coordinates (meters)
+                                float x = joints[j].Position.X;
+                                float y = joints[j].Position.Y;
+                                float z = joints[j].Position.Z;
 
-                                        if (x > 0 && x < width && y > 0 && y < height) {
-                                            jointPoints.push_back(cv::Point(x, y));
-                                        }
+                                // Save specific Y values for the joints
+                                if (j == JointType_HandLeft) {
+                                    leftHandY = y;
+                                    if (initialLeftHandZ == -1.0f) {
+                                        initialLeftHandZ = z;
+                                    }
+                                }
+                                else if (j == JointType_HandRight) {
+                                    rightHandY = y;
+                                    if (initialRightHandZ == -1.0f) {
+                                        initialRightHandZ = z;
+                                    }
+                                }
+                                else if (j == JointType_ElbowLeft) {
+                                    leftElbowY = y;
+                                    if (initialLeftElbowZ == -1.0f) {
+                                        initialLeftElbowZ = z;
+                                    }
+                                }
+                                else if (j == JointType_ElbowRight) {
+                                    rightElbowY = y;
+                                    if (initialRightElbowZ == -1.0f) {
+                                        initialRightElbowZ = z;
+                                    }
+                                }
+                                else if (j == JointType_SpineMid) {
+                                    midSpineY = y;
+                                    if (initialMidSpineZ == -1.0f) {
+                                        initialMidSpineZ = z;
+                                    }
+                                }
+                                else if (j == JointType_SpineShoulder) {
+                                    shoulderSpineY = y;
+                                    if (initialShoulderSpineZ == -1.0f) {
+                                        initialShoulderSpineZ = z;
                                     }
                                 }
 
-                                // If we have valid joint points, draw bounding box
-                                if (!jointPoints.empty()) {
-                                    cv::Rect boundingRect = cv::boundingRect(jointPoints);
-                                    cv::rectangle(bgrMat, boundingRect, cv::Scalar(0, 255, 0), 2);
+                                // Convert camera space to color space for visualization
+                                ColorSpacePoint colorPoint;
+                                coordinateMapper->MapCameraPointToColorSpace(joints[j].Position, &colorPoint);
+                                int cx = static_cast<int>(colorPoint.X); // Pixel coordinates for the live feed
+                                int cy = static_cast<int>(colorPoint.Y);
+
+                                // Ensure the pixel coordinates are within bounds before drawing
+                                if (cx >= 0 && cx < width && cy >= 0 && cy < height) {
+                                    //overlayCircle(overlay, cv::Point(cx, cy), 10, cv::Scalar(0, 0, 255), -1); // Draw a circle
 
                                 }
+                            }
+                        }
 
 
-                                // Only draw circles for selected joints
-                                for (int j = 0; j < JointType_Count; j++) {
-                                    if (joints[j].TrackingState == TrackingState_Tracked &&
-                                        (j == JointType_HandLeft || j == JointType_HandRight ||
-                                            j == JointType_ElbowLeft || j == JointType_ElbowRight ||
-                                            j == JointType_SpineMid || j == JointType_SpineShoulder)) {
-
-                                        // Use the raw camera space coordinates (meters)
-                                        float x = joints[j].Position.X;
-                                        float y = joints[j].Position.Y;
-                                        float z = joints[j].Position.Z;
-
-                                        // Save specific Y values for the joints
-                                        if (j == JointType_HandLeft) {
-                                            leftHandY = y;
-                                            if (initialLeftHandZ == -1.0f) {
-                                                initialLeftHandZ = z;
-                                            }
-                                        }
-                                        else if (j == JointType_HandRight) {
-                                            rightHandY = y;
-                                            if (initialRightHandZ == -1.0f) {
-                                                initialRightHandZ = z;
-                                            }
-                                        }
-                                        else if (j == JointType_ElbowLeft) {
-                                            leftElbowY = y;
-                                            if (initialLeftElbowZ == -1.0f) {
-                                                initialLeftElbowZ = z;
-                                            }
-                                        }
-                                        else if (j == JointType_ElbowRight) {
-                                            rightElbowY = y;
-                                            if (initialRightElbowZ == -1.0f) {
-                                                initialRightElbowZ = z;
-                                            }
-                                        }
-                                        else if (j == JointType_SpineMid) {
-                                            midSpineY = y;
-                                            if (initialMidSpineZ == -1.0f) {
-                                                initialMidSpineZ = z;
-                                            }
-                                        }
-                                        else if (j == JointType_SpineShoulder) {
-                                            shoulderSpineY = y;
-                                            if (initialShoulderSpineZ == -1.0f) {
-                                                initialShoulderSpineZ = z;
-                                            }
-                                        }
-
-                                        // Convert camera space to color space for visualization
-                                        ColorSpacePoint colorPoint;
-                                        coordinateMapper->MapCameraPointToColorSpace(joints[j].Position, &colorPoint);
-                                        int cx = static_cast<int>(colorPoint.X); // Pixel coordinates for the live feed
-                                        int cy = static_cast<int>(colorPoint.Y);
-
-                                        // Ensure the pixel coordinates are within bounds before drawing
-                                        if (cx >= 0 && cx < width && cy >= 0 && cy < height) {
-                                            //cv::circle(bgrMat, cv::Point(cx, cy), 10, cv::Scalar(0, 0, 255), -1); // Draw a circle
-
-                                        }
-                                    }
-                                }
+                        //Update history, the oldest value drops out once the ring is full
+                        leftHandYHistory.push(leftHandY);
+                        rightHandYHistory.push(rightHandY);
+                        leftElbowYHistory.push(leftElbowY);
+                        rightElbowYHistory.push(rightElbowY);
+                        midSpineYHistory.push(midSpineY);
+                        shoulderSpineYHistory.push(shoulderSpineY);
 
+                        // Check stability
+                        bool leftHandStable = isStable(leftHandYHistory, stabilityYThreshold);
+                        bool rightHandStable = isStable(rightHandYHistory, stabilityYThreshold);
+                        bool leftElbowStable = isStable(leftElbowYHistory, stabilityYThreshold);
+                        bool rightElbowStable = isStable(rightElbowYHistory, stabilityYThreshold);
+                        bool midSpineStable = isStable(midSpineYHistory, stabilityYThreshold);
+                        bool shoulderSpineStable = isStable(shoulderSpineYHistory, stabilityYThreshold);
 
-                                //Update history
-                                if (leftHandYHistory.size() >= stabilityFramesThreshold) leftHandYHistory.pop_front();
-                                if (rightHandYHistory.size() >= stabilityFramesThreshold) rightHandYHistory.pop_front();
-                                if (leftElbowYHistory.size() >= stabilityFramesThreshold) leftElbowYHistory.pop_front();
-                                if (rightElbowYHistory.size() >= stabilityFramesThreshold) rightElbowYHistory.pop_front();
-                                if (midSpineYHistory.size() >= stabilityFramesThreshold) midSpineYHistory.pop_front();
-                                if (shoulderSpineYHistory.size() >= stabilityFramesThreshold) shoulderSpineYHistory.pop_front();
-
-                                leftHandYHistory.push_back(leftHandY);
-                                rightHandYHistory.push_back(rightHandY);
-                                leftElbowYHistory.push_back(leftElbowY);
-                                rightElbowYHistory.push_back(rightElbowY);
-                                midSpineYHistory.push_back(midSpineY);
-                                shoulderSpineYHistory.push_back(shoulderSpineY);
-
-                                // Check stability
-                                bool leftHandStable = isStable(leftHandYHistory, stabilityYThreshold);
-                                bool rightHandStable = isStable(rightHandYHistory, stabilityYThreshold);
-                                bool leftElbowStable = isStable(leftElbowYHistory, stabilityYThreshold);
-                                bool rightElbowStable = isStable(rightElbowYHistory, stabilityYThreshold);
-                                bool midSpineStable = isStable(midSpineYHistory, stabilityYThreshold);
-                                bool shoulderSpineStable = isStable(shoulderSpineYHistory, stabilityYThreshold);
-
-
-                                // Conditional statement: When arms are stable, print message
-                                if (leftElbowStable && rightElbowStable && !messagePrinted && !initialSpeak && !testReady && !testStarted && !isPersonStable) {
-
-                                    messagePrinted = true; // Set the flag to true to prevent repeated printing
-                                    testReady = true;
-                                    isPersonStable = true;
-                                    armsRaised = true;
-                                    initialSpeak = true;
-
-                                    nonRaisedElbowLeftX = joints[JointType_ElbowLeft].Position.X;
-                                    nonRaisedElbowLeftY = joints[JointType_ElbowLeft].Position.Y;
-                                    nonRaisedElbowLeftZ = joints[JointType_ElbowLeft].Position.Z;
-
-                                    nonRaisedElbowRightX = joints[JointType_ElbowRight].Position.X;
-                                    nonRaisedElbowRightY = joints[JointType_ElbowRight].Position.Y;
-                                    nonRaisedElbowRightZ = joints[JointType_ElbowRight].Position.Z;
-
-                                    nonRaisedLeftHandX = joints[JointType_HandLeft].Position.X;
-                                    nonRaisedLeftHandY = joints[JointType_HandLeft].Position.Y;
-                                    nonRaisedLeftHandZ = joints[JointType_HandLeft].Position.Z;
-
-                                    nonRaisedRightHandX = joints[JointType_HandRight].Position.X;
-                                    nonRaisedRightHandY = joints[JointType_HandRight].Position.Y;
-                                    nonRaisedRightHandZ = joints[JointType_HandRight].Position.Z;
-
-                                    speak("Please move forward");
-                                }
 
-                                if (messagePrinted && isPersonStable && testReady && !testStarted)
-                                {
-                                    cv::putText(bgrMat, "Test Ready", cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
-                                }
+                        // Conditional statement: When arms are stable, print message
+                        if (leftElbowStable && rightElbowStable && !messagePrinted && !initialSpeak && !testReady && !testStarted && !isPersonStable) {
 
-                                //speak("Please move forward");
+                            messagePrinted = true; // Set the flag to true to prevent repeated printing
+                            testReady = true;
+                            isPersonStable = true;
+                            armsRaised = true;
+                            initialSpeak = true;
 
-                                if (armsRaised && testReady && !testStarted)
-                                {
-                                    cv::putText(bgrMat, "Please move Forward", cv::Point(50, 100), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
-                                }
+                            nonRaisedElbowLeftX = joints[JointType_ElbowLeft].Position.X;
+                            nonRaisedElbowLeftY = joints[JointType_ElbowLeft].Position.Y;
+                            nonRaisedElbowLeftZ = joints[JointType_ElbowLeft].Position.Z;
 
-                                //now the person bends forward covering the distance in X direction
-                                if (fabs(nonRaisedLeftHandX - joints[JointType_HandLeft].Position.X) >= armmovedthresholdX &&
-                                    fabs(nonRaisedRightHandX - joints[JointType_HandRight].Position.X) >= armmovedthresholdX &&
-                                    armsRaised && !FinalMaximumDistance)
-                                {
-                                    testStarted = true;
-                                    // Calculate the distance of the hands from their initial positions
-                                    currenRightHandDistance = joints[JointType_HandRight].Position.X;
-                                    currentLeftHandDistance = joints[JointType_HandLeft].Position.X;
-
-                                    RightHandDistance = fabs((nonRaisedRightHandX - currenRightHandDistance)) * 100.0f;    //current distance
-                                    LeftHandDistance = fabs((nonRaisedLeftHandX - currentLeftHandDistance)) * 100.0f;       //current distance
-
-                                    cout << "Right Hand Distance: " << fabs((nonRaisedRightHandX - joints[JointType_HandRight].Position.X)) * 100.0f << "cm" << endl;
-                                    cout << "Left Hand Distance: " << fabs((nonRaisedLeftHandX - joints[JointType_HandLeft].Position.X)) * 100.0f << "cm" << endl;
-
-                                    if ((MaximumRightHandDistance < RightHandDistance)) //checking if ccurrent distance is greater than maximum distance
-                                    {
-                                        MaximumRightHandDistance = RightHandDistance;
-                                    }
-                                    if (MaximumLeftHandDistance < LeftHandDistance)
-                                    {
-                                        MaximumLeftHandDistance = LeftHandDistance;
-                                    }
-                                    if (MaximumRightHandDistance > MaximumLeftHandDistance)
-                                        Distance = MaximumRightHandDistance;
-                                    else if (MaximumRightHandDistance < MaximumLeftHandDistance)
-                                        Distance = MaximumLeftHandDistance;
-
-                                    if ((RightHandDistance - MaximumRightHandDistance < 0.0f) && (LeftHandDistance - MaximumLeftHandDistance < 0.0f))
-                                    {
-                                        FinalMaximumDistance = true;
-                                        //cout << "You Have Reached your limit." << endl;
-                                        logSeatedForwardBendTest({ MaximumRightHandDistance }, { MaximumLeftHandDistance });
-                                    }
+                            nonRaisedElbowRightX = joints[JointType_ElbowRight].Position.X;
+                            nonRaisedElbowRightY = joints[JointType_ElbowRight].Position.Y;
+                            nonRaisedElbowRightZ = joints[JointType_ElbowRight].Position.Z;
 
+                            nonRaisedLeftHandX = joints[JointType_HandLeft].Position.X;
+                            nonRaisedLeftHandY = joints[JointType_HandLeft].Position.Y;
+                            nonRaisedLeftHandZ = joints[JointType_HandLeft].Position.Z;
 
-                                    if (armsRaised && testStarted && !initialPostureretain && !testComplete)
-                                    {
-                                        cv::putText(bgrMat, "Test Started", cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
-                                        cv::putText(bgrMat, "Right Hand Distance: " + std::to_string(MaximumRightHandDistance) + " cm",
-                                            cv::Point(50, 500), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
-                                        cv::putText(bgrMat, "Left Hand Distance: " + std::to_string(MaximumLeftHandDistance) + " cm",
-                                            cv::Point(50, 550), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
-                                        cv::putText(bgrMat, "Distance Covered: " + std::to_string(Distance) + " cm",
-                                            cv::Point(50, 600), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
-                                    }
+                            nonRaisedRightHandX = joints[JointType_HandRight].Position.X;
+                            nonRaisedRightHandY = joints[JointType_HandRight].Position.Y;
+                            nonRaisedRightHandZ = joints[JointType_HandRight].Position.Z;
 
-                                }
-                                if (testStarted && !testComplete && !initialPostureretain)
-                                {
-                                    //	cv::putText(bgrMat, "Test Started", cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            //the posture the trunk measurement starts from
+                            forwardBend.start(joints);
 
-                                }
-                                if (FinalMaximumDistance && testStarted && !testComplete)
-                                {
-                                    cv::putText(bgrMat, "Test Started", cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
-                                    cv::putText(bgrMat, "You Have Reached your limit.", cv::Point(50, 100), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
-                                    cv::putText(bgrMat, "Right Hand Distance: " + std::to_string(MaximumRightHandDistance) + " cm",
-                                        cv::Point(50, 500), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
-                                    cv::putText(bgrMat, "Left Hand Distance: " + std::to_string(MaximumLeftHandDistance) + " cm",
-                                        cv::Point(50, 550), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
-                                    cv::putText(bgrMat, "Distance Covered: " + std::to_string(Distance) + " cm",
-                                        cv::Point(50, 600), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            speak("Please move forward");
+                        }
 
-                                }
+                        if (messagePrinted && isPersonStable && testReady && !testStarted)
+                        {
+                            overlayText(overlay, "Test Ready", cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                        }
 
-                                //now person moves back to initial position
-                                if (fabs(nonRaisedLeftHandZ - joints[JointType_HandLeft].Position.Z) <= initialPositionHandsRetainedZ &&
-                                    fabs(nonRaisedLeftHandY - joints[JointType_HandLeft].Position.Y) <= initialPositionHandsRetainedY &&
-                                    fabs(nonRaisedLeftHandX - joints[JointType_HandLeft].Position.X) <= initialPositionHandsRetainedX &&
-                                    testStarted && FinalMaximumDistance && !initialPostureretain && !testComplete)
-                                {
-                                    /*cout << "You Have Reached your initialPosition" << endl;
-                                    std::cout << "Right Hand Coordinates | x: " << joints[JointType_HandRight].Position.X << "  | y: " << rightHandY << " | z: " << joints[JointType_HandRight].Position.Z << " |" << std::endl;
-                                    std::cout << "Right Elbow Coordinates| x: " << joints[JointType_ElbowRight].Position.X << "  | y: " << rightElbowY << " | z: " << joints[JointType_ElbowRight].Position.Z << " |" << std::endl;
-                                    std::cout << "Left Hand Coordinates  | x: " << joints[JointType_HandLeft].Position.X << " | y: " << leftHandY << " | z: " << joints[JointType_HandLeft].Position.Z << " |" << std::endl;
-                                    std::cout << "Left Elbow Coordinates | x: " << joints[JointType_ElbowLeft].Position.X << " | y: " << leftElbowY << " | z: " << joints[JointType_ElbowLeft].Position.Z << " |" << std::endl;
-                                    */
-                                    initialPostureretain = true;
-                                    testComplete = true;
-                                    speak("Test Complete");
-
-                                    cout << "Maximum Distance: " << Distance << "cm" << endl;
+                        //speak("Please move forward");
 
-                                }
-                                if (initialPostureretain && testComplete)
-                                {
-                                    cv::putText(bgrMat, "Test Complete", cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
-                                    cv::putText(bgrMat, "Right Hand Distance: " + std::to_string(MaximumRightHandDistance) + " cm",
-                                        cv::Point(50, 500), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
-                                    cv::putText(bgrMat, "Left Hand Distance: " + std::to_string(MaximumLeftHandDistance) + " cm",
-                                        cv::Point(50, 550), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
-                                    cv::putText(bgrMat, "Distance Covered: " + std::to_string(Distance) + " cm",
-                                        cv::Point(50, 600), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
-                                }
+                        if (armsRaised && testReady && !testStarted)
+                        {
+                            overlayText(overlay, "Please move Forward", cv::Point(50, 100), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                        }
 
-                                break;
+                        //trunk, hips and fused reach every frame from test ready until the test completes, whatever the hands
+                        //do: they are the noisy joints the trunk measurement stands in for
+                        if (forwardBend.started && !testComplete) {
+                            float handReach = std::max(fabs(nonRaisedRightHandX - joints[JointType_HandRight].Position.X),
+                                fabs(nonRaisedLeftHandX - joints[JointType_HandLeft].Position.X)) * 100.0f;
+                            forwardBend.update(joints, kinematics.body(i), handReach);
+                        }
+
+                        //now the person bends forward covering the distance in X direction
+                        if (fabs(nonRaisedLeftHandX - joints[JointType_HandLeft].Position.X) >= armmovedthresholdX &&
+                            fabs(nonRaisedRightHandX - joints[JointType_HandRight].Position.X) >= armmovedthresholdX &&
+                            armsRaised && !FinalMaximumDistance)
+                        {
+                            testStarted = true;
+                            // Calculate the distance of the hands from their initial positions
+                            currenRightHandDistance = joints[JointType_HandRight].Position.X;
+                            currentLeftHandDistance = joints[JointType_HandLeft].Position.X;
+
+                            RightHandDistance = fabs((nonRaisedRightHandX - currenRightHandDistance)) * 100.0f;    //current distance
+                            LeftHandDistance = fabs((nonRaisedLeftHandX - currentLeftHandDistance)) * 100.0f;       //current distance
+
+                            //per frame while bending, at most twice a second on the console
+                            DIAG_INFO_EVERY(500, "Right Hand Distance: {}cm, Left Hand Distance: {}cm",
+                                fabs((nonRaisedRightHandX - joints[JointType_HandRight].Position.X)) * 100.0f,
+                                fabs((nonRaisedLeftHandX - joints[JointType_HandLeft].Position.X)) * 100.0f);
+
+                            if ((MaximumRightHandDistance < RightHandDistance)) //checking if ccurrent distance is greater than maximum distance
+                            {
+                                MaximumRightHandDistance = RightHandDistance;
+                            }
+                            if (MaximumLeftHandDistance < LeftHandDistance)
+                            {
+                                MaximumLeftHandDistance = LeftHandDistance;
+                            }
+                            if (MaximumRightHandDistance > MaximumLeftHandDistance)
+                                Distance = MaximumRightHandDistance;
+                            else if (MaximumRightHandDistance < MaximumLeftHandDistance)
+                                Distance = MaximumLeftHandDistance;
+
+                            if ((RightHandDistance - MaximumRightHandDistance < 0.0f) && (LeftHandDistance - MaximumLeftHandDistance < 0.0f))
+                            {
+                                FinalMaximumDistance = true;
+                                //cout << "You Have Reached your limit." << endl;
+                                normativeScore = normativeTable.score(Norm_SeatedForwardBend, std::max(MaximumRightHandDistance, MaximumLeftHandDistance));
+                                normativeText = formatNormativeScore(normativeScore);
                             }
 
 
+                            if (armsRaised && testStarted && !initialPostureretain && !testComplete)
+                            {
+                                overlayText(overlay, "Test Started", cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                                overlayText(overlay, (FrameText() << "Right Hand Distance: " << decimals(MaximumRightHandDistance, 1) << " cm").c_str(),
+                                    cv::Point(50, 500), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                                overlayText(overlay, (FrameText() << "Left Hand Distance: " << decimals(MaximumLeftHandDistance, 1) << " cm").c_str(),
+                                    cv::Point(50, 550), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                                overlayText(overlay, (FrameText() << "Distance Covered: " << decimals(Distance, 1) << " cm").c_str(),
+                                    cv::Point(50, 600), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                                overlayText(overlay, (FrameText() << "Trunk: " << decimals(forwardBend.trunkFlexion, 0) << " deg  Hip: " << decimals(forwardBend.hipFlexion, 0)
+                                    << " deg  Fused Reach: " << decimals(forwardBend.maxFusedReach, 1) << " cm").c_str(),
+                                    cv::Point(50, 650), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            }
+
+                        }
+                        if (testStarted && !testComplete && !initialPostureretain)
+                        {
+                            //	overlayText(overlay, "Test Started", cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+
                         }
+                        if (FinalMaximumDistance && testStarted && !testComplete)
+                        {
+                            overlayText(overlay, "Test Started", cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            overlayText(overlay, "You Have Reached your limit.", cv::Point(50, 100), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            overlayText(overlay, (FrameText() << "Right Hand Distance: " << decimals(MaximumRightHandDistance, 1) << " cm").c_str(),
+                                cv::Point(50, 500), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            overlayText(overlay, (FrameText() << "Left Hand Distance: " << decimals(MaximumLeftHandDistance, 1) << " cm").c_str(),
+                                cv::Point(50, 550), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            overlayText(overlay, (FrameText() << "Distance Covered: " << decimals(Distance, 1) << " cm").c_str(),
+                                cv::Point(50, 600), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            overlayText(overlay, (FrameText() << "Max Trunk: " << decimals(forwardBend.maxTrunkFlexion, 0) << " deg  Hip: " << decimals(forwardBend.maxHipFlexion, 0)
+                                << " deg  Fused Reach: " << decimals(forwardBend.maxFusedReach, 1) << " cm").c_str(),
+                                cv::Point(50, 650), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+
+                        }
+
+                        //now person moves back to initial position
+                        if (fabs(nonRaisedLeftHandZ - joints[JointType_HandLeft].Position.Z) <= initialPositionHandsRetainedZ &&
+                            fabs(nonRaisedLeftHandY - joints[JointType_HandLeft].Position.Y) <= initialPositionHandsRetainedY &&
+                            fabs(nonRaisedLeftHandX - joints[JointType_HandLeft].Position.X) <= initialPositionHandsRetainedX &&
+                            testStarted && FinalMaximumDistance && !initialPostureretain && !testComplete)
+                        {
+                            /*cout << "You Have Reached your initialPosition" << endl;
+                            std::cout << "Right Hand Coordinates | x: " << joints[JointType_HandRight].Position.X << "  | y: " << rightHandY << " | z: " << joints[JointType_HandRight].Position.Z << " |" << std::endl;
+                            std::cout << "Right Elbow Coordinates| x: " << joints[JointType_ElbowRight].Position.X << "  | y: " << rightElbowY << " | z: " << joints[JointType_ElbowRight].Position.Z << " |" << std::endl;
+                            std::cout << "Left Hand Coordinates  | x: " << joints[JointType_HandLeft].Position.X << " | y: " << leftHandY << " | z: " << joints[JointType_HandLeft].Position.Z << " |" << std::endl;
+                            std::cout << "Left Elbow Coordinates | x: " << joints[JointType_ElbowLeft].Position.X << " | y: " << leftElbowY << " | z: " << joints[JointType_ElbowLeft].Position.Z << " |" << std::endl;
+                            */
+                            initialPostureretain = true;
+                            testComplete = true;
+                            speak("Test Complete");
+
+                            DIAG_INFO("Maximum Distance: {}cm", Distance);
+                            DIAG_INFO("Maximum Trunk Flexion: {} deg, Hip Flexion: {} deg, Fused Reach: {}cm", forwardBend.maxTrunkFlexion, forwardBend.maxHipFlexion, forwardBend.maxFusedReach);
+                            //the trunk maxima are final only now, the tracker ran through the return to the start posture
+                            logSeatedForwardBendTest({ MaximumRightHandDistance }, { MaximumLeftHandDistance }, normativeScore, forwardBend, participantIdentity);
+
+                        }
+                        if (initialPostureretain && testComplete)
+                        {
+                            overlayText(overlay, "Test Complete", cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            overlayText(overlay, (FrameText() << "Right Hand Distance: " << decimals(MaximumRightHandDistance, 1) << " cm").c_str(),
+                                cv::Point(50, 500), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            overlayText(overlay, (FrameText() << "Left Hand Distance: " << decimals(MaximumLeftHandDistance, 1) << " cm").c_str(),
+                                cv::Point(50, 550), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            overlayText(overlay, (FrameText() << "Distance Covered: " << decimals(Distance, 1) << " cm").c_str(),
+                                cv::Point(50, 600), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            overlayText(overlay, (FrameText() << "Max Trunk: " << decimals(forwardBend.maxTrunkFlexion, 0) << " deg  Hip: " << decimals(forwardBend.maxHipFlexion, 0)
+                                << " deg  Fused Reach: " << decimals(forwardBend.maxFusedReach, 1) << " cm").c_str(),
+                                cv::Point(50, 650), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            //display the normative percentile of the result
+                            overlayText(overlay, normativeText, cv::Point(50, 700), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                        }
+
+                        break;
                     }
 
-                    bodyFrame->Release();
+
                 }
-                cv::imshow("Seated Forward Bent Test", bgrMat);
             }
-
-            delete[] colorBuffer;
-            colorFrame->Release();
-            frameDescription->Release();
         }
 
-        if (cv::waitKey(30) == 13) break;
+        pipeline.publishOverlay(overlay);
+        frameArena().reset();
+        PROFILE_FRAME_END();
     }
 
-    colorFrameReader->Release();
-    bodyFrameReader->Release();
-    coordinateMapper->Release();
-    colorSource->Release();
-    sensor->Close();
-    sensor->Release();
+    pipeline.stop();
 
     return 0;
 }
@@ -3,12 +3,23 @@
 #include <opencv2/opencv.hpp>
 #include <iostream>
 #include <vector>
-#include <deque> // For stability history tracking
 #include <fstream>
 #include <vector>
 #include <sstream>
 #include <string>
 #include<sapi.h>
+#include "../Common/NormativeScoring.h"
+#include "../Common/FrameProfiler.h"
+#include "../Common/OverlayRenderer.h"
+#include "../Common/FramePipeline.h"
+#include "../Common/FrameArena.h"
+#include "../Common/DiagnosticLog.h"
+#include "../Common/KinectLease.h"
+#include "../Common/FloorPlane.h"
+#include "../Common/DepthPointCloud.h"
+#include "../Common/SingleLegStance.h"
+#include "../Common/ParticipantIdentity.h"
+#include "../Common/TrackingLock.h"
 using namespace std;
 
 
@@ -48,22 +59,12 @@ bool isPersonStable = false;
 bool isTestReady = false;
 bool isTestStarted = false;
 bool isTestCompleted = false;
-bool isRightFootRaised = false;
-bool isLeftFootRaised = false;
-bool rightFootRaised = false;
-bool leftFootRaised = false;
 
+//both stances, whichever foot is lifted first, timed from the body frame times
+SingleLegStanceTimer stanceTimer;
+//bone length signature matched to the day's participants (participants.csv), its ID goes into the result record
+ParticipantIdentifier participantIdentity;
 
-std::chrono::duration<float> rightFootTimeElapsed;
-std::chrono::duration<float> leftFootTimeElapsed;
-std::chrono::steady_clock::time_point rightFootStartTime;
-std::chrono::steady_clock::time_point rightFootEndTime;
-std::chrono::steady_clock::time_point leftFootStartTime;
-std::chrono::steady_clock::time_point leftFootEndTime;
-
-
-bool isRightFootInAir = false;  // Flag to check if the right foot is in the air
-bool isLeftFootInAir = false;   // Flag to check if the left foot is in the air
 bool TestReadySpoken = false;
 
 //variables to store coordinates of both foot
@@ -76,35 +77,62 @@ float initialLeftFootY = 0.0f;
 float initialLeftFootZ = 0.0f;
 
 
-//Thresholds for footraised
+//Thresholds for footraised, the lift threshold (m, above the floor or in camera Y) is stanceTimer.liftThreshold
 float rightFootRaisedThresholdZ = 0.1f;
 float leftFootRaisedThresholdZ = 0.1f;
-float rightFootRaisedThresholdY = 0.1f;
-float leftFootRaisedThresholdY = 0.1f;
+
+//foot heights above the floor when the test got ready, the lift is measured from these when the floor was known then
+bool footLiftFromFloor = false;
+float initialRightFootHeight = 0.0f;
+float initialLeftFootHeight = 0.0f;
+
+//how far a foot was lifted since the test got ready (m): the change of its height above the floor, so stepping
+//sideways or a tilted sensor does not count, or the change of camera Y when no floor was found yet
+float footLift(const FloorPlane& floor, const CameraSpacePoint& foot, float initialHeight, float initialY) {
+    if (footLiftFromFloor && floor.valid) return floor.height(foot) - initialHeight;
+    return fabs(initialY - foot.Y);
+}
 
 float rightFootElapsedTime = 0.0f;
 float leftFootElapsedTime = 0.0f;
 
 
-void logStandingOnOneLegTest(const std::vector<double>& rightFootElapsedTime, const std::vector<double>& leftFootElapsedTime) {
+//both stance times (NULL for a foot that was not timed), the first foot and the longest time with its normative score
+void logStandingOnOneLegTest(const SingleLegStanceTimer& stance, const NormativeScore& score, const ParticipantIdentifier& identity) {
     std::string filename = "Standing_on_One_Leg_with_Eye_Open_Test_Results_2.csv";
 
-    std::ofstream outfile(filename, std::ios::trunc);  // Open file in truncate mode (overwrite)
+    // Check if the file exists, the header is written only to a new file
+    std::ifstream infile(filename);
+    bool fileExists = infile.good();
+    infile.close();
+
+    std::ofstream outfile(filename, std::ios::app);  // Open file in append mode, every trial is kept
     if (!outfile) {
         std::cerr << "Error: Could not open file for writing.\n";
         return;
     }
 
-    // Write the header
-    outfile << "Standing on One Leg with Eye Open (s) 2\n";
-
-    // Ensure vectors are not empty
-    double maxRightFoot = rightFootElapsedTime.empty() ? 0.0 : *std::max_element(rightFootElapsedTime.begin(), rightFootElapsedTime.end());
-    double maxLeftFoot = leftFootElapsedTime.empty() ? 0.0 : *std::max_element(leftFootElapsedTime.begin(), leftFootElapsedTime.end());
-    double maxOverall = std::max(maxRightFoot, maxLeftFoot);
+    // Write header only if file is new
+    if (!fileExists) {
+        outfile << "Standing on One Leg with Eye Open (s) 2,Percentile,Z Score,Right Foot (s),Left Foot (s),First Foot" << participantColumnsHeader << "\n";
+    }
 
-    // Write only the max overall standing time
-    outfile << std::fixed << std::setprecision(2) << maxOverall << "\n";
+    // Write the max overall standing time of this trial in a new row, with its normative score
+    outfile << std::fixed << std::setprecision(2) << stance.longest() << ",";
+    if (score.valid) {
+        outfile << score.percentile << "," << score.zScore;
+    }
+    else {
+        outfile << "NULL,NULL";
+    }
+    for (int leg : { Leg_Right, Leg_Left }) {
+        outfile << ",";
+        if (stance.leg(leg).phase == Stance_Timed) outfile << stance.leg(leg).duration;
+        else outfile << "NULL";
+    }
+    outfile << "," << (stance.firstLeg() < 0 ? "NULL" : stanceLegName(stance.firstLeg()));
+    writeParticipantColumns(outfile, identity);
+    outfile << "\n";
 
     outfile.close();
 }
@@ -113,335 +141,362 @@ const int stabilityFramesThreshold = 17; // Number of frames to check for stabil
 const float stabilityYThreshold = 0.1f; // Y-coordinate fluctuation threshold for stability
 //const float stabilityXThreshold = 0.05f; // X-coordinate fluctuation threshold for stability 0.05f; // X-coordinate fluctuation threshold for stability
 
-// Deques to store Y-coordinate history for stability detection
-std::deque<float> leftFootYHistory, rightFootYHistory;
-
-//timer library variables
-std::chrono::steady_clock::time_point startTime;  // Store the start time when the foot is raised
-std::chrono::steady_clock::time_point endTime;    // Store the end time when the foot comes back down
+// Y-coordinate history for stability detection, the last stabilityFramesThreshold frames in fixed rings
+typedef FrameRing<float, stabilityFramesThreshold> StabilityHistory;
+StabilityHistory leftFootYHistory, rightFootYHistory;
+
+//puts the protocol back to waiting for stable feet, the sensor and body tracking stay open
+void rearmTest() {
+    isPersonStable = false;
+    isTestReady = false;
+    isTestStarted = false;
+    isTestCompleted = false;
+    stanceTimer.reset();
+    participantIdentity.reset();
+    TestReadySpoken = false;
+
+    initialRightFootX = initialRightFootY = initialRightFootZ = 0.0f;
+    initialLeftFootX = initialLeftFootY = initialLeftFootZ = 0.0f;
+    footLiftFromFloor = false;
+    initialRightFootHeight = initialLeftFootHeight = 0.0f;
+    rightFootElapsedTime = leftFootElapsedTime = 0.0f;
+
+    leftFootYHistory.clear();
+    rightFootYHistory.clear();
+}
 
 
 // Function to check stability
-bool isStable(const std::deque<float>& history, float threshold) {
-    if (history.size() < stabilityFramesThreshold) return false;
-    float minVal = *std::min_element(history.begin(), history.end());
-    float maxVal = *std::max_element(history.begin(), history.end());
+bool isStable(const StabilityHistory& history, float threshold) {
+    if (!history.full()) return false;
+    float minVal = history[0], maxVal = history[0];
+    for (size_t i = 1; i < history.size(); ++i) {
+        minVal = std::min(minVal, history[i]);
+        maxVal = std::max(maxVal, history[i]);
+    }
     return (maxVal - minVal) <= threshold;
 }
 
 
 int main() {
     // Initialize Kinect Sensor, readers, and coordinate mapper
-    IKinectSensor* sensor = nullptr;
-    IColorFrameReader* colorFrameReader = nullptr;
-    IBodyFrameReader* bodyFrameReader = nullptr;
-    ICoordinateMapper* coordinateMapper = nullptr;
+    //closed and released when main returns, on every return path
+    KinectSensorLease sensor;
+    ComLease<ICoordinateMapper> coordinateMapper;
 
-    if (FAILED(GetDefaultKinectSensor(&sensor)) || !sensor) {
+    if (!sensor.open()) {
         std::cerr << "Kinect sensor not found!" << std::endl;
         return -1;
     }
-    sensor->Open();
-    sensor->get_CoordinateMapper(&coordinateMapper);
-
-    IColorFrameSource* colorSource = nullptr;
-    sensor->get_ColorFrameSource(&colorSource);
-    colorSource->OpenReader(&colorFrameReader);
-
-    IBodyFrameSource* bodySource = nullptr;
-    sensor->get_BodyFrameSource(&bodySource);
-    bodySource->OpenReader(&bodyFrameReader);
+    sensor->get_CoordinateMapper(coordinateMapper.put());
+
+    //the floor is refitted from a depth frame every few seconds on its own thread
+    //its depth pixel rays come from the sensor's calibration, kept in depth_rays.bin for replaying recorded depth
+    FloorPlaneEstimator floorEstimator;
+    DepthRayTable& depthRays = floorEstimator.fitter.rays;
+    if (depthRays.fromMapper(coordinateMapper.get())) {
+        depthRays.save("depth_rays.bin");
+    }
+    else if (!depthRays.load("depth_rays.bin")) {
+        DIAG_WARNING("No depth calibration yet, the floor is fitted with the nominal depth camera");
+    }
+    floorEstimator.start();
+    bool floorReported = false;
 
-    cv::namedWindow("Standing on One Leg with Eye Open", cv::WINDOW_AUTOSIZE);
+    //acquisition, color conversion and display run on their own threads, the test logic below gets every body frame
+    FramePipeline pipeline;
+    pipeline.depthConsumer = [&floorEstimator](const UINT16* depth, TIMESPAN time) { floorEstimator.offer(depth, time); };
+    if (!pipeline.start(sensor.get(), FrameSourceTypes_Color | FrameSourceTypes_Depth | FrameSourceTypes_Body, "Standing on One Leg with Eye Open")) {
+        return -1;
+    }
+    BodyFrame bodyFrame;
+    OverlayList overlay;
+    PROFILE_SESSION("Standing_on_One_Leg_Test");
 
     bool messagePrinted = false; // Flag to track if message has been printed
-    UINT64 trackedID = 0;  // Track the first participant
-    bool isTrackingLocked = false;  // Ensure tracking remains locked
+    //the participant followed by tracking ID, bystanders never take over the test
+    TrackingLock trackingLock;
+
+    //reference table for the percentile shown at the end of the test
+    NormativeTable normativeTable;
+    normativeTable.load("averaged_data.csv");
+    participantIdentity.load("participants.csv");
+    std::string normativeText;
 
     // Frame loop
-    while (true) {
-        IColorFrame* colorFrame = nullptr;
-        HRESULT hrColor = colorFrameReader->AcquireLatestFrame(&colorFrame);
-
-        if (SUCCEEDED(hrColor)) {
-            IFrameDescription* frameDescription = nullptr;
-            colorFrame->get_FrameDescription(&frameDescription);
-
-            int width, height;
-            frameDescription->get_Width(&width);
-            frameDescription->get_Height(&height);
-
-            UINT bufferSize = width * height * 4;
-            BYTE* colorBuffer = new BYTE[bufferSize];
-            hrColor = colorFrame->CopyConvertedFrameDataToArray(bufferSize, colorBuffer, ColorImageFormat_Bgra);
-
-            if (SUCCEEDED(hrColor)) {
-                cv::Mat colorMat(height, width, CV_8UC4, colorBuffer);
-                cv::Mat bgrMat;
-                cv::cvtColor(colorMat, bgrMat, cv::COLOR_BGRA2BGR);
-
-                IBodyFrame* bodyFrame = nullptr;
-                HRESULT hrBody = bodyFrameReader->AcquireLatestFrame(&bodyFrame);
-
-                if (SUCCEEDED(hrBody)) {
-                    IBody* bodies[BODY_COUNT] = { 0 };
-                    hrBody = bodyFrame->GetAndRefreshBodyData(_countof(bodies), bodies);
-
-                    bool foundTrackedBody = false;
-
-                    for (int i = 0; i < BODY_COUNT; ++i) {
-                        IBody* body = bodies[i];
-                        if (body) {
-                            BOOLEAN isTracked = false;
-                            body->get_IsTracked(&isTracked);
-
-                            if (isTracked) {
-                                // Print messages only once when a person is detected for the first time
-                                UINT64 currentID;
-                                body->get_TrackingId(&currentID);
-
-                                if (!isTrackingLocked) {
-                                    trackedID = currentID;
-                                    isTrackingLocked = true;
-                                    std::cout << "Participant Locked: " << trackedID << std::endl;
-                                }
-                                else if (trackedID != currentID) {
-                                    // If a new person is detected, terminate the program
-                                    std::cout << "Test Invalidated! New person detected." << std::endl;
-                                    exit(0);
-                                }
+    while (pipeline.isRunning()) {
+        overlay.clear();
+
+        //R in the window re-arms the test for the next trial, it applies from this frame on
+        int key = pipeline.takeKey();
+        if (key == 'r' || key == 'R') {
+            rearmTest();
+            messagePrinted = false;
+            trackingLock.release();
+            normativeText.clear();
+            DIAG_INFO("Test re-armed for the next trial");
+            speak("Ready for the next trial");
+        }
+        //Y and N answer the question of a participant left unidentified (Identity_Ambiguous): the nearest, or someone new
+        if ((key == 'y' || key == 'Y') && participantIdentity.confirmCandidate()) {
+            DIAG_INFO("Participant confirmed by the operator: {}", participantIdentity.participantId());
+        }
+        if ((key == 'n' || key == 'N') && participantIdentity.confirmNew()) {
+            DIAG_INFO("New participant enrolled by the operator: {}", participantIdentity.participantId());
+        }
+        if (participantIdentity.awaitingConfirmation()) {
+            overlayText(overlay, (FrameText() << "Participant " << participantIdentity.ambiguousWith() << "? Y yes, N new participant").c_str(),
+                cv::Point(50, 1000), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 255), 2);
+        }
 
-                                foundTrackedBody = true;
+        int width = pipeline.colorWidth;
+        int height = pipeline.colorHeight;
 
-                                Joint joints[JointType_Count];
-                                body->GetJoints(_countof(joints), joints);
-                                std::vector<cv::Point> jointPoints;  // Store valid joint positions
+        if (pipeline.nextBodyFrame(bodyFrame)) {
+            BodySnapshot* bodies = bodyFrame.bodies;
+            FloorPlane floor = floorEstimator.plane();
+            if (floor.valid && !floorReported) {
+                floorReported = true;
+                DIAG_INFO("Floor found, sensor {} m above it, tilted {} degrees", floor.d, floor.tiltDegrees());
+            }
 
-                                for (int j = 0; j < JointType_Count; ++j) {
-                                    if (joints[j].TrackingState == TrackingState_Tracked) {
-                                        ColorSpacePoint colorPoint;
-                                        coordinateMapper->MapCameraPointToColorSpace(joints[j].Position, &colorPoint);
+            //the locked participant among the six bodies; someone entering during a timed stance invalidates only that
+            //attempt, the lock stays and a completed result is kept
+            int lockedBody = trackingLock.update(bodies);
+            if (trackingLock.newlyLocked()) DIAG_INFO("Participant Locked: {}", trackingLock.id());
+            if (trackingLock.newcomer() && isTestStarted && !isTestCompleted) {
+                DIAG_WARNING("Test Invalidated! New person detected.");
+                speak("Test invalidated, new person detected");
+                rearmTest();
+                messagePrinted = false;
+            }
+            if (trackingLock.locked() && lockedBody < 0) {
+                overlayText(overlay, "Participant not in view, R re-arms for the next one", cv::Point(50, 950), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 255), 2);
+            }
 
-                                        int x = static_cast<int>(colorPoint.X);
-                                        int y = static_cast<int>(colorPoint.Y);
+            for (int i = 0; i < BODY_COUNT; ++i) {
+                BodySnapshot* body = &bodies[i];
+                if (body && i == lockedBody) {
+                    BOOLEAN isTracked = false;
+                    body->get_IsTracked(&isTracked);
+
+                    if (isTracked) {
+                        Joint joints[JointType_Count];
+                        body->GetJoints(_countof(joints), joints);
+                        PROFILE_STAGE_BEGIN(Stage_TestLogic);
+
+                        //bone length signature of this participant, matched to the day's participants and watched for a swap
+                        switch (participantIdentity.update(joints)) {
+                        case Identity_Matched:
+                            DIAG_INFO("Participant identified: {} ({} cm)", participantIdentity.participantId(), participantIdentity.matchedDistance() * 100.0f);
+                            break;
+                        case Identity_Enrolled:
+                            DIAG_INFO("New participant enrolled: {}", participantIdentity.participantId());
+                            break;
+                        case Identity_Ambiguous:
+                            DIAG_WARNING("Participant not identified: {} cm from {}, not clearly the same participant, Y or N in the window", participantIdentity.matchedDistance() * 100.0f,
+                                participantIdentity.ambiguousWith());
+                            break;
+                        case Identity_Swapped:
+                            DIAG_WARNING("Participant swap! {} no longer matches the skeleton, now like: {}", participantIdentity.participantId(),
+                                participantIdentity.recentMatch());
+                            break;
+                        default:
+                            break;
+                        }
 
-                                        // Debugging output
-                                        //std::cout << "Joint " << j << " -> X: " << x << ", Y: " << y << std::endl;
+                        PROFILE_STAGE_BEGIN(Stage_Mapping);
+                        ArenaVector<cv::Point> jointPoints(frameArena());  // Store valid joint positions
+                        jointPoints.reserve(JointType_Count);
 
-                                        if (x > 0 && x < width && y > 0 && y < height) {
-                                            jointPoints.push_back(cv::Point(x, y));
-                                        }
-                                    }
-                                }
+                        for (int j = 0; j < JointType_Count; ++j) {
+                            if (joints[j].TrackingState == TrackingState_Tracked) {
+                                ColorSpacePoint colorPoint;
+                                coordinateMapper->MapCameraPointToColorSpace(joints[j].Position, &colorPoint);
 
-                                // If we have valid joint points, draw bounding box
-                                if (!jointPoints.empty()) {
-                                    cv::Rect boundingRect = cv::boundingRect(jointPoints);
-                                    cv::rectangle(bgrMat, boundingRect, cv::Scalar(0, 255, 0), 2);
+                                int x = static_cast<int>(colorPoint.X);
+                                int y = static_cast<int>(colorPoint.Y);
 
-                                }
-                                float leftFootY = 0, rightFootY = 0;
-
-                                // Only draw circles for the left and right foot joints
-                                for (int j = 0; j < JointType_Count; j++) {
-                                    if (joints[j].TrackingState == TrackingState_Tracked &&
-                                        (j == JointType_FootLeft || j == JointType_FootRight)) {
-
-                                        // Use the raw camera space coordinates (meters)
-                                        float x = joints[j].Position.X;
-                                        float y = joints[j].Position.Y;
-                                        float z = joints[j].Position.Z;
-
-                                        // Save specific Y values for the joints
-                                        if (j == JointType_FootLeft) {
-                                            leftFootY = y;
-                                        }
-                                        else if (j == JointType_FootRight) {
-                                            rightFootY = y;
-                                        }
-
-                                        // Convert camera space to color space only for visualization
-                                        ColorSpacePoint colorPoint;
-                                        coordinateMapper->MapCameraPointToColorSpace(joints[j].Position, &colorPoint);
-                                        int cx = static_cast<int>(colorPoint.X); // Pixel coordinates for the live feed
-                                        int cy = static_cast<int>(colorPoint.Y);
-
-                                        // Ensure the pixel coordinates are within bounds before drawing
-                                        if (cx >= 0 && cx < width && cy >= 0 && cy < height) {
-                                            cv::circle(bgrMat, cv::Point(cx, cy), 10, cv::Scalar(255, 0, 0), -1); // Draw a circle with radius 10
-
-                                            // Add text label next to the joints
-                                            if (j == JointType_FootLeft) {
-                                                cv::putText(bgrMat, "Left Foot", cv::Point(cx + 10, cy), cv::FONT_HERSHEY_SIMPLEX, 1, cv::Scalar(0, 255, 0), 2);
-                                            }
-                                            else if (j == JointType_FootRight) {
-                                                cv::putText(bgrMat, "Right Foot", cv::Point(cx + 10, cy), cv::FONT_HERSHEY_SIMPLEX, 1, cv::Scalar(0, 255, 0), 2);
-                                            }
-
-                                            // Display the decimal camera space coordinates
-                                            cv::putText(bgrMat, "X: " + std::to_string(x) + " Y: " + std::to_string(y) + " Z: " + std::to_string(z),
-                                                cv::Point(cx + 10, cy + 20), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 255, 0), 1);
-                                        }
-                                    }
-                                }
+                                // Debugging output
+                                //std::cout << "Joint " << j << " -> X: " << x << ", Y: " << y << std::endl;
 
-                                // Update history
-                                if (leftFootYHistory.size() >= stabilityFramesThreshold) leftFootYHistory.pop_front();
-                                if (rightFootYHistory.size() >= stabilityFramesThreshold) rightFootYHistory.pop_front();
-
-                                leftFootYHistory.push_back(leftFootY);
-                                rightFootYHistory.push_back(rightFootY);
-
-                                // Check stability
-                                bool leftFootStable = isStable(leftFootYHistory, stabilityYThreshold);
-                                bool rightFootStable = isStable(rightFootYHistory, stabilityYThreshold);
-
-                                // Conditional statement: When feet are stable, print message
-                                if (leftFootStable && rightFootStable && !messagePrinted && !isTestReady && !isTestStarted && !isPersonStable) {
-                                    messagePrinted = true; // Set the flag to true to prevent repeated printing
-                                    isTestReady = true;
-                                    isPersonStable = true;
-                                    speak("Test Ready");
-                                    if (!TestReadySpoken)
-                                        TestReadySpoken = true;
-                                    speak("Please raise your right foot");
-
-                                    //std::cout << "Test Ready" << std::endl;
-                                    //std::cout << "Feet are stable." << std::endl;
-
-                                    // Display initial Y coordinates for feet
-                                   // std::cout << "Initial Left Foot Y: " << leftFootY << std::endl;
-                                    //std::cout << "Initial Right Foot Y: " << rightFootY << std::endl;
-
-                                    initialRightFootX = joints[JointType_FootRight].Position.X;
-                                    initialRightFootY = joints[JointType_FootRight].Position.Y;
-                                    initialRightFootZ = joints[JointType_FootRight].Position.Z;
-                                    initialLeftFootX = joints[JointType_FootLeft].Position.X;
-                                    initialLeftFootY = joints[JointType_FootLeft].Position.Y;
-                                    initialLeftFootZ = joints[JointType_FootLeft].Position.Z;
-                                    //std::cout << "Right Foot Coordinates | x: " << joints[JointType_FootRight].Position.X << "  | y: " << rightFootY << " | z: " << joints[JointType_FootRight].Position.Z << " |" << std::endl;
-                                    //std::cout << "Left Foot Coordinates  | x: " << joints[JointType_FootLeft].Position.X << "  | y: " << leftFootY << " | z: " << joints[JointType_FootLeft].Position.Z << " |" << std::endl;
-                                    //std::cout << "Please Raise your Dominant Foot " << std::endl;
-                                    //speak("Test Ready");
+                                if (x > 0 && x < width && y > 0 && y < height) {
+                                    jointPoints.push_back(cv::Point(x, y));
                                 }
-                                if (messagePrinted && isPersonStable && isTestReady && !isTestStarted)
-                                {
-                                    cv::putText(bgrMat, "Test Ready", cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
-                                    cv::putText(bgrMat, "Please Raise your Right Foot", cv::Point(50, 100), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
-                                    //speak("Test Ready");
-                                    //speak("Please Raise your Right Foot");
+                            }
+                        }
+
+                        PROFILE_STAGE_END(Stage_Mapping);
+
+                        // If we have valid joint points, draw bounding box
+                        if (!jointPoints.empty()) {
+                            PROFILE_STAGE_BEGIN(Stage_Overlay);
+                            cv::Rect boundingRect = cv::boundingRect(pointsView(jointPoints));
+                            overlayRectangle(overlay, boundingRect, cv::Scalar(0, 255, 0), 2);
+
+                        }
+                        float leftFootY = 0, rightFootY = 0;
+
+                        // Only draw circles for the left and right foot joints
+                        for (int j = 0; j < JointType_Count; j++) {
+                            if (joints[j].TrackingState == TrackingState_Tracked &&
+                                (j == JointType_FootLeft || j == JointType_FootRight)) {
+
+                                // Use the raw camera space coordinates (meters)
+                                float x = joints[j].Position.X;
+                                float y = joints[j].Position.Y;
+                                float z = joints[j].Position.Z;
+
+                                // Save specific Y values for the joints
+                                if (j == JointType_FootLeft) {
+                                    leftFootY = y;
                                 }
-                                //if person has a dominant foot of right foot, then raises right foot first if timer > 70, test complete if timer < 70 raisess left foot first and then test is complete
-                                // IN CASE IF THE DOMINANT FOOT WAS RIGHT FOOT
-                                //first Right Foot is raised
-                                if ((fabs(initialRightFootY - joints[JointType_FootRight].Position.Y) > rightFootRaisedThresholdY)&& !rightFootRaised && !leftFootRaised && !isTestStarted && isPersonStable && messagePrinted) {
-                                    rightFootRaised = true;
-                                    isTestStarted = true;
-                                    //std::cout << "Test Started" << std::endl;
-                                    //std::cout << "Right Foot Raised" << std::endl;
-                                    //std::cout << "Timer Started for Right Foot" << std::endl;
-
-                                    // Start the timer when the right foot is raised
-                                    rightFootStartTime = std::chrono::steady_clock::now();
-                                    isRightFootInAir = true;
+                                else if (j == JointType_FootRight) {
+                                    rightFootY = y;
                                 }
 
-                                else if ((fabs(initialRightFootY - joints[JointType_FootRight].Position.Y) <= rightFootRaisedThresholdY) && rightFootRaised && isRightFootInAir && isTestStarted && !isTestCompleted && isPersonStable && messagePrinted) {
-                                    // Stop the timer when the right foot touches the ground
-
-                                    rightFootEndTime = std::chrono::steady_clock::now();
-                                    rightFootTimeElapsed = rightFootEndTime - rightFootStartTime;
-                                    /*std::cout << "Right Foot Returned to Ground." << std::endl;
-                                    std::cout << "Right Foot in the air for: " << rightFootTimeElapsed.count() << " seconds." << std::endl;
-                                    */
-                                    rightFootElapsedTime = rightFootTimeElapsed.count();
-                                    if (rightFootTimeElapsed.count() > 60.0f)
-                                    {
-                                        isTestCompleted = true;
-                                        /*std::cout << "Dominant Foot Time Greater Than 60 seconds, no need to do test for left Foot" << std::endl;
-                                        std::cout << "Test Complete" << std::endl;
-                                        */
-                                        speak("Test complete");
+                                // Convert camera space to color space only for visualization
+                                ColorSpacePoint colorPoint;
+                                coordinateMapper->MapCameraPointToColorSpace(joints[j].Position, &colorPoint);
+                                int cx = static_cast<int>(colorPoint.X); // Pixel coordinates for the live feed
+                                int cy = static_cast<int>(colorPoint.Y);
+
+                                // Ensure the pixel coordinates are within bounds before drawing
+                                if (cx >= 0 && cx < width && cy >= 0 && cy < height) {
+                                    PROFILE_STAGE_BEGIN(Stage_Overlay);
+                                    overlayCircle(overlay, cv::Point(cx, cy), 10, cv::Scalar(255, 0, 0), -1); // Draw a circle with radius 10
+                                    PROFILE_STAGE_END(Stage_Overlay);
+
+                                    // Add text label next to the joints
+                                    if (j == JointType_FootLeft) {
+                                        overlayText(overlay, "Left Foot", cv::Point(cx + 10, cy), cv::FONT_HERSHEY_SIMPLEX, 1, cv::Scalar(0, 255, 0), 2);
                                     }
-                                    else if (rightFootTimeElapsed.count() <= 60.0f)
-                                    {
-                                        //std::cout << "Right Foot Time Less Than 60 seconds, Please Raise Your Left Foot." << std::endl;
-                                        speak("Please Raise Your Left Foot");
+                                    else if (j == JointType_FootRight) {
+                                        overlayText(overlay, "Right Foot", cv::Point(cx + 10, cy), cv::FONT_HERSHEY_SIMPLEX, 1, cv::Scalar(0, 255, 0), 2);
                                     }
-                                    isRightFootInAir = false;
-                                }
-                                //then left foot is raised
-                                if ((fabs(initialLeftFootY - joints[JointType_FootLeft].Position.Y) >leftFootRaisedThresholdY) && !leftFootRaised && rightFootRaised && isTestStarted && !isTestCompleted && isPersonStable && messagePrinted) {
-                                    leftFootRaised = true;
-                                    /*std::cout << "Left Foot Raised" << std::endl;
-                                    std::cout << "Timer Started for Left Foot" << std::endl;*/
-
-                                    // Start the timer when the left foot is raised
-                                    leftFootStartTime = std::chrono::steady_clock::now();
-                                    isLeftFootInAir = true;
-                                }
-                                // Condition when the left foot touches the ground (timer stops)
-                                else if ((fabs(initialLeftFootY - joints[JointType_FootLeft].Position.Y) <= leftFootRaisedThresholdY) && leftFootRaised && isLeftFootInAir && isTestStarted && !isTestCompleted && isPersonStable && messagePrinted) {
-                                    // Stop the timer when the left foot touches the ground
-                                    leftFootEndTime = std::chrono::steady_clock::now();
-                                    leftFootTimeElapsed = leftFootEndTime - leftFootStartTime;
-                                    /*std::cout << "Left Foot Returned to Ground." << std::endl;
-                                    std::cout << "Left Foot in the air for: " << leftFootTimeElapsed.count() << " seconds." << std::endl;*/
-
-                                    // Mark test as completed
-                                    isTestCompleted = true;
-                                    //std::cout << "Test Complete" << std::endl;
-                                    speak("Test Complete");
-                                    // Print time taken by left foot
-                                    //std::cout << "Left Foot Time: " << leftFootTimeElapsed.count() << " seconds." << std::endl;
-                                    // Print time taken by right foot
-                                    //std::cout << "Right Foot Time: " << rightFootTimeElapsed.count() << " seconds." << std::endl;
-                                    rightFootElapsedTime = rightFootTimeElapsed.count();
-                                    leftFootElapsedTime = leftFootTimeElapsed.count();
-                                    logStandingOnOneLegTest({ static_cast<double>(rightFootElapsedTime) },
-                                        { static_cast<double>(leftFootElapsedTime) });
-                                }
-                                if (isTestCompleted)
-                                {
-                                    //put text to display test completed
-                                    cv::putText(bgrMat, "Test Completed", cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
-                                    cv::putText(bgrMat, "Right Foot Time: " + std::to_string(rightFootElapsedTime), cv::Point(50, 550), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
-                                    cv::putText(bgrMat, "Left Foot Time: " + std::to_string(leftFootElapsedTime), cv::Point(50, 600), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
-                                    //speak("Test Completed");
-                                }
 
-                                break;
+                                    // Display the decimal camera space coordinates, and the height above the floor once known
+                                    FrameText coordinates;
+                                    coordinates << "X: " << x << " Y: " << y << " Z: " << z;
+                                    if (floor.valid) coordinates << " H: " << floor.height(joints[j].Position);
+                                    overlayText(overlay, coordinates.c_str(),
+                                        cv::Point(cx + 10, cy + 20), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 255, 0), 1);
+                                }
                             }
-
                         }
-                    }
 
-                    for (int i = 0; i < BODY_COUNT; ++i) {
-                        if (bodies[i]) {
-                            bodies[i]->Release();
+                        // Update history, the oldest value drops out once the ring is full
+                        leftFootYHistory.push(leftFootY);
+                        rightFootYHistory.push(rightFootY);
+
+                        // Check stability
+                        bool leftFootStable = isStable(leftFootYHistory, stabilityYThreshold);
+                        bool rightFootStable = isStable(rightFootYHistory, stabilityYThreshold);
+
+                        // Conditional statement: When feet are stable, print message
+                        if (leftFootStable && rightFootStable && !messagePrinted && !isTestReady && !isTestStarted && !isPersonStable) {
+                            messagePrinted = true; // Set the flag to true to prevent repeated printing
+                            isTestReady = true;
+                            isPersonStable = true;
+                            speak("Test Ready");
+                            if (!TestReadySpoken)
+                                TestReadySpoken = true;
+                            speak("Please raise one foot");
+
+                            //std::cout << "Test Ready" << std::endl;
+                            //std::cout << "Feet are stable." << std::endl;
+
+                            // Display initial Y coordinates for feet
+                           // std::cout << "Initial Left Foot Y: " << leftFootY << std::endl;
+                            //std::cout << "Initial Right Foot Y: " << rightFootY << std::endl;
+
+                            initialRightFootX = joints[JointType_FootRight].Position.X;
+                            initialRightFootY = joints[JointType_FootRight].Position.Y;
+                            initialRightFootZ = joints[JointType_FootRight].Position.Z;
+                            initialLeftFootX = joints[JointType_FootLeft].Position.X;
+                            initialLeftFootY = joints[JointType_FootLeft].Position.Y;
+                            initialLeftFootZ = joints[JointType_FootLeft].Position.Z;
+                            footLiftFromFloor = floor.valid;
+                            if (footLiftFromFloor) {
+                                initialRightFootHeight = floor.height(joints[JointType_FootRight].Position);
+                                initialLeftFootHeight = floor.height(joints[JointType_FootLeft].Position);
+                            }
+                            stanceTimer.start();
+                            //std::cout << "Right Foot Coordinates | x: " << joints[JointType_FootRight].Position.X << "  | y: " << rightFootY << " | z: " << joints[JointType_FootRight].Position.Z << " |" << std::endl;
+                            //std::cout << "Left Foot Coordinates  | x: " << joints[JointType_FootLeft].Position.X << "  | y: " << leftFootY << " | z: " << joints[JointType_FootLeft].Position.Z << " |" << std::endl;
+                            //std::cout << "Please Raise your Dominant Foot " << std::endl;
+                            //speak("Test Ready");
+                        }
+                        if (messagePrinted && isPersonStable && isTestReady && !isTestStarted)
+                        {
+                            overlayText(overlay, "Test Ready", cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            overlayText(overlay, "Please Raise One Foot", cv::Point(50, 100), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            //speak("Test Ready");
+                            //speak("Please Raise your Right Foot");
+                        }
+                        //both legs go through the stance timer every frame, the first foot lifted starts the test and the
+                        //other foot is asked for once it is down, unless the first stance was over a minute
+                        double frameSeconds = bodyFrame.relativeTime * 1e-7;
+                        StanceEvent stanceEvent = stanceTimer.update(
+                            footLift(floor, joints[JointType_FootLeft].Position, initialLeftFootHeight, initialLeftFootY),
+                            footLift(floor, joints[JointType_FootRight].Position, initialRightFootHeight, initialRightFootY), frameSeconds);
+                        if (stanceEvent == StanceEvent_LiftOff) {
+                            isTestStarted = true;
+                            DIAG_INFO("{} Foot Raised", stanceLegName(stanceTimer.lastLeg()));
+                        }
+                        else if (stanceEvent == StanceEvent_TouchDown) {
+                            DIAG_INFO("{} Foot in the air for {} s", stanceLegName(stanceTimer.lastLeg()),
+                                stanceTimer.leg(stanceTimer.lastLeg()).duration);
+                            speak(std::string("Please Raise Your ") + stanceLegName(stanceTimer.nextLeg()) + " Foot");
+                        }
+                        else if (stanceEvent == StanceEvent_Completed) {
+                            isTestCompleted = true;
+                            speak("Test complete");
+                            rightFootElapsedTime = stanceTimer.leg(Leg_Right).duration;
+                            leftFootElapsedTime = stanceTimer.leg(Leg_Left).duration;
+                            DIAG_INFO("Right Foot Time: {} s, Left Foot Time: {} s, First Foot: {}", rightFootElapsedTime, leftFootElapsedTime,
+                                stanceLegName(stanceTimer.firstLeg()));
+
+                            NormativeScore normativeScore = normativeTable.score(Norm_StandingOneLeg, stanceTimer.longest());
+                            normativeText = formatNormativeScore(normativeScore);
+                            logStandingOnOneLegTest(stanceTimer, normativeScore, participantIdentity);
+                        }
+                        if (isTestStarted && !isTestCompleted)
+                        {
+                            float lifted = stanceTimer.liftedTime(frameSeconds);
+                            if (lifted > 0.0f) {
+                                overlayText(overlay, (FrameText() << "Foot Raised: " << decimals(lifted, 1) << " s").c_str(),
+                                    cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            }
+                            else if (stanceTimer.nextLeg() >= 0) {
+                                overlayText(overlay, (FrameText() << "Please Raise your " << stanceLegName(stanceTimer.nextLeg()) << " Foot").c_str(),
+                                    cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            }
+                        }
+                        if (isTestCompleted)
+                        {
+                            //put text to display test completed
+                            overlayText(overlay, "Test Completed", cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            overlayText(overlay, (FrameText() << "Right Foot Time: " << decimals(rightFootElapsedTime, 2) << "s").c_str(), cv::Point(50, 550), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            overlayText(overlay, (FrameText() << "Left Foot Time: " << decimals(leftFootElapsedTime, 2) << "s").c_str(), cv::Point(50, 600), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            //display the normative percentile of the result
+                            overlayText(overlay, normativeText, cv::Point(50, 650), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            //speak("Test Completed");
                         }
-                    }
 
+                        break;
+                    }
 
-                    bodyFrame->Release();
                 }
-                cv::imshow("Standing on One Leg with Eye Open", bgrMat);
             }
-
-            delete[] colorBuffer;
-            colorFrame->Release();
-            frameDescription->Release();
         }
 
-        if (cv::waitKey(30) == 13) break;
+        pipeline.publishOverlay(overlay);
+        frameArena().reset();
+        PROFILE_FRAME_END();
     }
 
-    colorFrameReader->Release();
-    bodyFrameReader->Release();
-    coordinateMapper->Release();
-    colorSource->Release();
-    sensor->Close();
-    sensor->Release();
+    pipeline.stop();
 
     return 0;
 }
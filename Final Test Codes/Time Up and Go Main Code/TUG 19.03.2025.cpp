@@ -14,6 +14,17 @@
 
 #include <string>
 #include<algorithm>
+#include "../Common/NormativeScoring.h"
+#include "../Common/FrameProfiler.h"
+#include "../Common/OverlayRenderer.h"
+#include "../Common/FramePipeline.h"
+#include "../Common/FrameArena.h"
+#include "../Common/DiagnosticLog.h"
+#include "../Common/KinectLease.h"
+#include "../Common/StationProfile.h"
+#include "../Common/JointKinematics.h"
+#include "../Common/ParticipantIdentity.h"
+#include "../Common/TrackingLock.h"
 using namespace std;
 
 // Constants
@@ -26,8 +37,9 @@ const float Y_COORD_TOLERANCE = 0.05f; // Allowable error in Y-coordinate compar
 // Timer variables
 bool isTiming = false;
 bool reachedTargetDepth = false;
-std::chrono::steady_clock::time_point startTime;
-std::chrono::steady_clock::time_point endTime;
+//body frame times (s) of the timer start and stop, so the time does not include how long a frame waited in the queue
+double startTime = 0.0;
+double endTime = 0.0;
 
 // Initial Y-coordinate for validation
 float initialYCoordinate = -1.0f;
@@ -76,7 +88,7 @@ bool isStable(const std::deque<float>& history, float threshold) {
 }
 
 //data logging function
-void logTUGTestTime(const std::vector<double>& testTimes) {
+void logTUGTestTime(std::initializer_list<double> testTimes, const NormativeScore& score, const ParticipantIdentifier& identity) {
     std::string filename = "Time_Up_and_Go_Test_Results.csv";
     std::ifstream infile(filename);
     std::ofstream outfile;
@@ -90,12 +102,20 @@ void logTUGTestTime(const std::vector<double>& testTimes) {
 
     // Write header only if file is new
     if (!fileExists) {
-        outfile << "Time Up and Go Test (s)\n";
+        outfile << "Time Up and Go Test (s),Percentile,Z Score" << participantColumnsHeader << "\n";
     }
 
-    // Write each test time in a new row
+    // Write each test time in a new row, with its normative score
     for (double time : testTimes) {
-        outfile << std::fixed << std::setprecision(2) << time << "\n";
+        outfile << std::fixed << std::setprecision(2) << time << ",";
+        if (score.valid) {
+            outfile << score.percentile << "," << score.zScore;
+        }
+        else {
+            outfile << "NULL,NULL";
+        }
+        writeParticipantColumns(outfile, identity);
+        outfile << "\n";
     }
 
     outfile.close();
@@ -125,28 +145,61 @@ float rightLegThreshold = 0.2f;
 float leftLegThreshold = 0.2f;
 //standing hips in line with knee threshold
 float standingHipsThreshold = 0.1f;
+//hip flexion (degrees) of a seated participant, checked on a side when its hip and knee are tracked
+const float seatedHipFlexion = 60.0f;
+const float kinematicsConfidence = 0.5f;
+
+//joint angles of every tracked body, computed once per body frame
+KinematicsFrame kinematics;
+
+//chair, turn-around and return gates of this station, C in the window calibrates them from the seated participant
+StationProfile station;
+SeatedCalibration chairCalibration;
+bool isCalibrating = false;
+bool calibrationFailed = false; //the last attempt timed out, shown until R or C
+
+//bone length signature matched to the day's participants (participants.csv), its ID goes into the result record
+ParticipantIdentifier participantIdentity;
+
+//puts the protocol back to waiting for a seated participant, the sensor and body tracking stay open
+void rearmTest() {
+    isTiming = false;
+    reachedTargetDepth = false;
+    startTime = endTime = 0.0;
+    initialYCoordinate = -1.0f;
+
+    isPersonDetected = false;
+    isPersonStable = false;
+    isTestStarted = false;
+    isTimerStarted = false;
+    isTargetDepthReached = false;
+    isTestCompleted = false;
+    isTimerStopped = false;
+
+    initialMidSpineX = 0.0f;
+    initialMidSpineY = 0.0f;
+    initialMidSpineZ = 0.0f;
+    participantIdentity.reset();
+}
 
 
 
 
 // Timer functions
-void startTimer(float depth, float yCoordinate) {
+void startTimer(float depth, float yCoordinate, double frameSeconds) {
     isTiming = true;
     reachedTargetDepth = false; // Reset target depth tracking
-    startTime = std::chrono::steady_clock::now();
+    startTime = frameSeconds;
     //cout << "Timer started! Depth: " << depth << "m, Y-coordinate: " << yCoordinate << endl;
     //display live timer on the screen using put text
 
 
 }
 
-void stopTimer(float depth, float yCoordinate) {
-    endTime = std::chrono::steady_clock::now();
+void stopTimer(float depth, float yCoordinate, double frameSeconds) {
+    endTime = frameSeconds;
     isTiming = false;
 
-    auto elapsedTime = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
-    float elapsedSeconds = elapsedTime / 1000.0f;
-
     //cout << "Timer stopped! Depth: " << depth << "m, Y-coordinate: " << yCoordinate << endl;
     //cout << "Total time taken: " << fixed << setprecision(2) << elapsedSeconds << " seconds" << endl;
 
@@ -157,261 +210,332 @@ void stopTimer(float depth, float yCoordinate) {
 
 // Main program
 int main() {
-    IKinectSensor* sensor = nullptr;
-    IColorFrameReader* colorFrameReader = nullptr;
-    IBodyFrameReader* bodyFrameReader = nullptr;
-    ICoordinateMapper* coordinateMapper = nullptr;
+    //closed and released when main returns, on every return path
+    KinectSensorLease sensor;
+    ComLease<ICoordinateMapper> coordinateMapper;
 
-    if (FAILED(GetDefaultKinectSensor(&sensor)) || !sensor) {
+    if (!sensor.open()) {
         cerr << "Kinect sensor not found!" << endl;
         return -1;
     }
 
-    sensor->Open();
-    sensor->get_CoordinateMapper(&coordinateMapper);
+    sensor->get_CoordinateMapper(coordinateMapper.put());
 
-    IColorFrameSource* colorSource = nullptr;
-    sensor->get_ColorFrameSource(&colorSource);
-    colorSource->OpenReader(&colorFrameReader);
-
-    IBodyFrameSource* bodySource = nullptr;
-    sensor->get_BodyFrameSource(&bodySource);
-    bodySource->OpenReader(&bodyFrameReader);
-
-    cv::namedWindow("Time Up and Go Test", cv::WINDOW_AUTOSIZE);
+    //acquisition, color conversion and display run on their own threads, the test logic below gets every body frame
+    FramePipeline pipeline;
+    if (!pipeline.start(sensor.get(), FrameSourceTypes_Color | FrameSourceTypes_Body, "Time Up and Go Test")) {
+        return -1;
+    }
+    BodyFrame bodyFrame;
+    OverlayList overlay;
+    PROFILE_SESSION("Time_Up_and_Go_Test");
     double elapsedSeconds = 0.0;
     // Format elapsedSeconds to 2 decimal places
     std::ostringstream stream;
     stream << std::fixed << std::setprecision(2) << elapsedSeconds;
     std::string elapsedStr = stream.str();
 
-    UINT64 trackedID = 0;  // Track the first participant
-    bool isTrackingLocked = false;  // Ensure tracking remains locked
-
-    while (true) {
-        IColorFrame* colorFrame = nullptr;
-        HRESULT hrColor = colorFrameReader->AcquireLatestFrame(&colorFrame);
-
-        if (SUCCEEDED(hrColor)) {
-            IFrameDescription* frameDescription = nullptr;
-            colorFrame->get_FrameDescription(&frameDescription);
-
-            int width, height;
-            frameDescription->get_Width(&width);
-            frameDescription->get_Height(&height);
-
-            UINT bufferSize = width * height * 4;
-            BYTE* colorBuffer = new BYTE[bufferSize];
-            hrColor = colorFrame->CopyConvertedFrameDataToArray(bufferSize, colorBuffer, ColorImageFormat_Bgra);
-
-            if (SUCCEEDED(hrColor)) {
-                cv::Mat colorMat(height, width, CV_8UC4, colorBuffer);
-                cv::Mat bgrMat;
-                cv::cvtColor(colorMat, bgrMat, cv::COLOR_BGRA2BGR);
-
-                IBodyFrame* bodyFrame = nullptr;
-                HRESULT hrBody = bodyFrameReader->AcquireLatestFrame(&bodyFrame);
-
-                if (SUCCEEDED(hrBody)) {
-                    IBody* bodies[BODY_COUNT] = { 0 };
-                    hrBody = bodyFrame->GetAndRefreshBodyData(_countof(bodies), bodies);
-
-                    for (int i = 0; i < BODY_COUNT; ++i) {
-                        IBody* body = bodies[i];
-                        if (body) {
-                            BOOLEAN isTracked = false;
-                            body->get_IsTracked(&isTracked);
-                            if (isTracked) {
-                                UINT64 currentID;
-                                body->get_TrackingId(&currentID);
-
-                                if (!isTrackingLocked) {
-                                    trackedID = currentID;
-                                    isTrackingLocked = true;
-                                    std::cout << "Participant Locked: " << trackedID << std::endl;
-                                }
-                                else if (trackedID != currentID) {
-                                    // If a new person is detected, terminate the program
-                                    std::cout << "Test Invalidated! New person detected." << std::endl;
-                                    exit(0);
-                                }
+    //the participant followed by tracking ID, bystanders never take over the test
+    TrackingLock trackingLock;
+
+    //reference table for the percentile shown at the end of the test
+    NormativeTable normativeTable;
+    normativeTable.load("averaged_data.csv");
+    participantIdentity.load("participants.csv");
+    NormativeScore normativeScore;
+    std::string normativeText;
+    station.load("station_profile.csv");
+
+    while (pipeline.isRunning()) {
+        overlay.clear();
+
+        //R in the window re-arms the test for the next trial, it applies from this frame on
+        int key = pipeline.takeKey();
+        if (key == 'r' || key == 'R') {
+            rearmTest();
+            calibrationFailed = false;
+            trackingLock.release();
+            elapsedSeconds = 0.0;
+            normativeScore = NormativeScore();
+            normativeText.clear();
+            DIAG_INFO("Test re-armed for the next trial");
+            speak("Ready for the next trial");
+        }
+        //Y and N answer the question of a participant left unidentified (Identity_Ambiguous): the nearest, or someone new
+        if ((key == 'y' || key == 'Y') && participantIdentity.confirmCandidate()) {
+            DIAG_INFO("Participant confirmed by the operator: {}", participantIdentity.participantId());
+        }
+        if ((key == 'n' || key == 'N') && participantIdentity.confirmNew()) {
+            DIAG_INFO("New participant enrolled by the operator: {}", participantIdentity.participantId());
+        }
+        if (participantIdentity.awaitingConfirmation()) {
+            overlayText(overlay, (FrameText() << "Participant " << participantIdentity.ambiguousWith() << "? Y yes, N new participant").c_str(),
+                cv::Point(50, 1000), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 255), 2);
+        }
+        //C calibrates the chair position, the participant sits still on the chair for a few seconds
+        if (key == 'c' || key == 'C') {
+            rearmTest();
+            chairCalibration.begin();
+            isCalibrating = true;
+            calibrationFailed = false;
+            DIAG_INFO("Chair calibration started");
+            speak("Calibration, please sit still on the chair");
+        }
+
+        int width = pipeline.colorWidth;
+        int height = pipeline.colorHeight;
 
-                                Joint joints[JointType_Count];
-                                body->GetJoints(_countof(joints), joints);
+        if (pipeline.nextBodyFrame(bodyFrame)) {
+            BodySnapshot* bodies = bodyFrame.bodies;
+            //sensor time of this body frame (s), the TUG timer runs on it
+            double frameSeconds = bodyFrame.relativeTime * 1e-7;
 
-                                std::vector<cv::Point> jointPoints;
-                                JointType upperBodyJoints[] = {
-                                    JointType_Head, JointType_Neck, JointType_SpineShoulder, JointType_SpineMid,
-                                    JointType_ShoulderLeft, JointType_ShoulderRight
-                                };
+            kinematics.clear();
+            for (int i = 0; i < BODY_COUNT; ++i) {
+                if (bodies[i].isTracked) kinematics.addBody(i, bodies[i].joints, bodies[i].orientations);
+            }
+            kinematics.compute();
+
+            //a calibration that does not complete in time leaves the gates as they were and tells the operator
+            if (isCalibrating && chairCalibration.timedOut(frameSeconds)) {
+                isCalibrating = false;
+                calibrationFailed = true;
+                DIAG_WARNING("Chair calibration failed: not seated still for 3 s within {} s, the gates are unchanged", chairCalibration.timeout);
+                speak("Calibration failed, please press C to try again");
+            }
+            if (calibrationFailed) {
+                overlayText(overlay, "Calibration failed, sit still and press C to try again", cv::Point(50, 900), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 255), 2);
+            }
 
-                                for (JointType jt : upperBodyJoints) {
-                                    if (joints[jt].TrackingState == TrackingState_Tracked) {
-                                        ColorSpacePoint colorPoint;
-                                        coordinateMapper->MapCameraPointToColorSpace(joints[jt].Position, &colorPoint);
+            //the locked participant among the six bodies; someone entering during a timed attempt invalidates only that
+            //attempt, the lock stays and a completed result is kept
+            int lockedBody = trackingLock.update(bodies);
+            if (trackingLock.newlyLocked()) DIAG_INFO("Participant Locked: {}", trackingLock.id());
+            if (trackingLock.newcomer() && isTestStarted && !isTestCompleted) {
+                DIAG_WARNING("Test Invalidated! New person detected.");
+                speak("Test invalidated, new person detected");
+                rearmTest();
+                elapsedSeconds = 0.0;
+            }
+            if (trackingLock.locked() && lockedBody < 0) {
+                overlayText(overlay, "Participant not in view, R re-arms for the next one", cv::Point(50, 950), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 255), 2);
+            }
 
-                                        int x = static_cast<int>(colorPoint.X);
-                                        int y = static_cast<int>(colorPoint.Y);
+            for (int i = 0; i < BODY_COUNT; ++i) {
+                BodySnapshot* body = &bodies[i];
+                if (body && i == lockedBody) {
+                    BOOLEAN isTracked = false;
+                    body->get_IsTracked(&isTracked);
+                    if (isTracked) {
+                        Joint joints[JointType_Count];
+                        body->GetJoints(_countof(joints), joints);
+                        PROFILE_STAGE_BEGIN(Stage_TestLogic);
+
+                        //bone length signature of this participant, matched to the day's participants and watched for a swap
+                        switch (participantIdentity.update(joints)) {
+                        case Identity_Matched:
+                            DIAG_INFO("Participant identified: {} ({} cm)", participantIdentity.participantId(), participantIdentity.matchedDistance() * 100.0f);
+                            break;
+                        case Identity_Enrolled:
+                            DIAG_INFO("New participant enrolled: {}", participantIdentity.participantId());
+                            break;
+                        case Identity_Ambiguous:
+                            DIAG_WARNING("Participant not identified: {} cm from {}, not clearly the same participant, Y or N in the window", participantIdentity.matchedDistance() * 100.0f,
+                                participantIdentity.ambiguousWith());
+                            break;
+                        case Identity_Swapped:
+                            DIAG_WARNING("Participant swap! {} no longer matches the skeleton, now like: {}", participantIdentity.participantId(),
+                                participantIdentity.recentMatch());
+                            break;
+                        default:
+                            break;
+                        }
 
-                                        if (x > 0 && x < width && y > 0 && y < height) {
-                                            jointPoints.push_back(cv::Point(x, y));
-                                        }
-                                    }
-                                }
+                        PROFILE_STAGE_BEGIN(Stage_Mapping);
+                        ArenaVector<cv::Point> jointPoints(frameArena());
+                        jointPoints.reserve(JointType_Count);
+                        JointType upperBodyJoints[] = {
+                            JointType_Head, JointType_Neck, JointType_SpineShoulder, JointType_SpineMid,
+                            JointType_ShoulderLeft, JointType_ShoulderRight
+                        };
 
-                                if (!jointPoints.empty()) {
-                                    cv::Rect boundingRect = cv::boundingRect(jointPoints);
-                                    cv::rectangle(bgrMat, boundingRect, cv::Scalar(0, 255, 0), 2);
-                                }
+                        for (JointType jt : upperBodyJoints) {
+                            if (joints[jt].TrackingState == TrackingState_Tracked) {
+                                ColorSpacePoint colorPoint;
+                                coordinateMapper->MapCameraPointToColorSpace(joints[jt].Position, &colorPoint);
 
-                                std::ostringstream stream;
-                                stream << std::fixed << std::setprecision(2) << joints[JointType_SpineMid].Position.Z;
-                                std::string depthStr = stream.str();
-                                cv::putText(bgrMat, "Depth: " + depthStr + "m", cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
-
-                                //print person detected sitting on the chair
-                                 //if mid spine Z is approximately at 4m depth, and hip and knee joint roughly align within threshold defined
-                                if (joints[JointType_SpineMid].Position.Z <= 4.5f && joints[JointType_SpineMid].Position.Z >= 4.3f && !isTestStarted && !isTestCompleted) {
-
-                                    if (joints[JointType_HipRight].Position.Y - joints[JointType_KneeRight].Position.Y < rightLegThresholdY &&
-                                        joints[JointType_HipLeft].Position.Y - joints[JointType_KneeLeft].Position.Y < leftLegThresholdY &&
-                                        joints[JointType_HipRight].Position.X - joints[JointType_KneeRight].Position.X < rightLegThresholdX &&
-                                        joints[JointType_HipLeft].Position.X - joints[JointType_KneeLeft].Position.X < leftLegThresholdX
-                                        && !isPersonDetected) {
-                                        isPersonDetected = true;
-                                        // cout << "Person detected sitting on the chair at depth of 4 meters" << endl;
-                                        speak("Test ready please stand up");
-                                        //cout << "Please Be Ready to Stand Up" << endl;
-
-                                        //speech API to speak the message
-                                        //speak("Person detected sitting on the chair. Test Ready");
-                                        //speak("Please Stand up");
-
-                                        //note initial mid spine x,y,z coordinates
-                                        initialMidSpineX = joints[JointType_SpineMid].Position.X;
-                                        initialMidSpineY = joints[JointType_SpineMid].Position.Y;
-                                        initialMidSpineZ = joints[JointType_SpineMid].Position.Z;
-                                        // print y coordinates of mid spine
-                                        //cout << "Initial Mid Spine Y Coordinate: " << initialMidSpineY << endl;
-
-                                    }
-                                    //put text person deteccted sitting on chair Test Ready
-                                    cv::putText(bgrMat, "Test Ready", cv::Point(50, 100), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                                int x = static_cast<int>(colorPoint.X);
+                                int y = static_cast<int>(colorPoint.Y);
 
+                                if (x > 0 && x < width && y > 0 && y < height) {
+                                    jointPoints.push_back(cv::Point(x, y));
                                 }
+                            }
+                        }
 
+                        PROFILE_STAGE_END(Stage_Mapping);
 
-                                //if person stands up, then start the timer
-                                if (isPersonDetected && joints[JointType_SpineMid].Position.Y - initialMidSpineY > 0.05f &&
-                                    joints[JointType_KneeLeft].Position.X - joints[JointType_HipLeft].Position.X < standingHipsThreshold &&
-                                    joints[JointType_KneeRight].Position.X - joints[JointType_HipRight].Position.X < standingHipsThreshold
-                                    && !isTestStarted) {
-                                    isTestStarted = true;
-                                    //start timer by calling the function
-                                    startTimer(joints[JointType_SpineMid].Position.Z, joints[JointType_SpineMid].Position.Y);
-                                    //start dynamic timer on screen
-                                    //cout << "Timer Started" << endl;
-                                    //speak("Timer Started");
+                        PROFILE_STAGE_BEGIN(Stage_Overlay);
+                        if (!jointPoints.empty()) {
+                            cv::Rect boundingRect = cv::boundingRect(pointsView(jointPoints));
+                            overlayRectangle(overlay, boundingRect, cv::Scalar(0, 255, 0), 2);
+                        }
 
-                                }
-                                //display dynamic timer on screen
+                        overlayText(overlay, (FrameText() << "Depth: " << decimals(joints[JointType_SpineMid].Position.Z, 2) << "m").c_str(), cv::Point(50, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
 
-                                if (isTestStarted && !isTestCompleted)
-                                {
-                                    // Inside your main loop, after the timer starts and before cv::imshow
+                        //hip and knee joints roughly aligned within the thresholds defined
+                        bool seatedPosture = joints[JointType_HipRight].Position.Y - joints[JointType_KneeRight].Position.Y < rightLegThresholdY &&
+                            joints[JointType_HipLeft].Position.Y - joints[JointType_KneeLeft].Position.Y < leftLegThresholdY &&
+                            joints[JointType_HipRight].Position.X - joints[JointType_KneeRight].Position.X < rightLegThresholdX &&
+                            joints[JointType_HipLeft].Position.X - joints[JointType_KneeLeft].Position.X < leftLegThresholdX;
 
-                                    if (isTestStarted && !isTestCompleted) {
-                                        auto currentTime = std::chrono::steady_clock::now();
-                                        auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime - startTime).count();
-                                        float elapsedSeconds = elapsedMs / 1000.0f;
+                        //and the thighs bent against the trunk, a participant standing close to the chair is not seated
+                        const BodyKinematics& bodyAngles = kinematics.body(i);
+                        for (KinematicAngle hip : { Angle_HipFlexionLeft, Angle_HipFlexionRight }) {
+                            if (bodyAngles.confidence[hip] >= kinematicsConfidence && bodyAngles.angle[hip] < seatedHipFlexion) seatedPosture = false;
+                        }
+                        overlayText(overlay, (FrameText() << "Hip: " << decimals(bodyAngles.angle[Angle_HipFlexionLeft], 0) << " / " << decimals(bodyAngles.angle[Angle_HipFlexionRight], 0)
+                            << "  Knee: " << decimals(bodyAngles.angle[Angle_KneeFlexionLeft], 0) << " / " << decimals(bodyAngles.angle[Angle_KneeFlexionRight], 0)).c_str(),
+                            cv::Point(50, 200), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+
+                        //calibration: the seated SpineMid depth over a few seconds sets every gate of the station
+                        if (isCalibrating) {
+                            if (seatedPosture && joints[JointType_SpineMid].TrackingState == TrackingState_Tracked) {
+                                if (chairCalibration.add(joints[JointType_SpineMid].Position.Z)) {
+                                    isCalibrating = false;
+                                    station.setChairDepth(chairCalibration.chairDepth());
+                                    station.save("station_profile.csv");
+                                    DIAG_INFO("Chair calibrated at {} m, turn-around between {} and {} m", chairCalibration.chairDepth(), station.tugTurn.low, station.tugTurn.high);
+                                    speak("Calibration complete");
+                                }
+                            }
+                            else {
+                                chairCalibration.reset();
+                            }
+                            overlayText(overlay, (FrameText() << "Calibrating, stay seated: " << static_cast<int>(chairCalibration.progress() * 100.0f) << "%").c_str(),
+                                cv::Point(50, 100), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            break;
+                        }
 
-                                        // Display the dynamic timer on the live feed
-                                        std::string timerText = "Timer: " + std::to_string(elapsedSeconds) + "s";
-                                        cv::putText(bgrMat, timerText, cv::Point(50, 500), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
-                                    }
-                                    //display message on live feed
-                                    cv::putText(bgrMat, "Test Started", cv::Point(50, 100), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                        //print person detected sitting on the chair
+                         //if mid spine Z is at the chair depth of the station, and hip and knee joint roughly align
+                        if (station.tugSeated.contains(joints[JointType_SpineMid].Position.Z) && !isTestStarted && !isTestCompleted) {
 
-                                }
+                            if (seatedPosture && !isPersonDetected) {
+                                isPersonDetected = true;
+                                // cout << "Person detected sitting on the chair at depth of 4 meters" << endl;
+                                speak("Test ready please stand up");
+                                //cout << "Please Be Ready to Stand Up" << endl;
 
-                                //if person reaches target depth of 1m, then print the message
-                                if (isTestStarted && joints[JointType_SpineMid].Position.Z < 1.5f && joints[JointType_SpineMid].Position.Z > 1.3f && !isTargetDepthReached) {
-                                    isTargetDepthReached = true;
-                                    //cout << "Target depth reached: " << joints[JointType_SpineMid].Position.Z << "m" << endl;
-                                    // speak("Target depth reached, Please Turn around");
-                                }
-                                if (isTargetDepthReached && !isTestCompleted)
-                                {
-                                    //display message on live feed
-                                    cv::putText(bgrMat, "Target depth reached", cv::Point(50, 150), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                                //speech API to speak the message
+                                //speak("Person detected sitting on the chair. Test Ready");
+                                //speak("Please Stand up");
 
-                                }
-                                // stop timer if hips align with knee again, and mid spine depth is 4m
-                                if (isTestStarted && joints[JointType_HipRight].Position.Y - joints[JointType_KneeRight].Position.Y < rightLegThreshold &&
-                                    joints[JointType_HipLeft].Position.Y - joints[JointType_KneeLeft].Position.Y < leftLegThreshold &&
-                                    joints[JointType_SpineMid].Position.Z < 4.5f && joints[JointType_SpineMid].Position.Z > 4.2f &&
-                                    !isTestCompleted && isTargetDepthReached)
-                                {
-                                    isTestCompleted = true;
-                                    speak("Test Completed");
-                                    stopTimer(joints[JointType_SpineMid].Position.Z, joints[JointType_SpineMid].Position.Y);
-                                    //store the timer value in a variable
-                                    elapsedSeconds = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count() / 1000.0f;
-                                    elapsedSeconds = std::round(elapsedSeconds * 100) / 100.0f;  // Rounds to 2 decimal places
-                                    //call the function to log the time
-                                    cout << "Maximum Time: " << elapsedSeconds << "s" << endl;
-                                    logTUGTestTime(std::vector<double>{elapsedSeconds});
-
-                                    //log the time in a file
-                                    //display test complete on live feed  
+                                //note initial mid spine x,y,z coordinates
+                                initialMidSpineX = joints[JointType_SpineMid].Position.X;
+                                initialMidSpineY = joints[JointType_SpineMid].Position.Y;
+                                initialMidSpineZ = joints[JointType_SpineMid].Position.Z;
+                                // print y coordinates of mid spine
+                                //cout << "Initial Mid Spine Y Coordinate: " << initialMidSpineY << endl;
 
-                                }
-                                // now to reset the test, all the flags
-                                if (isTestCompleted) {
+                            }
+                            //put text person deteccted sitting on chair Test Ready
+                            overlayText(overlay, "Test Ready", cv::Point(50, 100), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
 
-                                    // Display test completion messages
-                                    cv::putText(bgrMat, "Test Completed!", cv::Point(50, 100), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
-                                    //display elapsedSeconds on live feed
-                                    cv::putText(bgrMat, "Maximum Time: " + std::to_string(elapsedSeconds) + "s", cv::Point(50, 500), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                        }
 
-                                }
 
+                        //if person stands up, then start the timer
+                        if (isPersonDetected && joints[JointType_SpineMid].Position.Y - initialMidSpineY > 0.05f &&
+                            joints[JointType_KneeLeft].Position.X - joints[JointType_HipLeft].Position.X < standingHipsThreshold &&
+                            joints[JointType_KneeRight].Position.X - joints[JointType_HipRight].Position.X < standingHipsThreshold
+                            && !isTestStarted) {
+                            isTestStarted = true;
+                            //start timer by calling the function
+                            startTimer(joints[JointType_SpineMid].Position.Z, joints[JointType_SpineMid].Position.Y, frameSeconds);
+                            //start dynamic timer on screen
+                            //cout << "Timer Started" << endl;
+                            //speak("Timer Started");
 
-                                break;
+                        }
+                        //display dynamic timer on screen
+
+                        if (isTestStarted && !isTestCompleted)
+                        {
+                            // Inside your main loop, after the timer starts and before cv::imshow
 
+                            if (isTestStarted && !isTestCompleted) {
+                                float runningSeconds = static_cast<float>(frameSeconds - startTime);
 
+                                // Display the dynamic timer on the live feed
+                                overlayText(overlay, (FrameText() << "Timer: " << decimals(runningSeconds, 2) << "s").c_str(), cv::Point(50, 500), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
                             }
+                            //display message on live feed
+                            overlayText(overlay, "Test Started", cv::Point(50, 100), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+
                         }
-                    }
 
+                        //if person reaches the turn-around target, then print the message
+                        if (isTestStarted && joints[JointType_SpineMid].Position.Z < station.tugTurn.high && joints[JointType_SpineMid].Position.Z > station.tugTurn.low && !isTargetDepthReached) {
+                            isTargetDepthReached = true;
+                            //cout << "Target depth reached: " << joints[JointType_SpineMid].Position.Z << "m" << endl;
+                            // speak("Target depth reached, Please Turn around");
+                        }
+                        if (isTargetDepthReached && !isTestCompleted)
+                        {
+                            //display message on live feed
+                            overlayText(overlay, "Target depth reached", cv::Point(50, 150), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
 
+                        }
+                        // stop timer if hips align with knee again, and mid spine depth is back at the chair
+                        if (isTestStarted && joints[JointType_HipRight].Position.Y - joints[JointType_KneeRight].Position.Y < rightLegThreshold &&
+                            joints[JointType_HipLeft].Position.Y - joints[JointType_KneeLeft].Position.Y < leftLegThreshold &&
+                            joints[JointType_SpineMid].Position.Z < station.tugReturn.high && joints[JointType_SpineMid].Position.Z > station.tugReturn.low &&
+                            !isTestCompleted && isTargetDepthReached)
+                        {
+                            isTestCompleted = true;
+                            speak("Test Completed");
+                            stopTimer(joints[JointType_SpineMid].Position.Z, joints[JointType_SpineMid].Position.Y, frameSeconds);
+                            //store the timer value in a variable
+                            elapsedSeconds = endTime - startTime;
+                            elapsedSeconds = std::round(elapsedSeconds * 100) / 100.0f;  // Rounds to 2 decimal places
+                            //call the function to log the time
+                            DIAG_INFO("Maximum Time: {}s", elapsedSeconds);
+                            normativeScore = normativeTable.score(Norm_TimedUpGo, static_cast<float>(elapsedSeconds));
+                            normativeText = formatNormativeScore(normativeScore);
+                            logTUGTestTime({ elapsedSeconds }, normativeScore, participantIdentity);
+
+                            //log the time in a file
+                            //display test complete on live feed  
 
-                    for (int i = 0; i < BODY_COUNT; ++i) {
-                        if (bodies[i]) {
-                            bodies[i]->Release();
                         }
-                    }
+                        //results stay on screen until R re-arms the test (rearmTest)
+                        if (isTestCompleted) {
 
-                    bodyFrame->Release();
-                }
+                            // Display test completion messages
+                            overlayText(overlay, "Test Completed!", cv::Point(50, 100), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            //display elapsedSeconds on live feed
+                            overlayText(overlay, (FrameText() << "Maximum Time: " << decimals(elapsedSeconds, 2) << "s").c_str(), cv::Point(50, 500), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
+                            //display the normative percentile of the result
+                            overlayText(overlay, normativeText, cv::Point(50, 550), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(0, 0, 0), 2);
 
-                cv::imshow("Time Up and Go Test", bgrMat);
-            }
+                        }
 
-            delete[] colorBuffer;
-        }
 
-        if (colorFrame) {
-            colorFrame->Release();
+                        break;
 
-        }
 
-        if (cv::waitKey(30) == 13) {
-            break;
+                    }
+                }
+            }
         }
+
+        pipeline.publishOverlay(overlay);
+        frameArena().reset();
+        PROFILE_FRAME_END();
     }
 
-    sensor->Close();
+    pipeline.stop();
     cv::destroyAllWindows();
     return 0;
 }
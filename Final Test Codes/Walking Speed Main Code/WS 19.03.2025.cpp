@@ -4,39 +4,46 @@
 #include <opencv2/opencv.hpp>
 #include <deque>
 #include <numeric>
+#include <cmath>
 #include <chrono>
 #include <iomanip>
 #include<iostream>
 #include <fstream>
 #include <vector>
+#include <algorithm>
 #include <filesystem>  // C++17 for checking file existence
+#include "../Common/NormativeScoring.h"
+#include "../Common/FrameProfiler.h"
+#include "../Common/OverlayRenderer.h"
+#include "../Common/FrameArena.h"
+#include "../Common/DiagnosticLog.h"
+#include "../Common/KinectLease.h"
+#include "../Common/FramePipeline.h"
+#include "../Common/DepthPersonTracker.h"
+#include "../Common/WalkingSpeedEstimator.h"
+#include "../Common/StationProfile.h"
+#include "../Common/ParticipantIdentity.h"
 
 using namespace std;
 
 #pragma comment(lib, "kinect20.lib")
 
-template<class Interface>
-inline void SafeRelease(Interface*& interfaceToRelease) {
-    if (interfaceToRelease) {
-        interfaceToRelease->Release();
-        interfaceToRelease = nullptr;
-    }
-}
+// Moving average filter over the last smoothingWindowSize depths
+const size_t smoothingWindowSize = 10; // Adjust smoothing window size as needed
+typedef FrameRing<float, smoothingWindowSize> DepthHistory;
 
-// Moving average filter
-float getSmoothedDepth(std::deque<float>& depthQueue, float newDepth, size_t windowSize) {
-    depthQueue.push_back(newDepth);
-    if (depthQueue.size() > windowSize) {
-        depthQueue.pop_front();
-    }
-    float sum = std::accumulate(depthQueue.begin(), depthQueue.end(), 0.0f);
+float getSmoothedDepth(DepthHistory& depthQueue, float newDepth) {
+    depthQueue.push(newDepth);
+    float sum = 0.0f;
+    for (size_t i = 0; i < depthQueue.size(); ++i) sum += depthQueue[i];
     return sum / depthQueue.size();
 }
 
 // Timer variables
 bool isTiming = false;
-std::chrono::steady_clock::time_point startTime;
-std::chrono::steady_clock::time_point endTime;
+// Depth frame times (s) of the timer start and stop, the walk is timed by the sensor clock
+double startTime = 0.0;
+double endTime = 0.0;
 
 // Helper function to calculate the moving average of a deque
 float calculateMovingAverage(const std::deque<float>& values) {
@@ -47,60 +54,132 @@ float calculateMovingAverage(const std::deque<float>& values) {
 
 // Timer logic for walking test
 // Variables for displaying timer information
-std::string timerMessage = "";
-std::string timerStartedMessage = "";
-std::string timerStoppedMessage = "";
-std::string liveDepthMessage = "";
+FrameText timerStartedMessage;
+FrameText timerStoppedMessage;
+FrameText liveDepthMessage;
 float timerStartDepth = 0.0f;
 float timerStopDepth = 0.0f;
 float finalElapsedSeconds = 0.0f; // Store final elapsed time
+float previousGateDepth = 0.0f; // smoothed depth of the previous frame, for the gate crossings
+
+// Speed over the constant velocity part of the walk, fed while the timer runs
+WalkingSpeedEstimator walkingSpeed;
+float finalSteadySpeed = 0.0f; // m/s, 0 when the walk had no steady segment
 
-void logWalkingSpeedTestTime(const std::vector<double>& testTimes) {
+// Reference table for the percentile of the final time
+NormativeTable normativeTable;
+std::string normativeMessage = "";
+
+// Start and stop gates of this station, C in the window calibrates them from the markers in the empty corridor
+StationProfile station;
+CorridorMarkerCalibration markerCalibration;
+bool isCalibrating = false;
+bool calibrationFailed = false; // the last attempt timed out or found no markers, shown until R or C
+
+// Bone length signature matched to the day's participants (participants.csv), its ID goes into the result record
+ParticipantIdentifier participantIdentity;
+
+void logWalkingSpeedTestTime(std::initializer_list<double> testTimes, const NormativeScore& score, float steadySpeed,
+    const ParticipantIdentifier& identity) {
     std::string filename = "Walking_Speed_Test_Results_2.csv";
 
-    std::ofstream outfile(filename, std::ios::trunc);  // Open file in truncate mode (overwrite)
+    // Check if the file exists, the header is written only to a new file
+    std::ifstream infile(filename);
+    bool fileExists = infile.good();
+    infile.close();
+
+    std::ofstream outfile(filename, std::ios::app);  // Open file in append mode, every trial is kept
     if (!outfile.is_open()) {
         std::cerr << "Error: Could not open the file for writing.\n";
         return;
     }
 
-    // Write header
-    outfile << "Walking Speed Test 2 (s)\n";
+    // Write header only if file is new
+    if (!fileExists) {
+        outfile << "Walking Speed Test 2 (s),Percentile,Z Score,Steady Speed (m/s)" << participantColumnsHeader << "\n";
+    }
 
-    // Save only the latest test time
-    if (!testTimes.empty()) {
-        outfile << testTimes.back() << "\n";
+    // Append the latest test time in a new row, with its normative score
+    if (testTimes.size() > 0) {
+        outfile << *(testTimes.end() - 1) << ",";
+        if (score.valid) {
+            outfile << score.percentile << "," << score.zScore;
+        }
+        else {
+            outfile << "NULL,NULL";
+        }
+        outfile << ",";
+        if (steadySpeed > 0.0f) outfile << steadySpeed;
+        else outfile << "NULL";
+        writeParticipantColumns(outfile, identity);
+        outfile << "\n";
     }
 
     outfile.close();
 }
 
-void processWalkingTest(float depth, std::string& timerMessage) {
-    // Check for start condition (depth between 7.5m and 7.51m)
-    if (!isTiming && depth >= 6.5f && depth <= 6.8f) {
+// Depth inside the gate, or stepped over it towards the sensor since the previous frame
+bool crossedGate(float previous, float depth, float low, float high) {
+    return (depth >= low && depth <= high) || (previous > high && depth < low && depth > 0.0f);
+}
+
+void processWalkingTest(float depth, double frameSeconds) {
+    // Check for start condition (depth inside the start gate, 6.5m to 6.8m by default)
+    if (!isTiming && crossedGate(previousGateDepth, depth, station.wsStart.low, station.wsStart.high)) {
         isTiming = true;
-        startTime = std::chrono::steady_clock::now();
-        timerStartedMessage = "Test Started! Depth: " + std::to_string(depth).substr(0, 4) + "m";
-        std::cout << "Timer Started! Depth: " << depth << endl;
+        startTime = frameSeconds;
+        walkingSpeed.reset();
+        timerStartedMessage.clear();
+        timerStartedMessage << "Test Started! Depth: " << leadingDigits(depth, 4) << "m";
+        DIAG_INFO("Timer Started! Depth: {}", depth);
     }
 
-    // Check for stop condition (depth between 2.5m and 2.51m)
-    if (isTiming && depth >= 1.5f && depth <= 1.6f) {
-        endTime = std::chrono::steady_clock::now();
+    // Check for stop condition (depth inside the stop gate, 1.5m to 1.6m by default)
+    if (isTiming && crossedGate(previousGateDepth, depth, station.wsStop.low, station.wsStop.high)) {
+        endTime = frameSeconds;
         isTiming = false;
 
         // Calculate elapsed time
-        auto elapsedTime = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
-        finalElapsedSeconds = elapsedTime / 1000.0f; // Save the final elapsed time
+        finalElapsedSeconds = static_cast<float>(endTime - startTime); // Save the final elapsed time
 
-        timerStoppedMessage = "Test Completed! Depth: " + std::to_string(depth).substr(0, 4) + "m";
-        std::cout << "Timer Stopped! Depth: " << depth << "\nTime: " << finalElapsedSeconds << " s" << std::endl;
-        logWalkingSpeedTestTime(std::vector<double>{finalElapsedSeconds});
+        timerStoppedMessage.clear();
+        timerStoppedMessage << "Test Completed! Depth: " << leadingDigits(depth, 4) << "m";
+        finalSteadySpeed = walkingSpeed.hasSteadySpeed() ? walkingSpeed.steadySpeed() : 0.0f;
+        DIAG_INFO("Timer Stopped! Depth: {} Time: {} s Steady speed: {} m/s", depth, finalElapsedSeconds, finalSteadySpeed);
+        NormativeScore score = normativeTable.score(Norm_WalkingSpeed, finalElapsedSeconds);
+        normativeMessage = formatNormativeScore(score);
+        logWalkingSpeedTestTime({ finalElapsedSeconds }, score, finalSteadySpeed, participantIdentity);
 
     }
 
+    previousGateDepth = depth;
+
     // Display live depth value
-    liveDepthMessage = "Depth: " + std::to_string(depth).substr(0, 4) + "m";
+    liveDepthMessage.clear();
+    liveDepthMessage << "Depth: " << leadingDigits(depth, 4) << "m";
+}
+
+// SpineMid of the tracked body nearest to the depth track (nearest to the sensor without a track) and all joints of that
+// body in nearestJoints, false when no body is tracked
+bool nearestSpineMid(const BodySnapshot* bodies, const DepthTrack& track, CameraSpacePoint& spineMid, Joint* nearestJoints) {
+    bool found = false;
+    float bestDistance = 0.0f;
+    for (int i = 0; i < BODY_COUNT; ++i) {
+        BOOLEAN tracked = false;
+        if (FAILED(bodies[i].get_IsTracked(&tracked)) || !tracked) continue;
+        Joint joints[JointType_Count];
+        if (FAILED(bodies[i].GetJoints(JointType_Count, joints))) continue;
+        const Joint& joint = joints[JointType_SpineMid];
+        if (joint.TrackingState != TrackingState_Tracked) continue;
+        float distance = track.valid ? std::fabs(joint.Position.X - track.x) + std::fabs(joint.Position.Z - track.z) : joint.Position.Z;
+        if (!found || distance < bestDistance) {
+            spineMid = joint.Position;
+            std::copy(joints, joints + JointType_Count, nearestJoints);
+            bestDistance = distance;
+            found = true;
+        }
+    }
+    return found;
 }
 
 //flags for test status
@@ -108,155 +187,247 @@ bool testReady = false;
 bool testStarted = false;
 bool testCompleted = false;
 
+//clears the timer and the messages of the last trial, the next walk starts a new timing
+void rearmTest() {
+    isTiming = false;
+    startTime = endTime = 0.0;
+    timerStartedMessage.clear();
+    timerStoppedMessage.clear();
+    timerStartDepth = timerStopDepth = 0.0f;
+    finalElapsedSeconds = 0.0f;
+    previousGateDepth = 0.0f;
+    walkingSpeed.reset();
+    finalSteadySpeed = 0.0f;
+    normativeMessage.clear();
+    testReady = testStarted = testCompleted = false;
+    participantIdentity.reset();
+}
+
 
 int main() {
-    // Initialize Kinect sensor
-    IKinectSensor* kinectSensor = nullptr;
-    HRESULT hr = GetDefaultKinectSensor(&kinectSensor);
+    // Initialize Kinect sensor, every interface below is released when main returns, on every return path
+    KinectSensorLease kinectSensor;
 
-    if (FAILED(hr) || !kinectSensor) {
+    if (!kinectSensor.open()) {
         std::cerr << "Failed to initialize Kinect sensor!" << std::endl;
         return -1;
     }
 
-    hr = kinectSensor->Open();
-    if (FAILED(hr)) {
-        std::cerr << "Failed to open Kinect sensor!" << std::endl;
-        return -1;
-    }
-
-    // Depth frame reader
-    IDepthFrameReader* depthFrameReader = nullptr;
-    IDepthFrameSource* depthFrameSource = nullptr;
-
-    hr = kinectSensor->get_DepthFrameSource(&depthFrameSource);
-    if (FAILED(hr) || !depthFrameSource) {
-        std::cerr << "Failed to get Depth Frame Source!" << std::endl;
-        return -1;
-    }
-
-    hr = depthFrameSource->OpenReader(&depthFrameReader);
-    if (FAILED(hr) || !depthFrameReader) {
-        std::cerr << "Failed to open Depth Frame Reader!" << std::endl;
-        return -1;
-    }
-
-    // Color frame reader
-    IColorFrameReader* colorFrameReader = nullptr;
-    IColorFrameSource* colorFrameSource = nullptr;
-
-    hr = kinectSensor->get_ColorFrameSource(&colorFrameSource);
-    if (FAILED(hr) || !colorFrameSource) {
-        std::cerr << "Failed to get Color Frame Source!" << std::endl;
-        return -1;
-    }
-
-    hr = colorFrameSource->OpenReader(&colorFrameReader);
-    if (FAILED(hr) || !colorFrameReader) {
-        std::cerr << "Failed to open Color Frame Reader!" << std::endl;
+    // Load the normative reference table and the gates of the station once, before the test starts
+    normativeTable.load("averaged_data.csv");
+    participantIdentity.load("participants.csv");
+    station.load("station_profile.csv");
+
+    // Coordinate mapper, its depth-to-camera table gives the marker calibration its camera space points
+    ComLease<ICoordinateMapper> coordinateMapper;
+    kinectSensor->get_CoordinateMapper(coordinateMapper.put());
+
+    // Depth frames go from the acquisition thread to the test logic below, every one of them: the gates are crossed
+    // and the walk is timed on depth frames. The consumer only copies the frame, a full queue drops it.
+    SpscQueue<DepthFrame> depthFrames{ 4 };
+    StageSignal depthSignal;
+    DepthFrame acquiredDepth; // acquisition thread
+    acquiredDepth.data.resize(DepthPersonTracker::depthWidth * DepthPersonTracker::depthHeight);
+    uint64_t depthFramesDropped = 0; // acquisition thread
+
+    //acquisition, color conversion and display run on their own threads, the test logic below gets every depth frame
+    FramePipeline pipeline;
+    pipeline.depthConsumer = [&](const UINT16* depth, TIMESPAN time) {
+        acquiredDepth.relativeTime = time;
+        std::copy(depth, depth + acquiredDepth.data.size(), acquiredDepth.data.begin());
+        if (depthFrames.tryPush(acquiredDepth)) depthSignal.notify();
+        else ++depthFramesDropped;
+    };
+    if (!pipeline.start(kinectSensor.get(), FrameSourceTypes_Color | FrameSourceTypes_Depth | FrameSourceTypes_Body, "Walking Speed Test")) {
         return -1;
     }
+    PROFILE_SESSION("Walking_Speed_Test");
 
     // Depth frame properties
-    int depthWidth = 0, depthHeight = 0;
-    IFrameDescription* depthFrameDescription = nullptr;
-    depthFrameSource->get_FrameDescription(&depthFrameDescription);
-    depthFrameDescription->get_Width(&depthWidth);
-    depthFrameDescription->get_Height(&depthHeight);
-    SafeRelease(depthFrameDescription);
+    const int depthWidth = DepthPersonTracker::depthWidth;
+    const int depthHeight = DepthPersonTracker::depthHeight;
 
     // Depth buffer and smoothing
-    std::vector<UINT16> depthBuffer(depthWidth * depthHeight);
-    std::deque<float> depthQueue; // To store depth values for smoothing
-    const size_t smoothingWindowSize = 10; // Adjust smoothing window size as needed
+    DepthFrame depthFrame; // sized by the first frame taken from the queue and reused
+    uint64_t depthSeen = 0;
+    DepthHistory depthQueue; // To store depth values for smoothing
+    DepthPersonTracker depthTracker; // follows the walker from 8 m, learns the empty corridor over the first second
+    bool trackerRaysCalibrated = false; // the tracker uses the nominal depth camera until the mapper has the sensor's calibration
+    bool walkerTracked = false;
+    BodyFrame bodyFrame; // the latest body frame, kept when no new one is ready
+    OverlayList overlay; // messages in color frame coordinates, drawn scaled by the display thread
 
     // Main loop
-    // Main loop
-    while (true) {
-        // Get Depth Frame and process
-        IDepthFrame* depthFrame = nullptr;
-        hr = depthFrameReader->AcquireLatestFrame(&depthFrame);
-
-        if (SUCCEEDED(hr)) {
-            hr = depthFrame->CopyFrameDataToArray(static_cast<UINT>(depthBuffer.size()), &depthBuffer[0]);
-
-            if (SUCCEEDED(hr)) {
-                // Find the closest depth value in the center of the frame
-                int centerX = depthWidth / 2;
-                int centerY = depthHeight / 2;
-                int index = centerY * depthWidth + centerX;
-                UINT16 depthValue = depthBuffer[index];
-
-                // Convert depth to meters and smooth it
-                float depthInMeters = depthValue * 0.001f;
-                float smoothedDepth = getSmoothedDepth(depthQueue, depthInMeters, smoothingWindowSize);
-
-                // Process the walking test timer
-                processWalkingTest(smoothedDepth, timerMessage);
-
-                // Get color frame for live feed
-                IColorFrame* colorFrame = nullptr;
-                hr = colorFrameReader->AcquireLatestFrame(&colorFrame);
-
-                if (SUCCEEDED(hr)) {
-                    int colorWidth = 0, colorHeight = 0;
-                    IFrameDescription* colorFrameDescription = nullptr;
-                    colorFrame->get_FrameDescription(&colorFrameDescription);
-                    colorFrameDescription->get_Width(&colorWidth);
-                    colorFrameDescription->get_Height(&colorHeight);
-                    SafeRelease(colorFrameDescription);
-
-                    // Prepare frame buffer
-                    std::vector<BYTE> colorBuffer(colorWidth * colorHeight * 4); // BGRA
-                    hr = colorFrame->CopyConvertedFrameDataToArray(static_cast<UINT>(colorBuffer.size()), colorBuffer.data(), ColorImageFormat_Bgra);
-
-                    if (SUCCEEDED(hr)) {
-                        // Create OpenCV Mat and display it
-                        cv::Mat colorMat(colorHeight, colorWidth, CV_8UC4, colorBuffer.data());
-
-                        // Display the messages
-                        cv::putText(colorMat, liveDepthMessage, cv::Point(50, 50), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
-                        if (!timerStartedMessage.empty()) {
-                            cv::putText(colorMat, timerStartedMessage, cv::Point(50, 100),
-                                cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
-                        }
-                        if (!timerStoppedMessage.empty()) {
-                            cv::putText(colorMat, timerStoppedMessage, cv::Point(50, 150),
-                                cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
-                            //data log this value by calling the function
-
-                        }
-                        if (isTiming) {
-                            auto currentTime = std::chrono::steady_clock::now();
-                            auto elapsedTime = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime - startTime).count();
-                            float elapsedSeconds = elapsedTime / 1000.0f;
-                            cv::putText(colorMat, "Timer: " + std::to_string(elapsedSeconds).substr(0, 5) + "s",
-                                cv::Point(50, 200), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
-                        }
-                        else if (finalElapsedSeconds > 0.0f) {
-                            cv::putText(colorMat, "Final Time: " + std::to_string(finalElapsedSeconds).substr(0, 5) + "s",
-                                cv::Point(50, 200), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
-                        }
-
-                        // Display the frame
-                        cv::imshow("Walking Speed Test", colorMat);
-                        if (cv::waitKey(30) == 13) break; // Exit on ESC key
-                    }
+    while (pipeline.isRunning()) {
+        int key = pipeline.takeKey();
+        //R re-arms the test for the next trial, from the next frame on
+        if (key == 'r' || key == 'R') {
+            rearmTest();
+            calibrationFailed = false;
+            depthQueue.clear();
+            depthTracker.rearm();
+            DIAG_INFO("Test re-armed for the next trial");
+        }
+        //C calibrates the start and stop gates, nobody in the corridor, the markers on the lines
+        if (key == 'c' || key == 'C') {
+            rearmTest();
+            depthQueue.clear();
+            depthTracker.rearm();
+            markerCalibration.begin();
+            markerCalibration.floorFitter.rays.fromMapper(coordinateMapper.get());
+            isCalibrating = true;
+            calibrationFailed = false;
+            DIAG_INFO("Corridor calibration started");
+        }
+        //Y and N answer the question of a participant left unidentified (Identity_Ambiguous): the nearest, or someone new
+        if ((key == 'y' || key == 'Y') && participantIdentity.confirmCandidate()) {
+            DIAG_INFO("Participant confirmed by the operator: {}", participantIdentity.participantId());
+        }
+        if ((key == 'n' || key == 'N') && participantIdentity.confirmNew()) {
+            DIAG_INFO("New participant enrolled by the operator: {}", participantIdentity.participantId());
+        }
+
+        // Skeletons of the latest body frame, every queued body frame is taken so acquisition never waits on them
+        while (pipeline.nextBodyFrame(bodyFrame, 0)) {}
+
+        if (!depthFrames.tryPop(depthFrame)) {
+            depthSignal.wait(depthSeen, 10);
+            continue;
+        }
+        const UINT16* depthBuffer = depthFrame.data.data();
+        TIMESPAN depthTime = depthFrame.relativeTime;
+
+        // Walker depth: depth tracker far away, skeleton close, the center pixel when neither finds anybody
+        PROFILE_STAGE_BEGIN(Stage_TestLogic);
+        //the mapper has the depth-to-camera table only after the first frames, the marker calibration shares it
+        if (!trackerRaysCalibrated && markerCalibration.floorFitter.rays.fromMapper(coordinateMapper.get())) {
+            depthTracker.setRays(markerCalibration.floorFitter.rays);
+            trackerRaysCalibrated = true;
+            DIAG_INFO("Depth tracker uses the sensor's depth calibration");
+        }
+        const DepthTrack& track = depthTracker.update(depthBuffer, depthTime);
+        if (track.valid != walkerTracked) {
+            walkerTracked = track.valid;
+            if (walkerTracked) DIAG_INFO("Walker found by the depth tracker at {} m", track.z);
+            else DIAG_WARNING("Depth tracker lost the walker");
+        }
+        CameraSpacePoint spineMid = { 0.0f, 0.0f, 0.0f };
+        Joint joints[JointType_Count];
+        bool bodyTracked = nearestSpineMid(bodyFrame.bodies, track, spineMid, joints);
+        if (bodyTracked) {
+            //bone length signature of this participant, matched to the day's participants and watched for a swap
+            switch (participantIdentity.update(joints)) {
+            case Identity_Matched:
+                DIAG_INFO("Participant identified: {} ({} cm)", participantIdentity.participantId(), participantIdentity.matchedDistance() * 100.0f);
+                break;
+            case Identity_Enrolled:
+                DIAG_INFO("New participant enrolled: {}", participantIdentity.participantId());
+                break;
+            case Identity_Ambiguous:
+                DIAG_WARNING("Participant not identified: {} cm from {}, not clearly the same participant, Y or N in the window", participantIdentity.matchedDistance() * 100.0f,
+                    participantIdentity.ambiguousWith());
+                break;
+            case Identity_Swapped:
+                DIAG_WARNING("Participant swap! {} no longer matches the skeleton, now like: {}", participantIdentity.participantId(),
+                    participantIdentity.recentMatch());
+                break;
+            default:
+                break;
+            }
+        }
+        float depthInMeters = depthTracker.handoff(spineMid, bodyTracked);
+        if (depthInMeters <= 0.0f) {
+            int index = (depthHeight / 2) * depthWidth + depthWidth / 2;
+            depthInMeters = depthBuffer[index] * 0.001f;
+        }
+        float smoothedDepth = getSmoothedDepth(depthQueue, depthInMeters);
+
+        // Calibration: the markers of the empty corridor set the gates, the timer waits meanwhile
+        if (isCalibrating) {
+            if (markerCalibration.add(depthBuffer)) {
+                isCalibrating = false;
+                float nearMarker = 0.0f, farMarker = 0.0f;
+                if (markerCalibration.markers(nearMarker, farMarker)) {
+                    station.setCorridorMarkers(nearMarker, farMarker);
+                    station.save("station_profile.csv");
+                    DIAG_INFO("Corridor calibrated, start marker at {} m, stop marker at {} m", farMarker, nearMarker);
                 }
+                else {
+                    calibrationFailed = true;
+                    DIAG_WARNING("Calibration did not find the start and stop markers, the gates are unchanged");
+                }
+            }
+            else if (markerCalibration.timedOut(depthTime * 1e-7)) {
+                isCalibrating = false;
+                calibrationFailed = true;
+                DIAG_WARNING("Corridor calibration failed: {} within {} s, the gates are unchanged",
+                    markerCalibration.floorFound() ? "not enough frames of the empty corridor" : "no floor found", markerCalibration.timeout);
+            }
+        }
+        else {
+            // Process the walking test timer
+            processWalkingTest(smoothedDepth, depthTime * 1e-7);
+            if (isTiming) walkingSpeed.add(depthTime * 1e-7, depthInMeters);
+        }
+        PROFILE_STAGE_END(Stage_TestLogic);
+
+        // Display the messages, drawn on the newest color frame by the display thread
+        PROFILE_STAGE_BEGIN(Stage_Overlay);
+        overlay.clear();
+        overlayText(overlay, liveDepthMessage.c_str(), cv::Point(50, 50), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
+        if (isCalibrating) {
+            overlayText(overlay, (FrameText() << (markerCalibration.floorFound() ? "Calibrating, keep the corridor clear: " : "Calibrating, looking for the floor: ")
+                << static_cast<int>(markerCalibration.progress() * 100.0f) << "%").c_str(),
+                cv::Point(50, 100), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
+        }
+        if (calibrationFailed) {
+            overlayText(overlay, "Calibration failed, clear the corridor, check the markers and press C to try again",
+                cv::Point(50, 100), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 255), 2);
+        }
+        if (!timerStartedMessage.empty()) {
+            overlayText(overlay, timerStartedMessage.c_str(), cv::Point(50, 100),
+                cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
+        }
+        if (!timerStoppedMessage.empty()) {
+            overlayText(overlay, timerStoppedMessage.c_str(), cv::Point(50, 150),
+                cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
+            //data log this value by calling the function
 
-                SafeRelease(colorFrame);
+        }
+        if (isTiming) {
+            float elapsedSeconds = static_cast<float>(depthTime * 1e-7 - startTime);
+            overlayText(overlay, (FrameText() << "Timer: " << leadingDigits(elapsedSeconds, 5) << "s").c_str(),
+                cv::Point(50, 200), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
+            if (walkingSpeed.hasWindowSpeed()) {
+                FrameText speedText;
+                speedText << "Speed: " << decimals(walkingSpeed.windowSpeed(), 2) << " m/s";
+                if (walkingSpeed.hasSteadySpeed()) speedText << " (steady " << decimals(walkingSpeed.steadySpeed(), 2) << " m/s)";
+                overlayText(overlay, speedText.c_str(), cv::Point(50, 300), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
             }
         }
+        else if (finalElapsedSeconds > 0.0f) {
+            overlayText(overlay, (FrameText() << "Final Time: " << leadingDigits(finalElapsedSeconds, 5) << "s").c_str(),
+                cv::Point(50, 200), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
+            overlayText(overlay, normativeMessage, cv::Point(50, 250),
+                cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
+            if (finalSteadySpeed > 0.0f) {
+                overlayText(overlay, (FrameText() << "Steady Speed: " << decimals(finalSteadySpeed, 2) << " m/s").c_str(),
+                    cv::Point(50, 300), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
+            }
+        }
+        if (participantIdentity.awaitingConfirmation()) {
+            overlayText(overlay, (FrameText() << "Participant " << participantIdentity.ambiguousWith() << "? Y yes, N new participant").c_str(),
+                cv::Point(50, 1000), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 255), 2);
+        }
+        PROFILE_STAGE_END(Stage_Overlay);
+        pipeline.publishOverlay(overlay);
 
-        SafeRelease(depthFrame);
+        frameArena().reset();
+        PROFILE_FRAME_END();
     }
-    // Clean up
-    SafeRelease(depthFrameReader);
-    SafeRelease(depthFrameSource);
-    SafeRelease(colorFrameReader);
-    SafeRelease(colorFrameSource);
-    if (kinectSensor) kinectSensor->Close();
-    SafeRelease(kinectSensor);
+    // Clean up: the pipeline stops its threads, the sensor is released by its lease
+    pipeline.stop();
+    if (depthFramesDropped) DIAG_WARNING("{} depth frames dropped, the test logic fell behind", depthFramesDropped);
 
     return 0;
 }